@@ -0,0 +1,151 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sustain/framework/net/Service.h>
+#include <sustain/framework/net/Uri.h>
+#include <sustain/framework/net/patterns/pub_sub/Forwarder.h>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/signal_set.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/program_options.hpp>
+
+//!
+//! pfc_forwarder re-fans a Pub/Sub feed. Subscribers connect to the forwarder instead of the
+//! publisher, and forwarders may connect to each other to build a fan out tree.
+//!
+//!   pfc_forwarder -u tcp://sim-host:5600 -d tcp://*:5700 --name physiology.fanout --advertise tcp://10.0.0.7:5700
+//!
+int main(int argc, const char* argv[])
+{
+  namespace bpo = boost::program_options;
+  bpo::options_description options("Allowed options");
+  options.add_options()("help,h", "Produce help message") //
+    ("upstream,u", bpo::value<std::vector<std::string>>()->required(), "Publisher or forwarder to forward from. May be repeated to merge feeds") //
+    ("downstream,d", bpo::value<std::vector<std::string>>()->required(), "Endpoint subscribers connect to. May be repeated") //
+    ("topic,t", bpo::value<std::vector<std::string>>(), "Prefix of the messages to forward. May be repeated. Default forwards everything") //
+    ("name,n", bpo::value<std::string>()->default_value(""), "Register the forwarder with the registry under this name. Empty does not register") //
+    ("advertise,a", bpo::value<std::string>()->default_value(""), "tcp URI subscribers should use, required with --name") //
+    ("brief", bpo::value<std::string>()->default_value("Pub/Sub forwarder"), "Description registered with --name") //
+    ("bind,b", bpo::value<std::string>()->default_value("0::0"), "Multicast bind address used to reach the registry") //
+    ("multicast,m", bpo::value<std::string>()->default_value("ff31::8000:1234"), "Registry multicast address");
+
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::parse_command_line(argc, argv, options), vm);
+    if (vm.count("help")) {
+      std::cout << options << "\n";
+      return 1;
+    }
+    bpo::notify(vm);
+  } catch (const bpo::error& err) {
+    std::cerr << err.what() << "\n"
+              << options << "\n";
+    return 1;
+  }
+
+  auto upstreams = vm["upstream"].as<std::vector<std::string>>();
+  auto downstreams = vm["downstream"].as<std::vector<std::string>>();
+  std::vector<std::string> topics { "" };
+  if (vm.count("topic")) {
+    topics = vm["topic"].as<std::vector<std::string>>();
+  }
+
+  pfc::PubSub_Forwarder forwarder(pfc::URI(upstreams.front()), pfc::URI(downstreams.front()), topics.front());
+  if (!forwarder.is_valid()) {
+    BOOST_LOG_TRIVIAL(error) << "Unable to forward " << upstreams.front() << " to " << downstreams.front() << " " << forwarder.error();
+    return 1;
+  }
+  //A feed silently missing one of the endpoints or topics asked for is worse than not starting
+  for (size_t i = 1; i < upstreams.size(); ++i) {
+    auto ec = forwarder.connect(pfc::URI(upstreams[i]));
+    if (!ec.is_ok()) {
+      BOOST_LOG_TRIVIAL(error) << "Unable to connect to upstream " << upstreams[i] << " " << ec;
+      return 1;
+    }
+  }
+  std::vector<pfc::URI> local_endpoints;
+  for (size_t i = 1; i < downstreams.size(); ++i) {
+    pfc::URI downstream(downstreams[i]);
+    auto ec = forwarder.bind(downstream);
+    if (!ec.is_ok()) {
+      BOOST_LOG_TRIVIAL(error) << "Unable to bind downstream " << downstreams[i] << " " << ec;
+      return 1;
+    }
+    if (downstream.transport() == "inproc" || downstream.transport() == "ipc") {
+      local_endpoints.push_back(std::move(downstream));
+    }
+  }
+  for (size_t i = 1; i < topics.size(); ++i) {
+    auto ec = forwarder.subscribe(topics[i]);
+    if (!ec.is_ok()) {
+      BOOST_LOG_TRIVIAL(error) << "Unable to subscribe to topic " << topics[i] << " " << ec;
+      return 1;
+    }
+  }
+
+  std::unique_ptr<pfc::Service> registration;
+  auto name = vm["name"].as<std::string>();
+  if (!name.empty()) {
+    pfc::URI advertised(vm["advertise"].as<std::string>());
+    if (!advertised.is_valid() || advertised.port().empty()) {
+      std::cerr << "--name requires --advertise with the tcp://address:port subscribers should connect to\n";
+      return 1;
+    }
+    //URI has no default constructor, so Config is built whole. Every field is given, in declaration order
+    pfc::Service::Config config {
+      pfc::Service::Config::pub_sub, //style
+      static_cast<uint16_t>(advertised.port_i()), //port
+      name, //name
+      advertised, //address
+      vm["brief"].as<std::string>(), //brief
+      local_endpoints, //local_endpoints
+    };
+    registration = std::make_unique<pfc::Service>(config, vm["bind"].as<std::string>(), vm["multicast"].as<std::string>());
+    registration->start();
+  }
+
+  boost::asio::io_context context;
+  boost::asio::signal_set signals(context);
+  signals.add(SIGINT);
+  signals.add(SIGTERM);
+#if defined(SIGQUIT)
+  signals.add(SIGQUIT);
+#endif
+  signals.async_wait([&](const boost::system::error_code& ec, int /*no*/) {
+    if (!ec) {
+      BOOST_LOG_TRIVIAL(info) << "Stopping forwarder";
+      forwarder.shutdown();
+    }
+  });
+  std::thread signal_thread([&context]() { context.run(); });
+
+  BOOST_LOG_TRIVIAL(info) << "Forwarding " << upstreams.front() << " to " << downstreams.front();
+  auto ec = forwarder.forward();
+  if (!ec.is_ok()) {
+    BOOST_LOG_TRIVIAL(error) << "Forwarding stopped " << ec;
+  }
+
+  if (registration) {
+    registration->stop();
+    registration->join();
+  }
+  context.stop();
+  signal_thread.join();
+  return (ec.is_ok()) ? 0 : 1;
+}
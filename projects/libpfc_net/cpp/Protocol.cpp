@@ -35,13 +35,16 @@ pfc_service_announcement::~pfc_service_announcement()
   _name.resize(0);
   _address.resize(0);
   _brief.resize(0);
+  _endpoints.resize(0);
+  _host.resize(0);
 };
 //-----------------------------------------------------------------------------
 // \return size_t length of message once serialized
 size_t pfc_service_announcement::Length() const
 {
   size_t length = size_of_pfc_type<
-    decltype(_message_type), decltype(_port), decltype(_protacol), decltype(_name), decltype(_address), decltype(_brief)>(_message_type, _port, _protacol, _name, _address, _brief);
+    decltype(_message_type), decltype(_port), decltype(_protacol), decltype(_name), decltype(_address), decltype(_brief),
+    decltype(_endpoints), decltype(_host), decltype(_process)>(_message_type, _port, _protacol, _name, _address, _brief, _endpoints, _host, _process);
   return length;
 }
 //-----------------------------------------------------------------------------
@@ -58,7 +61,8 @@ Error pfc_service_announcement::serialize(std::ostream& os) const
 {
 
   return serialize_pfc_type<
-    decltype(_message_type), decltype(_port), decltype(_protacol), decltype(_name), decltype(_address), decltype(_brief)>(os, _message_type, _port, _protacol, _name, _address, _brief);
+    decltype(_message_type), decltype(_port), decltype(_protacol), decltype(_name), decltype(_address), decltype(_brief),
+    decltype(_endpoints), decltype(_host), decltype(_process)>(os, _message_type, _port, _protacol, _name, _address, _brief, _endpoints, _host, _process);
 }
 //-----------------------------------------------------------------------------
 //! Deserializes a given pfc_service_announcement from an istream
@@ -67,7 +71,8 @@ Error pfc_service_announcement::serialize(std::ostream& os) const
 Error pfc_service_announcement::deserialize(std::istream& is)
 {
   return deserialize_pfc_type<
-    decltype(_message_type), decltype(_port), decltype(_protacol), decltype(_name), decltype(_address), decltype(_brief)>(is, _message_type, _port, _protacol, _name, _address, _brief);
+    decltype(_message_type), decltype(_port), decltype(_protacol), decltype(_name), decltype(_address), decltype(_brief),
+    decltype(_endpoints), decltype(_host), decltype(_process)>(is, _message_type, _port, _protacol, _name, _address, _brief, _endpoints, _host, _process);
 }
 
 //! ostream oeprator for pfc_service_announcement messages
@@ -76,8 +81,11 @@ std::ostream& operator<<(std::ostream& os, const pfc_service_announcement& msg)
   os << "pfc_service_announcement("
      << "name=" << msg._name << ","
      << " address=" << msg._protacol << "://" << msg._address << ":" << msg._port << ","
-     << " brief=" << msg._brief
-     << ")";
+     << " brief=" << msg._brief;
+  if (!msg._endpoints.empty()) {
+    os << ", endpoints=" << msg._endpoints;
+  }
+  os << ")";
   return os;
 }
 //-----------------------------------------------------------------------------
@@ -93,7 +101,10 @@ bool operator==(const pfc_service_announcement& lhs, const pfc_service_announcem
     && lhs._port == rhs._port
     && lhs._name == rhs._name
     && lhs._address == rhs._address
-    && lhs._brief == rhs._brief;
+    && lhs._brief == rhs._brief
+    && lhs._endpoints == rhs._endpoints
+    && lhs._host == rhs._host
+    && lhs._process == rhs._process;
 }
 //-----------------------------------------------------------------------
 bool operator!=(const pfc_service_announcement& lhs, const pfc_service_announcement& rhs)
@@ -479,4 +490,683 @@ bool operator!=(const pfc_heartbeat_response& lhs, const pfc_heartbeat_response&
 {
   return !(lhs == rhs);
 }
+//-----------------------------------------------------------------------------
+//! Registry Digest
+//! \brief: Periodic anti-entropy summary of a registry table sent to peer registries
+//
+pfc_registry_digest::~pfc_registry_digest()
+{
+  _buckets.resize(0);
+};
+//-----------------------------------------------------------------------------
+// \return size_t length of message once serialized
+size_t pfc_registry_digest::Length() const
+{
+  size_t length = size_of_pfc_type<
+    decltype(_message_type), decltype(_registry_id), decltype(_entry_count), decltype(_root), decltype(_buckets)>(_message_type, _registry_id, _entry_count, _root, _buckets);
+  return length;
+}
+//-----------------------------------------------------------------------------
+// \return pfc_uint -- Message Type
+pfc_uint pfc_registry_digest::Type() const
+{
+  return _message_type;
+}
+//-----------------------------------------------------------------------------
+//! Serializes a given pfc_registry_digest to an ostream
+// \param os [IN,OUT] -- Outbound stream to contains a message
+// \return Error -- Success() unless an Error occured during deserialization
+Error pfc_registry_digest::serialize(std::ostream& os) const
+{
+  return serialize_pfc_type<
+    decltype(_message_type), decltype(_registry_id), decltype(_entry_count), decltype(_root), decltype(_buckets)>(os, _message_type, _registry_id, _entry_count, _root, _buckets);
+}
+//-----------------------------------------------------------------------------
+//! Deserializes a given pfc_registry_digest from an istream
+// \param is [IN,OUT] -- Input stream that contains a message
+// \return Error -- Success() unless an Error occured during deserialization
+Error pfc_registry_digest::deserialize(std::istream& is)
+{
+  return deserialize_pfc_type<
+    decltype(_message_type), decltype(_registry_id), decltype(_entry_count), decltype(_root), decltype(_buckets)>(is, _message_type, _registry_id, _entry_count, _root, _buckets);
+}
+
+//! ostream oeprator for pfc_registry_digest messages
+std::ostream& operator<<(std::ostream& os, const pfc_registry_digest& msg)
+{
+  os << "pfc_registry_digest("
+     << "registry=" << msg._registry_id << ","
+     << " entries=" << msg._entry_count << ","
+     << " root=" << msg._root << ","
+     << " buckets=" << msg._buckets.size()
+     << ")";
+  return os;
+}
+//-----------------------------------------------------------------------------
+//!
+//!  comparison of mesages
+//!
+//-----------------------------------------------------------------------
+bool operator==(const pfc_registry_digest& lhs, const pfc_registry_digest& rhs)
+{
+  return lhs._message_type == rhs._message_type
+    && lhs._registry_id == rhs._registry_id
+    && lhs._entry_count == rhs._entry_count
+    && lhs._root == rhs._root
+    && lhs._buckets == rhs._buckets;
+}
+//-----------------------------------------------------------------------
+bool operator!=(const pfc_registry_digest& lhs, const pfc_registry_digest& rhs)
+{
+  return !(lhs == rhs);
+}
+
+//-----------------------------------------------------------------------------
+//! Registry Sync Request
+//! \brief: Asks a peer registry to resend every entry in the listed digest buckets
+//
+pfc_registry_sync_request::~pfc_registry_sync_request()
+{
+  _buckets.resize(0);
+};
+//-----------------------------------------------------------------------------
+// \return size_t length of message once serialized
+size_t pfc_registry_sync_request::Length() const
+{
+  size_t length = size_of_pfc_type<
+    decltype(_message_type), decltype(_registry_id), decltype(_target_id), decltype(_buckets)>(_message_type, _registry_id, _target_id, _buckets);
+  return length;
+}
+//-----------------------------------------------------------------------------
+// \return pfc_uint -- Message Type
+pfc_uint pfc_registry_sync_request::Type() const
+{
+  return _message_type;
+}
+//-----------------------------------------------------------------------------
+//! Serializes a given pfc_registry_sync_request to an ostream
+// \param os [IN,OUT] -- Outbound stream to contains a message
+// \return Error -- Success() unless an Error occured during deserialization
+Error pfc_registry_sync_request::serialize(std::ostream& os) const
+{
+  return serialize_pfc_type<
+    decltype(_message_type), decltype(_registry_id), decltype(_target_id), decltype(_buckets)>(os, _message_type, _registry_id, _target_id, _buckets);
+}
+//-----------------------------------------------------------------------------
+//! Deserializes a given pfc_registry_sync_request from an istream
+// \param is [IN,OUT] -- Input stream that contains a message
+// \return Error -- Success() unless an Error occured during deserialization
+Error pfc_registry_sync_request::deserialize(std::istream& is)
+{
+  return deserialize_pfc_type<
+    decltype(_message_type), decltype(_registry_id), decltype(_target_id), decltype(_buckets)>(is, _message_type, _registry_id, _target_id, _buckets);
+}
+
+//! ostream oeprator for pfc_registry_sync_request messages
+std::ostream& operator<<(std::ostream& os, const pfc_registry_sync_request& msg)
+{
+  os << "pfc_registry_sync_request("
+     << "registry=" << msg._registry_id << ","
+     << " target=" << msg._target_id << ","
+     << " buckets=" << msg._buckets.size()
+     << ")";
+  return os;
+}
+//-----------------------------------------------------------------------------
+//!
+//!  comparison of mesages
+//!
+//-----------------------------------------------------------------------
+bool operator==(const pfc_registry_sync_request& lhs, const pfc_registry_sync_request& rhs)
+{
+  return lhs._message_type == rhs._message_type
+    && lhs._registry_id == rhs._registry_id
+    && lhs._target_id == rhs._target_id
+    && lhs._buckets == rhs._buckets;
+}
+//-----------------------------------------------------------------------
+bool operator!=(const pfc_registry_sync_request& lhs, const pfc_registry_sync_request& rhs)
+{
+  return !(lhs == rhs);
+}
+
+//-----------------------------------------------------------------------------
+//! Registry Sync Response
+//! \brief: A single versioned registry entry sent in reply to a pfc_registry_sync_request
+//
+pfc_registry_sync_response::~pfc_registry_sync_response()
+{
+  _name.resize(0);
+  _address.resize(0);
+  _brief.resize(0);
+};
+//-----------------------------------------------------------------------------
+// \return size_t length of message once serialized
+size_t pfc_registry_sync_response::Length() const
+{
+  size_t length = size_of_pfc_type<
+    decltype(_message_type), decltype(_registry_id), decltype(_version), decltype(_removed), decltype(_port), decltype(_protacol), decltype(_name), decltype(_address), decltype(_brief)>(_message_type, _registry_id, _version, _removed, _port, _protacol, _name, _address, _brief);
+  return length;
+}
+//-----------------------------------------------------------------------------
+// \return pfc_uint -- Message Type
+pfc_uint pfc_registry_sync_response::Type() const
+{
+  return _message_type;
+}
+//-----------------------------------------------------------------------------
+//! Serializes a given pfc_registry_sync_response to an ostream
+// \param os [IN,OUT] -- Outbound stream to contains a message
+// \return Error -- Success() unless an Error occured during deserialization
+Error pfc_registry_sync_response::serialize(std::ostream& os) const
+{
+  return serialize_pfc_type<
+    decltype(_message_type), decltype(_registry_id), decltype(_version), decltype(_removed), decltype(_port), decltype(_protacol), decltype(_name), decltype(_address), decltype(_brief)>(os, _message_type, _registry_id, _version, _removed, _port, _protacol, _name, _address, _brief);
+}
+//-----------------------------------------------------------------------------
+//! Deserializes a given pfc_registry_sync_response from an istream
+// \param is [IN,OUT] -- Input stream that contains a message
+// \return Error -- Success() unless an Error occured during deserialization
+Error pfc_registry_sync_response::deserialize(std::istream& is)
+{
+  return deserialize_pfc_type<
+    decltype(_message_type), decltype(_registry_id), decltype(_version), decltype(_removed), decltype(_port), decltype(_protacol), decltype(_name), decltype(_address), decltype(_brief)>(is, _message_type, _registry_id, _version, _removed, _port, _protacol, _name, _address, _brief);
+}
+
+//! ostream oeprator for pfc_registry_sync_response messages
+std::ostream& operator<<(std::ostream& os, const pfc_registry_sync_response& msg)
+{
+  os << "pfc_registry_sync_response("
+     << "registry=" << msg._registry_id << ","
+     << " version=" << msg._version << ","
+     << " removed=" << (msg._removed ? "true" : "false") << ","
+     << " name=" << msg._name << ","
+     << " address=" << msg._protacol << "://" << msg._address << ":" << msg._port << ","
+     << " brief=" << msg._brief
+     << ")";
+  return os;
+}
+//-----------------------------------------------------------------------------
+//!
+//!  comparison of mesages
+//!
+//-----------------------------------------------------------------------
+bool operator==(const pfc_registry_sync_response& lhs, const pfc_registry_sync_response& rhs)
+{
+  return lhs._message_type == rhs._message_type
+    && lhs._registry_id == rhs._registry_id
+    && lhs._version == rhs._version
+    && lhs._removed == rhs._removed
+    && lhs._protacol == rhs._protacol
+    && lhs._port == rhs._port
+    && lhs._name == rhs._name
+    && lhs._address == rhs._address
+    && lhs._brief == rhs._brief;
+}
+//-----------------------------------------------------------------------
+bool operator!=(const pfc_registry_sync_response& lhs, const pfc_registry_sync_response& rhs)
+{
+  return !(lhs == rhs);
+}
+//-----------------------------------------------------------------------------
+//!
+//!  Operator for seralizing pfc_registry_change to ostreams
+//!
+std::ostream& operator<<(std::ostream& os, const pfc_registry_change& rhs)
+{
+  switch (rhs) {
+  case registry_added:
+    os << "added";
+    break;
+  case registry_updated:
+    os << "updated";
+    break;
+  case registry_removed:
+    os << "removed";
+    break;
+  default:
+    os << "unknown";
+    break;
+  }
+  return os;
+}
+//-----------------------------------------------------------------------------
+//! \param protocol [IN] -- Protocol of the service
+//! \param name [IN] -- Name of the service
+//! \return pfc_string -- Watch feed topic of a service "<protocol>/<name>"
+pfc_string registry_topic(pfc_protocol protocol, const pfc_string& name)
+{
+  return ((protocol == pub_sub) ? "pub_sub/" : "req_rep/") + name;
+}
+//-----------------------------------------------------------------------------
+//! Registry Delta
+//! \brief: Published on the registry watch feed for every change to the registry table
+//
+pfc_registry_delta::~pfc_registry_delta()
+{
+  _name.resize(0);
+  _address.resize(0);
+  _brief.resize(0);
+};
+//-----------------------------------------------------------------------------
+// \return size_t length of message once serialized
+size_t pfc_registry_delta::Length() const
+{
+  size_t length = size_of_pfc_type<
+    decltype(_message_type), decltype(_sequence), decltype(_change), decltype(_version), decltype(_port), decltype(_protacol), decltype(_name), decltype(_address), decltype(_brief)>(_message_type, _sequence, _change, _version, _port, _protacol, _name, _address, _brief);
+  return length;
+}
+//-----------------------------------------------------------------------------
+// \return pfc_uint -- Message Type
+pfc_uint pfc_registry_delta::Type() const
+{
+  return _message_type;
+}
+//-----------------------------------------------------------------------------
+//! Serializes a given pfc_registry_delta to an ostream
+// \param os [IN,OUT] -- Outbound stream to contains a message
+// \return Error -- Success() unless an Error occured during deserialization
+Error pfc_registry_delta::serialize(std::ostream& os) const
+{
+  return serialize_pfc_type<
+    decltype(_message_type), decltype(_sequence), decltype(_change), decltype(_version), decltype(_port), decltype(_protacol), decltype(_name), decltype(_address), decltype(_brief)>(os, _message_type, _sequence, _change, _version, _port, _protacol, _name, _address, _brief);
+}
+//-----------------------------------------------------------------------------
+//! Deserializes a given pfc_registry_delta from an istream
+// \param is [IN,OUT] -- Input stream that contains a message
+// \return Error -- Success() unless an Error occured during deserialization
+Error pfc_registry_delta::deserialize(std::istream& is)
+{
+  return deserialize_pfc_type<
+    decltype(_message_type), decltype(_sequence), decltype(_change), decltype(_version), decltype(_port), decltype(_protacol), decltype(_name), decltype(_address), decltype(_brief)>(is, _message_type, _sequence, _change, _version, _port, _protacol, _name, _address, _brief);
+}
+
+//! ostream oeprator for pfc_registry_delta messages
+std::ostream& operator<<(std::ostream& os, const pfc_registry_delta& msg)
+{
+  os << "pfc_registry_delta("
+     << "sequence=" << msg._sequence << ","
+     << " change=" << msg._change << ","
+     << " version=" << msg._version << ","
+     << " name=" << msg._name << ","
+     << " address=" << msg._protacol << "://" << msg._address << ":" << msg._port << ","
+     << " brief=" << msg._brief
+     << ")";
+  return os;
+}
+//-----------------------------------------------------------------------------
+//!
+//!  comparison of mesages
+//!
+//-----------------------------------------------------------------------
+bool operator==(const pfc_registry_delta& lhs, const pfc_registry_delta& rhs)
+{
+  return lhs._message_type == rhs._message_type
+    && lhs._sequence == rhs._sequence
+    && lhs._change == rhs._change
+    && lhs._version == rhs._version
+    && lhs._port == rhs._port
+    && lhs._protacol == rhs._protacol
+    && lhs._name == rhs._name
+    && lhs._address == rhs._address
+    && lhs._brief == rhs._brief;
+}
+//-----------------------------------------------------------------------
+bool operator!=(const pfc_registry_delta& lhs, const pfc_registry_delta& rhs)
+{
+  return !(lhs == rhs);
+}
+//-----------------------------------------------------------------------------
+//! Registry Snapshot Request
+//! \brief: Asks a registry for every service under a watch topic prefix
+//
+pfc_registry_snapshot_request::~pfc_registry_snapshot_request()
+{
+  _topic.resize(0);
+};
+//-----------------------------------------------------------------------------
+// \return size_t length of message once serialized
+size_t pfc_registry_snapshot_request::Length() const
+{
+  size_t length = size_of_pfc_type<
+    decltype(_message_type), decltype(_topic)>(_message_type, _topic);
+  return length;
+}
+//-----------------------------------------------------------------------------
+// \return pfc_uint -- Message Type
+pfc_uint pfc_registry_snapshot_request::Type() const
+{
+  return _message_type;
+}
+//-----------------------------------------------------------------------------
+//! Serializes a given pfc_registry_snapshot_request to an ostream
+// \param os [IN,OUT] -- Outbound stream to contains a message
+// \return Error -- Success() unless an Error occured during deserialization
+Error pfc_registry_snapshot_request::serialize(std::ostream& os) const
+{
+  return serialize_pfc_type<
+    decltype(_message_type), decltype(_topic)>(os, _message_type, _topic);
+}
+//-----------------------------------------------------------------------------
+//! Deserializes a given pfc_registry_snapshot_request from an istream
+// \param is [IN,OUT] -- Input stream that contains a message
+// \return Error -- Success() unless an Error occured during deserialization
+Error pfc_registry_snapshot_request::deserialize(std::istream& is)
+{
+  return deserialize_pfc_type<
+    decltype(_message_type), decltype(_topic)>(is, _message_type, _topic);
+}
+
+//! ostream oeprator for pfc_registry_snapshot_request messages
+std::ostream& operator<<(std::ostream& os, const pfc_registry_snapshot_request& msg)
+{
+  os << "pfc_registry_snapshot_request("
+     << "topic=" << msg._topic
+     << ")";
+  return os;
+}
+//-----------------------------------------------------------------------------
+//!
+//!  comparison of mesages
+//!
+//-----------------------------------------------------------------------
+bool operator==(const pfc_registry_snapshot_request& lhs, const pfc_registry_snapshot_request& rhs)
+{
+  return lhs._message_type == rhs._message_type
+    && lhs._topic == rhs._topic;
+}
+//-----------------------------------------------------------------------
+bool operator!=(const pfc_registry_snapshot_request& lhs, const pfc_registry_snapshot_request& rhs)
+{
+  return !(lhs == rhs);
+}
+//-----------------------------------------------------------------------------
+//! Registry Snapshot Response
+//! \brief: Header of a snapshot. Followed by _count pfc_registry_delta messages
+//
+pfc_registry_snapshot_response::~pfc_registry_snapshot_response()
+{
+};
+//-----------------------------------------------------------------------------
+// \return size_t length of message once serialized
+size_t pfc_registry_snapshot_response::Length() const
+{
+  size_t length = size_of_pfc_type<
+    decltype(_message_type), decltype(_sequence), decltype(_count)>(_message_type, _sequence, _count);
+  return length;
+}
+//-----------------------------------------------------------------------------
+// \return pfc_uint -- Message Type
+pfc_uint pfc_registry_snapshot_response::Type() const
+{
+  return _message_type;
+}
+//-----------------------------------------------------------------------------
+//! Serializes a given pfc_registry_snapshot_response to an ostream
+// \param os [IN,OUT] -- Outbound stream to contains a message
+// \return Error -- Success() unless an Error occured during deserialization
+Error pfc_registry_snapshot_response::serialize(std::ostream& os) const
+{
+  return serialize_pfc_type<
+    decltype(_message_type), decltype(_sequence), decltype(_count)>(os, _message_type, _sequence, _count);
+}
+//-----------------------------------------------------------------------------
+//! Deserializes a given pfc_registry_snapshot_response from an istream
+// \param is [IN,OUT] -- Input stream that contains a message
+// \return Error -- Success() unless an Error occured during deserialization
+Error pfc_registry_snapshot_response::deserialize(std::istream& is)
+{
+  return deserialize_pfc_type<
+    decltype(_message_type), decltype(_sequence), decltype(_count)>(is, _message_type, _sequence, _count);
+}
+
+//! ostream oeprator for pfc_registry_snapshot_response messages
+std::ostream& operator<<(std::ostream& os, const pfc_registry_snapshot_response& msg)
+{
+  os << "pfc_registry_snapshot_response("
+     << "sequence=" << msg._sequence << ","
+     << " count=" << msg._count
+     << ")";
+  return os;
+}
+//-----------------------------------------------------------------------------
+//!
+//!  comparison of mesages
+//!
+//-----------------------------------------------------------------------
+bool operator==(const pfc_registry_snapshot_response& lhs, const pfc_registry_snapshot_response& rhs)
+{
+  return lhs._message_type == rhs._message_type
+    && lhs._sequence == rhs._sequence
+    && lhs._count == rhs._count;
+}
+//-----------------------------------------------------------------------
+bool operator!=(const pfc_registry_snapshot_response& lhs, const pfc_registry_snapshot_response& rhs)
+{
+  return !(lhs == rhs);
+}
+
+//-----------------------------------------------------------------------------
+//! Reliable Data
+//! \brief: Sequenced application frame multicast by a Reliable_Multicast_Sender
+//
+pfc_reliable_data::~pfc_reliable_data()
+{
+  _payload.resize(0);
+};
+//-----------------------------------------------------------------------------
+// \return size_t length of message once serialized
+size_t pfc_reliable_data::Length() const
+{
+  size_t length = size_of_pfc_type<
+    decltype(_message_type), decltype(_channel), decltype(_sequence), decltype(_retransmit), decltype(_payload)>(_message_type, _channel, _sequence, _retransmit, _payload);
+  return length;
+}
+//-----------------------------------------------------------------------------
+// \return pfc_uint -- Message Type
+pfc_uint pfc_reliable_data::Type() const
+{
+  return _message_type;
+}
+//-----------------------------------------------------------------------------
+//! Serializes a given pfc_reliable_data to an ostream
+// \param os [IN,OUT] -- Outbound stream to contains a message
+// \return Error -- Success() unless an Error occured during deserialization
+Error pfc_reliable_data::serialize(std::ostream& os) const
+{
+  return serialize_pfc_type<
+    decltype(_message_type), decltype(_channel), decltype(_sequence), decltype(_retransmit), decltype(_payload)>(os, _message_type, _channel, _sequence, _retransmit, _payload);
+}
+//-----------------------------------------------------------------------------
+//! Deserializes a given pfc_reliable_data from an istream
+// \param is [IN,OUT] -- Input stream that contains a message
+// \return Error -- Success() unless an Error occured during deserialization
+Error pfc_reliable_data::deserialize(std::istream& is)
+{
+  return deserialize_pfc_type<
+    decltype(_message_type), decltype(_channel), decltype(_sequence), decltype(_retransmit), decltype(_payload)>(is, _message_type, _channel, _sequence, _retransmit, _payload);
+}
+
+//! ostream oeprator for pfc_reliable_data messages
+std::ostream& operator<<(std::ostream& os, const pfc_reliable_data& msg)
+{
+  os << "pfc_reliable_data("
+     << "channel=" << msg._channel << ","
+     << " sequence=" << msg._sequence << ","
+     << " retransmit=" << ((msg._retransmit) ? "true" : "false") << ","
+     << " bytes=" << msg._payload.size()
+     << ")";
+  return os;
+}
+//-----------------------------------------------------------------------------
+//!
+//!  comparison of mesages
+//!
+//-----------------------------------------------------------------------
+bool operator==(const pfc_reliable_data& lhs, const pfc_reliable_data& rhs)
+{
+  return lhs._message_type == rhs._message_type
+    && lhs._channel == rhs._channel
+    && lhs._sequence == rhs._sequence
+    && lhs._retransmit == rhs._retransmit
+    && lhs._payload == rhs._payload;
+}
+//-----------------------------------------------------------------------
+bool operator!=(const pfc_reliable_data& lhs, const pfc_reliable_data& rhs)
+{
+  return !(lhs == rhs);
+}
+
+//-----------------------------------------------------------------------------
+//! Reliable Heartbeat
+//! \brief: Advertises the sequences a Reliable_Multicast_Sender has sent and can still retransmit
+//
+pfc_reliable_heartbeat::~pfc_reliable_heartbeat()
+{
+};
+//-----------------------------------------------------------------------------
+// \return size_t length of message once serialized
+size_t pfc_reliable_heartbeat::Length() const
+{
+  size_t length = size_of_pfc_type<
+    decltype(_message_type), decltype(_channel), decltype(_first), decltype(_high_water)>(_message_type, _channel, _first, _high_water);
+  return length;
+}
+//-----------------------------------------------------------------------------
+// \return pfc_uint -- Message Type
+pfc_uint pfc_reliable_heartbeat::Type() const
+{
+  return _message_type;
+}
+//-----------------------------------------------------------------------------
+//! Serializes a given pfc_reliable_heartbeat to an ostream
+// \param os [IN,OUT] -- Outbound stream to contains a message
+// \return Error -- Success() unless an Error occured during deserialization
+Error pfc_reliable_heartbeat::serialize(std::ostream& os) const
+{
+  return serialize_pfc_type<
+    decltype(_message_type), decltype(_channel), decltype(_first), decltype(_high_water)>(os, _message_type, _channel, _first, _high_water);
+}
+//-----------------------------------------------------------------------------
+//! Deserializes a given pfc_reliable_heartbeat from an istream
+// \param is [IN,OUT] -- Input stream that contains a message
+// \return Error -- Success() unless an Error occured during deserialization
+Error pfc_reliable_heartbeat::deserialize(std::istream& is)
+{
+  return deserialize_pfc_type<
+    decltype(_message_type), decltype(_channel), decltype(_first), decltype(_high_water)>(is, _message_type, _channel, _first, _high_water);
+}
+
+//! ostream oeprator for pfc_reliable_heartbeat messages
+std::ostream& operator<<(std::ostream& os, const pfc_reliable_heartbeat& msg)
+{
+  os << "pfc_reliable_heartbeat("
+     << "channel=" << msg._channel << ","
+     << " first=" << msg._first << ","
+     << " high_water=" << msg._high_water
+     << ")";
+  return os;
+}
+//-----------------------------------------------------------------------------
+//!
+//!  comparison of mesages
+//!
+//-----------------------------------------------------------------------
+bool operator==(const pfc_reliable_heartbeat& lhs, const pfc_reliable_heartbeat& rhs)
+{
+  return lhs._message_type == rhs._message_type
+    && lhs._channel == rhs._channel
+    && lhs._first == rhs._first
+    && lhs._high_water == rhs._high_water;
+}
+//-----------------------------------------------------------------------
+bool operator!=(const pfc_reliable_heartbeat& lhs, const pfc_reliable_heartbeat& rhs)
+{
+  return !(lhs == rhs);
+}
+
+//-----------------------------------------------------------------------------
+//! Reliable Nack
+//! \brief: Asks a Reliable_Multicast_Sender to multicast a range of frames again
+//
+pfc_reliable_nack::~pfc_reliable_nack()
+{
+};
+//-----------------------------------------------------------------------------
+// \return size_t length of message once serialized
+size_t pfc_reliable_nack::Length() const
+{
+  size_t length = size_of_pfc_type<
+    decltype(_message_type), decltype(_channel), decltype(_first), decltype(_count)>(_message_type, _channel, _first, _count);
+  return length;
+}
+//-----------------------------------------------------------------------------
+// \return pfc_uint -- Message Type
+pfc_uint pfc_reliable_nack::Type() const
+{
+  return _message_type;
+}
+//-----------------------------------------------------------------------------
+//! Serializes a given pfc_reliable_nack to an ostream
+// \param os [IN,OUT] -- Outbound stream to contains a message
+// \return Error -- Success() unless an Error occured during deserialization
+Error pfc_reliable_nack::serialize(std::ostream& os) const
+{
+  return serialize_pfc_type<
+    decltype(_message_type), decltype(_channel), decltype(_first), decltype(_count)>(os, _message_type, _channel, _first, _count);
+}
+//-----------------------------------------------------------------------------
+//! Deserializes a given pfc_reliable_nack from an istream
+// \param is [IN,OUT] -- Input stream that contains a message
+// \return Error -- Success() unless an Error occured during deserialization
+Error pfc_reliable_nack::deserialize(std::istream& is)
+{
+  return deserialize_pfc_type<
+    decltype(_message_type), decltype(_channel), decltype(_first), decltype(_count)>(is, _message_type, _channel, _first, _count);
+}
+
+//! ostream oeprator for pfc_reliable_nack messages
+std::ostream& operator<<(std::ostream& os, const pfc_reliable_nack& msg)
+{
+  os << "pfc_reliable_nack("
+     << "channel=" << msg._channel << ","
+     << " first=" << msg._first << ","
+     << " count=" << msg._count
+     << ")";
+  return os;
+}
+//-----------------------------------------------------------------------------
+//!
+//!  comparison of mesages
+//!
+//-----------------------------------------------------------------------
+bool operator==(const pfc_reliable_nack& lhs, const pfc_reliable_nack& rhs)
+{
+  return lhs._message_type == rhs._message_type
+    && lhs._channel == rhs._channel
+    && lhs._first == rhs._first
+    && lhs._count == rhs._count;
+}
+//-----------------------------------------------------------------------
+bool operator!=(const pfc_reliable_nack& lhs, const pfc_reliable_nack& rhs)
+{
+  return !(lhs == rhs);
+}
+//-----------------------------------------------------------------------------
+//! \param is [IN,OUT] -- Input stream positioned at the start of a message
+//! \return pfc_uint -- Type of the next message. The stream is rewound to where it started
+pfc_uint peek_message_type(std::istream& is)
+{
+  pfc_uint type = MESSAGE_TYPE_NOT_ASSIGNED;
+  auto start = is.tellg();
+  if (start == std::istream::pos_type(-1)) {
+    return MESSAGE_TYPE_NOT_ASSIGNED;
+  }
+  if (deserialize_pfc_type(is, type).is_not_ok() || !is.good()) {
+    type = MESSAGE_TYPE_NOT_ASSIGNED;
+  }
+  is.clear();
+  is.seekg(start);
+  return type;
+}
 }
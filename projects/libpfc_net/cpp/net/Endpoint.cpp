@@ -0,0 +1,127 @@
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+/*! \file */
+
+#include <sustain/framework/net/Endpoint.h>
+
+#include <cctype>
+#include <random>
+#include <sstream>
+
+#include <boost/asio/ip/host_name.hpp>
+#include <boost/system/error_code.hpp>
+
+namespace pfc {
+
+namespace {
+  //-----------------------------------------------------------------------------
+  //! \return std::string -- name with anything but letters, digits, '_', '.' and '-' replaced so it is a valid URI address
+  std::string address_safe(const std::string& name)
+  {
+    std::string result(name);
+    for (auto& c : result) {
+      if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '.' && c != '-') {
+        c = '_';
+      }
+    }
+    return result;
+  }
+}
+//-----------------------------------------------------------------------------
+//! \return pfc_string -- Name of this host as advertised in pfc_service_announcement::_host. Empty if it can not be read
+pfc_string local_host()
+{
+  static const pfc_string host = []() {
+    boost::system::error_code ec;
+    auto name = boost::asio::ip::host_name(ec);
+    return (ec) ? pfc_string() : name;
+  }();
+  return host;
+}
+//-----------------------------------------------------------------------------
+//! \return pfc_uint -- Random non zero token identifying this process. Unlike a process id it is never reused
+//!                     by another process on the host, or shared by processes in different containers
+pfc_uint local_process()
+{
+  static const pfc_uint process = []() {
+    std::random_device entropy;
+    pfc_uint token = 0;
+    while (token == 0) {
+      token = entropy();
+    }
+    return token;
+  }();
+  return process;
+}
+//-----------------------------------------------------------------------------
+//! \param service_name [IN] -- Name of the service. Characters not allowed in a URI are replaced
+//! \param port [IN] -- tcp port of the service, so several instances of one service on a host do not collide
+//! \return std::vector<URI> -- An inproc:// and an ipc:// endpoint unique to the service on this host
+std::vector<URI> local_endpoints(const std::string& service_name, uint16_t port)
+{
+  auto name = "pfc_" + address_safe(service_name) + "_" + std::to_string(port);
+#if defined(_WIN32)
+  auto ipc = URI("ipc://" + name);
+#else
+  auto ipc = URI("ipc:///tmp/" + name + ".ipc");
+#endif
+  return { URI("inproc://" + name), ipc };
+}
+//-----------------------------------------------------------------------------
+//! Records the extra endpoints of a service along with the host and process it runs in
+//! \param announcement [IN,OUT] -- Announcement of the service
+//! \param endpoints [IN] -- URIs the service listens on besides its tcp address
+void advertise_endpoints(pfc_service_announcement& announcement, const std::vector<URI>& endpoints)
+{
+  announcement._endpoints.clear();
+  for (auto& endpoint : endpoints) {
+    if (!announcement._endpoints.empty()) {
+      announcement._endpoints += ' ';
+    }
+    announcement._endpoints += endpoint.c_str();
+  }
+  announcement._host = local_host();
+  announcement._process = local_process();
+}
+//-----------------------------------------------------------------------------
+//! Picks the cheapest transport which can reach an announced service from this process
+//! \param announcement [IN] -- Announcement of the service
+//! \return URI -- An advertised inproc:// endpoint when the service shares this process, an advertised ipc://
+//!                endpoint when it shares this host, else tcp://address:port
+URI select_endpoint(const pfc_service_announcement& announcement)
+{
+  auto same_host = !announcement._host.empty() && announcement._host == local_host();
+  auto same_process = same_host && announcement._process == local_process();
+
+  std::istringstream endpoints(announcement._endpoints);
+  std::string text;
+  std::string ipc;
+  while (endpoints >> text) {
+    URI endpoint(text);
+    if (!endpoint.is_valid()) {
+      continue;
+    }
+    if (same_process && endpoint.transport() == "inproc") {
+      return endpoint;
+    }
+    if (same_host && ipc.empty() && endpoint.transport() == "ipc") {
+      ipc = text;
+    }
+  }
+  if (!ipc.empty()) {
+    return URI(ipc);
+  }
+  return URI("tcp", announcement._address, announcement._port);
+}
+//-----------------------------------------------------------------------------
+}
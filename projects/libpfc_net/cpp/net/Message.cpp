@@ -0,0 +1,275 @@
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+/*! \file */
+
+#include <sustain/framework/net/Message.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include <nanomsg/nn.h>
+
+namespace pfc {
+
+namespace {
+  constexpr size_t smallest_block = 64; //!< Smallest pooled block in bytes
+  constexpr size_t class_count = 11; //!< Size classes 64B through 64KB are cached
+  constexpr size_t blocks_per_class = 16; //!< Free blocks cached per size class per thread
+
+  //!
+  //!  Per thread cache of freed pooled blocks. Blocks are powers of two so the capacity of a
+  //!  message is enough to find its size class. A block freed on another thread simply joins
+  //!  that threads cache.
+  //!
+  struct Message_Pool {
+    Message_Pool() { state = State::alive; }
+    ~Message_Pool()
+    {
+      state = State::destroyed;
+      for (auto& blocks : free) {
+        for (auto block : blocks) {
+          delete[] block;
+        }
+      }
+    }
+
+    std::array<std::vector<char*>, class_count> free;
+
+    //! Messages destroyed during thread exit must not touch a pool which is already gone
+    enum class State { unused, alive, destroyed };
+    static thread_local State state;
+  };
+  thread_local Message_Pool::State Message_Pool::state = Message_Pool::State::unused;
+
+  Message_Pool& thread_pool()
+  {
+    thread_local Message_Pool pool;
+    return pool;
+  }
+  //-----------------------------------------------------------------------------
+  //! \param capacity [IN,OUT] -- Requested capacity. Rounded up to the block actually returned
+  char* pool_acquire(size_t& capacity)
+  {
+    size_t block = smallest_block;
+    size_t size_class = 0;
+    while (block < capacity) {
+      block <<= 1;
+      ++size_class;
+    }
+    capacity = block;
+    if (size_class < class_count && Message_Pool::state != Message_Pool::State::destroyed) {
+      auto& blocks = thread_pool().free[size_class];
+      if (!blocks.empty()) {
+        auto result = blocks.back();
+        blocks.pop_back();
+        return result;
+      }
+    }
+    return new char[block];
+  }
+  //-----------------------------------------------------------------------------
+  //! \param block [IN] -- Block returned by pool_acquire
+  //! \param capacity [IN] -- Capacity pool_acquire reported for block
+  void pool_release(char* block, size_t capacity)
+  {
+    size_t size_class = 0;
+    for (size_t size = smallest_block; size < capacity; size <<= 1) {
+      ++size_class;
+    }
+    if (size_class < class_count && Message_Pool::state != Message_Pool::State::destroyed) {
+      auto& blocks = thread_pool().free[size_class];
+      if (blocks.size() < blocks_per_class) {
+        blocks.push_back(block);
+        return;
+      }
+    }
+    delete[] block;
+  }
+}
+//-----------------------------------------------------------------------------
+//! Empty message which owns no memory
+message::message() noexcept
+  : _data(nullptr)
+  , _size(0)
+  , _capacity(0)
+  , _storage(Storage::none)
+{
+}
+//-----------------------------------------------------------------------------
+//! \param capacity [IN] -- Bytes to reserve. The message starts empty
+//! \param preferred [IN] -- Storage to try first. nanomsg falls back to pooled if nn_allocmsg fails
+message::message(size_t capacity, Storage preferred)
+  : message()
+{
+  if (preferred == Storage::nanomsg) {
+    if ((_data = static_cast<char*>(nn_allocmsg(capacity, 0))) != nullptr) {
+      _capacity = capacity;
+      _storage = Storage::nanomsg;
+      return;
+    }
+  }
+  _capacity = capacity;
+  _data = pool_acquire(_capacity);
+  _storage = Storage::pooled;
+}
+//-----------------------------------------------------------------------------
+//! \param data [IN] -- Bytes copied in to the new message
+//! \param size [IN] -- Length of data
+//! \param preferred [IN] -- Storage to try first
+message::message(const char* data, size_t size, Storage preferred)
+  : message(size, preferred)
+{
+  if (size) {
+    std::memcpy(_data, data, size);
+  }
+  _size = size;
+}
+//-----------------------------------------------------------------------------
+message::message(message&& rhs) noexcept
+  : _data(rhs._data)
+  , _size(rhs._size)
+  , _capacity(rhs._capacity)
+  , _storage(rhs._storage)
+{
+  rhs._data = nullptr;
+  rhs._size = rhs._capacity = 0;
+  rhs._storage = Storage::none;
+}
+//-----------------------------------------------------------------------------
+message::~message()
+{
+  reset();
+}
+//-----------------------------------------------------------------------------
+message& message::operator=(message&& rhs) noexcept
+{
+  if (this != &rhs) {
+    reset();
+    std::swap(_data, rhs._data);
+    std::swap(_size, rhs._size);
+    std::swap(_capacity, rhs._capacity);
+    std::swap(_storage, rhs._storage);
+  }
+  return *this;
+}
+//-----------------------------------------------------------------------------
+//! Takes ownership of a chunk nanomsg allocated, such as the result of nn_recv with NN_MSG
+//! \param chunk [IN] -- Chunk which will be released with nn_freemsg
+//! \param size [IN] -- Bytes of the chunk in use
+//! \return message -- Owns chunk. Empty if chunk was null
+message message::adopt(void* chunk, size_t size)
+{
+  message result;
+  if (chunk) {
+    result._data = static_cast<char*>(chunk);
+    result._size = result._capacity = size;
+    result._storage = Storage::nanomsg;
+  }
+  return result;
+}
+//-----------------------------------------------------------------------------
+//! Gives up ownership of a nanomsg chunk so it can be passed to nn_send with NN_MSG.
+//! The chunk is first shrunk to size() because nanomsg sends the whole chunk.
+//! \return void* -- The chunk. nullptr, with the message unchanged, for pooled storage
+void* message::release_chunk()
+{
+  if (_storage != Storage::nanomsg) {
+    return nullptr;
+  }
+  if (_size != _capacity) {
+    auto shrunk = nn_reallocmsg(_data, _size);
+    if (!shrunk) {
+      return nullptr;
+    }
+    _data = static_cast<char*>(shrunk);
+    _capacity = _size;
+  }
+  auto chunk = _data;
+  _data = nullptr;
+  _size = _capacity = 0;
+  _storage = Storage::none;
+  return chunk;
+}
+//-----------------------------------------------------------------------------
+//! Grows the message so at least capacity bytes can be written without reallocating.
+//! A nanomsg chunk which can not be grown moves to pooled storage.
+//! \param capacity [IN] -- Minimum capacity. Never shrinks the message
+void message::reserve(size_t capacity)
+{
+  if (capacity <= _capacity && _storage != Storage::none) {
+    return;
+  }
+  if (_storage == Storage::none) {
+    *this = message(capacity);
+    return;
+  }
+  if (_storage == Storage::nanomsg) {
+    if (auto grown = nn_reallocmsg(_data, capacity)) {
+      _data = static_cast<char*>(grown);
+      _capacity = capacity;
+      return;
+    }
+  }
+  message grown(capacity, Storage::pooled);
+  std::memcpy(grown._data, _data, _size);
+  grown._size = _size;
+  *this = std::move(grown);
+}
+//-----------------------------------------------------------------------------
+//! \param size [IN] -- New number of bytes in use. Bytes added are uninitialized
+void message::resize(size_t size)
+{
+  reserve(size);
+  _size = size;
+}
+//-----------------------------------------------------------------------------
+//! \param data [IN] -- Bytes copied to the end of the message
+//! \param size [IN] -- Length of data
+void message::append(const char* data, size_t size)
+{
+  if (_size + size > _capacity) {
+    reserve(std::max(_size + size, _capacity * 2));
+  }
+  if (size) {
+    std::memcpy(_data + _size, data, size);
+  }
+  _size += size;
+}
+//-----------------------------------------------------------------------------
+//! Marks every byte unused but keeps the memory for reuse
+void message::clear() noexcept
+{
+  _size = 0;
+}
+//-----------------------------------------------------------------------------
+//! Returns memory to nanomsg or the pool
+void message::reset() noexcept
+{
+  switch (_storage) {
+  case Storage::nanomsg:
+    nn_freemsg(_data);
+    break;
+  case Storage::pooled:
+    pool_release(_data, _capacity);
+    break;
+  case Storage::none:
+    break;
+  }
+  _data = nullptr;
+  _size = _capacity = 0;
+  _storage = Storage::none;
+}
+}
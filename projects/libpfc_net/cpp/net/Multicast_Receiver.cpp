@@ -14,6 +14,7 @@ specific language governing permissions and limitations under the license.
 
 #include <sustain/framework/net/Multicast_Receiver.h>
 
+#include <algorithm>
 #include <thread>
 
 #include <boost/asio/ip/multicast.hpp>
@@ -38,7 +39,7 @@ public:
   vector_streambuf(std::vector<CharT>&& vec)
     : self(std::move(vec))
   {
-    setg(self.data(), self.data(), self.data() + self.size());
+    this->setg(self.data(), self.data(), self.data() + self.size());
   }
   //!
   //! Copies Vector to self
@@ -46,7 +47,7 @@ public:
   vector_streambuf(std::vector<CharT> vec)
     : self(std::move(vec))
   {
-    setg(self.data(), self.data(), self.data() + self.size());
+    this->setg(self.data(), self.data(), self.data() + self.size());
   }
   //!
   //! Internally stores the current &vec[0] and vec->size()
@@ -56,7 +57,48 @@ public:
   vector_streambuf(std::vector<CharT>* vec)
     : self()
   {
-    setg(vec->data(), vec->data(), vec->data() + vec->size());
+    this->setg(vec->data(), vec->data(), vec->data() + vec->size());
+  }
+  //!
+  //! Same as vector_streambuf(std::vector<CharT>*) but only exposes the first length elements.
+  //! Used to limit the stream to the bytes of a received datagram
+  //!
+  vector_streambuf(std::vector<CharT>* vec, size_t length)
+    : self()
+  {
+    this->setg(vec->data(), vec->data(), vec->data() + std::min(length, vec->size()));
+  }
+
+protected:
+  //!
+  //! Allows tellg/seekg on the get area so messages can be peeked before being consumed
+  //!
+  typename TraitsT::pos_type seekoff(typename TraitsT::off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+  {
+    typename TraitsT::off_type position = 0;
+    switch (dir) {
+    case std::ios_base::beg:
+      position = off;
+      break;
+    case std::ios_base::cur:
+      position = (this->gptr() - this->eback()) + off;
+      break;
+    default:
+      position = (this->egptr() - this->eback()) + off;
+      break;
+    }
+    if (!(which & std::ios_base::in) || position < 0 || position > this->egptr() - this->eback()) {
+      return typename TraitsT::pos_type(typename TraitsT::off_type(-1));
+    }
+    this->setg(this->eback(), this->eback() + position, this->egptr());
+    return typename TraitsT::pos_type(position);
+  }
+  //!
+  //! Absolute seek implemented in terms of seekoff
+  //!
+  typename TraitsT::pos_type seekpos(typename TraitsT::pos_type pos, std::ios_base::openmode which) override
+  {
+    return seekoff(typename TraitsT::off_type(pos), std::ios_base::beg, which);
   }
 
 private:
@@ -147,7 +189,7 @@ void Multicast_Receiver::Implementation::multicast_receive()
     boost::asio::buffer(buffer), endpoint,
     [this](boost::system::error_code ec, std::size_t length) {
       if (!ec) {
-        vector_streambuf<char> in_buffer { &buffer };
+        vector_streambuf<char> in_buffer { &buffer, length };
         std::istream stream { &in_buffer };
         process_message_function(stream);
         multicast_receive();
@@ -38,6 +38,7 @@ struct Multicast_Sender::Implementation {
   Implementation& operator==(Implementation&&) = delete;
 
   Error multicast_setup(const std::string& multicast_addres, uint16_t ports);
+  void multicast_send();
   void multicast_broadcast();
   void multicast_timeout();
 
@@ -89,7 +90,25 @@ Error Multicast_Sender::Implementation::multicast_setup(const std::string& multi
   return system_status;
 }
 //-----------------------------------------------------------------------------
-//! Broadcast a single multicast message using blocking IO
+//! Sends a single multicast message using blocking IO. Unlike multicast_broadcast
+//! no rebroadcast is scheduled so the sender can be reused for one shot messages.
+//! Nothing is sent when process_message_function writes no data.
+void Multicast_Sender::Implementation::multicast_send()
+{
+  std::ostream os(&buffer);
+  process_message_function(os);
+
+  if (buffer.size()) {
+    boost::system::error_code ec;
+    socket.send_to(buffer.data(), endpoint, 0, ec);
+    if (ec) {
+      system_status = Error::Code::PFC_BAD_OPERATION;
+    }
+  }
+  buffer.consume(buffer.size());
+}
+//-----------------------------------------------------------------------------
+//! Broadcast a single multicast message using async IO and schedules the next rebroadcast
 void Multicast_Sender::Implementation::multicast_broadcast()
 {
   std::ostream os(&buffer);
@@ -98,6 +117,7 @@ void Multicast_Sender::Implementation::multicast_broadcast()
   socket.async_send_to(
     buffer.data(), endpoint,
     [this](boost::system::error_code ec, std::size_t /*length*/) {
+      buffer.consume(buffer.size());
       if (!ec) {
         multicast_timeout();
       }
@@ -140,12 +160,12 @@ Multicast_Sender::~Multicast_Sender()
 //-----------------------------------------------------------------------------
 //! \param process_message_function [IN] std::function<void( const std::ostream& )> - Function to be excuted everytime a message is received.
 //!
-//! Blocking call to send a single multicast message
+//! Blocking call to send a single multicast message. Safe to call repeatedly from one thread
+//! but must not be mixed with async_send on the same Multicast_Sender
 void Multicast_Sender::send(std::function<void(std::ostream&)> process_message_function)
 {
   _impl->process_message_function = process_message_function;
-  _impl->multicast_broadcast();
-  _impl->io_context.run_one();
+  _impl->multicast_send();
 }
 //-----------------------------------------------------------------------------
 //! \param process_message_function [IN] std::function<void( const std::ostream& )> - Function to be excuted everytime a message is received.
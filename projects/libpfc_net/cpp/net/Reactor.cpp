@@ -0,0 +1,377 @@
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+/*! \file */
+
+#include <sustain/framework/net/Reactor.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nanomsg/nn.h>
+#include <nanomsg/pipeline.h>
+
+#include <sustain/framework/util/Mpsc_Queue.h>
+#include <sustain/framework/util/Wake_Signal.h>
+
+#include "patterns/nanomsg_helper.h"
+
+namespace pfc {
+
+namespace {
+  constexpr int g_max_poll = 100; //!< Longest nn_poll in ms, which bounds how long stop waits
+  constexpr size_t g_dispatch_depth = 4096; //!< Ready sockets waiting for a worker
+}
+
+//!
+//!  Registration of one socket
+//!
+struct Reactor_Entry {
+  int socket = no_socket;
+  short events = 0;
+  Reactor::ReadyFunc handler;
+  bool armed = true; //!< In the poll set. Cleared while the handler is queued or running
+  bool removed = false;
+  std::thread::id running_on; //!< Worker running the handler, so remove can be called from inside it
+};
+
+//!
+//!  Ready socket handed from the poll thread to a worker, or a job queued with post
+//!
+struct Reactor_Task {
+  std::shared_ptr<Reactor_Entry> entry;
+  short events = 0;
+  Reactor::JobFunc job;
+};
+
+//!
+//!  @struct Reactor::Implementation
+//!  Private PIMPL implementation of Reactor
+//!
+struct Reactor::Implementation {
+  Implementation(size_t workers);
+  ~Implementation();
+
+  void poll();
+  void work();
+  void run(Reactor_Task&);
+  void wake();
+  void shutdown();
+  void run_queued();
+
+  std::map<int, std::shared_ptr<Reactor_Entry>> entries;
+  mutable std::mutex entries_mutex;
+  std::condition_variable handler_done; //!< Signalled when a handler returns so remove can wait for it
+
+  int wake_pull; //!< Polled with the registered sockets so changes interrupt nn_poll
+  int wake_push;
+  std::atomic<bool> polling; //!< True while the poll thread may be blocked in nn_poll
+  std::atomic<bool> running;
+
+  size_t worker_count;
+  Mpsc_Queue<Reactor_Task> tasks;
+  Wake_Signal task_signal;
+  std::thread poll_thread;
+  std::vector<std::thread> worker_threads;
+
+  Error ec; //!< Current Error code of the system else Success()
+};
+//-----------------------------------------------------------------------------
+//! \param workers [IN] -- Threads running handlers. 0 runs them on the poll thread
+Reactor::Implementation::Implementation(size_t workers)
+  : wake_pull(no_socket)
+  , wake_push(no_socket)
+  , polling(false)
+  , running(true)
+  , worker_count(workers)
+  , tasks(g_dispatch_depth)
+{
+  auto wake_endpoint = "inproc://pfc_reactor_wake_" + std::to_string(reinterpret_cast<uintptr_t>(this));
+  if ((wake_pull = nn_socket(AF_SP, NN_PULL)) < 0 || nn_bind(wake_pull, wake_endpoint.c_str()) < 0
+      || (wake_push = nn_socket(AF_SP, NN_PUSH)) < 0 || nn_connect(wake_push, wake_endpoint.c_str()) < 0) {
+    ec = nano_to_Error(nn_errno());
+  }
+  for (size_t worker = 0; worker < worker_count; ++worker) {
+    worker_threads.emplace_back(&Implementation::work, this);
+  }
+  poll_thread = std::thread(&Implementation::poll, this);
+}
+//-----------------------------------------------------------------------------
+Reactor::Implementation::~Implementation()
+{
+  shutdown();
+}
+//-----------------------------------------------------------------------------
+//! Stops the poll thread and workers. Handlers which are running finish first, then the jobs
+//! still queued run on the calling thread
+void Reactor::Implementation::shutdown()
+{
+  running = false;
+  wake();
+  if (poll_thread.joinable()) {
+    poll_thread.join();
+  }
+  task_signal.notify();
+  for (auto& worker : worker_threads) {
+    worker.join();
+  }
+  worker_threads.clear();
+  run_queued();
+  for (auto wake_socket : { &wake_push, &wake_pull }) {
+    if (*wake_socket >= 0) {
+      nn_close(*wake_socket);
+      *wake_socket = no_socket;
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+//! Runs the posted jobs left in the queue once nothing else will. Ready sockets are dropped
+void Reactor::Implementation::run_queued()
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  Reactor_Task task;
+  while (tasks.try_pop(task)) {
+    if (task.job) {
+      task.job();
+    }
+    task = Reactor_Task();
+  }
+}
+//-----------------------------------------------------------------------------
+//! Interrupts nn_poll if the poll thread is, or is about to be, blocked in it
+void Reactor::Implementation::wake()
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (polling.exchange(false) && wake_push >= 0) {
+    nn_send(wake_push, "", 0, NN_DONTWAIT);
+  }
+}
+//-----------------------------------------------------------------------------
+//! Poll thread. Builds the poll set from armed sockets, waits, then disarms and dispatches the ready ones
+void Reactor::Implementation::poll()
+{
+  std::vector<nn_pollfd> fds;
+  std::vector<std::shared_ptr<Reactor_Entry>> polled;
+  while (running) {
+    fds.assign(1, nn_pollfd { wake_pull, NN_POLLIN, 0 });
+    polled.clear();
+    {
+      std::lock_guard<std::mutex> guard(entries_mutex);
+      for (auto& registered : entries) {
+        if (registered.second->armed) {
+          fds.push_back(nn_pollfd { registered.first, registered.second->events, 0 });
+          polled.push_back(registered.second);
+        }
+      }
+      polling.store(true);
+    }
+    //Jobs posted while the set was built would otherwise wait out g_max_poll
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto timeout = (worker_count == 0 && !tasks.empty()) ? 0 : g_max_poll;
+    nn_poll(fds.data(), static_cast<int>(fds.size()), timeout);
+    polling.store(false);
+
+    if (fds[0].revents & NN_POLLIN) {
+      void* wake_message = nullptr;
+      while (nn_recv(wake_pull, &wake_message, NN_MSG, NN_DONTWAIT) >= 0) {
+        nn_freemsg(wake_message);
+      }
+    }
+    for (size_t index = 0; index < polled.size(); ++index) {
+      auto events = fds[index + 1].revents;
+      if (!events) {
+        continue;
+      }
+      Reactor_Task task;
+      task.entry = polled[index];
+      task.events = events;
+      {
+        std::lock_guard<std::mutex> guard(entries_mutex);
+        if (task.entry->removed) {
+          continue;
+        }
+        task.entry->armed = false;
+      }
+      if (worker_count == 0) {
+        run(task);
+      } else if (tasks.try_push(std::move(task))) {
+        task_signal.notify();
+      } else {
+        std::lock_guard<std::mutex> guard(entries_mutex);
+        polled[index]->armed = true;
+      }
+    }
+    if (worker_count == 0) {
+      Reactor_Task task;
+      while (tasks.try_pop(task)) {
+        run(task);
+      }
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+//! Worker thread. Runs handlers of ready sockets
+void Reactor::Implementation::work()
+{
+  Reactor_Task task;
+  while (running) {
+    task_signal.wait([this]() { return !running || !tasks.empty(); });
+    while (tasks.try_pop(task)) {
+      run(task);
+      task = Reactor_Task();
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+//! Runs a posted job, or one handler and puts its socket back in the poll set
+void Reactor::Implementation::run(Reactor_Task& task)
+{
+  if (task.job) {
+    task.job();
+    return;
+  }
+  auto& entry = *task.entry;
+  {
+    std::lock_guard<std::mutex> guard(entries_mutex);
+    if (entry.removed) {
+      return;
+    }
+    entry.running_on = std::this_thread::get_id();
+  }
+  entry.handler(entry.socket, task.events);
+  {
+    std::lock_guard<std::mutex> guard(entries_mutex);
+    entry.running_on = std::thread::id();
+    entry.armed = !entry.removed;
+  }
+  handler_done.notify_all();
+  wake();
+}
+//-----------------------------------------------------------------------------
+//! \param workers [IN] -- Threads running handlers. 0 runs them on the poll thread
+Reactor::Reactor(size_t workers)
+  : _impl(std::make_unique<Implementation>(workers))
+{
+}
+//-----------------------------------------------------------------------------
+//! Stops polling and joins every thread
+Reactor::~Reactor()
+{
+  //Queued jobs run while _impl is still set, as they may post again
+  _impl->shutdown();
+  _impl = nullptr;
+}
+//-----------------------------------------------------------------------------
+//! Registers a nanomsg socket
+//! \param socket [IN] -- Socket returned by nn_socket
+//! \param events [IN] -- NN_POLLIN, NN_POLLOUT or both
+//! \param handler [IN] -- Called on a worker each time the socket is ready
+//! \return Error -- PFC_ADDRESS_IN_USE if the socket is already registered, PFC_BAD_OPERATION after stop
+Error Reactor::add(int socket, short events, ReadyFunc handler)
+{
+  auto& impl = *_impl;
+  if (!impl.running) {
+    return Error::Code::PFC_BAD_OPERATION;
+  }
+  if (impl.ec) {
+    return impl.ec;
+  }
+  auto entry = std::make_shared<Reactor_Entry>();
+  entry->socket = socket;
+  entry->events = events;
+  entry->handler = std::move(handler);
+  {
+    std::lock_guard<std::mutex> guard(impl.entries_mutex);
+    if (!impl.entries.emplace(socket, entry).second) {
+      return Error::Code::PFC_ADDRESS_IN_USE;
+    }
+  }
+  impl.wake();
+  return Success();
+}
+//-----------------------------------------------------------------------------
+//! Unregisters a socket. Blocks while its handler is running on another thread, so the socket may
+//! be closed as soon as remove returns.
+//! \param socket [IN] -- Socket previously passed to add
+//! \return Error -- PFC_INVALID_SOCKET if the socket is not registered
+Error Reactor::remove(int socket)
+{
+  auto& impl = *_impl;
+  std::unique_lock<std::mutex> lock(impl.entries_mutex);
+  auto registered = impl.entries.find(socket);
+  if (registered == impl.entries.end()) {
+    return Error::Code::PFC_INVALID_SOCKET;
+  }
+  auto entry = registered->second;
+  entry->removed = true;
+  entry->armed = false;
+  impl.entries.erase(registered);
+  impl.handler_done.wait(lock, [&entry]() {
+    return entry->running_on == std::thread::id() || entry->running_on == std::this_thread::get_id();
+  });
+  lock.unlock();
+  impl.wake();
+  return Success();
+}
+//-----------------------------------------------------------------------------
+//! Runs job on a worker, or on the poll thread when the Reactor has no workers
+//! \param job [IN] -- Must not block for long; it shares the workers with every registered socket
+//! \return Error -- PFC_QUEUE_FULL when too many jobs and ready sockets are waiting, PFC_BAD_OPERATION after stop
+Error Reactor::post(JobFunc job)
+{
+  auto& impl = *_impl;
+  if (!impl.running) {
+    return Error::Code::PFC_BAD_OPERATION;
+  }
+  Reactor_Task task;
+  task.job = std::move(job);
+  if (!impl.tasks.try_push(std::move(task))) {
+    return Error::Code::PFC_QUEUE_FULL;
+  }
+  if (impl.worker_count) {
+    impl.task_signal.notify();
+  } else {
+    impl.wake();
+  }
+  //stop may have run the queue between the check of running and the push
+  if (!impl.running) {
+    impl.run_queued();
+  }
+  return Success();
+}
+//-----------------------------------------------------------------------------
+//! Stops dispatching. Handlers which are running finish first. Jobs still queued then run on the
+//! calling thread, so every job accepted by post runs once. Ready sockets are dropped.
+//! Safe to call more than once
+void Reactor::stop()
+{
+  _impl->shutdown();
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Registered sockets
+size_t Reactor::size() const
+{
+  std::lock_guard<std::mutex> guard(_impl->entries_mutex);
+  return _impl->entries.size();
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Threads running handlers. 0 when handlers run on the poll thread
+size_t Reactor::workers() const
+{
+  return _impl->worker_count;
+}
+}
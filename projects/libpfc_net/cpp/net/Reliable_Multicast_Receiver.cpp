@@ -0,0 +1,186 @@
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+/*! \file */
+
+#include <sustain/framework/net/Reliable_Multicast_Receiver.h>
+
+#include <streambuf>
+#include <vector>
+
+#include <sustain/framework/net/Multicast_Receiver.h>
+#include <sustain/framework/net/Multicast_Sender.h>
+#include <sustain/framework/net/Reliable_Sequencer.h>
+
+namespace pfc {
+
+namespace {
+  constexpr size_t g_datagram_bytes = 65536; //!< Largest UDP datagram, so any frame a sender can send fits the receive buffer
+
+  //!
+  //! Read only istream buffer over a frame payload
+  //!
+  class payload_streambuf : public std::streambuf {
+  public:
+    explicit payload_streambuf(std::vector<pfc_byte>& payload)
+    {
+      auto begin = reinterpret_cast<char*>(payload.data());
+      setg(begin, begin, begin + payload.size());
+    }
+  };
+}
+
+//!
+//! PIMPL Implementation of a Reliable_Multicast_Receiver
+//! The sockets around a Reliable_Sequencer, which is only fed on the receive thread of data_receiver
+//!
+struct Reliable_Multicast_Receiver::Implementation {
+  Implementation(const std::string& bind_address, const std::string& multicast_address, uint16_t port, Reliable_Multicast_Options options);
+
+  void handle(std::istream& is);
+  void deliver(std::vector<pfc_byte>& payload);
+  void nack(pfc_uint first, pfc_uint count);
+
+  Multicast_Receiver data_receiver; //!< Frames and heartbeats on port
+  Multicast_Sender nack_sender; //!< NACKs to port + 1
+  Reliable_Sequencer sequencer;
+  std::function<void(std::istream&)> process_message_function;
+
+  Error system_status;
+};
+//-----------------------------------------------------------------------------
+//! \param bind_address [IN] -- Interface frames are received on
+//! \param multicast_address [IN] -- Group of the sender
+//! \param port [IN] -- Port of frames. NACKs are sent to port + 1
+//! \param options [IN] -- History size and timing. Should match the sender
+Reliable_Multicast_Receiver::Implementation::Implementation(const std::string& bind_address, const std::string& multicast_address, uint16_t port, Reliable_Multicast_Options options)
+  : data_receiver(bind_address, multicast_address, port)
+  , nack_sender(multicast_address, static_cast<uint16_t>(port + 1))
+  , sequencer(options, [this](std::vector<pfc_byte>& payload) { deliver(payload); }, [this](pfc_uint first, pfc_uint count) { nack(first, count); })
+{
+  data_receiver.buffer_legth(g_datagram_bytes);
+  if (!data_receiver.is_valid()) {
+    system_status |= data_receiver.error();
+  }
+  if (!nack_sender.is_valid()) {
+    system_status |= nack_sender.error();
+  }
+}
+//-----------------------------------------------------------------------------
+//! \param is [IN,OUT] -- One datagram from the sender
+void Reliable_Multicast_Receiver::Implementation::handle(std::istream& is)
+{
+  switch (peek_message_type(is)) {
+  case RELIABLE_DATA_REQUEST: {
+    pfc_reliable_data frame;
+    if (frame.deserialize(is).is_ok()) {
+      sequencer.handle_data(frame, std::chrono::steady_clock::now());
+    }
+  } break;
+  case RELIABLE_HEARTBEAT_REQUEST: {
+    pfc_reliable_heartbeat heartbeat;
+    if (heartbeat.deserialize(is).is_ok()) {
+      sequencer.handle_heartbeat(heartbeat, std::chrono::steady_clock::now());
+    }
+  } break;
+  default:
+    break;
+  }
+}
+//-----------------------------------------------------------------------------
+//! \param payload [IN] -- Frame payload handed to process_message_function as a stream
+void Reliable_Multicast_Receiver::Implementation::deliver(std::vector<pfc_byte>& payload)
+{
+  payload_streambuf buffer { payload };
+  std::istream stream { &buffer };
+  process_message_function(stream);
+}
+//-----------------------------------------------------------------------------
+//! \param first [IN] -- First missing sequence
+//! \param count [IN] -- Consecutive missing sequences
+void Reliable_Multicast_Receiver::Implementation::nack(pfc_uint first, pfc_uint count)
+{
+  pfc_reliable_nack request;
+  request._channel = sequencer.channel();
+  request._first = first;
+  request._count = count;
+  nack_sender.send([&request](std::ostream& os) { request.serialize(os); });
+}
+//-----------------------------------------------------------------------------
+//! \param bind_address [IN] -- Interface frames are received on
+//! \param multicast_address [IN] -- Group of the sender
+//! \param port [IN] -- Port of frames. NACKs are sent to port + 1
+//! \param options [IN] -- History size and timing. Should match the sender
+Reliable_Multicast_Receiver::Reliable_Multicast_Receiver(std::string bind_address, std::string multicast_address, uint16_t port, Reliable_Multicast_Options options)
+  : _impl(std::make_unique<Implementation>(bind_address, multicast_address, port, options))
+{
+}
+//-----------------------------------------------------------------------------
+//! Stops receiving
+Reliable_Multicast_Receiver::~Reliable_Multicast_Receiver()
+{
+  stop();
+  join();
+  _impl = nullptr;
+}
+//-----------------------------------------------------------------------------
+//! \param process_message_function [IN] -- Called on a background thread with the payload of each frame in sequence order
+void Reliable_Multicast_Receiver::async_receive(std::function<void(std::istream&)> process_message_function)
+{
+  auto impl = _impl.get();
+  impl->process_message_function = process_message_function;
+  impl->data_receiver.async_receive([impl](std::istream& is) { impl->handle(is); });
+}
+//-----------------------------------------------------------------------------
+//! Stops receiving. Held frames are dropped
+void Reliable_Multicast_Receiver::stop()
+{
+  _impl->data_receiver.stop();
+}
+//-----------------------------------------------------------------------------
+//! Blocks until the receive thread has exited
+void Reliable_Multicast_Receiver::join()
+{
+  _impl->data_receiver.join();
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Frames passed to process_message_function
+uint64_t Reliable_Multicast_Receiver::delivered() const
+{
+  return _impl->sequencer.delivered();
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Frames skipped because the sender could no longer repair them
+uint64_t Reliable_Multicast_Receiver::lost() const
+{
+  return _impl->sequencer.lost();
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- NACKs sent, one per run of missing frames
+uint64_t Reliable_Multicast_Receiver::nacks() const
+{
+  return _impl->sequencer.nacks();
+}
+//-----------------------------------------------------------------------------
+//! \return bool -- true if error() == Success()
+bool Reliable_Multicast_Receiver::is_valid() const
+{
+  return _impl->system_status == Success();
+}
+//-----------------------------------------------------------------------------
+//! \return Error -- Success() unless the multicast sockets could not be created
+Error Reliable_Multicast_Receiver::error() const
+{
+  return _impl->system_status;
+}
+//-----------------------------------------------------------------------------
+}
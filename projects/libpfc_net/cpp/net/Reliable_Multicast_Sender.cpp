@@ -0,0 +1,298 @@
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+/*! \file */
+
+#include <sustain/framework/net/Reliable_Multicast_Sender.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <sustain/framework/net/Multicast_Receiver.h>
+#include <sustain/framework/net/Multicast_Sender.h>
+
+namespace pfc {
+
+namespace {
+  //-----------------------------------------------------------------------------
+  //! \return pfc_uint -- Non zero identifier which distinguishes this sender from its earlier runs
+  pfc_uint random_channel()
+  {
+    std::random_device device;
+    pfc_uint channel = 0;
+    while (channel == 0) {
+      channel = static_cast<pfc_uint>(device());
+    }
+    return channel;
+  }
+  //-----------------------------------------------------------------------------
+  //! \param sequence [IN] -- Sequence to advance
+  //! \return pfc_uint -- Sequence after sequence. 0 is reserved for nothing sent and is skipped
+  pfc_uint next_sequence(pfc_uint sequence)
+  {
+    return (sequence + 1 == 0) ? 1 : sequence + 1;
+  }
+  //-----------------------------------------------------------------------------
+  //! \param multicast_address [IN] -- Group NACKs are sent to
+  //! \return std::string -- Wildcard interface of the same address family
+  std::string any_address(const std::string& multicast_address)
+  {
+    return (multicast_address.find(':') != std::string::npos) ? "::" : "0.0.0.0";
+  }
+}
+
+//!
+//! Frame kept for retransmission
+//!
+struct History_Entry {
+  pfc_reliable_data frame; //!< _sequence is 0 until the slot is first used
+  std::chrono::steady_clock::time_point repaired; //!< Last retransmission of frame
+};
+
+//!
+//! PIMPL Implementation of a Reliable_Multicast_Sender
+//!
+struct Reliable_Multicast_Sender::Implementation {
+  Implementation(const std::string& multicast_address, uint16_t port, Reliable_Multicast_Options options);
+  ~Implementation();
+
+  Error multicast(const pfc_message& message);
+  void repair(const pfc_reliable_nack& nack);
+  void beat();
+
+  Reliable_Multicast_Options options;
+  Multicast_Sender data_sender; //!< Frames, repairs and heartbeats on port
+  Multicast_Receiver nack_receiver; //!< NACKs on port + 1
+
+  std::vector<History_Entry> history; //!< Ring indexed by sequence modulo its size
+  std::mutex send_mutex; //!< Guards data_sender, history and first
+  pfc_uint channel;
+  pfc_uint first = 1; //!< Oldest sequence in history
+  std::atomic<pfc_uint> high_water { 0 };
+
+  std::atomic<uint64_t> sent_count { 0 };
+  std::atomic<uint64_t> retransmit_count { 0 };
+
+  std::thread heartbeat_thread;
+  std::mutex heartbeat_mutex;
+  std::condition_variable heartbeat_signal;
+  bool running = true; //!< Guarded by heartbeat_mutex
+
+  Error system_status;
+};
+//-----------------------------------------------------------------------------
+//! \param multicast_address [IN] -- Group frames are multicast to
+//! \param port [IN] -- Port of frames. NACKs are heard on port + 1
+//! \param opts [IN] -- History size and timing
+Reliable_Multicast_Sender::Implementation::Implementation(const std::string& multicast_address, uint16_t port, Reliable_Multicast_Options opts)
+  : options(opts)
+  , data_sender(multicast_address, port)
+  , nack_receiver(any_address(multicast_address), multicast_address, static_cast<uint16_t>(port + 1))
+  , history(std::max<size_t>(opts.history, 1))
+  , channel(random_channel())
+{
+  if (!data_sender.is_valid()) {
+    system_status |= data_sender.error();
+  }
+  if (!nack_receiver.is_valid()) {
+    system_status |= nack_receiver.error();
+  }
+}
+//-----------------------------------------------------------------------------
+//! Stops the heartbeat and NACK threads before the state they use is destroyed
+Reliable_Multicast_Sender::Implementation::~Implementation()
+{
+  {
+    std::lock_guard<std::mutex> guard(heartbeat_mutex);
+    running = false;
+  }
+  heartbeat_signal.notify_all();
+  nack_receiver.stop();
+  nack_receiver.join();
+  if (heartbeat_thread.joinable()) {
+    heartbeat_thread.join();
+  }
+}
+//-----------------------------------------------------------------------------
+//! Caller holds send_mutex
+//! \param message [IN] -- Protocol message to send as one datagram
+//! \return Error -- PFC_BAD_OPERATION if the datagram could not be sent
+Error Reliable_Multicast_Sender::Implementation::multicast(const pfc_message& message)
+{
+  Error result;
+  data_sender.send([&message, &result](std::ostream& os) { result = message.serialize(os); });
+  if (result.is_ok() && !data_sender.is_valid()) {
+    result = Error::Code::PFC_BAD_OPERATION;
+  }
+  return result;
+}
+//-----------------------------------------------------------------------------
+//! Multicasts the NACKed frames still in the history. A frame repaired within the last
+//! nack_interval is skipped, as the repair already answers every receiver which lost it.
+//! \param nack [IN] -- Request from any receiver
+void Reliable_Multicast_Sender::Implementation::repair(const pfc_reliable_nack& nack)
+{
+  if (nack._channel != channel) {
+    return;
+  }
+  auto count = std::min<size_t>(nack._count, history.size());
+  auto sequence = nack._first;
+  for (size_t i = 0; i < count; ++i, sequence = next_sequence(sequence)) {
+    std::lock_guard<std::mutex> guard(send_mutex);
+    auto& entry = history[sequence % history.size()];
+    auto now = std::chrono::steady_clock::now();
+    if (entry.frame._sequence != sequence || now - entry.repaired < options.nack_interval) {
+      continue;
+    }
+    entry.frame._retransmit = True;
+    if (multicast(entry.frame).is_ok()) {
+      entry.repaired = now;
+      ++retransmit_count;
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+//! Heartbeat thread. Advertises the history every options.heartbeat until stopped
+void Reliable_Multicast_Sender::Implementation::beat()
+{
+  std::unique_lock<std::mutex> lock(heartbeat_mutex);
+  while (!heartbeat_signal.wait_for(lock, options.heartbeat, [this]() { return !running; })) {
+    pfc_reliable_heartbeat heartbeat;
+    heartbeat._channel = channel;
+    heartbeat._high_water = high_water;
+    if (heartbeat._high_water == 0) {
+      continue;
+    }
+    std::lock_guard<std::mutex> guard(send_mutex);
+    heartbeat._first = first;
+    multicast(heartbeat);
+  }
+}
+//-----------------------------------------------------------------------------
+//! \param multicast_address [IN] -- Group frames are multicast to
+//! \param port [IN] -- Port of frames. NACKs are heard on port + 1
+//! \param options [IN] -- History size and timing
+Reliable_Multicast_Sender::Reliable_Multicast_Sender(std::string multicast_address, uint16_t port, Reliable_Multicast_Options options)
+  : _impl(std::make_unique<Implementation>(multicast_address, port, options))
+{
+  auto impl = _impl.get();
+  if (impl->system_status.is_not_ok()) {
+    return;
+  }
+  impl->nack_receiver.async_receive([impl](std::istream& is) {
+    if (peek_message_type(is) == RELIABLE_NACK_REQUEST) {
+      pfc_reliable_nack nack;
+      if (nack.deserialize(is).is_ok()) {
+        impl->repair(nack);
+      }
+    }
+  });
+  impl->heartbeat_thread = std::thread([impl]() { impl->beat(); });
+}
+//-----------------------------------------------------------------------------
+//! Stops heartbeats and repairs
+Reliable_Multicast_Sender::~Reliable_Multicast_Sender()
+{
+  _impl = nullptr;
+}
+//-----------------------------------------------------------------------------
+//! \param process_message_function [IN] -- Writes the payload of the next frame. Nothing is sent when it writes no data
+//! \return Error -- PFC_BAD_OPERATION if the frame could not be sent. It is still kept for repair
+Error Reliable_Multicast_Sender::send(std::function<void(std::ostream&)> process_message_function)
+{
+  auto& impl = *_impl;
+  std::ostringstream payload;
+  process_message_function(payload);
+  auto bytes = payload.str();
+  if (bytes.empty()) {
+    return Success();
+  }
+
+  std::lock_guard<std::mutex> guard(impl.send_mutex);
+  auto sequence = next_sequence(impl.high_water);
+  auto& entry = impl.history[sequence % impl.history.size()];
+  if (entry.frame._sequence != 0) {
+    impl.first = next_sequence(entry.frame._sequence);
+  }
+  entry.frame._channel = impl.channel;
+  entry.frame._sequence = sequence;
+  entry.frame._retransmit = False;
+  entry.frame._payload.assign(bytes.begin(), bytes.end());
+  entry.repaired = std::chrono::steady_clock::time_point();
+  impl.high_water = sequence;
+  ++impl.sent_count;
+  return impl.multicast(entry.frame);
+}
+//-----------------------------------------------------------------------------
+//! Stops heartbeats and repairs. Frames already sent are no longer repaired
+void Reliable_Multicast_Sender::stop()
+{
+  {
+    std::lock_guard<std::mutex> guard(_impl->heartbeat_mutex);
+    _impl->running = false;
+  }
+  _impl->heartbeat_signal.notify_all();
+  _impl->nack_receiver.stop();
+}
+//-----------------------------------------------------------------------------
+//! Blocks until the heartbeat and NACK threads have exited. Call stop first
+void Reliable_Multicast_Sender::join()
+{
+  _impl->nack_receiver.join();
+  if (_impl->heartbeat_thread.joinable()) {
+    _impl->heartbeat_thread.join();
+  }
+}
+//-----------------------------------------------------------------------------
+//! \return pfc_uint -- Random identifier carried by every frame of this sender
+pfc_uint Reliable_Multicast_Sender::channel() const
+{
+  return _impl->channel;
+}
+//-----------------------------------------------------------------------------
+//! \return pfc_uint -- Sequence of the newest frame. 0 before the first
+pfc_uint Reliable_Multicast_Sender::high_water() const
+{
+  return _impl->high_water;
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Frames sent, not counting repairs
+uint64_t Reliable_Multicast_Sender::sent() const
+{
+  return _impl->sent_count;
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Frames multicast again in answer to NACKs
+uint64_t Reliable_Multicast_Sender::retransmitted() const
+{
+  return _impl->retransmit_count;
+}
+//-----------------------------------------------------------------------------
+//! \return bool -- true if error() == Success()
+bool Reliable_Multicast_Sender::is_valid() const
+{
+  return _impl->system_status == Success();
+}
+//-----------------------------------------------------------------------------
+//! \return Error -- Success() unless the multicast sockets could not be created
+Error Reliable_Multicast_Sender::error() const
+{
+  return _impl->system_status;
+}
+//-----------------------------------------------------------------------------
+}
@@ -0,0 +1,317 @@
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+/*! \file */
+
+#include <sustain/framework/net/Reliable_Sequencer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <utility>
+
+namespace pfc {
+
+namespace {
+  //-----------------------------------------------------------------------------
+  //! \param sequence [IN] -- Sequence to advance
+  //! \return pfc_uint -- Sequence after sequence. Senders never use 0
+  pfc_uint next_sequence(pfc_uint sequence)
+  {
+    return (sequence + 1 == 0) ? 1 : sequence + 1;
+  }
+}
+
+//!
+//! PIMPL Implementation of a Reliable_Sequencer
+//! Everything but the counters is only touched by the thread feeding the sequencer
+//!
+struct Reliable_Sequencer::Implementation {
+  Implementation(Reliable_Multicast_Options options, DeliverFunc deliver, NackFunc nack);
+
+  void handle_data(pfc_reliable_data& frame, time_point now);
+  void handle_heartbeat(const pfc_reliable_heartbeat& heartbeat, time_point now);
+  void restart(pfc_uint channel, pfc_uint next);
+  void deliver(std::vector<pfc_byte>& payload);
+  void drain();
+  void skip_to(pfc_uint sequence);
+  void request_missing(time_point now);
+  void nack(pfc_uint first, pfc_uint count);
+
+  Reliable_Multicast_Options options;
+  DeliverFunc deliver_function;
+  NackFunc nack_function;
+
+  bool synced = false; //!< False until the first frame or heartbeat names a channel
+  pfc_uint channel = 0;
+  pfc_uint next = 0; //!< Sequence to deliver next
+  pfc_uint high_water = 0; //!< Newest sequence known to be sent
+  pfc_uint nacked_through = 0; //!< Newest sequence already NACKed at least once
+  time_point last_nack;
+  std::map<pfc_uint, std::vector<pfc_byte>> pending; //!< Frames after a gap, all within history of next
+
+  std::atomic<uint64_t> delivered_count { 0 };
+  std::atomic<uint64_t> lost_count { 0 };
+  std::atomic<uint64_t> nack_count { 0 };
+};
+//-----------------------------------------------------------------------------
+//! \param opts [IN] -- History size and timing. Should match the sender
+//! \param deliver [IN] -- Called with each payload in sequence order
+//! \param nack [IN] -- Called with each run of missing sequences to request again
+Reliable_Sequencer::Implementation::Implementation(Reliable_Multicast_Options opts, DeliverFunc deliver, NackFunc nack)
+  : options(opts)
+  , deliver_function(std::move(deliver))
+  , nack_function(std::move(nack))
+{
+  options.history = std::max<size_t>(options.history, 1);
+}
+//-----------------------------------------------------------------------------
+//! Delivers a frame in order or holds it until the gap before it is repaired
+//! \param frame [IN,OUT] -- Frame received. Its payload is moved from
+//! \param now [IN] -- Arrival time, which paces the NACKs
+void Reliable_Sequencer::Implementation::handle_data(pfc_reliable_data& frame, time_point now)
+{
+  if (frame._sequence == 0) {
+    return;
+  }
+  if (!synced || frame._channel != channel) {
+    restart(frame._channel, frame._sequence);
+  }
+  auto distance = sequence_distance(next, frame._sequence);
+  if (distance < 0) {
+    return; //Already delivered
+  }
+  if (static_cast<size_t>(distance) >= options.history) {
+    skip_to(static_cast<pfc_uint>(frame._sequence - options.history + 1));
+  }
+  if (sequence_distance(high_water, frame._sequence) > 0) {
+    high_water = frame._sequence;
+  }
+  if (frame._sequence == next) {
+    deliver(frame._payload);
+    next = next_sequence(next);
+    drain();
+  } else {
+    pending.emplace(frame._sequence, std::move(frame._payload));
+  }
+  request_missing(now);
+}
+//-----------------------------------------------------------------------------
+//! Skips what the sender can no longer repair and NACKs frames lost at the end of a burst
+//! \param heartbeat [IN] -- History advertised by the sender
+//! \param now [IN] -- Arrival time, which paces the NACKs
+void Reliable_Sequencer::Implementation::handle_heartbeat(const pfc_reliable_heartbeat& heartbeat, time_point now)
+{
+  if (heartbeat._high_water == 0) {
+    return;
+  }
+  if (!synced || heartbeat._channel != channel) {
+    //Join at the live edge
+    restart(heartbeat._channel, next_sequence(heartbeat._high_water));
+    return;
+  }
+  if (sequence_distance(next, heartbeat._first) > 0) {
+    skip_to(heartbeat._first);
+  }
+  if (sequence_distance(high_water, heartbeat._high_water) > 0) {
+    high_water = heartbeat._high_water;
+  }
+  if (sequence_distance(next, high_water) >= static_cast<int32_t>(options.history)) {
+    skip_to(static_cast<pfc_uint>(high_water - options.history + 1));
+  }
+  request_missing(now);
+}
+//-----------------------------------------------------------------------------
+//! Forgets the previous sender
+//! \param new_channel [IN] -- Channel of the sender now followed
+//! \param first [IN] -- First sequence to deliver
+void Reliable_Sequencer::Implementation::restart(pfc_uint new_channel, pfc_uint first)
+{
+  synced = true;
+  channel = new_channel;
+  next = first;
+  high_water = first - 1;
+  nacked_through = high_water;
+  pending.clear();
+}
+//-----------------------------------------------------------------------------
+//! \param payload [IN] -- Frame payload handed to deliver_function
+void Reliable_Sequencer::Implementation::deliver(std::vector<pfc_byte>& payload)
+{
+  deliver_function(payload);
+  ++delivered_count;
+}
+//-----------------------------------------------------------------------------
+//! Delivers held frames which no longer follow a gap
+void Reliable_Sequencer::Implementation::drain()
+{
+  for (auto held = pending.find(next); held != pending.end(); held = pending.find(next)) {
+    deliver(held->second);
+    pending.erase(held);
+    next = next_sequence(next);
+  }
+}
+//-----------------------------------------------------------------------------
+//! Gives up on every frame before sequence. Held frames before it are delivered in order and the
+//! missing ones are counted as lost
+//! \param sequence [IN] -- New next sequence
+void Reliable_Sequencer::Implementation::skip_to(pfc_uint sequence)
+{
+  auto skipped = sequence_distance(next, sequence);
+  if (skipped <= 0) {
+    return;
+  }
+  std::vector<std::pair<int32_t, pfc_uint>> held;
+  for (auto& frame : pending) {
+    auto distance = sequence_distance(next, frame.first);
+    if (distance < skipped) {
+      held.emplace_back(distance, frame.first);
+    }
+  }
+  std::sort(held.begin(), held.end());
+  for (auto& frame : held) {
+    auto found = pending.find(frame.second);
+    deliver(found->second);
+    pending.erase(found);
+  }
+  auto missing = static_cast<uint64_t>(skipped) - held.size();
+  if (sequence_distance(next, 0) > 0 && sequence_distance(0, sequence) > 0) {
+    --missing; //The range wrapped past 0, which is never sent
+  }
+  lost_count += missing;
+  next = (sequence == 0) ? 1 : sequence;
+  drain();
+}
+//-----------------------------------------------------------------------------
+//! NACKs each run of missing frames between next and high_water. Runs past nacked_through are new
+//! and are NACKed at once; older runs are NACKed again once nack_interval has passed.
+//! \param now [IN] -- Time of the frame or heartbeat which prompted the check
+void Reliable_Sequencer::Implementation::request_missing(time_point now)
+{
+  auto span = sequence_distance(next, high_water);
+  if (span < 0) {
+    return;
+  }
+  auto start = next;
+  if (now - last_nack < options.nack_interval) {
+    if (sequence_distance(nacked_through, high_water) <= 0) {
+      return;
+    }
+    if (sequence_distance(next, nacked_through) >= 0) {
+      start = next_sequence(nacked_through);
+    }
+  }
+
+  pfc_uint run_first = 0;
+  pfc_uint run_count = 0;
+  for (auto sequence = start; sequence_distance(sequence, high_water) >= 0; sequence = next_sequence(sequence)) {
+    if (pending.count(sequence)) {
+      if (run_count) {
+        nack(run_first, run_count);
+        run_count = 0;
+      }
+    } else if (run_count++ == 0) {
+      run_first = sequence;
+    }
+  }
+  if (run_count) {
+    nack(run_first, run_count);
+  }
+  nacked_through = high_water;
+  last_nack = now;
+}
+//-----------------------------------------------------------------------------
+//! \param first [IN] -- First missing sequence
+//! \param count [IN] -- Consecutive missing sequences
+void Reliable_Sequencer::Implementation::nack(pfc_uint first, pfc_uint count)
+{
+  nack_function(first, count);
+  ++nack_count;
+}
+//-----------------------------------------------------------------------------
+//! \param options [IN] -- History size and timing. Should match the sender
+//! \param deliver [IN] -- Called with each payload in sequence order, on the thread feeding the sequencer
+//! \param nack [IN] -- Called with each run of missing sequences to request again, on the thread feeding the sequencer
+Reliable_Sequencer::Reliable_Sequencer(Reliable_Multicast_Options options, DeliverFunc deliver, NackFunc nack)
+  : _impl(std::make_unique<Implementation>(options, std::move(deliver), std::move(nack)))
+{
+}
+//-----------------------------------------------------------------------------
+//! Drops the held frames
+Reliable_Sequencer::~Reliable_Sequencer()
+{
+  _impl = nullptr;
+}
+//-----------------------------------------------------------------------------
+//! \param frame [IN,OUT] -- Frame received. Its payload is moved from
+//! \param now [IN] -- Arrival time, which paces the NACKs
+void Reliable_Sequencer::handle_data(pfc_reliable_data& frame, time_point now)
+{
+  _impl->handle_data(frame, now);
+}
+//-----------------------------------------------------------------------------
+//! \param heartbeat [IN] -- History advertised by the sender
+//! \param now [IN] -- Arrival time, which paces the NACKs
+void Reliable_Sequencer::handle_heartbeat(const pfc_reliable_heartbeat& heartbeat, time_point now)
+{
+  _impl->handle_heartbeat(heartbeat, now);
+}
+//-----------------------------------------------------------------------------
+//! \return bool -- true once a frame or heartbeat named the channel followed
+bool Reliable_Sequencer::synced() const
+{
+  return _impl->synced;
+}
+//-----------------------------------------------------------------------------
+//! \return pfc_uint -- Channel of the sender followed
+pfc_uint Reliable_Sequencer::channel() const
+{
+  return _impl->channel;
+}
+//-----------------------------------------------------------------------------
+//! \return pfc_uint -- Sequence delivered next
+pfc_uint Reliable_Sequencer::next() const
+{
+  return _impl->next;
+}
+//-----------------------------------------------------------------------------
+//! \return pfc_uint -- Newest sequence known to be sent
+pfc_uint Reliable_Sequencer::high_water() const
+{
+  return _impl->high_water;
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Frames held until the gap before them is repaired
+size_t Reliable_Sequencer::held() const
+{
+  return _impl->pending.size();
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Payloads passed to the DeliverFunc
+uint64_t Reliable_Sequencer::delivered() const
+{
+  return _impl->delivered_count;
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Frames skipped because the sender could no longer repair them
+uint64_t Reliable_Sequencer::lost() const
+{
+  return _impl->lost_count;
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- NACKs requested, one per run of missing frames
+uint64_t Reliable_Sequencer::nacks() const
+{
+  return _impl->nack_count;
+}
+//-----------------------------------------------------------------------------
+}
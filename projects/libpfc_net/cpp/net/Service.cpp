@@ -15,6 +15,7 @@ specific language governing permissions and limitations under the license.
 #include <sustain/framework/net/Service.h>
 
 #include <sustain/framework/Protocol.h>
+#include <sustain/framework/net/Endpoint.h>
 #include <sustain/framework/net/Multicast_Receiver.h>
 #include <sustain/framework/net/Multicast_Sender.h>
 #include <sustain/framework/util/Error.h>
@@ -85,10 +86,13 @@ void Service::Implementation::announce_service_creation(std::ostream& os)
 //! for the derived class to handle the inbound config. This allows services to depend on each other
 //! Before being fully live. 
 //!
+//! The registry packs several announcements back to back in to a single datagram
+//! so the callback is executed once for each announcement in the stream.
+//!
 void Service::Implementation::handle_service_broadcaster_message(std::istream& is)
 {
   pfc_service_announcement announcement;
-  if (announcement.deserialize(is).is_ok()) {
+  while (peek_message_type(is) == SERVICE_Announcement_REQUEST && announcement.deserialize(is).is_ok() && !is.fail()) {
     std::cout << "Registry Sent:" << announcement << "\n";
     if(service_broadcast_callback)
     { service_broadcast_callback(announcement); }
@@ -106,9 +110,10 @@ Service::Service(const Config config, const std::string& multicast_bind_address,
   pfc_service_announcement service;
   service._name = config.name;
   service._protacol = (config.style == Config::pub_sub) ? pfc_protocol::pub_sub : pfc_protocol::req_req;
-  service._address = config.address.c_str();
+  service._address = config.address.address();
   service._brief = config.brief;
   service._port = config.port;
+  advertise_endpoints(service, config.local_endpoints);
 
   _impl->style = config.style;
   _impl->service_config = service;
@@ -0,0 +1,489 @@
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+/*! \file */
+
+#include <sustain/framework/net/Shm_Ring.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace pfc {
+
+namespace {
+  constexpr uint64_t g_ring_magic = 0x50464353484d5231; //!< "PFCSHMR1", stored last so readers never use a half built ring
+  constexpr size_t g_record_align = 16; //!< Records start on this boundary so a wrap marker always fits before the end
+  constexpr uint32_t g_wrap_marker = UINT32_MAX; //!< Record size meaning the rest of the ring is unused
+  constexpr auto g_attach_interval = std::chrono::milliseconds(10); //!< Retry period of a reader waiting for its writer
+  constexpr auto g_liveness_interval = std::chrono::milliseconds(250); //!< Longest a reader sleeps before checking its writer is alive
+
+  static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "Shm_Ring needs address free atomics");
+
+  //!
+  //! Start of every mapping. The ring data follows it
+  //!
+  struct Ring_Header {
+    std::atomic<uint64_t> magic;
+    uint64_t capacity; //!< Bytes of ring data, a power of two
+    int32_t writer_pid;
+    alignas(64) std::atomic<uint64_t> reserved; //!< The writer may be overwriting anything before reserved - capacity
+    alignas(64) std::atomic<uint64_t> head; //!< Every record before head is complete
+    alignas(64) std::atomic<uint32_t> doorbell; //!< Futex word. Bumped whenever sleeping readers are woken
+    std::atomic<uint32_t> sleepers; //!< Readers in every process waiting on doorbell
+    std::atomic<uint32_t> closed; //!< Set when the writer is destroyed
+  };
+
+  //!
+  //! Precedes each message in the ring data
+  //!
+  struct Record_Header {
+    uint64_t sequence; //!< Messages written before this one, so readers can count what they lose
+    uint32_t size; //!< Payload bytes, or g_wrap_marker
+    uint32_t padding;
+  };
+  static_assert(sizeof(Record_Header) == g_record_align, "Record_Header must fill one record boundary");
+
+  //-----------------------------------------------------------------------------
+  //! \return size_t -- Ring bytes used by a message of size bytes
+  size_t record_bytes(size_t size)
+  {
+    return (sizeof(Record_Header) + size + g_record_align - 1) & ~(g_record_align - 1);
+  }
+  //-----------------------------------------------------------------------------
+  //! \return size_t -- Smallest power of two holding at least bytes
+  size_t round_capacity(size_t bytes)
+  {
+    size_t capacity = 4096;
+    while (capacity < bytes) {
+      capacity <<= 1;
+    }
+    return capacity;
+  }
+}
+
+//!
+//! PIMPL Implementation of a Shm_Ring
+//!
+struct Shm_Ring::Implementation {
+  Implementation(const std::string& name, Shm_Role, size_t capacity);
+  ~Implementation();
+
+  bool create();
+  bool attach();
+  void detach();
+  bool take(message& next);
+  void sleep(std::chrono::milliseconds timeout);
+  void wake();
+  bool writer_alive() const;
+
+  std::string name; //!< Name passed to shm_open
+  Shm_Role role;
+  size_t requested; //!< Ring size asked for by the writer
+
+  Ring_Header* header; //!< Start of the mapping, nullptr while detached
+  char* data; //!< Ring data inside the mapping
+  size_t mapped; //!< Bytes mapped
+  uint64_t capacity;
+  std::mutex map_mutex; //!< Held while the mapping changes so close can ring the doorbell safely
+
+  std::mutex write_mutex; //!< Serializes writers of one Shm_Ring
+  uint64_t sequence; //!< Messages written
+
+  uint64_t cursor; //!< Next byte this reader will read
+  uint64_t next_sequence; //!< Sequence expected at cursor
+  bool synced; //!< False until the first record after attaching sets next_sequence
+  std::atomic<uint64_t> lost_count;
+  std::atomic<bool> closing; //!< Set by close to end blocked reads
+
+  Error ec;
+};
+//-----------------------------------------------------------------------------
+//! \param n [IN] -- Name of the ring, the address of a shm:// URI
+//! \param r [IN] -- Which end this is
+//! \param c [IN] -- Ring size for a writer. Rounded up to a power of two
+Shm_Ring::Implementation::Implementation(const std::string& n, Shm_Role r, size_t c)
+  : name("/pfc_shm_" + n)
+  , role(r)
+  , requested(round_capacity(c))
+  , header(nullptr)
+  , data(nullptr)
+  , mapped(0)
+  , capacity(0)
+  , sequence(0)
+  , cursor(0)
+  , next_sequence(0)
+  , synced(false)
+  , lost_count(0)
+  , closing(false)
+{
+#if defined(__linux__)
+  if (role == Shm_Role::writer) {
+    create();
+  } else {
+    attach();
+  }
+#else
+  ec = Error::Code::PFC_PROTOCOL_NOT_SUPPORTED;
+#endif
+}
+//-----------------------------------------------------------------------------
+Shm_Ring::Implementation::~Implementation()
+{
+#if defined(__linux__)
+  if (role == Shm_Role::writer && header) {
+    header->closed.store(1, std::memory_order_seq_cst);
+    wake();
+    shm_unlink(name.c_str());
+  }
+  detach();
+#endif
+}
+//-----------------------------------------------------------------------------
+//! Creates the shared memory for a writer. A ring left behind by a writer which has exited is replaced
+//! \return bool -- false with ec set when the ring could not be created
+bool Shm_Ring::Implementation::create()
+{
+#if defined(__linux__)
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0660);
+  if (fd < 0 && errno == EEXIST) {
+    if (attach()) {
+      auto stale = !writer_alive();
+      detach();
+      if (!stale) {
+        ec = Error::Code::PFC_ADDRESS_IN_USE;
+        return false;
+      }
+    }
+    shm_unlink(name.c_str());
+    fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0660);
+  }
+  if (fd < 0) {
+    ec = (errno == EEXIST) ? Error::Code::PFC_ADDRESS_IN_USE : Error::Code::PFC_BIND_ERROR;
+    return false;
+  }
+  auto size = sizeof(Ring_Header) + requested;
+  void* mapping = MAP_FAILED;
+  if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+    mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    shm_unlink(name.c_str());
+    ec = Error::Code::PFC_BIND_ERROR;
+    return false;
+  }
+  //ftruncate zero fills, so only the constants need setting before the magic publishes them
+  auto ring = static_cast<Ring_Header*>(mapping);
+  ring->capacity = requested;
+  ring->writer_pid = static_cast<int32_t>(getpid());
+  ring->magic.store(g_ring_magic, std::memory_order_release);
+
+  std::lock_guard<std::mutex> guard(map_mutex);
+  header = ring;
+  data = static_cast<char*>(mapping) + sizeof(Ring_Header);
+  mapped = size;
+  capacity = requested;
+  return true;
+#else
+  return false;
+#endif
+}
+//-----------------------------------------------------------------------------
+//! Maps the ring of a writer. Readers start at the newest record
+//! \return bool -- false while no complete ring exists
+bool Shm_Ring::Implementation::attach()
+{
+#if defined(__linux__)
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat status;
+  void* mapping = MAP_FAILED;
+  if (fstat(fd, &status) == 0 && static_cast<size_t>(status.st_size) > sizeof(Ring_Header)) {
+    mapping = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+  auto size = static_cast<size_t>(status.st_size);
+  auto ring = static_cast<Ring_Header*>(mapping);
+  if (ring->magic.load(std::memory_order_acquire) != g_ring_magic || ring->capacity + sizeof(Ring_Header) != size) {
+    munmap(mapping, size);
+    return false;
+  }
+  std::lock_guard<std::mutex> guard(map_mutex);
+  header = ring;
+  data = static_cast<char*>(mapping) + sizeof(Ring_Header);
+  mapped = size;
+  capacity = ring->capacity;
+  cursor = ring->head.load(std::memory_order_acquire);
+  synced = false;
+  return true;
+#else
+  return false;
+#endif
+}
+//-----------------------------------------------------------------------------
+void Shm_Ring::Implementation::detach()
+{
+#if defined(__linux__)
+  std::lock_guard<std::mutex> guard(map_mutex);
+  if (header) {
+    munmap(header, mapped);
+    header = nullptr;
+    data = nullptr;
+    mapped = 0;
+  }
+#endif
+}
+//-----------------------------------------------------------------------------
+//! Copies the record at the cursor without blocking. Records the writer overwrote are skipped
+//! \param next [OUT] -- Payload of the record
+//! \return bool -- false when the reader has caught up with the writer
+bool Shm_Ring::Implementation::take(message& next)
+{
+  auto& ring = *header;
+  while (true) {
+    auto head = ring.head.load(std::memory_order_acquire);
+    if (cursor == head) {
+      return false;
+    }
+    auto offset = cursor & (capacity - 1);
+    Record_Header record;
+    if (head - cursor <= capacity) {
+      std::memcpy(&record, data + offset, sizeof(record));
+      if (record.size != g_wrap_marker && record.size <= capacity - offset - sizeof(record)) {
+        next.clear();
+        if (record.size) {
+          next.resize(record.size);
+          std::memcpy(next.data(), data + offset + sizeof(record), record.size);
+        }
+      }
+      //Everything copied is valid only if the writer had not started overwriting it by the time the copy finished
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (ring.reserved.load(std::memory_order_relaxed) - cursor <= capacity) {
+        if (record.size == g_wrap_marker) {
+          cursor += capacity - offset;
+          continue;
+        }
+        if (synced && record.sequence > next_sequence) {
+          lost_count += record.sequence - next_sequence;
+        }
+        synced = true;
+        next_sequence = record.sequence + 1;
+        cursor += record_bytes(record.size);
+        return true;
+      }
+    }
+    //Overrun. Resume with the next record written, whose sequence counts what was missed
+    cursor = ring.head.load(std::memory_order_acquire);
+  }
+}
+//-----------------------------------------------------------------------------
+//! Sleeps on the doorbell until the writer publishes, close is called or the timeout passes
+void Shm_Ring::Implementation::sleep(std::chrono::milliseconds timeout)
+{
+#if defined(__linux__)
+  auto& ring = *header;
+  ring.sleepers.fetch_add(1, std::memory_order_seq_cst);
+  auto bell = ring.doorbell.load(std::memory_order_seq_cst);
+  if (ring.head.load(std::memory_order_seq_cst) == cursor && !ring.closed && !closing) {
+    struct timespec wait;
+    wait.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+    wait.tv_nsec = static_cast<long>(timeout.count() % 1000) * 1000000;
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&ring.doorbell), FUTEX_WAIT, bell, &wait, nullptr, 0);
+  }
+  ring.sleepers.fetch_sub(1, std::memory_order_seq_cst);
+#else
+  std::this_thread::sleep_for(timeout);
+#endif
+}
+//-----------------------------------------------------------------------------
+//! Wakes every reader sleeping on the ring, in any process
+void Shm_Ring::Implementation::wake()
+{
+#if defined(__linux__)
+  header->doorbell.fetch_add(1, std::memory_order_seq_cst);
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&header->doorbell), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+//-----------------------------------------------------------------------------
+//! \return bool -- false once the writer of the mapped ring has been destroyed or its process has exited
+bool Shm_Ring::Implementation::writer_alive() const
+{
+#if defined(__linux__)
+  return !header->closed && (kill(header->writer_pid, 0) == 0 || errno == EPERM);
+#else
+  return false;
+#endif
+}
+//-----------------------------------------------------------------------------
+//! \param name [IN] -- Name shared by the writer and its readers. The address of a shm:// URI
+//! \param role [IN] -- Which end of the ring this is
+//! \param capacity [IN] -- Bytes of ring data created by a writer. Readers use the size the writer chose
+Shm_Ring::Shm_Ring(const std::string& name, Shm_Role role, size_t capacity)
+  : _impl(std::make_unique<Implementation>(name, role, capacity))
+{
+}
+//-----------------------------------------------------------------------------
+//! A writer marks the ring closed and removes its name so readers detach
+Shm_Ring::~Shm_Ring()
+{
+  _impl = nullptr;
+}
+//-----------------------------------------------------------------------------
+//! Appends a message and wakes sleeping readers. Never waits for readers
+//! \param payload [IN] -- Bytes to publish
+//! \param size [IN] -- Length of payload
+//! \return bool -- false for a reader, a ring which failed to create, or a message larger than the ring
+bool Shm_Ring::write(const char* payload, size_t size)
+{
+  auto& impl = *_impl;
+  std::lock_guard<std::mutex> guard(impl.write_mutex);
+  auto total = record_bytes(size);
+  if (impl.role != Shm_Role::writer || !impl.header || size >= g_wrap_marker || total > impl.capacity) {
+    return false;
+  }
+  auto& ring = *impl.header;
+  auto position = ring.head.load(std::memory_order_relaxed);
+  auto offset = position & (impl.capacity - 1);
+  auto remaining = impl.capacity - offset;
+  if (remaining < total) {
+    ring.reserved.store(position + remaining + total, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    Record_Header marker = { impl.sequence, g_wrap_marker, 0 };
+    std::memcpy(impl.data + offset, &marker, sizeof(marker));
+    position += remaining;
+    offset = 0;
+  } else {
+    ring.reserved.store(position + total, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+  Record_Header record = { impl.sequence++, static_cast<uint32_t>(size), 0 };
+  std::memcpy(impl.data + offset, &record, sizeof(record));
+  if (size) {
+    std::memcpy(impl.data + offset + sizeof(record), payload, size);
+  }
+  ring.head.store(position + total, std::memory_order_seq_cst);
+  if (ring.sleepers.load(std::memory_order_seq_cst)) {
+    impl.wake();
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+//! Blocks until a message arrives or close is called
+//! \param next [OUT] -- Copy of the next message. Its buffer is reused when large enough
+//! \return bool -- false once closed
+bool Shm_Ring::read(message& next)
+{
+  while (!_impl->closing) {
+    if (read(next, g_liveness_interval)) {
+      return true;
+    }
+  }
+  return false;
+}
+//-----------------------------------------------------------------------------
+//! \param next [OUT] -- Copy of the next message. Its buffer is reused when large enough
+//! \param timeout [IN] -- Longest to wait. Zero only takes what is already in the ring
+//! \return bool -- false on timeout, once closed, or for a writer
+bool Shm_Ring::read(message& next, std::chrono::milliseconds timeout)
+{
+  auto& impl = *_impl;
+  if (impl.role != Shm_Role::reader) {
+    return false;
+  }
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (!impl.closing) {
+    if (!impl.header && !impl.attach()) {
+      auto now = std::chrono::steady_clock::now();
+      if (now >= deadline) {
+        return false;
+      }
+      std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(deadline - now, g_attach_interval));
+      continue;
+    }
+    if (impl.take(next)) {
+      return true;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now >= deadline) {
+      return false;
+    }
+    auto wait = std::min(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now) + std::chrono::milliseconds(1), g_liveness_interval);
+    impl.sleep(wait);
+    if (impl.take(next)) {
+      return true;
+    }
+    if (!impl.writer_alive()) {
+      //The writer is gone and everything it wrote has been read. Wait for its replacement
+      impl.detach();
+    }
+  }
+  return false;
+}
+//-----------------------------------------------------------------------------
+//! Ends blocked and future reads. Safe to call from any thread
+void Shm_Ring::close()
+{
+  auto& impl = *_impl;
+  impl.closing = true;
+  std::lock_guard<std::mutex> guard(impl.map_mutex);
+  if (impl.header) {
+    impl.wake();
+  }
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Bytes of ring data, zero until a reader has attached
+size_t Shm_Ring::capacity() const
+{
+  return static_cast<size_t>(_impl->capacity);
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Messages a reader missed because the writer overran it
+uint64_t Shm_Ring::lost() const
+{
+  return _impl->lost_count;
+}
+//-----------------------------------------------------------------------------
+//! \return bool -- Shortcut for error().is_ok()
+bool Shm_Ring::is_valid() const
+{
+  return _impl->ec.is_ok();
+}
+//-----------------------------------------------------------------------------
+//! \return Error -- PFC_ADDRESS_IN_USE when a live writer already owns the name, PFC_BIND_ERROR when the
+//!                  shared memory could not be created, PFC_PROTOCOL_NOT_SUPPORTED off Linux
+Error Shm_Ring::error() const
+{
+  return _impl->ec;
+}
+//-----------------------------------------------------------------------------
+}
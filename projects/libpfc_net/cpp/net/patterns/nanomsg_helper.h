@@ -15,12 +15,22 @@ specific language governing permissions and limitations under the license.
 
 /*! \file */
 
+#include <sustain/framework/net/Message.h>
+#include <sustain/framework/net/Patterns.h>
 #include <sustain/framework/util/Error.h>
 
 #include <nanomsg/nn.h>
 
+#include <chrono>
+
 namespace pfc {
 
+//!
+//!  Value held by a socket member before nn_socket succeeds and after nn_close. nanomsg hands out 0
+//!  as a valid socket, the first one a process opens, so only a negative socket means none and a
+//!  socket is open exactly when it is >= 0.
+constexpr int no_socket = -1;
+
 //!  
 //!  Converts nanomsg Errors to PFC Errors
 //!  \param code [IN] Known NanoMSG Error
@@ -81,5 +91,168 @@ inline Error nano_to_Error(int code)
   return l_ec;
 }
 //-------------------------------------------------------------------------------
+//!
+//!  Sends a message. nanomsg storage is handed over with NN_MSG so nanomsg takes ownership
+//!  without copying; pooled storage is copied by nanomsg and stays with the message.
+//!  \param socket [IN] Socket to send on
+//!  \param msg [IN,OUT] Message to send. Emptied when nanomsg took ownership, untouched if the send failed
+//!  \param flags [IN] nn_send flags
+//!  \return int - Result of nn_send. Check nn_errno when negative
+inline int send_message(int socket, message& msg, int flags = 0)
+{
+  if (msg.storage() == message::Storage::nanomsg) {
+    auto size = msg.size();
+    if (void* chunk = msg.release_chunk()) {
+      int bytes = nn_send(socket, &chunk, NN_MSG, flags);
+      if (bytes < 0) {
+        //On failure the chunk still belongs to us
+        msg = message::adopt(chunk, size);
+      }
+      return bytes;
+    }
+  }
+  return nn_send(socket, msg.data(), msg.size(), flags);
+}
+//-------------------------------------------------------------------------------
+//!
+//!  Adapts a vector generator to the zero copy interface. Each vector is copied once in to
+//!  a nanomsg message, which is what nn_send did with the vector before.
+//!  \param func [IN] Generator returning serialized messages
+//!  \return Broadcaster::MessageFunc - Generator returning the same bytes as messages
+inline Broadcaster::MessageFunc to_message_func(Broadcaster::BroadcastFunc func)
+{
+  return [func]() {
+    auto buffer = func();
+    return message(buffer.data(), buffer.size());
+  };
+}
+//-------------------------------------------------------------------------------
+//!
+//!  Adapts a vector listener to the zero copy interface. The reply vector is copied once in to
+//!  a nanomsg message, which is what nn_send did with the vector before.
+//!  \param func [IN] Listener returning serialized replies
+//!  \return Listiner::MessageListenFunc - Listener returning the same bytes as messages
+inline Listiner::MessageListenFunc to_message_func(Listiner::ListenFunc func)
+{
+  return [func](message request) {
+    auto reply = func(request.data(), request.size());
+    return (reply.empty()) ? message() : message(reply.data(), reply.size());
+  };
+}
+//-------------------------------------------------------------------------------
+//!
+//!  Receives the next message in the buffer nanomsg allocated for it
+//!  \param socket [IN] Socket to receive on
+//!  \param msg [OUT] Owns the received buffer on success
+//!  \param flags [IN] nn_recv flags
+//!  \return int - Result of nn_recv. Check nn_errno when negative
+inline int receive_message(int socket, message& msg, int flags = 0)
+{
+  void* chunk = nullptr;
+  int bytes = nn_recv(socket, &chunk, NN_MSG, flags);
+  if (bytes >= 0) {
+    msg = message::adopt(chunk, static_cast<size_t>(bytes));
+  }
+  return bytes;
+}
+//-------------------------------------------------------------------------------
+//!
+//!  Receives from an AF_SP_RAW socket keeping the routing header nanomsg needs to
+//!  deliver the reply to the right peer.
+//!  \param socket [IN] Raw socket to receive on
+//!  \param msg [OUT] Owns the received body on success
+//!  \param control [OUT] Owns the routing header on success. Pass it to send_routed or free it with nn_freemsg
+//!  \param flags [IN] nn_recvmsg flags
+//!  \return int - Result of nn_recvmsg. Check nn_errno when negative
+inline int receive_routed(int socket, message& msg, void*& control, int flags = 0)
+{
+  void* body = nullptr;
+  struct nn_iovec iov;
+  iov.iov_base = &body;
+  iov.iov_len = NN_MSG;
+  struct nn_msghdr header;
+  header.msg_iov = &iov;
+  header.msg_iovlen = 1;
+  header.msg_control = &control;
+  header.msg_controllen = NN_MSG;
+  int bytes = nn_recvmsg(socket, &header, flags);
+  if (bytes >= 0) {
+    msg = message::adopt(body, static_cast<size_t>(bytes));
+  }
+  return bytes;
+}
+//-------------------------------------------------------------------------------
+//!
+//!  Sends a reply on an AF_SP_RAW socket to the peer identified by a routing header
+//!  \param socket [IN] Raw socket the request arrived on
+//!  \param msg [IN,OUT] Reply. Handed over with NN_MSG when it holds nanomsg storage
+//!  \param control [IN,OUT] Routing header from receive_routed. nanomsg always consumes it, so it is nulled
+//!  \param flags [IN] nn_sendmsg flags
+//!  \return int - Result of nn_sendmsg. Check nn_errno when negative
+inline int send_routed(int socket, message& msg, void*& control, int flags = 0)
+{
+  auto size = msg.size();
+  void* chunk = msg.release_chunk();
+  struct nn_iovec iov;
+  if (chunk) {
+    iov.iov_base = &chunk;
+    iov.iov_len = NN_MSG;
+  } else {
+    iov.iov_base = msg.data();
+    iov.iov_len = msg.size();
+  }
+  struct nn_msghdr header;
+  header.msg_iov = &iov;
+  header.msg_iovlen = 1;
+  header.msg_control = &control;
+  header.msg_controllen = NN_MSG;
+  int bytes = nn_sendmsg(socket, &header, flags);
+  //nanomsg frees an NN_MSG header even when the send fails, but leaves a failed body with the caller
+  control = nullptr;
+  if (bytes < 0 && chunk) {
+    msg = message::adopt(chunk, size);
+  }
+  return bytes;
+}
+//-------------------------------------------------------------------------------
+//!
+//! Request or survey read from a raw socket waiting for a worker
+//!
+struct Routed_Request {
+  Routed_Request() = default;
+  Routed_Request(const Routed_Request&) = delete;
+  Routed_Request(Routed_Request&& rhs) noexcept { *this = std::move(rhs); }
+  ~Routed_Request() { release(); }
+
+  Routed_Request& operator=(const Routed_Request&) = delete;
+  Routed_Request& operator=(Routed_Request&& rhs) noexcept
+  {
+    if (this != &rhs) {
+      release();
+      body = std::move(rhs.body);
+      control = rhs.control;
+      received = rhs.received;
+      rhs.control = nullptr;
+    }
+    return *this;
+  }
+  void release()
+  {
+    if (control) {
+      nn_freemsg(control);
+      control = nullptr;
+    }
+  }
+
+  message body;
+  void* control = nullptr; //!< nanomsg routing header. Identifies the peer the reply goes to and, for a survey, which survey it answers
+  std::chrono::steady_clock::time_point received;
+};
+//-------------------------------------------------------------------------------
+//!
+//!  Messages a Listiner reads each time its Reactor reports it ready, so one busy socket can not
+//!  starve the others sharing the Reactor
+constexpr int reactor_batch = 64;
+//-------------------------------------------------------------------------------
 }
 #endif //SUSTAIN_FRAMEWORK_NET_NANOMSG_HELPER_H
@@ -0,0 +1,410 @@
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+/*! \file */
+
+#include <sustain/framework/net/patterns/pipeline/Puller.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nanomsg/pipeline.h>
+
+#include "../nanomsg_helper.h"
+#include <sustain/framework/net/Reactor.h>
+#include <sustain/framework/util/Work_Stealing_Deque.h>
+
+namespace pfc {
+
+namespace {
+  constexpr int g_idle_poll = 100; //!< Longest an idle worker sleeps in nn_poll, which bounds how long shutdown waits
+}
+
+//!
+//! One thread of a Pipeline_Puller and the work it has read but not started
+//!
+struct Puller_Worker {
+  explicit Puller_Worker(size_t depth)
+    : deque(depth)
+  {
+  }
+  ~Puller_Worker()
+  {
+    message* work = nullptr;
+    while (deque.try_pop(work)) {
+      delete work;
+    }
+  }
+
+  Work_Stealing_Deque<message*> deque; //!< Popped by this worker, stolen by the others
+  std::thread thread;
+};
+//!
+//! PIMPL Implementation for a Pipeline_Puller
+//!
+struct Pipeline_Puller::Implementation {
+  Implementation(URI&&, Puller_Options&&);
+  ~Implementation();
+
+  void listen();
+  void work(size_t index);
+  bool fill(Puller_Worker& self, std::unique_ptr<message>& work);
+  bool steal(size_t thief, std::unique_ptr<message>& work);
+  void idle();
+  void wake();
+  void run(message& work);
+  void react(int ready_socket);
+  void stop();
+
+  URI uri; //!<  URI of the service to be given to nano_msg
+  int socket; //!<  Socket the service runs
+  int rv; //!<  return value of any nano_msg calls
+  std::atomic<bool> running; //!<  Run control for async threading
+  Reactor* reactor; //!< Reactor the socket is registered with by async_listen, else nullptr
+
+  Puller_Options options;
+  MessageListenFunc message_process_function;
+  std::vector<std::unique_ptr<Puller_Worker>> workers;
+
+  int wake_pull; //!< Polled with socket by idle workers so queued work interrupts nn_poll
+  int wake_push;
+  std::atomic<int> idle_count; //!< Workers which may be blocked in nn_poll
+
+  std::atomic<uint64_t> processed_count;
+  std::atomic<uint64_t> stolen_count;
+  Error ec; //!< Current Error code of the system else Success()
+};
+//-------------------------------------------------------------------------------
+//!
+//! URI based constructor
+//! \param u [IN,OUT] Moves URI in to palce and stands up nn_socket and nn_connect
+//! \param o [IN] Worker pool configuration
+Pipeline_Puller::Implementation::Implementation(URI&& u, Puller_Options&& o)
+  : uri(std::move(u))
+  , socket(no_socket)
+  , rv(0)
+  , running(false)
+  , reactor(nullptr)
+  , options(std::move(o))
+  , wake_pull(no_socket)
+  , wake_push(no_socket)
+  , idle_count(0)
+  , processed_count(0)
+  , stolen_count(0)
+{
+  if (options.workers == 0) {
+    options.workers = std::max(1u, std::thread::hardware_concurrency());
+  }
+  if (options.prefetch == 0) {
+    options.prefetch = 1;
+  }
+  if ((socket = nn_socket(AF_SP, NN_PULL)) < 0) {
+    ec = nano_to_Error(nn_errno());
+  }
+  if ((rv = nn_connect(socket, uri.c_str())) < 0) {
+    ec = nano_to_Error(nn_errno());
+    rv = 0;
+  }
+  auto wake_endpoint = "inproc://pfc_puller_wake_" + std::to_string(reinterpret_cast<uintptr_t>(this));
+  if ((wake_pull = nn_socket(AF_SP, NN_PULL)) < 0 || nn_bind(wake_pull, wake_endpoint.c_str()) < 0
+      || (wake_push = nn_socket(AF_SP, NN_PUSH)) < 0 || nn_connect(wake_push, wake_endpoint.c_str()) < 0) {
+    ec = nano_to_Error(nn_errno());
+  }
+}
+//-------------------------------------------------------------------------------
+//! Deconstructor for Implementation - Shutsdown all pending nn activity and clears memory
+Pipeline_Puller::Implementation::~Implementation()
+{
+  stop();
+  if (socket >= 0) {
+    if (rv) {
+      nn_shutdown(socket, rv);
+    }
+    nn_close(socket);
+  }
+  socket = no_socket;
+  rv = 0;
+  for (auto wake_socket : { &wake_push, &wake_pull }) {
+    if (*wake_socket >= 0) {
+      nn_close(*wake_socket);
+      *wake_socket = no_socket;
+    }
+  }
+}
+//-------------------------------------------------------------------------------
+//! Blocking receive of work items run on the calling thread
+void Pipeline_Puller::Implementation::listen()
+{
+  message work;
+  do {
+    if (receive_message(socket, work) < 0) {
+      ec = nano_to_Error(nn_errno());
+      continue;
+    }
+    run(work);
+  } while (running);
+}
+//-------------------------------------------------------------------------------
+//! Worker thread. Runs its own queued work first, then reads more from the socket, then steals
+//! from its siblings, and only sleeps when all three come up empty
+//! \param index [IN] -- Position of this worker in workers
+void Pipeline_Puller::Implementation::work(size_t index)
+{
+  auto& self = *workers[index];
+  std::unique_ptr<message> work;
+  message* queued = nullptr;
+  while (running) {
+    if (self.deque.try_pop(queued)) {
+      work.reset(queued);
+    } else if (!fill(self, work) && !steal(index, work)) {
+      idle();
+      continue;
+    }
+    run(*work);
+    work = nullptr;
+  }
+}
+//-------------------------------------------------------------------------------
+//! Reads up to Puller_Options::prefetch messages without blocking. The first is returned to run
+//! straight away, the rest are queued where idle siblings can steal them
+//! \param self [IN,OUT] -- The calling worker
+//! \param work [OUT] -- First message read
+//! \return bool -- false when nothing was waiting on the socket
+bool Pipeline_Puller::Implementation::fill(Puller_Worker& self, std::unique_ptr<message>& work)
+{
+  work = std::make_unique<message>();
+  if (receive_message(socket, *work, NN_DONTWAIT) < 0) {
+    if (nn_errno() != EAGAIN && running) {
+      ec = nano_to_Error(nn_errno());
+    }
+    work = nullptr;
+    return false;
+  }
+  size_t queued = 0;
+  auto next = std::make_unique<message>();
+  while (queued + 1 < options.prefetch && self.deque.size() < self.deque.capacity()
+         && receive_message(socket, *next, NN_DONTWAIT) >= 0) {
+    if (!self.deque.try_push(next.get())) {
+      run(*next);
+      break;
+    }
+    next.release();
+    next = std::make_unique<message>();
+    ++queued;
+  }
+  if (queued) {
+    wake();
+  }
+  return true;
+}
+//-------------------------------------------------------------------------------
+//! Takes the oldest queued work of the first sibling which has any
+//! \param thief [IN] -- Position of the calling worker in workers
+//! \param work [OUT] -- Stolen message
+//! \return bool -- false when every sibling was empty
+bool Pipeline_Puller::Implementation::steal(size_t thief, std::unique_ptr<message>& work)
+{
+  message* stolen = nullptr;
+  for (size_t offset = 1; offset < workers.size(); ++offset) {
+    auto& victim = *workers[(thief + offset) % workers.size()];
+    if (victim.deque.try_steal(stolen)) {
+      work.reset(stolen);
+      ++stolen_count;
+      //Pass the wake up on while the victim still has a backlog
+      if (!victim.deque.empty()) {
+        wake();
+      }
+      return true;
+    }
+  }
+  return false;
+}
+//-------------------------------------------------------------------------------
+//! Sleeps until the socket is readable, a sibling queues work or g_idle_poll expires
+void Pipeline_Puller::Implementation::idle()
+{
+  idle_count.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  //Recheck after announcing, a sibling which queued work before seeing idle_count did not wake us
+  for (auto& worker : workers) {
+    if (!worker->deque.empty()) {
+      idle_count.fetch_sub(1, std::memory_order_relaxed);
+      return;
+    }
+  }
+  nn_pollfd fds[2] = { nn_pollfd { socket, NN_POLLIN, 0 }, nn_pollfd { wake_pull, NN_POLLIN, 0 } };
+  nn_poll(fds, (wake_pull >= 0) ? 2 : 1, g_idle_poll);
+  if (fds[1].revents & NN_POLLIN) {
+    void* wake_message = nullptr;
+    while (nn_recv(wake_pull, &wake_message, NN_MSG, NN_DONTWAIT) >= 0) {
+      nn_freemsg(wake_message);
+    }
+  }
+  idle_count.fetch_sub(1, std::memory_order_relaxed);
+}
+//-------------------------------------------------------------------------------
+//! Interrupts the nn_poll of idle workers. Free while no worker is idle
+void Pipeline_Puller::Implementation::wake()
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (idle_count.load(std::memory_order_relaxed) && wake_push >= 0) {
+    nn_send(wake_push, "", 0, NN_DONTWAIT);
+  }
+}
+//-------------------------------------------------------------------------------
+//! \param work [IN,OUT] -- Work item handed to the ListenFunc. Its reply is discarded
+void Pipeline_Puller::Implementation::run(message& work)
+{
+  message_process_function(std::move(work));
+  ++processed_count;
+}
+//-------------------------------------------------------------------------------
+//! Called by the Reactor when work is waiting. Runs up to reactor_batch items without blocking
+//! \param ready_socket [IN] -- The puller socket
+void Pipeline_Puller::Implementation::react(int ready_socket)
+{
+  message work;
+  for (int count = 0; count < reactor_batch; ++count) {
+    if (receive_message(ready_socket, work, NN_DONTWAIT) < 0) {
+      if (nn_errno() != EAGAIN) {
+        ec = nano_to_Error(nn_errno());
+      }
+      return;
+    }
+    run(work);
+  }
+}
+//-------------------------------------------------------------------------------
+//! Detaches from the Reactor and joins the workers once they finish the item they are running.
+//! Idle workers leave nn_poll within g_idle_poll, so the socket and the wake pair stay open until
+//! no worker can use them
+void Pipeline_Puller::Implementation::stop()
+{
+  running = false;
+  if (reactor) {
+    reactor->remove(socket);
+    reactor = nullptr;
+  }
+  if (wake_push >= 0) {
+    nn_send(wake_push, "", 0, NN_DONTWAIT);
+  }
+  for (auto& worker : workers) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+  workers.clear();
+}
+//-------------------------------------------------------------------------------
+//!  URI based constructor. Takes a copy of a URI to setup networking information
+//! \param uri [IN]  Endpoint of the Pipeline_Pusher
+//! \param options [IN] Worker pool used by async_listen
+Pipeline_Puller::Pipeline_Puller(URI uri, Puller_Options options)
+  : _impl(std::make_unique<Implementation>(std::move(uri), std::move(options)))
+{
+}
+//-------------------------------------------------------------------------------
+//!  Shuts down async threading and fress all memory
+Pipeline_Puller::~Pipeline_Puller()
+{
+  _impl = nullptr;
+}
+//-------------------------------------------------------------------------------
+//! \return uint64_t -- Work items the ListenFunc has finished
+uint64_t Pipeline_Puller::processed() const
+{
+  return _impl->processed_count;
+}
+//-------------------------------------------------------------------------------
+//! \return uint64_t -- Work items run by a worker other than the one which read them
+uint64_t Pipeline_Puller::stolen() const
+{
+  return _impl->stolen_count;
+}
+//-------------------------------------------------------------------------------
+//!
+//! \param func [IN] -- Function that will be called when work is received
+//!
+//! Blocking call for receiving a single work item
+void Pipeline_Puller::listen(MessageListenFunc func)
+{
+  _impl->message_process_function = func;
+  _impl->running = false;
+  _impl->listen();
+}
+//-------------------------------------------------------------------------------
+//! \param func [IN] -- Function that will be called for each work item. Called from every worker at once
+//! Non Blocking listen; starts the worker pool which runs until shutdown
+void Pipeline_Puller::async_listen(MessageListenFunc func)
+{
+  auto& impl = *_impl;
+  impl.message_process_function = func;
+  impl.running = true;
+  for (size_t worker = 0; worker < impl.options.workers; ++worker) {
+    impl.workers.push_back(std::make_unique<Puller_Worker>(impl.options.deque_depth));
+  }
+  //Threads start once every deque exists, as any worker may steal from any other
+  for (size_t worker = 0; worker < impl.workers.size(); ++worker) {
+    impl.workers[worker]->thread = std::thread(&Implementation::work, &impl, worker);
+  }
+}
+//-------------------------------------------------------------------------------
+//! \param reactor [IN] -- Reactor which polls the socket in place of the worker pool
+//! \param func [IN] -- Function that will be called for each work item
+//!
+//! Non Blocking listen without threads of its own. func runs on a Reactor worker
+void Pipeline_Puller::async_listen(Reactor& reactor, MessageListenFunc func)
+{
+  _impl->message_process_function = func;
+  _impl->running = true;
+  auto impl = _impl.get();
+  auto ec = reactor.add(_impl->socket, NN_POLLIN, [impl](int ready_socket, short) { impl->react(ready_socket); });
+  if (ec) {
+    _impl->ec = ec;
+    return;
+  }
+  _impl->reactor = &reactor;
+}
+//-------------------------------------------------------------------------------
+//!
+//! \param func [IN] -- Function that will be called when work is received
+//!
+//! Blocking call for receiving a single work item. Adapts func with to_message_func
+void Pipeline_Puller::listen(ListenFunc func)
+{
+  listen(to_message_func(std::move(func)));
+}
+//-------------------------------------------------------------------------------
+//! \param func [IN] -- Function that will be called for each work item
+//!
+//! Non Blocking listen. Adapts func with to_message_func
+void Pipeline_Puller::async_listen(ListenFunc func)
+{
+  async_listen(to_message_func(std::move(func)));
+}
+//-------------------------------------------------------------------------------
+//! Part of the Pattern interface stands up all IO not handled by the RIIA
+void Pipeline_Puller::standup()
+{
+}
+//-------------------------------------------------------------------------------
+//! Stops the worker pool. Workers finish the item they are running and queued work is dropped
+void Pipeline_Puller::shutdown()
+{
+  _impl->stop();
+}
+//-------------------------------------------------------------------------------
+}
@@ -0,0 +1,219 @@
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+/*! \file */
+
+#include <sustain/framework/net/patterns/pipeline/Pusher.h>
+
+#include <atomic>
+#include <thread>
+
+#include <nanomsg/pipeline.h>
+
+#include "../nanomsg_helper.h"
+
+namespace pfc {
+
+//!
+//! PIMPL Implementation for a Pipeline_Pusher
+//!
+struct Pipeline_Pusher::Implementation {
+  Implementation(URI&&);
+  ~Implementation();
+
+  void push();
+  bool send(message& work, int flags);
+
+  URI uri; //!<  URI of the service to be given to nano_msg
+  int socket; //!<  Socket the service runs
+  int rv; //!<  return value of any nano_msg calls
+  std::atomic<bool> running; //!<  Run control for async threading
+
+  std::thread pipeline_main_thread; //!< Runs async_broadcast
+  MessageFunc generate_message_func; //!< Generator used by broadcast and async_broadcast
+
+  std::atomic<uint64_t> pushed_count;
+  Error ec; //!< Current Error code of the system else Success()
+};
+//-------------------------------------------------------------------------------
+//!
+//! URI based constructor
+//! \param u [IN,OUT] Moves URI in to palce and stands up nn_socket and nn_bind
+Pipeline_Pusher::Implementation::Implementation(URI&& u)
+  : uri(std::move(u))
+  , socket(no_socket)
+  , rv(0)
+  , running(false)
+  , pushed_count(0)
+{
+  if ((socket = nn_socket(AF_SP, NN_PUSH)) < 0) {
+    ec = nano_to_Error(nn_errno());
+  }
+  if ((rv = nn_bind(socket, uri.c_str())) < 0) {
+    ec = nano_to_Error(nn_errno());
+    rv = 0;
+  }
+}
+//-------------------------------------------------------------------------------
+//! Deconstructor for Implementation - Shutsdown all pending nn activity and clears memory
+Pipeline_Pusher::Implementation::~Implementation()
+{
+  running = false;
+  if (rv && socket >= 0) {
+    nn_shutdown(socket, rv);
+  }
+  //Closing the socket wakes a broadcast thread blocked in nn_send
+  if (socket >= 0) {
+    nn_close(socket);
+  }
+  if (pipeline_main_thread.joinable()) {
+    pipeline_main_thread.join();
+  }
+  socket = no_socket;
+}
+//-------------------------------------------------------------------------------
+//! Sends generated work until running is cleared
+void Pipeline_Pusher::Implementation::push()
+{
+  do {
+    auto work = generate_message_func();
+    send(work, 0);
+  } while (running);
+}
+//-------------------------------------------------------------------------------
+//! \param work [IN,OUT] -- Message to send. nanomsg takes ownership of nanomsg storage
+//! \param flags [IN] -- nn_send flags
+//! \return bool -- false when nanomsg rejected the message. ec is set unless it was NN_DONTWAIT backpressure
+bool Pipeline_Pusher::Implementation::send(message& work, int flags)
+{
+  if (send_message(socket, work, flags) < 0) {
+    if (nn_errno() != EAGAIN) {
+      ec = nano_to_Error(nn_errno());
+    }
+    return false;
+  }
+  ++pushed_count;
+  return true;
+}
+//-------------------------------------------------------------------------------
+//!  URI based constructor. Takes a copy of a URI to setup networking information
+//! \param uri [IN]  Endpoint workers connect to
+Pipeline_Pusher::Pipeline_Pusher(URI uri)
+  : _impl(std::make_unique<Implementation>(std::move(uri)))
+{
+}
+//-------------------------------------------------------------------------------
+//!  Shuts down async threading and fress all memory
+Pipeline_Pusher::~Pipeline_Pusher()
+{
+  _impl = nullptr;
+}
+//-------------------------------------------------------------------------------
+//! Hands a message to the next worker with room for it, waiting while every worker is full
+//! \param work [IN] -- Work item. nanomsg storage is sent without a copy
+//! \return Error -- Result of nn_send
+Error Pipeline_Pusher::push(message work)
+{
+  if (!_impl->send(work, 0)) {
+    return nano_to_Error(nn_errno());
+  }
+  return Success();
+}
+//-------------------------------------------------------------------------------
+//! \param buffer [IN] -- Serialized work item. Copied once in to a nanomsg message
+//! \return Error -- As push(message)
+Error Pipeline_Pusher::push(const std::vector<char>& buffer)
+{
+  return push(message(buffer.data(), buffer.size()));
+}
+//-------------------------------------------------------------------------------
+//! Hands a message to the next worker with room for it without waiting
+//! \param work [IN,OUT] -- Work item. Left untouched when the push fails
+//! \return bool -- false when no worker had room or nanomsg rejected the message
+bool Pipeline_Pusher::try_push(message& work)
+{
+  return _impl->send(work, NN_DONTWAIT);
+}
+//-------------------------------------------------------------------------------
+//! Listens on another endpoint as well as the one given at construction
+//! \param endpoint [IN] -- Endpoint to bind, e.g. one of local_endpoints
+//! \return Error -- PFC_BAD_OPERATION when the pusher has no socket, else the result of nn_bind
+Error Pipeline_Pusher::bind(URI endpoint)
+{
+  if (_impl->socket < 0) {
+    return Error::Code::PFC_BAD_OPERATION;
+  }
+  if (nn_bind(_impl->socket, endpoint.c_str()) < 0) {
+    return nano_to_Error(nn_errno());
+  }
+  return Success();
+}
+//-------------------------------------------------------------------------------
+//! \return uint64_t -- Work items handed to nanomsg
+uint64_t Pipeline_Pusher::pushed() const
+{
+  return _impl->pushed_count;
+}
+//-------------------------------------------------------------------------------
+//! Workers never reply to a pusher, so the callback is never called
+void Pipeline_Pusher::set_response_callaback_func(CallbackFunc)
+{
+}
+//-------------------------------------------------------------------------------
+//!
+//! \param func [IN] -- Function that will be called to generate a work item
+//!
+//! Blocking call which pushes a single work item
+void Pipeline_Pusher::broadcast(MessageFunc func)
+{
+  _impl->generate_message_func = func;
+  _impl->running = false;
+  _impl->push();
+}
+//-------------------------------------------------------------------------------
+//! \param func [IN] --  Function that will be called to generate each work item
+//! Non Blocking broadcast; pushes generated work until shutdown, waiting while every worker is full
+void Pipeline_Pusher::async_broadcast(MessageFunc func)
+{
+  _impl->generate_message_func = func;
+  _impl->running = true;
+  _impl->pipeline_main_thread = std::thread(&Implementation::push, _impl.get());
+}
+//-------------------------------------------------------------------------------
+//! \param func [IN] -- Function that will be called to generate a work item
+//!
+//! Copies each generated vector in to a nanomsg message and sends it with broadcast(MessageFunc)
+void Pipeline_Pusher::broadcast(BroadcastFunc func)
+{
+  broadcast(to_message_func(std::move(func)));
+}
+//-------------------------------------------------------------------------------
+//! \param func [IN] -- Function that will be called to generate each work item
+//!
+//! Copies each generated vector in to a nanomsg message and sends it with async_broadcast(MessageFunc)
+void Pipeline_Pusher::async_broadcast(BroadcastFunc func)
+{
+  async_broadcast(to_message_func(std::move(func)));
+}
+//-------------------------------------------------------------------------------
+//! Part of the Pattern interface stands up all IO not handled by the RIIA
+void Pipeline_Pusher::standup()
+{
+}
+//-------------------------------------------------------------------------------
+//! Stops async_broadcast. Work already handed to nanomsg is still delivered
+void Pipeline_Pusher::shutdown()
+{
+  _impl->running = false;
+}
+//-------------------------------------------------------------------------------
+}
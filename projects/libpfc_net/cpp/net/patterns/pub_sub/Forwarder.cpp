@@ -0,0 +1,208 @@
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+/*! \file */
+
+#include <sustain/framework/net/patterns/pub_sub/Forwarder.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include <nanomsg/pubsub.h>
+
+#include "../nanomsg_helper.h"
+
+namespace pfc {
+
+//!
+//! PIMPL Implementation for a PubSub_Forwarder
+//!
+struct PubSub_Forwarder::Implementation {
+  Implementation(URI&& upstream, URI&& downstream, const std::string& topic);
+  ~Implementation();
+
+  Error forward();
+  void close();
+
+  int upstream_socket; //!< Raw SUB socket connected to the publishers
+  int downstream_socket; //!< Raw PUB socket subscribers connect to
+  std::atomic<bool> running; //!< True while nn_device may be running
+  std::thread forward_thread; //!< Runs async_forward
+  std::mutex close_mutex;
+
+  Error ec; //!< Current Error code of the system else Success()
+};
+//-------------------------------------------------------------------------------
+//! \param upstream [IN,OUT] -- Publisher, or downstream endpoint of another forwarder, to connect to
+//! \param downstream [IN,OUT] -- Endpoint to bind for subscribers
+//! \param topic [IN] -- Prefix of the messages to forward. Empty forwards everything
+PubSub_Forwarder::Implementation::Implementation(URI&& upstream, URI&& downstream, const std::string& topic)
+  : upstream_socket(no_socket)
+  , downstream_socket(no_socket)
+  , running(false)
+{
+  if ((upstream_socket = nn_socket(AF_SP_RAW, NN_SUB)) < 0
+      || nn_setsockopt(upstream_socket, NN_SUB, NN_SUB_SUBSCRIBE, topic.data(), topic.size()) < 0
+      || nn_connect(upstream_socket, upstream.c_str()) < 0) {
+    ec = nano_to_Error(nn_errno());
+  }
+  if ((downstream_socket = nn_socket(AF_SP_RAW, NN_PUB)) < 0 || nn_bind(downstream_socket, downstream.c_str()) < 0) {
+    ec = nano_to_Error(nn_errno());
+  }
+}
+//-------------------------------------------------------------------------------
+//! Deconstructor for Implementation - Stops nn_device and closes both sockets
+PubSub_Forwarder::Implementation::~Implementation()
+{
+  close();
+  if (forward_thread.joinable()) {
+    forward_thread.join();
+  }
+}
+//-------------------------------------------------------------------------------
+//! Runs nn_device until close is called or nanomsg fails
+//! \return Error -- Success() when stopped by close, else why nanomsg stopped forwarding
+Error PubSub_Forwarder::Implementation::forward()
+{
+  int upstream = no_socket;
+  int downstream = no_socket;
+  {
+    std::lock_guard<std::mutex> guard(close_mutex);
+    if (upstream_socket < 0 || downstream_socket < 0) {
+      return Error::Code::PFC_INVALID_SOCKET;
+    }
+    upstream = upstream_socket;
+    downstream = downstream_socket;
+    running = true;
+  }
+  nn_device(upstream, downstream);
+  auto code = nn_errno();
+  if (!running.exchange(false)) {
+    return Success();
+  }
+  ec = nano_to_Error(code);
+  return ec;
+}
+//-------------------------------------------------------------------------------
+//! Closing the sockets is the only way to return from nn_device short of nn_term, which would stop
+//! every other socket in the process
+void PubSub_Forwarder::Implementation::close()
+{
+  std::lock_guard<std::mutex> guard(close_mutex);
+  running = false;
+  for (auto socket : { &upstream_socket, &downstream_socket }) {
+    if (*socket >= 0) {
+      nn_close(*socket);
+      *socket = no_socket;
+    }
+  }
+}
+//-------------------------------------------------------------------------------
+//! \param upstream [IN] -- Publisher, or downstream endpoint of another forwarder, to connect to
+//! \param downstream [IN] -- Endpoint to bind for subscribers
+//! \param topic [IN] -- Prefix of the messages to forward. Empty forwards everything
+PubSub_Forwarder::PubSub_Forwarder(URI upstream, URI downstream, std::string topic)
+  : _impl(std::make_unique<Implementation>(std::move(upstream), std::move(downstream), topic))
+{
+}
+//-------------------------------------------------------------------------------
+//! Stops forwarding and closes both sockets
+PubSub_Forwarder::~PubSub_Forwarder()
+{
+  _impl = nullptr;
+}
+//-------------------------------------------------------------------------------
+//! Merges another publisher in to the forwarded feed
+//! \param upstream [IN] -- Publisher, or downstream endpoint of another forwarder, to connect to
+//! \return Error -- Result of nn_connect
+Error PubSub_Forwarder::connect(URI upstream)
+{
+  if (_impl->upstream_socket < 0) {
+    return Error::Code::PFC_INVALID_SOCKET;
+  }
+  if (nn_connect(_impl->upstream_socket, upstream.c_str()) < 0) {
+    return nano_to_Error(nn_errno());
+  }
+  return Success();
+}
+//-------------------------------------------------------------------------------
+//! Offers the forwarded feed on another endpoint as well
+//! \param downstream [IN] -- Endpoint to bind
+//! \return Error -- Result of nn_bind
+Error PubSub_Forwarder::bind(URI downstream)
+{
+  if (_impl->downstream_socket < 0) {
+    return Error::Code::PFC_INVALID_SOCKET;
+  }
+  if (nn_bind(_impl->downstream_socket, downstream.c_str()) < 0) {
+    return nano_to_Error(nn_errno());
+  }
+  return Success();
+}
+//-------------------------------------------------------------------------------
+//! \param topic [IN] -- Another prefix to forward
+//! \return Error -- Success() or the reason nanomsg rejected the subscription
+Error PubSub_Forwarder::subscribe(const std::string& topic)
+{
+  if (_impl->upstream_socket < 0) {
+    return Error::Code::PFC_INVALID_SOCKET;
+  }
+  if (nn_setsockopt(_impl->upstream_socket, NN_SUB, NN_SUB_SUBSCRIBE, topic.data(), topic.size()) < 0) {
+    return nano_to_Error(nn_errno());
+  }
+  return Success();
+}
+//-------------------------------------------------------------------------------
+//! Blocking forward. Returns once shutdown is called from another thread or nanomsg fails
+//! \return Error -- Success() when stopped by shutdown
+Error PubSub_Forwarder::forward()
+{
+  return _impl->forward();
+}
+//-------------------------------------------------------------------------------
+//! Non blocking forward on a thread owned by the forwarder until shutdown
+void PubSub_Forwarder::async_forward()
+{
+  if (!_impl->forward_thread.joinable()) {
+    auto impl = _impl.get();
+    _impl->forward_thread = std::thread([impl]() { impl->forward(); });
+  }
+}
+//-------------------------------------------------------------------------------
+//! \return bool -- true when both sockets were set up and nn_device has not failed
+bool PubSub_Forwarder::is_valid() const
+{
+  return _impl->ec.is_ok();
+}
+//-------------------------------------------------------------------------------
+//! \return Error -- Why the forwarder is not valid, else Success()
+Error PubSub_Forwarder::error() const
+{
+  return _impl->ec;
+}
+//-------------------------------------------------------------------------------
+//! Part of the Pattern interface stands up all IO not handled by the RIIA
+void PubSub_Forwarder::standup()
+{
+}
+//-------------------------------------------------------------------------------
+//! Stops forwarding. Both sockets are closed, so the forwarder can not be restarted
+void PubSub_Forwarder::shutdown()
+{
+  _impl->close();
+  if (_impl->forward_thread.joinable()) {
+    _impl->forward_thread.join();
+  }
+}
+//-------------------------------------------------------------------------------
+}
@@ -0,0 +1,194 @@
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+/*! \file */
+
+#include <sustain/framework/net/patterns/pub_sub/Last_Value_Cache.h>
+
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <sustain/framework/net/patterns/pub_sub/Topic.h>
+
+namespace pfc {
+
+namespace {
+  constexpr size_t g_length_size = 4; //!< Bytes of the length before each message of a snapshot
+
+  //-----------------------------------------------------------------------------
+  //! \param framed [IN] -- Message to test
+  //! \param filter [IN] -- Leading bytes framed must start with
+  //! \param size [IN] -- Length of filter
+  bool matches(const message& framed, const char* filter, size_t size)
+  {
+    return framed.size() >= size && (size == 0 || std::memcmp(framed.data(), filter, size) == 0);
+  }
+}
+
+//!
+//! Latest value of one topic
+//!
+struct Cached_Value {
+  message value; //!< Empty once a conflated value has been taken
+  bool changed = false; //!< True while value is waiting in the changed list
+};
+
+//!
+//! PIMPL Implementation of a Last_Value_Cache
+//!
+struct Last_Value_Cache::Implementation {
+  std::map<std::string, Cached_Value> values;
+  std::deque<std::string> changed; //!< Topics with undelivered values in the order they first changed
+  mutable std::mutex values_mutex;
+  uint64_t conflated_count = 0;
+};
+//-----------------------------------------------------------------------------
+Last_Value_Cache::Last_Value_Cache()
+  : _impl(std::make_unique<Implementation>())
+{
+}
+//-----------------------------------------------------------------------------
+Last_Value_Cache::~Last_Value_Cache()
+{
+  _impl = nullptr;
+}
+//-----------------------------------------------------------------------------
+//! Records a copy of a message as the latest value of its topic. Used by publishers
+//! \param framed [IN] -- Message built with topic_message
+//! \return bool -- false when framed has no topic
+bool Last_Value_Cache::store(const message& framed)
+{
+  Topic_Frame frame;
+  if (!split_topic(framed, frame)) {
+    return false;
+  }
+  message copy(framed.data(), framed.size(), message::Storage::pooled);
+  std::lock_guard<std::mutex> guard(_impl->values_mutex);
+  _impl->values[frame.topic_string()].value = std::move(copy);
+  return true;
+}
+//-----------------------------------------------------------------------------
+//! Queues a message for delivery, replacing an undelivered message of the same topic. Used by subscribers
+//! \param framed [IN,OUT] -- Message built with topic_message. Moved from only when it is queued
+//! \param only_if_absent [IN] -- Ignore framed if its topic was ever conflated before. Used for snapshot values
+//!                               which must not overwrite newer live ones
+//! \return bool -- false when framed has no topic or was ignored
+bool Last_Value_Cache::conflate(message& framed, bool only_if_absent)
+{
+  Topic_Frame frame;
+  if (!split_topic(framed, frame)) {
+    return false;
+  }
+  auto& impl = *_impl;
+  std::lock_guard<std::mutex> guard(impl.values_mutex);
+  auto inserted = impl.values.emplace(frame.topic_string(), Cached_Value());
+  auto& cached = inserted.first->second;
+  if (only_if_absent && !inserted.second) {
+    return false;
+  }
+  if (cached.changed) {
+    ++impl.conflated_count;
+  } else {
+    cached.changed = true;
+    impl.changed.push_back(inserted.first->first);
+  }
+  cached.value = std::move(framed);
+  return true;
+}
+//-----------------------------------------------------------------------------
+//! \param latest [OUT] -- Newest undelivered value of the topic which changed first
+//! \return bool -- false when nothing is waiting
+bool Last_Value_Cache::take_changed(message& latest)
+{
+  auto& impl = *_impl;
+  std::lock_guard<std::mutex> guard(impl.values_mutex);
+  while (!impl.changed.empty()) {
+    auto cached = impl.values.find(impl.changed.front());
+    impl.changed.pop_front();
+    if (cached != impl.values.end() && cached->second.changed) {
+      cached->second.changed = false;
+      latest = std::move(cached->second.value);
+      return true;
+    }
+  }
+  return false;
+}
+//-----------------------------------------------------------------------------
+//! \param filter [IN] -- Leading bytes of the messages wanted, as passed to NN_SUB_SUBSCRIBE. Empty for all
+//! \param size [IN] -- Length of filter
+//! \return message -- Every matching value, each preceded by its length. Empty when nothing matches
+message Last_Value_Cache::snapshot(const char* filter, size_t size) const
+{
+  std::lock_guard<std::mutex> guard(_impl->values_mutex);
+  size_t total = 0;
+  for (auto& cached : _impl->values) {
+    if (!cached.second.value.empty() && matches(cached.second.value, filter, size)) {
+      total += g_length_size + cached.second.value.size();
+    }
+  }
+  message result(total);
+  for (auto& cached : _impl->values) {
+    auto& value = cached.second.value;
+    if (!value.empty() && matches(value, filter, size)) {
+      auto length = static_cast<uint32_t>(value.size());
+      char prefix[g_length_size] = { static_cast<char>(length >> 24), static_cast<char>(length >> 16),
+                                     static_cast<char>(length >> 8), static_cast<char>(length) };
+      result.append(prefix, g_length_size);
+      result.append(value.data(), value.size());
+    }
+  }
+  return result;
+}
+//-----------------------------------------------------------------------------
+//! Splits a snapshot back in to messages
+//! \param snapshot [IN] -- Result of snapshot, as received by a subscriber
+//! \param each [IN] -- Called with each value in the snapshot
+//! \return bool -- false if the snapshot was truncated. Values before the damage are still passed to each
+bool Last_Value_Cache::unpack(const message& snapshot, const std::function<void(message)>& each)
+{
+  auto position = reinterpret_cast<const unsigned char*>(snapshot.data());
+  auto remaining = snapshot.size();
+  while (remaining) {
+    if (remaining < g_length_size) {
+      return false;
+    }
+    size_t length = (size_t(position[0]) << 24) | (size_t(position[1]) << 16) | (size_t(position[2]) << 8) | size_t(position[3]);
+    position += g_length_size;
+    remaining -= g_length_size;
+    if (length > remaining) {
+      return false;
+    }
+    each(message(reinterpret_cast<const char*>(position), length, message::Storage::pooled));
+    position += length;
+    remaining -= length;
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Topics cached
+size_t Last_Value_Cache::size() const
+{
+  std::lock_guard<std::mutex> guard(_impl->values_mutex);
+  return _impl->values.size();
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Messages replaced by a newer one of the same topic before they were taken
+uint64_t Last_Value_Cache::conflated() const
+{
+  std::lock_guard<std::mutex> guard(_impl->values_mutex);
+  return _impl->conflated_count;
+}
+//-----------------------------------------------------------------------------
+}
@@ -14,12 +14,23 @@ specific language governing permissions and limitations under the license.
 
 #include <sustain/framework/net/patterns/pub_sub/Publisher.h>
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <thread>
 
 #include <nanomsg/pubsub.h>
 
+#include <sustain/framework/util/Mpsc_Queue.h>
+#include <sustain/framework/util/Wake_Signal.h>
+
 #include "../nanomsg_helper.h"
+#include <sustain/framework/net/Shm_Ring.h>
+#include <sustain/framework/net/patterns/pub_sub/Last_Value_Cache.h>
+#include <sustain/framework/net/patterns/pub_sub/Topic.h>
+#include <sustain/framework/net/patterns/req_rep/Server.h>
 
 namespace pfc {
 
@@ -38,12 +49,23 @@ struct nn_buffer : std::streambuf {
   }
 };
 
+//!
+//! Messages of one topic waiting to be sent together by a batching publisher
+//!
+struct Open_Batch {
+  message first; //!< Sent unchanged if no other message joins it
+  message frame; //!< Topic batch, started when a second message joins
+  size_t count = 0; //!< Messages waiting
+  size_t bytes = 0; //!< Size of the topic batch holding them
+  std::chrono::steady_clock::time_point deadline; //!< When the first message has waited batch_window
+};
+
 //!
 //!  @struct PubSub_Publisher::Implementation
 //!  Private PIMPL implementation of PubSub_Publisher
 //!
 struct PubSub_Publisher::Implementation {
-  Implementation(URI&&);
+  Implementation(URI&&, Publish_Options&&);
   ~Implementation();
 
   Implementation(const Implementation&) = delete;
@@ -52,15 +74,43 @@ struct PubSub_Publisher::Implementation {
   Implementation& operator==(Implementation&&) = delete;
 
   URI uri;               //!<  URI of the service to be given to nano_msg
-  int socket;            //!<  Socket the service runs 
+  int socket;            //!<  Socket the service runs, no_socket for a shm:// publisher
+  std::unique_ptr<Shm_Ring> ring; //!< Transport of a shm:// publisher in place of socket
   int rv;                //!<  return value of any nano_msg calls
   char* msg_buffer;      //!<  msg_buffer nano_messages internal buffer
-  bool running;          //!<  Run control for async threading
+  std::atomic<bool> running; //!<  Run control for async threading
 
   void publish();
 
   std::thread pubsub_main_thread; //!< Thread control for async braodcast request. 
-  BroadcastFunc generate_message_func; //!<  Callback for processing received broadcast
+  MessageFunc generate_message_func; //!<  Callback for processing received broadcast
+
+  bool start_publishing();
+  bool admit();
+  void stop_publishing();
+  void drain();
+  bool send(message& msg);
+  void send_counted(message& msg, size_t count);
+  void add_to_batch(message& msg);
+  void flush(Open_Batch& open);
+  std::chrono::steady_clock::time_point flush_due(bool all);
+
+  Publish_Options options;
+  Mpsc_Queue<message> queue; //!< Messages pushed by publish and try_publish. Sent without copying
+  Wake_Signal publish_signal; //!< Wakes the publisher thread when a message is queued
+  Wake_Signal space_signal; //!< Wakes producers blocked by Overflow_Policy::block
+  std::mutex lifecycle_mutex; //!< Serializes starting and stopping the publisher thread
+  std::atomic<bool> publishing; //!< True while the publisher thread accepts messages
+  std::atomic<size_t> producers; //!< publish and try_publish calls admitted and not yet done with queue
+  bool closed; //!< Set by shutdown so the publisher thread is never restarted
+  std::thread publish_thread; //!< Drains queue. Started by the first publish
+  std::atomic<uint64_t> sent_count;
+  std::atomic<uint64_t> dropped_count;
+  std::atomic<uint64_t> batched_count;
+  std::map<std::string, Open_Batch> batches; //!< Open batches by topic. Only touched by the publisher thread
+
+  Last_Value_Cache cache; //!< Latest message per topic when Publish_Options::last_value_cache is set
+  std::unique_ptr<ReqRep_Server> snapshot_server; //!< Answers snapshot requests from cache. Started by serve_snapshots
 
   Error ec; //!< Current Error code of the system else Success()
 };
@@ -68,14 +118,21 @@ struct PubSub_Publisher::Implementation {
 //! Deconstructor for Implementation - Shutsdown all pending nn activity and clears memory
 PubSub_Publisher::Implementation::~Implementation()
 {
-  if(rv && socket)
+  running = false;
+  snapshot_server = nullptr;
+  stop_publishing();
+  if(rv && socket >= 0)
   {
     nn_shutdown(socket,rv);
   }
 
-  if(socket)
+  if(socket >= 0)
   {
     nn_close(socket);
+    socket = no_socket;
+  }
+  if (pubsub_main_thread.joinable()) {
+    pubsub_main_thread.join();
   }
   if(msg_buffer)
   {
@@ -87,18 +144,37 @@ PubSub_Publisher::Implementation::~Implementation()
 //!
 //! URI based constructor
 //! \param u [IN,OUT] Moves URI in to palce and stands up nn_socket and nn_bind
-PubSub_Publisher::Implementation::Implementation(URI&& u)
+//! \param o [IN] Sizing and overflow behavior of the publish queue
+PubSub_Publisher::Implementation::Implementation(URI&& u, Publish_Options&& o)
   : uri(std::move(u))
-  , socket(0)
+  , socket(no_socket)
   , rv(0)
   , msg_buffer(nullptr)
   , running(false)
+  , options(std::move(o))
+  , queue(options.capacity)
+  , publishing(false)
+  , producers(0)
+  , closed(false)
+  , sent_count(0)
+  , dropped_count(0)
+  , batched_count(0)
 {
+  if (options.max_batch == 0) {
+    options.max_batch = 1;
+  }
+  if (uri.transport() == "shm") {
+    ring = std::make_unique<Shm_Ring>(uri.address(), Shm_Role::writer, options.ring_bytes);
+    ec = ring->error();
+    return;
+  }
   if ((socket = nn_socket(AF_SP, NN_PUB)) < 0) {
-    ec = nano_to_Error(socket);
+    ec = nano_to_Error(nn_errno());
+    return;
   }
   if ((rv = nn_bind(socket, uri.c_str())) < 0) {
-    ec = nano_to_Error(rv);
+    ec = nano_to_Error(nn_errno());
+    rv = 0;
   }
 }
 //-----------------------------------------------------------------------------
@@ -109,28 +185,376 @@ PubSub_Publisher::Implementation::Implementation(URI&& u)
 void PubSub_Publisher::Implementation::publish()
 {
   do {
-    int bytes = 0;
     auto buffer = generate_message_func();
-    if ((bytes = nn_send(socket, &buffer[0], buffer.size(), 0)) < 0) {
-      ec = nano_to_Error(bytes);
-    }
+    send(buffer);
   } while (running);
 }
 //-----------------------------------------------------------------------------
+//! Starts the publisher thread on first use
+//! \return bool -- false once shutdown has been called
+bool PubSub_Publisher::Implementation::start_publishing()
+{
+  if (publishing.load()) {
+    return true;
+  }
+  std::lock_guard<std::mutex> guard(lifecycle_mutex);
+  if (closed) {
+    return false;
+  }
+  if (!publishing) {
+    publishing = true;
+    publish_thread = std::thread(&Implementation::drain, this);
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+//! Counts a producer in before it touches queue. The caller decrements producers once its push
+//! is done, so stop_publishing can wait for it and send the message
+//! \return bool -- false once shutdown has been called, in which case nothing is counted
+bool PubSub_Publisher::Implementation::admit()
+{
+  ++producers;
+  if (start_publishing()) {
+    return true;
+  }
+  --producers;
+  return false;
+}
+//-----------------------------------------------------------------------------
+//! Stops accepting messages and waits for the publisher thread to send what is already queued.
+//! A producer admitted before publishing was cleared may still push after the publisher thread saw
+//! the queue empty, so once every producer is done the rest of the queue is sent here.
+void PubSub_Publisher::Implementation::stop_publishing()
+{
+  {
+    std::lock_guard<std::mutex> guard(lifecycle_mutex);
+    closed = true;
+    publishing = false;
+  }
+  publish_signal.notify();
+  space_signal.notify();
+  while (producers) {
+    std::this_thread::yield();
+  }
+  if (publish_thread.joinable()) {
+    publish_thread.join();
+    drain();
+  }
+}
+//-----------------------------------------------------------------------------
+//! Publisher thread. Sleeps until messages are queued then sends up to max_batch of them
+//! before checking for shutdown again. PUB sockets never block so a batch is never held up
+//! by a slow subscriber. A batching publisher also wakes when its oldest open batch is due
+//! and sends every open batch before exiting.
+void PubSub_Publisher::Implementation::drain()
+{
+  message next;
+  auto due = std::chrono::steady_clock::time_point::max();
+  auto ready = [this]() { return !publishing || !queue.empty(); };
+  while (publishing || !queue.empty()) {
+    if (batches.empty()) {
+      publish_signal.wait(ready);
+    } else {
+      publish_signal.wait_until(ready, due);
+    }
+
+    size_t batch = 0;
+    while (batch < options.max_batch && queue.try_pop(next)) {
+      ++batch;
+      if (options.last_value_cache) {
+        cache.store(next);
+      }
+      if (options.batch_bytes) {
+        add_to_batch(next);
+      } else {
+        send_counted(next, 1);
+      }
+    }
+    if (batch) {
+      space_signal.notify();
+    }
+    if (!batches.empty()) {
+      due = flush_due(false);
+    }
+  }
+  flush_due(true);
+}
+//-----------------------------------------------------------------------------
+//! \param msg [IN,OUT] -- Message or topic batch to send
+//! \param count [IN] -- Published messages msg carries, added to sent or dropped
+void PubSub_Publisher::Implementation::send_counted(message& msg, size_t count)
+{
+  if (!send(msg)) {
+    dropped_count += count;
+  } else {
+    sent_count += count;
+  }
+}
+//-----------------------------------------------------------------------------
+//! Adds a message to the open batch of its topic, sending the batch first if the message would
+//! overflow it. Messages which can not be batched are sent at once
+//! \param msg [IN,OUT] -- Message from the publish queue. Moved from
+void PubSub_Publisher::Implementation::add_to_batch(message& msg)
+{
+  Topic_Frame frame;
+  if (!split_topic(msg, frame)) {
+    send_counted(msg, 1);
+    return;
+  }
+  auto topic = frame.topic_string();
+  auto& open = batches[topic];
+  auto added = topic_batch_length_size + frame.payload_size;
+  if (open.count && open.bytes + added > options.batch_bytes) {
+    flush(open);
+  }
+  if (open.count == 0) {
+    open.bytes = frame.topic_size + 1 + sizeof(topic_batch_marker) + added;
+    if (open.bytes > options.batch_bytes) {
+      send_counted(msg, 1);
+      return;
+    }
+    open.first = std::move(msg);
+    open.count = 1;
+    open.deadline = std::chrono::steady_clock::now() + options.batch_window;
+    return;
+  }
+  if (open.count == 1) {
+    Topic_Frame first;
+    split_topic(open.first, first);
+    open.frame = topic_batch(topic, options.batch_bytes);
+    append_topic_batch(open.frame, first.payload, first.payload_size);
+    open.first = message();
+  }
+  append_topic_batch(open.frame, frame.payload, frame.payload_size);
+  open.bytes += added;
+  ++open.count;
+  if (open.bytes + topic_batch_length_size >= options.batch_bytes) {
+    flush(open); //Full, nothing more would fit
+  }
+}
+//-----------------------------------------------------------------------------
+//! Sends the messages waiting in an open batch and empties it
+//! \param open [IN,OUT] -- Batch to send
+void PubSub_Publisher::Implementation::flush(Open_Batch& open)
+{
+  if (open.count == 1) {
+    send_counted(open.first, 1);
+  } else if (open.count > 1) {
+    batched_count += open.count;
+    send_counted(open.frame, open.count);
+  }
+  open.first = message();
+  open.frame = message();
+  open.count = 0;
+}
+//-----------------------------------------------------------------------------
+//! Sends every open batch whose window has closed
+//! \param all [IN] -- Send every open batch regardless of its window. Used at shutdown
+//! \return time_point -- When the oldest batch still open is due, or time_point::max() when none are open
+std::chrono::steady_clock::time_point PubSub_Publisher::Implementation::flush_due(bool all)
+{
+  auto now = std::chrono::steady_clock::now();
+  auto due = std::chrono::steady_clock::time_point::max();
+  for (auto open = batches.begin(); open != batches.end();) {
+    if (open->second.count && (all || open->second.deadline <= now)) {
+      flush(open->second);
+    }
+    if (open->second.count == 0) {
+      open = batches.erase(open);
+    } else {
+      due = std::min(due, open->second.deadline);
+      ++open;
+    }
+  }
+  return due;
+}
+//-----------------------------------------------------------------------------
+//! Hands a message to the socket or shared memory ring
+//! \param msg [IN,OUT] -- Message to send. nanomsg takes ownership of nanomsg storage
+//! \return bool -- false with ec set when the transport rejected the message
+bool PubSub_Publisher::Implementation::send(message& msg)
+{
+  if (ring) {
+    if (!ring->write(msg.data(), msg.size())) {
+      ec = Error::Code::PFC_BAD_OPERATION;
+      return false;
+    }
+    return true;
+  }
+  if (send_message(socket, msg) < 0) {
+    ec = nano_to_Error(nn_errno());
+    return false;
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
 //!  URI based constructor. Takes a copy of a URI to setup networking information
 //! \param uri [IN]  Service configuration of the new PubSub_Publisher
-PubSub_Publisher::PubSub_Publisher(URI uri)
-  : _impl(std::make_unique<Implementation>(std::move(uri)))
+//! \param options [IN] Sizing and overflow behavior of the publish queue
+PubSub_Publisher::PubSub_Publisher(URI uri, Publish_Options options)
+  : _impl(std::make_unique<Implementation>(std::move(uri), std::move(options)))
 {
 }
 //-----------------------------------------------------------------------------
 //!  Shuts down async threading and fress all memory
 PubSub_Publisher::~PubSub_Publisher()
 {
-  nn_close(_impl->socket);
   _impl = nullptr;
 }
 //-----------------------------------------------------------------------------
+//! Queues a message for the publisher thread. Safe to call from any number of threads.
+//! Messages built in nanomsg storage are handed to nanomsg without a copy.
+//! \param msg [IN] -- Serialized message including any topic prefix subscribers filter on
+//! \return Error -- PFC_QUEUE_FULL when the message was discarded by Overflow_Policy::drop_newest,
+//!                  PFC_BAD_OPERATION after shutdown. Success() otherwise, even if drop_oldest evicted an older message
+Error PubSub_Publisher::publish(message msg)
+{
+  auto& impl = *_impl;
+  if (!impl.admit()) {
+    return Error::Code::PFC_BAD_OPERATION;
+  }
+  Error result = Success();
+  switch (impl.options.overflow) {
+  case Overflow_Policy::drop_newest:
+    if (!impl.queue.try_push(std::move(msg))) {
+      ++impl.dropped_count;
+      result = Error::Code::PFC_QUEUE_FULL;
+    }
+    break;
+  case Overflow_Policy::drop_oldest:
+    while (!impl.queue.try_push(std::move(msg))) {
+      message oldest;
+      if (impl.queue.try_pop(oldest)) {
+        ++impl.dropped_count;
+      }
+    }
+    break;
+  case Overflow_Policy::block:
+    while (!impl.queue.try_push(std::move(msg))) {
+      if (!impl.publishing) {
+        result = Error::Code::PFC_BAD_OPERATION;
+        break;
+      }
+      impl.publish_signal.notify();
+      impl.space_signal.wait([&impl]() { return !impl.publishing || impl.queue.size() < impl.queue.capacity(); });
+    }
+    break;
+  }
+  --impl.producers;
+  impl.publish_signal.notify();
+  return result;
+}
+//-----------------------------------------------------------------------------
+//! Copies buffer in to a message and queues it. See publish(message)
+//! \param buffer [IN] -- Serialized message including any topic prefix subscribers filter on
+//! \return Error -- As publish(message)
+Error PubSub_Publisher::publish(const std::vector<char>& buffer)
+{
+  return publish(message(buffer.data(), buffer.size()));
+}
+//-----------------------------------------------------------------------------
+//! Frames a payload with a topic and queues it. See publish(message)
+//! \param topic [IN] -- Topic subscribers filter on. Must not contain '\0'
+//! \param payload [IN] -- Serialized payload, copied once in to the framed message
+//! \param size [IN] -- Length of payload
+//! \return Error -- As publish(message)
+Error PubSub_Publisher::publish(const std::string& topic, const char* payload, size_t size)
+{
+  auto framed = topic_message(topic, size);
+  framed.append(payload, size);
+  return publish(std::move(framed));
+}
+//-----------------------------------------------------------------------------
+//! Queues a message without ever blocking or discarding anything
+//! \param msg [IN,OUT] -- Moved from when queued, left untouched when the queue is full
+//! \return bool -- false when the queue is full or the publisher has been shutdown
+bool PubSub_Publisher::try_publish(message& msg)
+{
+  auto& impl = *_impl;
+  if (!impl.admit()) {
+    return false;
+  }
+  auto queued = impl.queue.try_push(std::move(msg));
+  --impl.producers;
+  if (queued) {
+    impl.publish_signal.notify();
+  }
+  return queued;
+}
+//-----------------------------------------------------------------------------
+//! \param buffer [IN,OUT] -- Cleared when queued, left untouched when the queue is full
+//! \return bool -- false when the queue is full or the publisher has been shutdown
+bool PubSub_Publisher::try_publish(std::vector<char>& buffer)
+{
+  message msg(buffer.data(), buffer.size());
+  if (!try_publish(msg)) {
+    return false;
+  }
+  buffer.clear();
+  return true;
+}
+//-----------------------------------------------------------------------------
+//! Listens on another endpoint as well as the one given at construction
+//! \param endpoint [IN] -- Endpoint to bind, e.g. one of local_endpoints
+//! \return Error -- PFC_BAD_OPERATION for a shm:// publisher or one without a socket, else the result of nn_bind
+Error PubSub_Publisher::bind(URI endpoint)
+{
+  auto& impl = *_impl;
+  if (impl.ring || impl.socket < 0) {
+    return Error::Code::PFC_BAD_OPERATION;
+  }
+  if (nn_bind(impl.socket, endpoint.c_str()) < 0) {
+    return nano_to_Error(nn_errno());
+  }
+  return Success();
+}
+//-----------------------------------------------------------------------------
+//! Starts a ReqRep endpoint answering snapshot requests from the last value cache. A request holds a
+//! subscription filter and the reply is every cached message it matches, see Last_Value_Cache::snapshot
+//! \param snapshot_uri [IN] -- Endpoint to bind the snapshot server to
+//! \return Error -- PFC_BAD_OPERATION without Publish_Options::last_value_cache, PFC_ADDRESS_IN_USE if already serving
+Error PubSub_Publisher::serve_snapshots(URI snapshot_uri)
+{
+  auto& impl = *_impl;
+  if (!impl.options.last_value_cache) {
+    return Error::Code::PFC_BAD_OPERATION;
+  }
+  std::lock_guard<std::mutex> guard(impl.lifecycle_mutex);
+  if (impl.snapshot_server) {
+    return Error::Code::PFC_ADDRESS_IN_USE;
+  }
+  impl.snapshot_server = std::make_unique<ReqRep_Server>(std::move(snapshot_uri));
+  auto cache = &impl.cache;
+  impl.snapshot_server->async_listen(Listiner::MessageListenFunc([cache](message filter) {
+    return cache->snapshot(filter.data(), filter.size());
+  }));
+  return Success();
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Messages waiting for the publisher thread
+size_t PubSub_Publisher::queued() const
+{
+  return _impl->queue.size();
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Messages from publish and try_publish handed to nanomsg
+uint64_t PubSub_Publisher::sent() const
+{
+  return _impl->sent_count;
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Messages discarded by the overflow policy or rejected by nanomsg
+uint64_t PubSub_Publisher::dropped() const
+{
+  return _impl->dropped_count;
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Messages sent packed with others of their topic in a topic batch
+uint64_t PubSub_Publisher::batched() const
+{
+  return _impl->batched_count;
+}
+//-----------------------------------------------------------------------------
 void PubSub_Publisher::set_response_callaback_func(CallbackFunc func)
 {
 }
@@ -139,7 +563,7 @@ void PubSub_Publisher::set_response_callaback_func(CallbackFunc func)
 //! \param func [IN] -- Function that will be called to generate broadcast message
 //!
 //! Blocking call for receiving a single message
-void PubSub_Publisher::broadcast(BroadcastFunc func)
+void PubSub_Publisher::broadcast(MessageFunc func)
 {
   _impl->generate_message_func = func;
   _impl->running = false;
@@ -152,13 +576,30 @@ void PubSub_Publisher::broadcast(BroadcastFunc func)
 //! Future versions of async_broadcast may allow multiple parallel broadcast, but this is currently
 //! Undefined behavior.
 //!
-void PubSub_Publisher::async_broadcast(BroadcastFunc func)
+void PubSub_Publisher::async_broadcast(MessageFunc func)
 {
   _impl->generate_message_func = func;
   _impl->running = true;
   _impl->pubsub_main_thread = std::thread(&Implementation::publish, _impl.get());
 }
 //-----------------------------------------------------------------------------
+//!
+//! \param func [IN] -- Function that will be called to generate broadcast message
+//!
+//! Copies each generated vector in to a nanomsg message and sends it with broadcast(MessageFunc)
+void PubSub_Publisher::broadcast(BroadcastFunc func)
+{
+  broadcast(to_message_func(std::move(func)));
+}
+//-----------------------------------------------------------------------------
+//! \param func [IN] -- Function that will be called to generate broadcast message
+//!
+//! Copies each generated vector in to a nanomsg message and sends it with async_broadcast(MessageFunc)
+void PubSub_Publisher::async_broadcast(BroadcastFunc func)
+{
+  async_broadcast(to_message_func(std::move(func)));
+}
+//-----------------------------------------------------------------------------
 //! Part of the Pattern interface stands up all IO not handled by the RIIA
 void PubSub_Publisher::standup()
 {
@@ -168,10 +609,12 @@ void PubSub_Publisher::standup()
 //! Before the Surveyor goes out of scope.
 void PubSub_Publisher::shutdown()
 {
-  _impl->running = true;
-  if (_impl->socket) {
+  _impl->running = false;
+  _impl->stop_publishing();
+  _impl->snapshot_server = nullptr;
+  if (_impl->socket >= 0) {
     nn_close(_impl->socket);
-    _impl->socket = 0;
+    _impl->socket = no_socket;
   }
 }
 //-----------------------------------------------------------------------------
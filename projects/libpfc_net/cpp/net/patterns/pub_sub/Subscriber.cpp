@@ -14,30 +14,98 @@ specific language governing permissions and limitations under the license.
 
 #include <sustain/framework/net/patterns/pub_sub/Subscriber.h>
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 #include <nanomsg/pubsub.h>
 
 #include "../nanomsg_helper.h"
+#include <sustain/framework/Protocol.h>
+#include <sustain/framework/net/Endpoint.h>
+#include <sustain/framework/net/Reactor.h>
+#include <sustain/framework/net/Shm_Ring.h>
+#include <sustain/framework/net/patterns/pub_sub/Last_Value_Cache.h>
+#include <sustain/framework/net/patterns/pub_sub/Topic.h>
+#include <sustain/framework/net/patterns/req_rep/Client.h>
 #include <sustain/framework/util/Error.h>
+#include <sustain/framework/util/Spsc_Queue.h>
+#include <sustain/framework/util/Wake_Signal.h>
 
 namespace pfc {
+
+namespace {
+  constexpr int g_conflate_batch = 4096; //!< Messages a conflating subscriber reads before delivering, so a flood can not starve the listener
+  constexpr int g_receive_poll = 100; //!< NN_RCVTIMEO of the receive thread, which bounds how long shutdown waits for it
+
+  //-----------------------------------------------------------------------------
+  //! FNV-1a, so hashing a topic needs no std::string
+  //! \param data [IN] -- Bytes to hash
+  //! \param size [IN] -- Length of data
+  size_t hash_bytes(const char* data, size_t size)
+  {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+      hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ull;
+    }
+    return static_cast<size_t>(hash);
+  }
+}
+
+//!
+//! Dispatch thread of a PubSub_Subscriber and the messages hashed to it.
+//! The receive thread is the only producer and the worker thread the only consumer
+//!
+struct Dispatch_Worker {
+  explicit Dispatch_Worker(size_t capacity)
+    : queue(capacity)
+  {
+  }
+  Spsc_Queue<message> queue;
+  Wake_Signal work_signal; //!< Wakes the worker when a message is queued
+  Wake_Signal space_signal; //!< Wakes a receive thread blocked by Subscribe_Options::dispatch_block
+  std::thread thread;
+};
 //!
 //! PIMPL Implementation of a PubSub_Subscriber
 struct PubSub_Subscriber::Implementation {
-  Implementation(URI&&);
+  Implementation(URI&&, const std::string& topic, Subscribe_Options&&);
   ~Implementation();
 
-  URI uri; //!< Boost io_context used in this Multicast_Sender
-  int socket; //!< Multicast broadcast channel
-  int rv; //!< Socket used to send messages
-  char* msg_buffer; //!< timeout clock
-  bool running; //!< Message buffer that broadcast will be stored in
+  URI uri; //!< URI of the publisher to connect to
+  int socket; //!< Socket the subscriber listens on, no_socket for a shm:// subscriber
+  int rv; //!< Endpoint id returned by nn_connect
+  char* msg_buffer; //!< msg_buffer nano_messages internal buffer
+  std::atomic<bool> running; //!< Run control for async threading
 
   void listen();
+  void react();
+  bool receive(message& published, int flags);
+  bool wanted(const message& published);
+  void accept(message& published);
+  void deliver(message& published);
+  void drain_conflated();
+  void deliver_changed();
+  void hand_off(message& published);
+  void start_dispatch();
+  void stop_dispatch();
+  void work(Dispatch_Worker& worker);
 
+  std::unique_ptr<Shm_Ring> ring; //!< Transport of a shm:// subscriber in place of socket
+  Reactor* reactor; //!< Reactor the socket is registered with by async_listen, else nullptr
   std::thread pubsub_main_thread; //!< Thread control for async braodcast request. 
-  ListenFunc message_process_function; //!<  Callback for processing received broadcast
+  MessageListenFunc message_process_function; //!<  Callback for processing received broadcast. Its return value is discarded
+
+  Subscribe_Options options;
+  Last_Value_Cache latest; //!< Undelivered messages of a conflating subscriber, one per topic
+  std::vector<std::string> filters; //!< Subscriptions, so request_snapshot can ask for the same topics
+  std::mutex filters_mutex;
+
+  std::vector<std::unique_ptr<Dispatch_Worker>> workers; //!< Started with the listen when Subscribe_Options::dispatch_workers is set
+  std::atomic<bool> dispatching; //!< True while the workers accept messages
+  std::atomic<uint64_t> dispatch_dropped_count;
 
   Error ec; //!< Current Error code of the system else Success()
 };
@@ -45,13 +113,25 @@ struct PubSub_Subscriber::Implementation {
 //! Constructs an Implementation of a PubSub_Subscriber
 PubSub_Subscriber::Implementation::~Implementation()
 {
-  if (rv && socket) {
+  running = false;
+  if (reactor) {
+    reactor->remove(socket);
+    reactor = nullptr;
+  }
+  if (ring) {
+    ring->close();
+  }
+  if (rv && socket >= 0) {
     nn_shutdown(socket, rv);
   }
-
-  if (socket) {
+  if (socket >= 0) {
     nn_close(socket);
+    socket = no_socket;
   }
+  if (pubsub_main_thread.joinable()) {
+    pubsub_main_thread.join();
+  }
+  stop_dispatch();
   if (msg_buffer) {
     nn_freemsg(msg_buffer);
     msg_buffer = nullptr;
@@ -60,21 +140,35 @@ PubSub_Subscriber::Implementation::~Implementation()
 //-------------------------------------------------------------------------------
 //!  URI based constructor. Takes a copy of a URI to setup networking information
 //! \param u [IN]  Service configuration of the new Surveyor
-PubSub_Subscriber::Implementation::Implementation(URI&& u)
+//! \param topic [IN] Initial topic prefix to subscribe to
+//! \param o [IN] Delivery behavior
+PubSub_Subscriber::Implementation::Implementation(URI&& u, const std::string& topic, Subscribe_Options&& o)
   : uri(std::move(u))
-  , socket(0)
+  , socket(no_socket)
   , rv(0)
   , msg_buffer(nullptr)
   , running(false)
+  , reactor(nullptr)
+  , options(std::move(o))
+  , filters(1, topic)
+  , dispatching(false)
+  , dispatch_dropped_count(0)
 {
+  if (uri.transport() == "shm") {
+    ring = std::make_unique<Shm_Ring>(uri.address(), Shm_Role::reader);
+    ec = ring->error();
+    return;
+  }
   if ((socket = nn_socket(AF_SP, NN_SUB)) < 0) {
-    ec = nano_to_Error(socket);
+    ec = nano_to_Error(nn_errno());
+    return;
   }
-  if (nn_setsockopt(socket, NN_SUB, NN_SUB_SUBSCRIBE, "", 0) < 0) {
-    ec = nano_to_Error(socket);
+  if (nn_setsockopt(socket, NN_SUB, NN_SUB_SUBSCRIBE, topic.data(), topic.size()) < 0) {
+    ec = nano_to_Error(nn_errno());
   }
-  if (nn_connect(socket, uri.c_str()) < 0) {
-    ec = nano_to_Error(socket);
+  if ((rv = nn_connect(socket, uri.c_str())) < 0) {
+    ec = nano_to_Error(nn_errno());
+    rv = 0;
   }
 }
 //-------------------------------------------------------------------------------
@@ -84,41 +178,314 @@ PubSub_Subscriber::Implementation::Implementation(URI&& u)
 //!
 void PubSub_Subscriber::Implementation::listen()
 {
+  message published;
+  deliver_changed();
   do {
-    char* l_buffer = NULL;
-    int bytes;
-    if ((bytes = nn_recv(socket, &l_buffer, NN_MSG, 0)) < 0) {
-      ec = nano_to_Error(bytes);
+    if (!receive(published, 0)) {
+      continue;
+    }
+    accept(published);
+    if (options.conflate) {
+      drain_conflated();
     }
-    std::vector<char> response = message_process_function(l_buffer, bytes);
-    nn_freemsg(l_buffer);
   } while (running);
 }
 //-------------------------------------------------------------------------------
+//! Receives the next message from the socket or shared memory ring
+//! \param published [OUT] -- Received message
+//! \param flags [IN] -- 0 to block or NN_DONTWAIT
+//! \return bool -- false when nothing was received. ec is set unless there was simply nothing waiting
+bool PubSub_Subscriber::Implementation::receive(message& published, int flags)
+{
+  if (ring) {
+    //The ring carries every message, so subscriptions are applied here rather than by nanomsg
+    bool received = false;
+    do {
+      received = (flags & NN_DONTWAIT) ? ring->read(published, std::chrono::milliseconds(0)) : ring->read(published);
+    } while (received && !wanted(published));
+    return received;
+  }
+  if (receive_message(socket, published, flags) < 0) {
+    if (nn_errno() != EAGAIN && nn_errno() != ETIMEDOUT) {
+      ec = nano_to_Error(nn_errno());
+    }
+    return false;
+  }
+  return true;
+}
+//-------------------------------------------------------------------------------
+//! \return bool -- true when published begins with a subscribed topic, as NN_SUB_SUBSCRIBE matches
+bool PubSub_Subscriber::Implementation::wanted(const message& published)
+{
+  std::lock_guard<std::mutex> guard(filters_mutex);
+  for (auto& filter : filters) {
+    if (published.size() >= filter.size() && std::equal(filter.begin(), filter.end(), published.data())) {
+      return true;
+    }
+  }
+  return false;
+}
+//-------------------------------------------------------------------------------
+//! Delivers a received message, or each message of a topic batch from a batching publisher
+//! \param published [IN,OUT] -- Received message. Moved from
+void PubSub_Subscriber::Implementation::accept(message& published)
+{
+  Topic_Frame frame;
+  if (split_topic(published, frame) && is_topic_batch(frame)) {
+    unpack_topic_batch(frame, [this](message unpacked) { deliver(unpacked); });
+    return;
+  }
+  deliver(published);
+}
+//-------------------------------------------------------------------------------
+//! Delivers a message, or for a conflating subscriber queues it as the latest value of its topic.
+//! Messages without a topic can not be conflated and are always delivered
+//! \param published [IN,OUT] -- Received message. Moved from
+void PubSub_Subscriber::Implementation::deliver(message& published)
+{
+  if (options.conflate && latest.conflate(published)) {
+    return;
+  }
+  hand_off(published);
+}
+//-------------------------------------------------------------------------------
+//! Reads everything buffered for the subscriber, keeping only the newest message per topic, then delivers those.
+//! However far the listener falls behind it is handed current values and the socket buffer never fills.
+void PubSub_Subscriber::Implementation::drain_conflated()
+{
+  message published;
+  for (int count = 0; count < g_conflate_batch && receive(published, NN_DONTWAIT); ++count) {
+    accept(published);
+  }
+  deliver_changed();
+}
+//-------------------------------------------------------------------------------
+//! Hands every conflated value to the listener in the order its topic first changed
+void PubSub_Subscriber::Implementation::deliver_changed()
+{
+  message changed;
+  while (latest.take_changed(changed)) {
+    hand_off(changed);
+  }
+}
+//-------------------------------------------------------------------------------
+//! Runs the listener, or queues the message to the dispatch worker its key hashes to
+//! \param published [IN,OUT] -- Message to deliver. Moved from
+void PubSub_Subscriber::Implementation::hand_off(message& published)
+{
+  if (workers.empty()) {
+    message_process_function(std::move(published));
+    return;
+  }
+  size_t key = 0;
+  Topic_Frame frame;
+  if (options.dispatch_key) {
+    key = options.dispatch_key(published);
+  } else if (split_topic(published, frame)) {
+    key = hash_bytes(frame.topic, frame.topic_size);
+  }
+  auto& worker = *workers[key % workers.size()];
+  while (!worker.queue.try_push(std::move(published))) {
+    if (!options.dispatch_block || !dispatching) {
+      ++dispatch_dropped_count;
+      return;
+    }
+    worker.work_signal.notify();
+    worker.space_signal.wait([this, &worker]() { return !dispatching || worker.queue.size() < worker.queue.capacity(); });
+  }
+  worker.work_signal.notify();
+}
+//-------------------------------------------------------------------------------
+//! Starts the dispatch workers when a listen begins and none are running
+void PubSub_Subscriber::Implementation::start_dispatch()
+{
+  if (!options.dispatch_workers || !workers.empty()) {
+    return;
+  }
+  dispatching = true;
+  for (size_t i = 0; i < options.dispatch_workers; ++i) {
+    workers.push_back(std::make_unique<Dispatch_Worker>(options.dispatch_capacity));
+  }
+  for (auto& worker : workers) {
+    auto next = worker.get();
+    worker->thread = std::thread([this, next]() { work(*next); });
+  }
+}
+//-------------------------------------------------------------------------------
+//! Stops the dispatch workers once they have delivered what is queued and releases them, so the
+//! next listen starts a new pool. Nothing may hand off messages while this runs
+void PubSub_Subscriber::Implementation::stop_dispatch()
+{
+  dispatching = false;
+  for (auto& worker : workers) {
+    worker->work_signal.notify();
+    worker->space_signal.notify();
+  }
+  for (auto& worker : workers) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+  workers.clear();
+}
+//-------------------------------------------------------------------------------
+//! Dispatch worker thread. Runs the listener on each message queued to it in the order they were queued
+//! \param worker [IN,OUT] -- Queue owned by this thread
+void PubSub_Subscriber::Implementation::work(Dispatch_Worker& worker)
+{
+  message next;
+  while (dispatching || !worker.queue.empty()) {
+    worker.work_signal.wait([this, &worker]() { return !dispatching || !worker.queue.empty(); });
+    while (worker.queue.try_pop(next)) {
+      worker.space_signal.notify();
+      message_process_function(std::move(next));
+    }
+  }
+}
+//-------------------------------------------------------------------------------
+//! Called by the Reactor when messages are waiting. Drains up to reactor_batch without blocking
+void PubSub_Subscriber::Implementation::react()
+{
+  if (options.conflate) {
+    drain_conflated();
+    return;
+  }
+  message published;
+  for (int count = 0; count < reactor_batch && receive(published, NN_DONTWAIT); ++count) {
+    accept(published);
+  }
+}
+//-------------------------------------------------------------------------------
 //!  URI based constructor. Takes a copy of a URI to setup networking information
 //! \param uri [IN]  Service configuration of the new PubSub_Subscriber
-PubSub_Subscriber::PubSub_Subscriber(URI uri)
-  : _impl(std::make_unique<Implementation>(std::move(uri)))
+//! \param topic [IN] Initial topic prefix. The default empty topic receives every message
+//! \param options [IN] Delivery behavior. The default delivers every message
+PubSub_Subscriber::PubSub_Subscriber(URI uri, std::string topic, Subscribe_Options options)
+  : _impl(std::make_unique<Implementation>(std::move(uri), topic, std::move(options)))
+{
+}
+//-------------------------------------------------------------------------------
+//!  Connects to a service on the cheapest transport it advertises, see select_endpoint
+//! \param service [IN]  Announcement of the publishing service
+//! \param topic [IN] Initial topic prefix. The default empty topic receives every message
+//! \param options [IN] Delivery behavior. The default delivers every message
+PubSub_Subscriber::PubSub_Subscriber(const pfc_service_announcement& service, std::string topic, Subscribe_Options options)
+  : PubSub_Subscriber(select_endpoint(service), std::move(topic), std::move(options))
 {
 }
 //-------------------------------------------------------------------------------
 //!  Shuts down async threading and fress all memory
 PubSub_Subscriber::~PubSub_Subscriber()
 {
-  if (_impl->socket) {
-    nn_close(_impl->socket);
+  _impl = nullptr;
+}
+//-------------------------------------------------------------------------------
+//! \param topic [IN] -- Additional prefix to receive. Messages matching any subscribed prefix are delivered
+//! \return Error -- Success() or the reason nanomsg rejected the subscription
+Error PubSub_Subscriber::subscribe(const std::string& topic)
+{
+  if (!_impl->ring && nn_setsockopt(_impl->socket, NN_SUB, NN_SUB_SUBSCRIBE, topic.data(), topic.size()) < 0) {
+    return nano_to_Error(nn_errno());
+  }
+  std::lock_guard<std::mutex> guard(_impl->filters_mutex);
+  _impl->filters.push_back(topic);
+  return Success();
+}
+//-------------------------------------------------------------------------------
+//! \param topic [IN] -- Prefix previously passed to subscribe or the constructor
+//! \return Error -- Success() or the reason nanomsg rejected the request
+Error PubSub_Subscriber::unsubscribe(const std::string& topic)
+{
+  if (!_impl->ring && nn_setsockopt(_impl->socket, NN_SUB, NN_SUB_UNSUBSCRIBE, topic.data(), topic.size()) < 0) {
+    return nano_to_Error(nn_errno());
+  }
+  std::lock_guard<std::mutex> guard(_impl->filters_mutex);
+  auto& filters = _impl->filters;
+  auto filter = std::find(filters.begin(), filters.end(), topic);
+  if (filter != filters.end()) {
+    filters.erase(filter);
+  }
+  return Success();
+}
+//-------------------------------------------------------------------------------
+//! Asks the snapshot server of a publisher with a last value cache for the current value of every subscribed
+//! topic. The values are delivered like conflated messages, but never replace a value which already arrived
+//! live. Call before listening so they are delivered as soon as the listen starts.
+//! \param snapshot_uri [IN] -- Endpoint passed to PubSub_Publisher::serve_snapshots
+//! \param timeout [IN] -- Time allowed for each reply
+//! \return Error -- PFC_BAD_OPERATION unless Subscribe_Options::conflate is set, PFC_TIMEOUT or a nanomsg error
+//!                  if the server did not answer, PFC_IP_SERIALIZATION_ERROR for a damaged snapshot
+Error PubSub_Subscriber::request_snapshot(URI snapshot_uri, std::chrono::milliseconds timeout)
+{
+  auto& impl = *_impl;
+  if (!impl.options.conflate) {
+    return Error::Code::PFC_BAD_OPERATION;
+  }
+  std::vector<std::string> filters;
+  {
+    std::lock_guard<std::mutex> guard(impl.filters_mutex);
+    filters = impl.filters;
   }
-  _impl->socket = 0;
+  Client_Options client_options;
+  client_options.sockets = 1;
+  ReqRep_Client client(std::move(snapshot_uri), client_options);
+  for (auto& filter : filters) {
+    auto reply = client.request(message(filter.data(), filter.size()), timeout).get();
+    if (reply.ec) {
+      return reply.ec;
+    }
+    auto complete = Last_Value_Cache::unpack(reply.body, [&impl](message value) {
+      impl.latest.conflate(value, true);
+    });
+    if (!complete) {
+      return Error::Code::PFC_IP_SERIALIZATION_ERROR;
+    }
+  }
+  return Success();
+}
+//-------------------------------------------------------------------------------
+//! \return uint64_t -- Messages a conflating subscriber skipped because a newer one of the same topic arrived first
+uint64_t PubSub_Subscriber::conflated() const
+{
+  return _impl->latest.conflated();
+}
+//-------------------------------------------------------------------------------
+//! \return size_t -- Messages waiting for the dispatch workers
+size_t PubSub_Subscriber::dispatch_queued() const
+{
+  size_t queued = 0;
+  for (auto& worker : _impl->workers) {
+    queued += worker->queue.size();
+  }
+  return queued;
+}
+//-------------------------------------------------------------------------------
+//! \return size_t -- Most messages ever waiting for a single dispatch worker
+size_t PubSub_Subscriber::dispatch_high_water() const
+{
+  size_t high_water = 0;
+  for (auto& worker : _impl->workers) {
+    high_water = std::max(high_water, worker->queue.high_water());
+  }
+  return high_water;
+}
+//-------------------------------------------------------------------------------
+//! \return uint64_t -- Messages discarded because their dispatch worker was full
+uint64_t PubSub_Subscriber::dispatch_dropped() const
+{
+  return _impl->dispatch_dropped_count;
 }
 //-------------------------------------------------------------------------------
 //!
 //! \param func [IN] -- Function that will be called when a message is received by a client
 //!
-//! Blocking call for receiving a single message
-void PubSub_Subscriber::listen(ListenFunc func)
+//! Blocking call for receiving a single message. With dispatch workers the call returns once the
+//! message is queued, and func runs on a worker
+void PubSub_Subscriber::listen(MessageListenFunc func)
 {
   _impl->message_process_function = func;
   _impl->running = false;
+  _impl->start_dispatch();
   _impl->listen();
 }
 //-------------------------------------------------------------------------------
@@ -128,13 +495,66 @@ void PubSub_Subscriber::listen(ListenFunc func)
 //! Future versions of async_broadcast may allow multiple parallel broadcast, but this is currently
 //! Undefined behavior.
 //!
-void PubSub_Subscriber::async_listen(ListenFunc func)
+void PubSub_Subscriber::async_listen(MessageListenFunc func)
 {
   _impl->message_process_function = func;
   _impl->running = true;
+  _impl->start_dispatch();
+  //The receive thread wakes periodically to see running cleared, so shutdown can join it
+  if (_impl->socket >= 0) {
+    int timeout = g_receive_poll;
+    nn_setsockopt(_impl->socket, NN_SOL_SOCKET, NN_RCVTIMEO, &timeout, sizeof(timeout));
+  }
   _impl->pubsub_main_thread = std::thread(&Implementation::listen, _impl.get());
 }
 //-------------------------------------------------------------------------------
+//! \param reactor [IN] -- Reactor which polls the socket and runs func on one of its workers
+//! \param func [IN] -- Function that will be called when a message is received
+//!
+//! Non Blocking listen without a thread of its own. func is never called twice at once by one
+//! Subscriber, but may run in parallel with other Listiners sharing the Reactor.
+//! A shm:// subscriber has no socket to poll and listens on a thread of its own instead.
+void PubSub_Subscriber::async_listen(Reactor& reactor, MessageListenFunc func)
+{
+  if (_impl->ring) {
+    async_listen(std::move(func));
+    return;
+  }
+  _impl->message_process_function = func;
+  _impl->running = true;
+  _impl->start_dispatch();
+  auto impl = _impl.get();
+  auto ec = reactor.add(_impl->socket, NN_POLLIN, [impl](int, short) { impl->react(); });
+  if (ec) {
+    _impl->ec = ec;
+    return;
+  }
+  _impl->reactor = &reactor;
+}
+//-------------------------------------------------------------------------------
+//!
+//! \param func [IN] -- Function that will be called when a message is received
+//!
+//! Blocking call for receiving a single message. The vector func returns is ignored
+void PubSub_Subscriber::listen(ListenFunc func)
+{
+  listen([func](message msg) {
+    func(msg.data(), msg.size());
+    return message();
+  });
+}
+//-------------------------------------------------------------------------------
+//! \param func [IN] -- Function that will be called when a message is received
+//!
+//! Non Blocking listen. The vector func returns is ignored
+void PubSub_Subscriber::async_listen(ListenFunc func)
+{
+  async_listen([func](message msg) {
+    func(msg.data(), msg.size());
+    return message();
+  });
+}
+//-------------------------------------------------------------------------------
 //! Part of the Pattern interface stands up all IO not handled by the RIIA
 //
 void PubSub_Subscriber::standup()
@@ -143,9 +563,22 @@ void PubSub_Subscriber::standup()
 //-------------------------------------------------------------------------------
 //! Terminates all pending IO will invalidate future broadcast events and should onyl be called
 //! Before the Surveyor goes out of scope.
+//! The receive thread is joined before the dispatch workers are released, so a nanomsg
+//! subscriber may listen again afterwards.
 void PubSub_Subscriber::shutdown()
 {
   _impl->running = false;
+  if (_impl->reactor) {
+    _impl->reactor->remove(_impl->socket);
+    _impl->reactor = nullptr;
+  }
+  if (_impl->ring) {
+    _impl->ring->close();
+  }
+  if (_impl->pubsub_main_thread.joinable()) {
+    _impl->pubsub_main_thread.join();
+  }
+  _impl->stop_dispatch();
 }
 //-------------------------------------------------------------------------------
 }
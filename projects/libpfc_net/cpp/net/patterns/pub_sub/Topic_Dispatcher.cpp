@@ -0,0 +1,188 @@
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+/*! \file */
+
+#include <sustain/framework/net/patterns/pub_sub/Topic_Dispatcher.h>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+
+namespace pfc {
+//!
+//! PIMPL Implementation of a Topic_Dispatcher
+//!
+struct Topic_Dispatcher::Implementation {
+  Implementation(PubSub_Subscriber&);
+
+  using Handlers = std::map<std::string, std::shared_ptr<FrameFunc>>;
+
+  std::shared_ptr<FrameFunc> find(const Topic_Frame&) const;
+  static std::string filter(const std::string& topic, Topic_Match);
+
+  PubSub_Subscriber& subscriber;
+  Handlers exact; //!< Handlers keyed by the exact topic they receive
+  Handlers prefixes; //!< Handlers keyed by the topic prefix they receive
+  mutable std::mutex handlers_mutex; //!< Held only to look a handler up, never while it runs
+
+  std::atomic<uint64_t> dispatched_count;
+  std::atomic<uint64_t> unmatched_count;
+  std::atomic<uint64_t> malformed_count;
+};
+//-----------------------------------------------------------------------------
+//! \param s [IN] -- Subscriber whose subscriptions the dispatcher manages
+Topic_Dispatcher::Implementation::Implementation(PubSub_Subscriber& s)
+  : subscriber(s)
+  , dispatched_count(0)
+  , unmatched_count(0)
+  , malformed_count(0)
+{
+}
+//-----------------------------------------------------------------------------
+//! \param frame [IN] -- Topic of a received message
+//! \return std::shared_ptr<FrameFunc> -- The exact handler, else the longest matching prefix handler, else nullptr
+std::shared_ptr<Topic_Dispatcher::FrameFunc> Topic_Dispatcher::Implementation::find(const Topic_Frame& frame) const
+{
+  std::string topic(frame.topic, frame.topic_size);
+  std::lock_guard<std::mutex> guard(handlers_mutex);
+  auto handler = exact.find(topic);
+  if (handler != exact.end()) {
+    return handler->second;
+  }
+  std::shared_ptr<FrameFunc> longest;
+  size_t longest_size = 0;
+  for (auto& prefix : prefixes) {
+    if (prefix.first.size() >= longest_size && topic.compare(0, prefix.first.size(), prefix.first) == 0) {
+      longest = prefix.second;
+      longest_size = prefix.first.size();
+    }
+  }
+  return longest;
+}
+//-----------------------------------------------------------------------------
+//! \return std::string -- nanomsg subscription which implements match for topic
+std::string Topic_Dispatcher::Implementation::filter(const std::string& topic, Topic_Match match)
+{
+  return (match == Topic_Match::exact) ? exact_topic(topic) : topic;
+}
+//-----------------------------------------------------------------------------
+//! \param subscriber [IN] -- Subscriber to dispatch for. Must outlive the dispatcher
+Topic_Dispatcher::Topic_Dispatcher(PubSub_Subscriber& subscriber)
+  : _impl(std::make_unique<Implementation>(subscriber))
+{
+  subscriber.unsubscribe("");
+}
+//-----------------------------------------------------------------------------
+Topic_Dispatcher::~Topic_Dispatcher()
+{
+  _impl = nullptr;
+}
+//-----------------------------------------------------------------------------
+//! Registers a handler and subscribes to its topic. Replaces any handler already registered for it
+//! \param topic [IN] -- Topic the publisher framed the message with
+//! \param handler [IN] -- Receives the topic and raw payload
+//! \param match [IN] -- Exact topic or every topic topic prefixes
+//! \return Error -- Success() or the reason nanomsg rejected the subscription
+Error Topic_Dispatcher::on_frame(const std::string& topic, FrameFunc handler, Topic_Match match)
+{
+  auto& impl = *_impl;
+  auto& handlers = (match == Topic_Match::exact) ? impl.exact : impl.prefixes;
+  bool subscribed = false;
+  {
+    std::lock_guard<std::mutex> guard(impl.handlers_mutex);
+    auto& registered = handlers[topic];
+    subscribed = registered != nullptr;
+    registered = std::make_shared<FrameFunc>(std::move(handler));
+  }
+  if (subscribed) {
+    return Success();
+  }
+  auto ec = impl.subscriber.subscribe(Implementation::filter(topic, match));
+  if (ec) {
+    std::lock_guard<std::mutex> guard(impl.handlers_mutex);
+    handlers.erase(topic);
+  }
+  return ec;
+}
+//-----------------------------------------------------------------------------
+//! Removes a handler and its subscription. A call to the handler already under way still completes
+//! \param topic [IN] -- Topic passed to on or on_frame
+//! \param match [IN] -- Match passed to on or on_frame
+//! \return Error -- PFC_BAD_OPERATION when no such handler is registered
+Error Topic_Dispatcher::off(const std::string& topic, Topic_Match match)
+{
+  auto& impl = *_impl;
+  auto& handlers = (match == Topic_Match::exact) ? impl.exact : impl.prefixes;
+  {
+    std::lock_guard<std::mutex> guard(impl.handlers_mutex);
+    if (handlers.erase(topic) == 0) {
+      return Error::Code::PFC_BAD_OPERATION;
+    }
+  }
+  return impl.subscriber.unsubscribe(Implementation::filter(topic, match));
+}
+//-----------------------------------------------------------------------------
+//! Calls the handler for the topic of a framed message
+//! \param framed [IN] -- Message built with topic_message
+void Topic_Dispatcher::dispatch(const message& framed)
+{
+  auto& impl = *_impl;
+  Topic_Frame frame;
+  if (!split_topic(framed, frame)) {
+    ++impl.malformed_count;
+    return;
+  }
+  auto handler = impl.find(frame);
+  if (!handler) {
+    ++impl.unmatched_count;
+    return;
+  }
+  ++impl.dispatched_count;
+  (*handler)(frame);
+}
+//-----------------------------------------------------------------------------
+//! \return Listiner::MessageListenFunc -- Listener for the subscriber which calls dispatch.
+//!         The dispatcher must outlive the listen
+Listiner::MessageListenFunc Topic_Dispatcher::listener()
+{
+  return [this](message framed) {
+    dispatch(framed);
+    return message();
+  };
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Messages handed to a handler
+uint64_t Topic_Dispatcher::dispatched() const
+{
+  return _impl->dispatched_count;
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Messages which matched no handler. They passed another subscription of the
+//!                     subscriber, such as the topic it was constructed with, or raced with off
+uint64_t Topic_Dispatcher::unmatched() const
+{
+  return _impl->unmatched_count;
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Messages without a topic, or whose payload a typed handler could not deserialize
+uint64_t Topic_Dispatcher::malformed() const
+{
+  return _impl->malformed_count;
+}
+//-----------------------------------------------------------------------------
+void Topic_Dispatcher::count_malformed()
+{
+  ++_impl->malformed_count;
+}
+//-----------------------------------------------------------------------------
+}
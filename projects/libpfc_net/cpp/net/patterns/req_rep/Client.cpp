@@ -14,11 +14,26 @@ specific language governing permissions and limitations under the license.
 
 #include <sustain/framework/net/patterns/req_rep/Client.h>
 
-#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
+#include <nanomsg/pipeline.h>
 #include <nanomsg/reqrep.h>
 
+#include <sustain/framework/Protocol.h>
+#include <sustain/framework/net/Endpoint.h>
+#include <sustain/framework/net/patterns/pub_sub/Subscriber.h>
+#include <sustain/framework/net/patterns/pub_sub/Topic.h>
+#include <sustain/framework/util/Mpsc_Queue.h>
+
 #include "../nanomsg_helper.h"
 
 namespace pfc {
@@ -36,11 +51,49 @@ struct nn_buffer : std::streambuf {
     this->setg(begin, begin, end);
   }
 };
+namespace {
+  constexpr double latency_weight = 0.2; //!< Weight of the newest reply time in the moving average of a replica
+  constexpr size_t latency_samples = 256; //!< Reply times the hedge percentile is taken over
+  constexpr size_t latency_refresh = 32; //!< Replies between recalculations of the hedge delay
+}
+//!
+//!  Asynchronous request waiting for, or occupying, a pooled socket
+//!
+struct Client_Call {
+  uint64_t id = 0;
+  message body;
+  ReqRep_Client::ReplyFunc done;
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+  message hedge; //!< Copy of body for a second replica. Empty when the call is not hedged
+  std::chrono::steady_clock::time_point hedge_at = std::chrono::steady_clock::time_point::max(); //!< When hedge is sent
+};
+struct Client_Replica;
+//!
+//!  REQ socket of the request pool and the call it is carrying
+//!
+struct Pooled_Socket {
+  int socket = no_socket;
+  bool busy = false;
+  bool duplicate = false; //!< Carries the hedge of the call on twin rather than a call of its own
+  Client_Call call;
+  Client_Replica* replica = nullptr;
+  Pooled_Socket* twin = nullptr; //!< Other socket carrying the same call while it is hedged
+  std::chrono::steady_clock::time_point sent;
+};
+//!
+//!  Replica of the service and the request pool connected to it. Only used by the dispatch thread
+//!
+struct Client_Replica {
+  std::string endpoint;
+  std::vector<Pooled_Socket> pool;
+  size_t outstanding = 0; //!< Busy sockets of pool
+  double latency = 0; //!< Moving average of reply times in microseconds. 0 until the first reply
+};
 //!
 //!  PIMPL Implementation of Survey_Surveyor
 //!
 struct ReqRep_Client::Implementation {
-  Implementation(URI&&);
+  Implementation(Client_Options&&);
   ~Implementation();
 
   Implementation(const Implementation&) = delete;
@@ -48,18 +101,76 @@ struct ReqRep_Client::Implementation {
   Implementation& operator==(const Implementation&) = delete;
   Implementation& operator==(Implementation&&) = delete;
 
-  URI uri; //!<  URI of the service to be given to nano_msg
   int socket; //!<  Socket the service runs
-  int rv; //!<  return value of any nano_msg calls
   char* msg_buffer; //!<  msg_buffer nano_messages internal buffer
   bool running; //!<  Run control for async threading
 
   void listen();
 
   std::thread pubsub_main_thread; //!< Threading control or async read/write
-  BroadcastFunc generate_message_func; //!< Function used to generate message needed for call back
+  MessageFunc generate_message_func; //!< Function used to generate message needed for call back
   CallbackFunc response_callback_function;//!< Function used to respond to message used as callback in nanomssg
 
+  bool start_dispatching();
+  bool open_wake();
+  void stop_dispatching();
+  void fail_queued();
+  void wake();
+  void dispatch();
+  void complete(Client_Call&, Error, message&&);
+
+  Error add(const URI&);
+  Error remove(const URI&);
+  void apply_replica_changes();
+  void close_replica(Client_Replica&);
+  Pooled_Socket* pick(const Client_Replica* exclude);
+  void send(Pooled_Socket&, Client_Call&&);
+  void hedge(Pooled_Socket&, std::chrono::steady_clock::time_point now);
+  void finish(Pooled_Socket&, Error, message&&);
+  void release(Pooled_Socket&);
+  void record(Client_Replica&, std::chrono::steady_clock::duration, bool replied);
+
+  void follow(const Replica_Discovery&);
+  void stop_following();
+  void on_delta(const message&);
+  void on_snapshot(Client_Reply&);
+  void apply(const pfc_registry_delta&);
+
+  Client_Options options;
+  Mpsc_Queue<Client_Call> calls; //!< Requests handed to the dispatch thread
+  std::deque<Client_Call> waiting; //!< Requests the dispatch thread took off calls and holds until a socket is free or their deadline passes
+  std::atomic<size_t> queued; //!< Requests in calls or waiting, bounded by the capacity of calls
+  std::vector<std::unique_ptr<Client_Replica>> replicas; //!< Pools opened by the dispatch thread
+  size_t next_replica; //!< Where pick starts, rotated so ties are spread over the replicas
+  int wake_pull; //!< Polled with the pool so a new request interrupts nn_poll
+  int wake_push;
+  std::atomic<bool> polling; //!< True while the dispatch thread may be blocked in nn_poll
+  std::atomic<bool> dispatching;
+  std::mutex lifecycle_mutex; //!< Serializes starting and stopping the dispatch thread
+  std::atomic<bool> closed; //!< Set by shutdown so the dispatch thread is never restarted
+  std::thread dispatch_thread;
+  std::atomic<uint64_t> next_id;
+  std::atomic<size_t> pending; //!< Requests accepted and not yet completed
+
+  std::mutex replica_mutex; //!< Guards endpoints and replica_changes
+  std::map<std::string, int> endpoints; //!< Replicas and their endpoint on socket
+  std::vector<std::pair<std::string, bool>> replica_changes; //!< Replicas added (true) or removed since the dispatch thread last looked
+
+  std::vector<double> samples; //!< Recent reply times in microseconds, used as a ring
+  std::vector<double> ranked; //!< Scratch for the percentile of samples
+  size_t sample_count;
+  std::chrono::microseconds hedge_delay;
+  uint64_t send_count; //!< Requests put on the wire, the base of Client_Options::hedge_budget
+  std::atomic<uint64_t> hedge_count;
+
+  std::string service; //!< Service followed on the registry change feed
+  std::unique_ptr<PubSub_Subscriber> watch;
+  std::unique_ptr<ReqRep_Client> registry; //!< Asks for the snapshot which watch is applied on top of
+  std::mutex discovery_mutex; //!< Guards synced, synced_sequence and early
+  bool synced;
+  pfc_uint synced_sequence;
+  std::vector<pfc_registry_delta> early; //!< Changes heard before the snapshot arrived
+
   Error ec; //!< Current Error code of the system else Success()
 };
  //-------------------------------------------------------------------------------
@@ -67,11 +178,9 @@ struct ReqRep_Client::Implementation {
 //!  Deconstructor for the Implementation
 ReqRep_Client::Implementation::~Implementation()
 {
-  if (rv && socket) {
-    nn_shutdown(socket, rv);
-  }
-
-  if (socket) {
+  stop_following();
+  stop_dispatching();
+  if (socket >= 0) {
     nn_close(socket);
   }
   if (msg_buffer) {
@@ -81,20 +190,36 @@ ReqRep_Client::Implementation::~Implementation()
 }
 //-------------------------------------------------------------------------------
 //!
-//! URI based constructor
-//! \param u [IN,OUT] Moves URI in to palce and stands up nn_socket and nn_bind
-ReqRep_Client::Implementation::Implementation(URI&& u)
-  : uri(std::move(u))
-  , socket(0)
-  , rv(0)
+//! Stands up the nn_socket used by broadcast. Replicas are connected by add
+//! \param o [IN] Pools used by request
+ReqRep_Client::Implementation::Implementation(Client_Options&& o)
+  : socket(no_socket)
   , msg_buffer(nullptr)
   , running(false)
+  , options(std::move(o))
+  , calls(options.max_pending)
+  , queued(0)
+  , next_replica(0)
+  , wake_pull(no_socket)
+  , wake_push(no_socket)
+  , polling(false)
+  , dispatching(false)
+  , closed(false)
+  , next_id(1)
+  , pending(0)
+  , samples(latency_samples)
+  , sample_count(0)
+  , hedge_delay(options.hedge_min_delay)
+  , send_count(0)
+  , hedge_count(0)
+  , synced(false)
+  , synced_sequence(0)
 {
-  if ((socket = nn_socket(AF_SP, NN_REQ)) < 0) {
-    ec = nano_to_Error(socket);
+  if (options.sockets == 0) {
+    options.sockets = 1;
   }
-  if (rv = nn_connect(socket, uri.c_str()) < 0) {
-    ec = nano_to_Error(socket);
+  if ((socket = nn_socket(AF_SP, NN_REQ)) < 0) {
+    ec = nano_to_Error(nn_errno());
   }
 }
 //-----------------------------------------------------------------------------
@@ -107,8 +232,8 @@ void ReqRep_Client::Implementation::listen()
   do {
     int bytes = 0;
     auto buffer = generate_message_func();
-    if ((bytes = nn_send(socket, &buffer[0], buffer.size(), 0)) < 0) {
-      ec = nano_to_Error(bytes);
+    if ((bytes = send_message(socket, buffer)) < 0) {
+      ec = nano_to_Error(nn_errno());
     }
 
     char* nanomsg_buffer = 0;
@@ -126,17 +251,712 @@ void ReqRep_Client::Implementation::listen()
   } while (running);
 }
 //-----------------------------------------------------------------------------
+//! Opens the wake up sockets and starts the dispatch thread on first use
+//! \return bool -- false after shutdown or when the sockets could not be opened, which also closes the client
+bool ReqRep_Client::Implementation::start_dispatching()
+{
+  if (dispatching.load(std::memory_order_acquire)) {
+    return true;
+  }
+  std::lock_guard<std::mutex> guard(lifecycle_mutex);
+  if (closed) {
+    return false;
+  }
+  if (dispatching) {
+    return true;
+  }
+  if (!open_wake()) {
+    closed = true;
+    return false;
+  }
+  dispatching = true;
+  dispatch_thread = std::thread(&Implementation::dispatch, this);
+  return true;
+}
+//-----------------------------------------------------------------------------
+//! Fails every request left in calls with PFC_LIBRARY_SHUTDOWN. Called once closed is set, by
+//! stop_dispatching and by any request which pushed its call too late for it. Each call is popped
+//! by exactly one of them.
+void ReqRep_Client::Implementation::fail_queued()
+{
+  //Pairs with the fence in wake: either the pusher sees closed or this sees its call
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  Client_Call call;
+  while (calls.try_pop(call)) {
+    complete(call, Error::Code::PFC_LIBRARY_SHUTDOWN, message());
+  }
+}
+//-----------------------------------------------------------------------------
+//! Opens the sockets which interrupt nn_poll when a request is queued or the replicas change
+//! \return bool -- false with ec set if nanomsg refused a socket
+bool ReqRep_Client::Implementation::open_wake()
+{
+  auto wake_endpoint = "inproc://pfc_client_wake_" + std::to_string(reinterpret_cast<uintptr_t>(this));
+  if ((wake_pull = nn_socket(AF_SP, NN_PULL)) < 0 || nn_bind(wake_pull, wake_endpoint.c_str()) < 0
+      || (wake_push = nn_socket(AF_SP, NN_PUSH)) < 0 || nn_connect(wake_push, wake_endpoint.c_str()) < 0) {
+    ec = nano_to_Error(nn_errno());
+    return false;
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+//! Stops the dispatch thread, fails every unfinished request with PFC_LIBRARY_SHUTDOWN and closes the pools
+void ReqRep_Client::Implementation::stop_dispatching()
+{
+  {
+    std::lock_guard<std::mutex> guard(lifecycle_mutex);
+    closed = true;
+    dispatching = false;
+  }
+  if (wake_push >= 0) {
+    nn_send(wake_push, "", 0, NN_DONTWAIT);
+  }
+  if (dispatch_thread.joinable()) {
+    dispatch_thread.join();
+  }
+
+  for (auto& call : waiting) {
+    complete(call, Error::Code::PFC_LIBRARY_SHUTDOWN, message());
+  }
+  waiting.clear();
+  fail_queued();
+  queued = 0;
+  for (auto& replica : replicas) {
+    for (auto& slot : replica->pool) {
+      if (slot.busy && !slot.duplicate) {
+        complete(slot.call, Error::Code::PFC_LIBRARY_SHUTDOWN, message());
+      }
+      slot.busy = false;
+      if (slot.socket >= 0) {
+        nn_close(slot.socket);
+        slot.socket = no_socket;
+      }
+    }
+  }
+  replicas.clear();
+  for (auto wake : { &wake_push, &wake_pull }) {
+    if (*wake >= 0) {
+      nn_close(*wake);
+      *wake = no_socket;
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+//! Interrupts nn_poll so the dispatch thread sees new requests and replicas
+void ReqRep_Client::Implementation::wake()
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (polling.exchange(false)) {
+    nn_send(wake_push, "", 0, NN_DONTWAIT);
+  }
+}
+//-----------------------------------------------------------------------------
+//! Dispatch thread. Hands queued requests to idle sockets of the preferred replicas, then polls the
+//! busy sockets for replies until a reply arrives, a deadline or hedge falls due or a new request or
+//! replica wakes it. Requests still waiting for a socket time out like those on the wire, which
+//! matters most while discovery has not found a replica.
+void ReqRep_Client::Implementation::dispatch()
+{
+  using namespace std::chrono;
+  constexpr int max_poll = 100; //!< Bounds how long shutdown may wait in ms
+
+  Client_Call call;
+  std::vector<nn_pollfd> fds;
+  std::vector<Pooled_Socket*> polled;
+  while (dispatching) {
+    apply_replica_changes();
+
+    while (calls.try_pop(call)) {
+      waiting.push_back(std::move(call));
+    }
+    bool idle = false;
+    while (auto slot = pick(nullptr)) {
+      if (waiting.empty()) {
+        idle = true;
+        break;
+      }
+      --queued;
+      send(*slot, std::move(waiting.front()));
+      waiting.pop_front();
+    }
+
+    fds.assign(1, nn_pollfd { wake_pull, NN_POLLIN, 0 });
+    polled.clear();
+    auto next_deadline = steady_clock::time_point::max();
+    for (auto& replica : replicas) {
+      for (auto& slot : replica->pool) {
+        if (slot.busy) {
+          fds.push_back(nn_pollfd { slot.socket, NN_POLLIN, 0 });
+          polled.push_back(&slot);
+          next_deadline = std::min({ next_deadline, slot.call.deadline, slot.call.hedge_at });
+        }
+      }
+    }
+    for (auto& queued_call : waiting) {
+      next_deadline = std::min(next_deadline, queued_call.deadline);
+    }
+    int timeout = max_poll;
+    if (next_deadline != steady_clock::time_point::max()) {
+      auto remaining = duration_cast<milliseconds>(next_deadline - steady_clock::now()).count() + 1;
+      timeout = static_cast<int>(std::max<long long>(0, std::min<long long>(remaining, max_poll)));
+    }
+
+    //A request queued after this point sees polling and wakes the poll
+    polling.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (idle && !calls.empty()) {
+      timeout = 0;
+    }
+    nn_poll(fds.data(), static_cast<int>(fds.size()), timeout);
+    polling.store(false);
+
+    if (fds[0].revents & NN_POLLIN) {
+      void* wake = nullptr;
+      while (nn_recv(wake_pull, &wake, NN_MSG, NN_DONTWAIT) >= 0) {
+        nn_freemsg(wake);
+      }
+    }
+    for (size_t index = 0; index < polled.size(); ++index) {
+      //A hedged call may already have been answered by its twin
+      if ((fds[index + 1].revents & NN_POLLIN) && polled[index]->busy) {
+        auto& slot = *polled[index];
+        message reply;
+        if (receive_message(slot.socket, reply, NN_DONTWAIT) >= 0) {
+          finish(slot, Success(), std::move(reply));
+        }
+      }
+    }
+    //Sending the next request on a REQ socket abandons the one which timed out or lost the hedge
+    auto now = steady_clock::now();
+    for (auto slot : polled) {
+      if (slot->busy && slot->call.deadline <= now) {
+        finish(*slot, Error::Code::PFC_TIMEOUT, message());
+      }
+    }
+    for (auto queued_call = waiting.begin(); queued_call != waiting.end();) {
+      if (queued_call->deadline <= now) {
+        --queued;
+        complete(*queued_call, Error::Code::PFC_TIMEOUT, message());
+        queued_call = waiting.erase(queued_call);
+      } else {
+        ++queued_call;
+      }
+    }
+    for (auto slot : polled) {
+      if (slot->busy && slot->call.hedge_at <= now) {
+        hedge(*slot, now);
+      }
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+//! Runs the completion callback of a request and releases its resources
+void ReqRep_Client::Implementation::complete(Client_Call& call, Error result, message&& body)
+{
+  Client_Reply reply;
+  reply.id = call.id;
+  reply.ec = result;
+  reply.body = std::move(body);
+  auto done = std::move(call.done);
+  call = Client_Call();
+  --pending;
+  if (done) {
+    done(std::move(reply));
+  }
+}
+//-----------------------------------------------------------------------------
+//! Connects the broadcast socket to a replica and has the dispatch thread open a pool for it
+//! \param replica [IN] -- Endpoint of the replica
+//! \return Error -- Success() if the replica is now used, PFC_LIBRARY_SHUTDOWN after shutdown or the reason nanomsg refused it
+Error ReqRep_Client::Implementation::add(const URI& replica)
+{
+  if (!replica.is_valid()) {
+    return replica.error();
+  }
+  {
+    std::lock_guard<std::mutex> guard(lifecycle_mutex);
+    if (closed) {
+      return Error::Code::PFC_LIBRARY_SHUTDOWN;
+    }
+  }
+  std::string endpoint = replica.c_str();
+  {
+    std::lock_guard<std::mutex> guard(replica_mutex);
+    if (endpoints.count(endpoint)) {
+      return Success();
+    }
+    int connection = nn_connect(socket, endpoint.c_str());
+    if (connection < 0) {
+      return nano_to_Error(nn_errno());
+    }
+    endpoints[endpoint] = connection;
+    replica_changes.emplace_back(endpoint, true);
+  }
+  wake();
+  return Success();
+}
+//-----------------------------------------------------------------------------
+//! Disconnects a replica. Requests it was answering are failed unless a hedge is still out
+//! \param replica [IN] -- Endpoint given to add
+//! \return Error -- Success() or PFC_INVALID_ENDPOINT when replica is not in use
+Error ReqRep_Client::Implementation::remove(const URI& replica)
+{
+  std::string endpoint = replica.c_str();
+  {
+    std::lock_guard<std::mutex> guard(replica_mutex);
+    auto found = endpoints.find(endpoint);
+    if (found == endpoints.end()) {
+      return Error::Code::PFC_INVALID_ENDPOINT;
+    }
+    nn_shutdown(socket, found->second);
+    endpoints.erase(found);
+    replica_changes.emplace_back(endpoint, false);
+  }
+  wake();
+  return Success();
+}
+//-----------------------------------------------------------------------------
+//! Dispatch thread. Opens a pool for each replica added and closes the pool of each one removed
+void ReqRep_Client::Implementation::apply_replica_changes()
+{
+  std::vector<std::pair<std::string, bool>> changes;
+  {
+    std::lock_guard<std::mutex> guard(replica_mutex);
+    changes.swap(replica_changes);
+  }
+  int resend_interval = static_cast<int>(options.resend_interval.count());
+  for (auto& change : changes) {
+    auto found = std::find_if(replicas.begin(), replicas.end(),
+                              [&change](const std::unique_ptr<Client_Replica>& replica) { return replica->endpoint == change.first; });
+    if (!change.second) {
+      if (found != replicas.end()) {
+        close_replica(**found);
+        replicas.erase(found);
+      }
+      continue;
+    }
+    if (found != replicas.end()) {
+      continue;
+    }
+    auto replica = std::make_unique<Client_Replica>();
+    replica->endpoint = change.first;
+    replica->pool.resize(options.sockets);
+    bool opened = true;
+    for (auto& slot : replica->pool) {
+      slot.replica = replica.get();
+      if ((slot.socket = nn_socket(AF_SP, NN_REQ)) < 0) {
+        ec = nano_to_Error(nn_errno());
+        opened = false;
+        break;
+      }
+      if (resend_interval > 0) {
+        nn_setsockopt(slot.socket, NN_REQ, NN_REQ_RESEND_IVL, &resend_interval, sizeof(resend_interval));
+      }
+      if (nn_connect(slot.socket, replica->endpoint.c_str()) < 0) {
+        ec = nano_to_Error(nn_errno());
+        opened = false;
+        break;
+      }
+    }
+    if (opened) {
+      replicas.push_back(std::move(replica));
+    } else {
+      close_replica(*replica);
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+//! Closes the pool of a replica. A hedged call carries on with its twin, other calls on the
+//! replica fail with PFC_INVALID_ENDPOINT as their request was already handed to nanomsg
+void ReqRep_Client::Implementation::close_replica(Client_Replica& replica)
+{
+  for (auto& slot : replica.pool) {
+    if (slot.busy) {
+      if (slot.duplicate) {
+        slot.twin->twin = nullptr;
+      } else if (slot.twin) {
+        auto& twin = *slot.twin;
+        twin.call = std::move(slot.call);
+        twin.duplicate = false;
+        twin.twin = nullptr;
+      } else {
+        complete(slot.call, Error::Code::PFC_INVALID_ENDPOINT, message());
+      }
+      slot.busy = false;
+    }
+    if (slot.socket >= 0) {
+      nn_close(slot.socket);
+      slot.socket = no_socket;
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+//! Chooses where the next request goes
+//! \param exclude [IN] -- Replica not to choose, nullptr for none
+//! \return Pooled_Socket* -- Idle socket of the replica Client_Options::balance prefers, nullptr when every replica is busy
+Pooled_Socket* ReqRep_Client::Implementation::pick(const Client_Replica* exclude)
+{
+  Pooled_Socket* best = nullptr;
+  double best_score = 0;
+  auto count = replicas.size();
+  for (size_t offset = 0; offset < count; ++offset) {
+    auto& replica = *replicas[(next_replica + offset) % count];
+    if (&replica == exclude || replica.outstanding == replica.pool.size()) {
+      continue;
+    }
+    //An untimed replica scores 0 under ewma_latency so every new replica is tried
+    auto score = (options.balance == Balance_Policy::ewma_latency)
+      ? replica.latency * static_cast<double>(replica.outstanding + 1)
+      : static_cast<double>(replica.outstanding);
+    if (best && score >= best_score) {
+      continue;
+    }
+    for (auto& slot : replica.pool) {
+      if (!slot.busy) {
+        best = &slot;
+        best_score = score;
+        break;
+      }
+    }
+  }
+  if (best) {
+    next_replica = (next_replica + 1) % count;
+  }
+  return best;
+}
+//-----------------------------------------------------------------------------
+//! Puts a request on the wire. When hedging is possible a copy is kept for a second replica
+//! \param slot [IN,OUT] -- Idle socket chosen by pick
+//! \param call [IN] -- Request to send. Completed straight away if nanomsg refuses it
+void ReqRep_Client::Implementation::send(Pooled_Socket& slot, Client_Call&& call)
+{
+  auto now = std::chrono::steady_clock::now();
+  if (options.hedge_percentile > 0 && replicas.size() > 1) {
+    auto storage = (call.body.storage() == message::Storage::pooled) ? message::Storage::pooled : message::Storage::nanomsg;
+    call.hedge = message(call.body.data(), call.body.size(), storage);
+    call.hedge_at = now + hedge_delay;
+  }
+  if (send_message(slot.socket, call.body, NN_DONTWAIT) < 0) {
+    complete(call, nano_to_Error(nn_errno()), message());
+    return;
+  }
+  slot.call = std::move(call);
+  slot.busy = true;
+  slot.sent = now;
+  ++slot.replica->outstanding;
+  ++send_count;
+}
+//-----------------------------------------------------------------------------
+//! Sends the copy of a slow request to the preferred other replica. A call is hedged at most once
+//! and not at all once the hedges would exceed Client_Options::hedge_budget
+//! \param owner [IN,OUT] -- Busy socket whose hedge_at has passed
+//! \param now [IN] -- Time of the check
+void ReqRep_Client::Implementation::hedge(Pooled_Socket& owner, std::chrono::steady_clock::time_point now)
+{
+  auto copy = std::move(owner.call.hedge);
+  owner.call.hedge = message();
+  owner.call.hedge_at = std::chrono::steady_clock::time_point::max();
+  if (static_cast<double>(hedge_count + 1) > options.hedge_budget * static_cast<double>(send_count)) {
+    return;
+  }
+  auto target = pick(owner.replica);
+  if (!target || send_message(target->socket, copy, NN_DONTWAIT) < 0) {
+    return;
+  }
+  target->call = Client_Call();
+  target->call.id = owner.call.id;
+  target->busy = true;
+  target->duplicate = true;
+  target->twin = &owner;
+  target->sent = now;
+  ++target->replica->outstanding;
+  owner.twin = target;
+  ++hedge_count;
+}
+//-----------------------------------------------------------------------------
+//! Completes the call a socket is carrying and frees both sockets of a hedged call. The replica
+//! which lost the hedge is penalized as if it had timed out, so it is chosen less while it is slow
+//! \param slot [IN,OUT] -- Socket which got the reply or whose call timed out
+//! \param result [IN] -- Success() or PFC_TIMEOUT
+//! \param body [IN] -- Reply
+void ReqRep_Client::Implementation::finish(Pooled_Socket& slot, Error result, message&& body)
+{
+  auto now = std::chrono::steady_clock::now();
+  record(*slot.replica, now - slot.sent, result.is_ok());
+  auto& owner = (slot.duplicate) ? *slot.twin : slot;
+  auto loser = (&owner == &slot) ? owner.twin : &owner;
+  if (loser) {
+    record(*loser->replica, now - loser->sent, false);
+  }
+  if (owner.twin) {
+    release(*owner.twin);
+  }
+  release(owner);
+  complete(owner.call, result, std::move(body));
+}
+//-----------------------------------------------------------------------------
+//! Returns a socket to its pool
+void ReqRep_Client::Implementation::release(Pooled_Socket& slot)
+{
+  slot.busy = false;
+  slot.duplicate = false;
+  slot.twin = nullptr;
+  --slot.replica->outstanding;
+}
+//-----------------------------------------------------------------------------
+//! Updates the moving average of a replica and, from replies, the hedge delay
+//! \param replica [IN,OUT] -- Replica which answered or timed out
+//! \param elapsed [IN] -- Time since the request was sent to it
+//! \param replied [IN] -- false for a timeout, which only penalizes the replica
+void ReqRep_Client::Implementation::record(Client_Replica& replica, std::chrono::steady_clock::duration elapsed, bool replied)
+{
+  auto micros = std::chrono::duration<double, std::micro>(elapsed).count();
+  replica.latency = (replica.latency == 0) ? micros : replica.latency + latency_weight * (micros - replica.latency);
+  if (!replied || options.hedge_percentile <= 0) {
+    return;
+  }
+  samples[sample_count++ % samples.size()] = micros;
+  if (sample_count % latency_refresh != 0) {
+    return;
+  }
+  ranked.assign(samples.begin(), samples.begin() + std::min(sample_count, samples.size()));
+  auto rank = ranked.begin() + static_cast<std::ptrdiff_t>(std::min(options.hedge_percentile, 1.0) * static_cast<double>(ranked.size() - 1));
+  std::nth_element(ranked.begin(), rank, ranked.end());
+  hedge_delay = std::max(options.hedge_min_delay, std::chrono::microseconds(static_cast<long long>(*rank)));
+}
+//-----------------------------------------------------------------------------
+//! Subscribes to the changes of a service on the registry feed and asks for the current replicas
+//! \param discovery [IN] -- Service and registry to follow
+void ReqRep_Client::Implementation::follow(const Replica_Discovery& discovery)
+{
+  service = discovery.service;
+  auto topic = registry_topic(pfc_protocol::req_req, service);
+  watch = std::make_unique<PubSub_Subscriber>(discovery.watch, exact_topic(topic));
+  watch->async_listen(Listiner::MessageListenFunc([this](message framed) {
+    on_delta(framed);
+    return message();
+  }));
+
+  //nanomsg resends the snapshot request until a registry answers
+  Client_Options snapshot_options;
+  snapshot_options.sockets = 1;
+  snapshot_options.resend_interval = std::chrono::milliseconds(1000);
+  registry = std::make_unique<ReqRep_Client>(discovery.snapshot, snapshot_options);
+  pfc_registry_snapshot_request request;
+  request._topic = topic;
+  message body(request.Length());
+  {
+    message_ostream os(body);
+    request.serialize(os);
+  }
+  registry->request(std::move(body), [this](Client_Reply reply) { on_snapshot(reply); });
+}
+//-----------------------------------------------------------------------------
+//! Stops listening to the registry before the replicas it changes are torn down
+void ReqRep_Client::Implementation::stop_following()
+{
+  if (watch) {
+    watch->shutdown();
+  }
+  watch = nullptr;
+  registry = nullptr;
+}
+//-----------------------------------------------------------------------------
+//! Subscriber thread. Applies a change, or holds it until the snapshot it follows has arrived
+//! \param framed [IN] -- Topic framed pfc_registry_delta
+void ReqRep_Client::Implementation::on_delta(const message& framed)
+{
+  Topic_Frame frame;
+  if (!split_topic(framed, frame)) {
+    return;
+  }
+  pfc_registry_delta delta;
+  message_istream is(frame.payload, frame.payload_size);
+  if (delta.deserialize(is).is_not_ok() || is.fail()) {
+    return;
+  }
+  std::lock_guard<std::mutex> guard(discovery_mutex);
+  if (!synced) {
+    early.push_back(std::move(delta));
+  } else if (static_cast<int32_t>(delta._sequence - synced_sequence) > 0) {
+    apply(delta);
+  }
+}
+//-----------------------------------------------------------------------------
+//! Snapshot client dispatch thread. Adds the replicas registered so far, then the changes heard
+//! meanwhile which the snapshot does not already reflect
+//! \param reply [IN] -- pfc_registry_snapshot_response followed by its registry_added deltas
+void ReqRep_Client::Implementation::on_snapshot(Client_Reply& reply)
+{
+  if (reply.ec.is_not_ok()) {
+    return;
+  }
+  pfc_registry_snapshot_response response;
+  std::vector<pfc_registry_delta> services;
+  {
+    message_istream is(reply.body);
+    if (response.deserialize(is).is_not_ok() || is.fail()) {
+      return;
+    }
+    for (pfc_uint index = 0; index < response._count; ++index) {
+      pfc_registry_delta delta;
+      if (delta.deserialize(is).is_not_ok() || is.fail()) {
+        return;
+      }
+      services.push_back(std::move(delta));
+    }
+  }
+  std::lock_guard<std::mutex> guard(discovery_mutex);
+  synced = true;
+  synced_sequence = response._sequence;
+  for (auto& delta : services) {
+    apply(delta);
+  }
+  for (auto& delta : early) {
+    if (static_cast<int32_t>(delta._sequence - synced_sequence) > 0) {
+      apply(delta);
+    }
+  }
+  early.clear();
+}
+//-----------------------------------------------------------------------------
+//! Caller holds discovery_mutex
+//! \param delta [IN] -- Registry change of a replica
+void ReqRep_Client::Implementation::apply(const pfc_registry_delta& delta)
+{
+  //The snapshot matches by prefix so it may include services whose name extends service
+  if (delta._name != service) {
+    return;
+  }
+  URI replica("tcp", delta._address, delta._port);
+  if (delta._change == registry_removed) {
+    remove(replica);
+  } else {
+    add(replica);
+  }
+}
+//-----------------------------------------------------------------------------
 //!  URI based constructor. Takes a copy of a URI to setup networking information
 //! \param uri [IN]  Service configuration of the new ReqRep_Client
-ReqRep_Client::ReqRep_Client(URI uri)
-  : _impl(std::make_unique<Implementation>(std::move(uri)))
+//! \param options [IN] Socket pool used by request
+ReqRep_Client::ReqRep_Client(URI uri, Client_Options options)
+  : _impl(std::make_unique<Implementation>(std::move(options)))
+{
+  auto result = _impl->add(uri);
+  if (result.is_not_ok()) {
+    _impl->ec = result;
+    _impl->closed = true;
+  }
+}
+//-----------------------------------------------------------------------------
+//!  Connects to a service on the cheapest transport it advertises, see select_endpoint
+//! \param service [IN]  Announcement of the replying service
+//! \param options [IN] Socket pool used by request
+ReqRep_Client::ReqRep_Client(const pfc_service_announcement& service, Client_Options options)
+  : ReqRep_Client(select_endpoint(service), std::move(options))
+{
+}
+//-----------------------------------------------------------------------------
+//!  Follows the replicas of a service through the registry. Requests queue until the first
+//!  replica is known
+//! \param discovery [IN]  Service name and registry endpoints
+//! \param options [IN] Socket pools used by request
+ReqRep_Client::ReqRep_Client(Replica_Discovery discovery, Client_Options options)
+  : _impl(std::make_unique<Implementation>(std::move(options)))
+{
+  _impl->follow(discovery);
+}
+//-----------------------------------------------------------------------------
+//! Queues a request. Safe to call from any number of threads
+//! \param body [IN] -- Serialized request
+//! \param done [IN] -- Called on the dispatch thread with the reply or the reason there is none
+//! \param timeout [IN] -- Time allowed for the reply. 0 uses Client_Options::timeout
+//! \return uint64_t -- Id passed back in Client_Reply::id
+uint64_t ReqRep_Client::request(message body, ReplyFunc done, std::chrono::milliseconds timeout)
+{
+  auto& impl = *_impl;
+  Client_Call call;
+  call.id = impl.next_id++;
+  call.body = std::move(body);
+  call.done = std::move(done);
+  if (timeout.count() == 0) {
+    timeout = impl.options.timeout;
+  }
+  if (timeout.count() > 0) {
+    call.deadline = std::chrono::steady_clock::now() + timeout;
+  }
+
+  ++impl.pending;
+  if (!impl.start_dispatching()) {
+    impl.complete(call, (impl.ec) ? impl.ec : Error(Error::Code::PFC_LIBRARY_SHUTDOWN), message());
+    return call.id;
+  }
+  auto id = call.id;
+  //calls is drained in to waiting by the dispatch thread, so queued is what enforces max_pending
+  if (impl.queued++ >= impl.calls.capacity() || !impl.calls.try_push(std::move(call))) {
+    --impl.queued;
+    impl.complete(call, Error::Code::PFC_QUEUE_FULL, message());
+    return id;
+  }
+  impl.wake();
+  //shutdown may have drained calls between start_dispatching and the push
+  if (impl.closed) {
+    impl.fail_queued();
+  }
+  return id;
+}
+//-----------------------------------------------------------------------------
+//! Queues a request. Safe to call from any number of threads
+//! \param body [IN] -- Serialized request
+//! \param timeout [IN] -- Time allowed for the reply. 0 uses Client_Options::timeout
+//! \return std::future<Client_Reply> -- Ready once the reply arrives or the request fails
+std::future<Client_Reply> ReqRep_Client::request(message body, std::chrono::milliseconds timeout)
+{
+  auto promise = std::make_shared<std::promise<Client_Reply>>();
+  auto result = promise->get_future();
+  request(std::move(body), [promise](Client_Reply reply) { promise->set_value(std::move(reply)); }, timeout);
+  return result;
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Requests accepted by request which have not completed
+size_t ReqRep_Client::in_flight() const
+{
+  return _impl->pending;
+}
+//-----------------------------------------------------------------------------
+//! Sends requests to another replica of the service as well. Safe to call from any thread
+//! \param replica [IN] -- Endpoint of the replica. Adding one already in use does nothing
+//! \return Error -- Success(), PFC_LIBRARY_SHUTDOWN after shutdown or the reason the endpoint was refused
+Error ReqRep_Client::add_replica(URI replica)
+{
+  return _impl->add(replica);
+}
+//-----------------------------------------------------------------------------
+//! Stops sending requests to a replica. Requests on the wire to it fail with PFC_INVALID_ENDPOINT
+//! unless they were hedged to another replica. Safe to call from any thread
+//! \param replica [IN] -- Endpoint given to add_replica or heard from the registry
+//! \return Error -- Success() or PFC_INVALID_ENDPOINT when replica is not in use
+Error ReqRep_Client::remove_replica(const URI& replica)
+{
+  return _impl->remove(replica);
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Replicas requests are spread over
+size_t ReqRep_Client::replicas() const
+{
+  std::lock_guard<std::mutex> guard(_impl->replica_mutex);
+  return _impl->endpoints.size();
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Requests also sent to a second replica because the first was slow
+uint64_t ReqRep_Client::hedged() const
 {
+  return _impl->hedge_count;
 }
 //-----------------------------------------------------------------------------
 //!  Shuts down async threading and frees all memory
 ReqRep_Client::~ReqRep_Client()
 {
-  nn_close(_impl->socket);
   _impl = nullptr;
 }
 //-----------------------------------------------------------------------------
@@ -152,7 +972,7 @@ void ReqRep_Client::set_response_callaback_func(CallbackFunc func)
 //!  \param func [IN] Function to use to generate Survey broadcast message
 //!
 //! Blocking call to a single broadcast. Broadcast Func should return a valid seralized braodcast message that particpants will be able to deserialize.
-void ReqRep_Client::broadcast(BroadcastFunc func)
+void ReqRep_Client::broadcast(MessageFunc func)
 {
   _impl->generate_message_func = func;
   _impl->running = false;
@@ -169,13 +989,30 @@ void ReqRep_Client::broadcast(BroadcastFunc func)
 //!
 //! Thread implementaiton will continue to respond to broadcast until the first
 //! Timeout occurs Then rebroad cast message until running is set to false
-void ReqRep_Client::async_broadcast(BroadcastFunc func)
+void ReqRep_Client::async_broadcast(MessageFunc func)
 {
   _impl->generate_message_func = func;
   _impl->running = true;
   _impl->pubsub_main_thread = std::thread(&Implementation::listen, _impl.get());
 }
 //-----------------------------------------------------------------------------
+//!
+//! \param func [IN] -- Function that will be called to generate broadcast message
+//!
+//! Copies each generated vector in to a nanomsg message and sends it with broadcast(MessageFunc)
+void ReqRep_Client::broadcast(BroadcastFunc func)
+{
+  broadcast(to_message_func(std::move(func)));
+}
+//-----------------------------------------------------------------------------
+//! \param func [IN] -- Function that will be called to generate broadcast message
+//!
+//! Copies each generated vector in to a nanomsg message and sends it with async_broadcast(MessageFunc)
+void ReqRep_Client::async_broadcast(BroadcastFunc func)
+{
+  async_broadcast(to_message_func(std::move(func)));
+}
+//-----------------------------------------------------------------------------
 //! Part of the Pattern interface stands up all IO not handled by the RIIA
 //
 void ReqRep_Client::standup()
@@ -186,10 +1023,12 @@ void ReqRep_Client::standup()
 //! Before the Surveyor goes out of scope.
 void ReqRep_Client::shutdown()
 {
+  _impl->stop_following();
+  _impl->stop_dispatching();
   _impl->running = true;
-  if (_impl->socket) {
+  if (_impl->socket >= 0) {
     nn_close(_impl->socket);
-    _impl->socket = 0;
+    _impl->socket = no_socket;
   }
 }
 //-----------------------------------------------------------------------------
@@ -0,0 +1,280 @@
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+/*! \file */
+
+#include <sustain/framework/net/patterns/req_rep/Response_Cache.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pfc {
+
+namespace {
+  constexpr size_t g_entry_overhead = 64; //!< Bytes charged to each entry for its list node and index slot
+
+  //-----------------------------------------------------------------------------
+  //! FNV-1a of the request bytes
+  //! \param data [IN] -- Bytes to hash
+  //! \param size [IN] -- Length of data
+  uint64_t hash_bytes(const char* data, size_t size)
+  {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+      hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ull;
+    }
+    return hash;
+  }
+}
+
+//!
+//! Cached reply and the request it answers
+//!
+struct Cache_Entry {
+  uint64_t hash = 0;
+  std::string request; //!< Compared on lookup, so two requests sharing a hash never share a reply
+  std::string response;
+  std::chrono::steady_clock::time_point stored;
+
+  size_t bytes() const { return request.size() + response.size() + g_entry_overhead; }
+  bool answers(const message& other) const
+  {
+    return request.size() == other.size() && (other.empty() || std::memcmp(request.data(), other.data(), other.size()) == 0);
+  }
+};
+
+//!
+//! One independently locked LRU list of a Response_Cache
+//!
+struct Cache_Shard {
+  std::mutex mutex;
+  std::list<Cache_Entry> entries; //!< Most recently used first
+  std::unordered_map<uint64_t, std::list<Cache_Entry>::iterator> index; //!< Entries by request hash
+  size_t bytes = 0;
+
+  //! Caller holds mutex
+  void erase(std::list<Cache_Entry>::iterator entry)
+  {
+    bytes -= entry->bytes();
+    index.erase(entry->hash);
+    entries.erase(entry);
+  }
+};
+
+//!
+//! PIMPL Implementation of a Response_Cache
+//!
+struct Response_Cache::Implementation {
+  explicit Implementation(const Response_Cache_Options& options);
+
+  Cache_Shard& shard_of(uint64_t hash) { return *shards[hash % shards.size()]; }
+
+  std::vector<std::unique_ptr<Cache_Shard>> shards;
+  size_t shard_bytes; //!< Share of max_bytes each shard may hold
+  std::chrono::milliseconds ttl;
+
+  std::atomic<uint64_t> generation_count { 0 }; //!< Increased by every invalidation before it touches a shard
+  std::atomic<uint64_t> hit_count { 0 };
+  std::atomic<uint64_t> miss_count { 0 };
+  std::atomic<uint64_t> eviction_count { 0 };
+};
+//-----------------------------------------------------------------------------
+//! \param options [IN] -- Shard count, size limit and time to live
+Response_Cache::Implementation::Implementation(const Response_Cache_Options& options)
+  : shard_bytes(options.max_bytes / std::max<size_t>(options.shards, 1))
+  , ttl(options.ttl)
+{
+  shards.resize(std::max<size_t>(options.shards, 1));
+  for (auto& shard : shards) {
+    shard = std::make_unique<Cache_Shard>();
+  }
+}
+//-----------------------------------------------------------------------------
+//! \param options [IN] -- Shard count, size limit and time to live
+Response_Cache::Response_Cache(Response_Cache_Options options)
+  : _impl(std::make_unique<Implementation>(options))
+{
+}
+//-----------------------------------------------------------------------------
+Response_Cache::~Response_Cache()
+{
+  _impl = nullptr;
+}
+//-----------------------------------------------------------------------------
+//! \param request [IN] -- Request as received
+//! \param response [OUT] -- Copy of the cached reply in nanomsg memory, ready to send without a further copy
+//! \return bool -- true on a hit. Expired entries are dropped and count as misses
+bool Response_Cache::lookup(const message& request, message& response)
+{
+  auto& impl = *_impl;
+  auto hash = hash_bytes(request.data(), request.size());
+  auto& shard = impl.shard_of(hash);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+  auto found = shard.index.find(hash);
+  if (found == shard.index.end() || !found->second->answers(request)) {
+    ++impl.miss_count;
+    return false;
+  }
+  auto entry = found->second;
+  if (impl.ttl.count() && std::chrono::steady_clock::now() - entry->stored > impl.ttl) {
+    shard.erase(entry);
+    ++impl.miss_count;
+    return false;
+  }
+  shard.entries.splice(shard.entries.begin(), shard.entries, entry);
+  response = message(entry->response.data(), entry->response.size());
+  ++impl.hit_count;
+  return true;
+}
+//-----------------------------------------------------------------------------
+//! Caches the reply to a request, evicting the least recently used entries of its shard to make room
+//! \param request [IN] -- Request the reply was computed from
+//! \param response [IN] -- Reply to return for the same request bytes
+//! \param generation [IN] -- generation() read before the reply was computed
+//! \return bool -- false when an invalidation ran since generation or the entry is larger than a shard
+bool Response_Cache::store(const message& request, const message& response, uint64_t generation)
+{
+  auto& impl = *_impl;
+  Cache_Entry entry;
+  entry.hash = hash_bytes(request.data(), request.size());
+  entry.request.assign(request.data(), request.size());
+  entry.response.assign(response.data(), response.size());
+  entry.stored = std::chrono::steady_clock::now();
+  if (entry.bytes() > impl.shard_bytes) {
+    return false;
+  }
+
+  auto& shard = impl.shard_of(entry.hash);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+  //Checked under the shard lock: an invalidation either fails this store or runs after it and removes the entry
+  if (generation != impl.generation_count) {
+    return false;
+  }
+  auto found = shard.index.find(entry.hash);
+  if (found != shard.index.end()) {
+    shard.erase(found->second);
+  }
+  shard.bytes += entry.bytes();
+  shard.entries.push_front(std::move(entry));
+  shard.index[shard.entries.front().hash] = shard.entries.begin();
+  while (shard.bytes > impl.shard_bytes) {
+    shard.erase(std::prev(shard.entries.end()));
+    ++impl.eviction_count;
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Changes with every invalidation. Read before computing a reply and pass to store
+uint64_t Response_Cache::generation() const
+{
+  return _impl->generation_count;
+}
+//-----------------------------------------------------------------------------
+//! \param request [IN] -- Request whose reply is no longer valid
+//! \return bool -- true if a reply was cached for it
+bool Response_Cache::invalidate(const message& request)
+{
+  auto& impl = *_impl;
+  ++impl.generation_count;
+  auto hash = hash_bytes(request.data(), request.size());
+  auto& shard = impl.shard_of(hash);
+  std::lock_guard<std::mutex> guard(shard.mutex);
+  auto found = shard.index.find(hash);
+  if (found == shard.index.end() || !found->second->answers(request)) {
+    return false;
+  }
+  shard.erase(found->second);
+  return true;
+}
+//-----------------------------------------------------------------------------
+//! \param predicate [IN] -- Called with the bytes of each cached request, true drops its reply
+//! \return size_t -- Replies dropped
+size_t Response_Cache::invalidate_if(RequestPredicate predicate)
+{
+  auto& impl = *_impl;
+  ++impl.generation_count;
+  size_t dropped = 0;
+  for (auto& shard : impl.shards) {
+    std::lock_guard<std::mutex> guard(shard->mutex);
+    for (auto entry = shard->entries.begin(); entry != shard->entries.end();) {
+      auto next = std::next(entry);
+      if (predicate(entry->request.data(), entry->request.size())) {
+        shard->erase(entry);
+        ++dropped;
+      }
+      entry = next;
+    }
+  }
+  return dropped;
+}
+//-----------------------------------------------------------------------------
+//! Drops every cached reply
+void Response_Cache::clear()
+{
+  auto& impl = *_impl;
+  ++impl.generation_count;
+  for (auto& shard : impl.shards) {
+    std::lock_guard<std::mutex> guard(shard->mutex);
+    shard->entries.clear();
+    shard->index.clear();
+    shard->bytes = 0;
+  }
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Replies cached
+size_t Response_Cache::size() const
+{
+  size_t count = 0;
+  for (auto& shard : _impl->shards) {
+    std::lock_guard<std::mutex> guard(shard->mutex);
+    count += shard->entries.size();
+  }
+  return count;
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Bytes charged against Response_Cache_Options::max_bytes
+size_t Response_Cache::bytes() const
+{
+  size_t total = 0;
+  for (auto& shard : _impl->shards) {
+    std::lock_guard<std::mutex> guard(shard->mutex);
+    total += shard->bytes;
+  }
+  return total;
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Lookups answered from the cache
+uint64_t Response_Cache::hits() const
+{
+  return _impl->hit_count;
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Lookups which found nothing, another request with the same hash or an expired reply
+uint64_t Response_Cache::misses() const
+{
+  return _impl->miss_count;
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Replies dropped to stay within Response_Cache_Options::max_bytes
+uint64_t Response_Cache::evictions() const
+{
+  return _impl->eviction_count;
+}
+//-----------------------------------------------------------------------------
+}
@@ -14,32 +14,60 @@ specific language governing permissions and limitations under the license.
 
 #include <sustain/framework/net/patterns/req_rep/Server.h>
 
+#include <atomic>
 #include <thread>
+#include <vector>
 
 #include <nanomsg/reqrep.h>
 
 #include "../nanomsg_helper.h"
+#include <sustain/framework/net/Reactor.h>
 #include "sustain/framework/net/patterns/survey/Surveyor.h"
 
 #include <sustain/framework/util/Error.h>
+#include <sustain/framework/util/Mpsc_Queue.h>
+#include <sustain/framework/util/Wake_Signal.h>
 namespace pfc {
+
+namespace {
+  constexpr int g_receive_poll = 100; //!< NN_RCVTIMEO of the receive thread, which bounds how long shutdown waits for it
+}
+
 //!
 //! PIMPL Implementation for a ReqRep_Server
 //!
 struct ReqRep_Server::Implementation {
-  Implementation(URI&&);
+  Implementation(URI&&, Server_Options&&);
   ~Implementation();
 
   URI uri; //!<  URI of the service to be given to nano_msg
   int socket; //!<  Socket the service runs
   int rv; //!<  return value of any nano_msg calls
   char* msg_buffer; //!<  msg_buffer nano_messages internal buffer
-  bool running; //!<  Run control for async threading
+  std::atomic<bool> running; //!<  Run control for async threading
+  Reactor* reactor; //!< Reactor the socket is registered with by async_listen, else nullptr
 
+  void stop();
   void listen();
+  void receive_requests();
+  void react(int ready_socket);
+  void enqueue(Routed_Request&);
+  void work();
+  bool serve(Routed_Request&);
+  bool lookup(const message& request, message& response);
+  bool serve_cached(Routed_Request&);
+  message respond(message request);
 
   std::thread pubsub_main_thread; //!< Threading control for async read/writes
-  ListenFunc message_process_function; //!< Call back functions for managing
+  MessageListenFunc message_process_function; //!< Call back functions for managing
+
+  Server_Options options;
+  Mpsc_Queue<Routed_Request> queue; //!< Requests read by the receive thread waiting for a worker
+  Wake_Signal work_signal; //!< Wakes idle workers when a request is queued
+  std::vector<std::thread> workers;
+  std::atomic<uint64_t> served_count;
+  std::atomic<uint64_t> shed_count;
+  std::atomic<uint64_t> expired_count;
 
   Error ec; //!< Current Error code of the system else Success()
 };
@@ -47,79 +75,263 @@ struct ReqRep_Server::Implementation {
 //!
 //! URI based constructor
 //! \param u [IN,OUT] Moves URI in to palce and stands up nn_socket and nn_bind
-ReqRep_Server::Implementation::Implementation(URI&& u)
+//! \param o [IN] Worker pool configuration. A pool uses a raw REP socket
+ReqRep_Server::Implementation::Implementation(URI&& u, Server_Options&& o)
   : uri(std::move(u))
-  , socket(0)
+  , socket(no_socket)
   , rv(0)
   , msg_buffer(nullptr)
   , running(false)
+  , reactor(nullptr)
+  , options(std::move(o))
+  , queue((options.workers) ? options.queue_depth : 2)
+  , served_count(0)
+  , shed_count(0)
+  , expired_count(0)
 {
-  if ((socket = nn_socket(AF_SP, NN_REP)) < 0) {
-    ec = nano_to_Error(socket);
+  if ((socket = nn_socket((options.workers) ? AF_SP_RAW : AF_SP, NN_REP)) < 0) {
+    ec = nano_to_Error(nn_errno());
+    return;
   }
   if ((rv = nn_bind(socket, uri.c_str())) < 0) {
-    ec = nano_to_Error(rv);
+    ec = nano_to_Error(nn_errno());
+    rv = 0;
   }
 }
 //-------------------------------------------------------------------------------
 //! Deconstructor for Implementation - Shutsdown all pending nn activity and clears memory
 ReqRep_Server::Implementation::~Implementation()
 {
-  if (rv && socket) {
-    nn_shutdown(socket, rv);
-  }
-
-  if (socket) {
-    nn_close(socket);
-  }
+  stop();
   if (msg_buffer) {
     nn_freemsg(msg_buffer);
     msg_buffer = nullptr;
   }
 }
 //-------------------------------------------------------------------------------
+//! Stops every thread using the socket and then closes it, so a reply is never sent on a closed
+//! socket or on one nanomsg has handed out again. The receive thread notices within g_receive_poll
+void ReqRep_Server::Implementation::stop()
+{
+  running = false;
+  if (reactor) {
+    reactor->remove(socket);
+    reactor = nullptr;
+  }
+  work_signal.notify();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  workers.clear();
+  if (pubsub_main_thread.joinable()) {
+    pubsub_main_thread.join();
+  }
+
+  if (socket >= 0) {
+    if (rv) {
+      nn_shutdown(socket, rv);
+    }
+    nn_close(socket);
+  }
+  socket = no_socket;
+  rv = 0;
+}
+//-------------------------------------------------------------------------------
 //!
 //! Listen function for controlling Surver paradigm.
 //! Underlying Implementation is done in nanomsg
 //!
 void ReqRep_Server::Implementation::listen()
 {
+  if (options.workers) {
+    Routed_Request request;
+    if (receive_routed(socket, request.body, request.control) < 0) {
+      ec = nano_to_Error(nn_errno());
+      return;
+    }
+    if (!serve_cached(request)) {
+      serve(request);
+    }
+    return;
+  }
+  message request;
   do {
-    char* l_buffer = NULL;
-    int bytes;
-    if ((bytes = nn_recv(socket, &l_buffer, NN_MSG, 0)) < 0) {
-      ec = nano_to_Error(bytes);
+    if (receive_message(socket, request) < 0) {
+      if (nn_errno() != ETIMEDOUT) {
+        ec = nano_to_Error(nn_errno());
+      }
       continue;
     }
-    std::vector<char> response = message_process_function(l_buffer, bytes);
-    if ((bytes = nn_send(socket, response.data(), response.size(), 0)) < 0) {
-      ec = nano_to_Error(bytes);
+    message response;
+    if (!lookup(request, response)) {
+      response = respond(std::move(request));
+    }
+    if (send_message(socket, response) < 0) {
+      ec = nano_to_Error(nn_errno());
     }
-    nn_freemsg(l_buffer);
   } while (running);
 }
 //-------------------------------------------------------------------------------
+//! Receive thread of a worker pool. Only reads the socket so a slow request never delays the next
+//! read. When every worker is busy and the queue is full the new request is shed.
+void ReqRep_Server::Implementation::receive_requests()
+{
+  Routed_Request request;
+  while (running) {
+    if (receive_routed(socket, request.body, request.control) < 0) {
+      if (nn_errno() != ETIMEDOUT) {
+        ec = nano_to_Error(nn_errno());
+      }
+      continue;
+    }
+    if (!serve_cached(request)) {
+      enqueue(request);
+    }
+  }
+}
+//-------------------------------------------------------------------------------
+//! Called by the Reactor when requests are waiting. Reads up to reactor_batch without blocking.
+//! A worker pool is fed exactly as by receive_requests, otherwise each request is answered here.
+//! \param ready_socket [IN] -- The server socket
+void ReqRep_Server::Implementation::react(int ready_socket)
+{
+  for (int count = 0; count < reactor_batch; ++count) {
+    if (options.workers) {
+      Routed_Request request;
+      if (receive_routed(ready_socket, request.body, request.control, NN_DONTWAIT) < 0) {
+        if (nn_errno() != EAGAIN) {
+          ec = nano_to_Error(nn_errno());
+        }
+        return;
+      }
+      if (!serve_cached(request)) {
+        enqueue(request);
+      }
+      continue;
+    }
+    message request;
+    if (receive_message(ready_socket, request, NN_DONTWAIT) < 0) {
+      if (nn_errno() != EAGAIN) {
+        ec = nano_to_Error(nn_errno());
+      }
+      return;
+    }
+    message response;
+    if (!lookup(request, response)) {
+      response = respond(std::move(request));
+    }
+    if (send_message(ready_socket, response) < 0) {
+      ec = nano_to_Error(nn_errno());
+    }
+  }
+}
+//-------------------------------------------------------------------------------
+//! Hands a request to the worker pool, shedding it when the queue is full
+//! \param request [IN,OUT] -- Request read from the raw socket. Empty afterwards
+void ReqRep_Server::Implementation::enqueue(Routed_Request& request)
+{
+  request.received = std::chrono::steady_clock::now();
+  if (!queue.try_push(std::move(request))) {
+    ++shed_count;
+    request.release();
+    return;
+  }
+  work_signal.notify();
+}
+//-------------------------------------------------------------------------------
+//! Worker thread. Runs the ListenFunc for queued requests and replies to the client each came from
+void ReqRep_Server::Implementation::work()
+{
+  Routed_Request request;
+  while (running) {
+    work_signal.wait([this]() { return !running || !queue.empty(); });
+    while (running && queue.try_pop(request)) {
+      if (options.deadline.count() && std::chrono::steady_clock::now() - request.received > options.deadline) {
+        ++expired_count;
+        request.release();
+        continue;
+      }
+      serve(request);
+    }
+  }
+}
+//-------------------------------------------------------------------------------
+//! \param request [IN,OUT] -- Request read from the raw socket. Its routing header is consumed
+//! \return bool -- true if the reply was handed to nanomsg
+bool ReqRep_Server::Implementation::serve(Routed_Request& request)
+{
+  auto response = respond(std::move(request.body));
+  if (send_routed(socket, response, request.control) < 0) {
+    ec = nano_to_Error(nn_errno());
+    return false;
+  }
+  ++served_count;
+  return true;
+}
+//-------------------------------------------------------------------------------
+//! \param request [IN] -- Request as received
+//! \param response [OUT] -- Cached reply to request
+//! \return bool -- true if Server_Options::cache holds a reply for request
+bool ReqRep_Server::Implementation::lookup(const message& request, message& response)
+{
+  return options.cache && options.cache->lookup(request, response);
+}
+//-------------------------------------------------------------------------------
+//! Receive thread. Replies from the cache so a repeated request never waits for a worker
+//! \param request [IN,OUT] -- Request read from the raw socket. Its routing header is consumed on a hit
+//! \return bool -- false if the request still has to be queued for a worker
+bool ReqRep_Server::Implementation::serve_cached(Routed_Request& request)
+{
+  message response;
+  if (!lookup(request.body, response)) {
+    return false;
+  }
+  if (send_routed(socket, response, request.control) < 0) {
+    ec = nano_to_Error(nn_errno());
+  } else {
+    ++served_count;
+  }
+  request.body = message();
+  return true;
+}
+//-------------------------------------------------------------------------------
+//! Runs the ListenFunc and caches its reply when Server_Options::cache and cacheable allow
+//! \param request [IN] -- Request which missed the cache
+//! \return message -- Reply of the ListenFunc
+message ReqRep_Server::Implementation::respond(message request)
+{
+  if (!options.cache) {
+    return message_process_function(std::move(request));
+  }
+  //The ListenFunc takes the request, so the key is kept in pooled memory
+  auto generation = options.cache->generation();
+  message key(request.data(), request.size(), message::Storage::pooled);
+  auto response = message_process_function(std::move(request));
+  if (!response.empty() && (!options.cacheable || options.cacheable(key, response))) {
+    options.cache->store(key, response, generation);
+  }
+  return response;
+}
+//-------------------------------------------------------------------------------
 //!  URI based constructor. Takes a copy of a URI to setup networking information
 //! \param uri [IN]  Service configuration of the new Surveyor
-ReqRep_Server::ReqRep_Server(URI uri)
-  : _impl(std::make_unique<Implementation>(std::move(uri)))
+//! \param options [IN] Worker pool configuration. The default is a single threaded server
+ReqRep_Server::ReqRep_Server(URI uri, Server_Options options)
+  : _impl(std::make_unique<Implementation>(std::move(uri), std::move(options)))
 {
 }
 //-------------------------------------------------------------------------------
 //!  Shuts down async threading and fress all memory
 ReqRep_Server::~ReqRep_Server()
 {
-  if (_impl->socket) {
-    nn_close(_impl->socket);
-  }
-  _impl->socket = 0;
+  _impl = nullptr;
 }
 //-------------------------------------------------------------------------------
 //!
 //! \param func [IN] -- Function that will be called when a message is received by a client
 //!
 //! Blocking call for receiving a single message
-void ReqRep_Server::listen(ListenFunc func)
+void ReqRep_Server::listen(MessageListenFunc func)
 {
   _impl->message_process_function = func;
   _impl->running = false;
@@ -130,11 +342,91 @@ void ReqRep_Server::listen(ListenFunc func)
 //! Non Blocking listen request; Will continue to process inbound messages by calling the ListenFunc
 //! Until running is set to false.
 //! 
-void ReqRep_Server::async_listen(ListenFunc func)
+void ReqRep_Server::async_listen(MessageListenFunc func)
 {
   _impl->message_process_function = func;
   _impl->running = true;
-  _impl->pubsub_main_thread = std::thread(&Implementation::listen, _impl.get());
+  //The receive thread wakes periodically to see running cleared, so shutdown can join it before closing the socket
+  int timeout = g_receive_poll;
+  nn_setsockopt(_impl->socket, NN_SOL_SOCKET, NN_RCVTIMEO, &timeout, sizeof(timeout));
+  if (_impl->options.workers) {
+    for (size_t worker = 0; worker < _impl->options.workers; ++worker) {
+      _impl->workers.emplace_back(&Implementation::work, _impl.get());
+    }
+    _impl->pubsub_main_thread = std::thread(&Implementation::receive_requests, _impl.get());
+  } else {
+    _impl->pubsub_main_thread = std::thread(&Implementation::listen, _impl.get());
+  }
+}
+//-------------------------------------------------------------------------------
+//! \param reactor [IN] -- Reactor which polls the socket in place of the receive thread
+//! \param func [IN] -- Function that will be called when a message is received
+//!
+//! Non Blocking listen without a receive thread. With Server_Options::workers the Reactor only
+//! reads requests and the workers still run func, otherwise func runs on a Reactor worker.
+void ReqRep_Server::async_listen(Reactor& reactor, MessageListenFunc func)
+{
+  _impl->message_process_function = func;
+  _impl->running = true;
+  for (size_t worker = 0; worker < _impl->options.workers; ++worker) {
+    _impl->workers.emplace_back(&Implementation::work, _impl.get());
+  }
+  auto impl = _impl.get();
+  auto ec = reactor.add(_impl->socket, NN_POLLIN, [impl](int ready_socket, short) { impl->react(ready_socket); });
+  if (ec) {
+    _impl->ec = ec;
+    return;
+  }
+  _impl->reactor = &reactor;
+}
+//-------------------------------------------------------------------------------
+//!
+//! \param func [IN] -- Function that will be called when a message is received
+//!
+//! Blocking call for receiving a single message. Adapts func with to_message_func
+void ReqRep_Server::listen(ListenFunc func)
+{
+  listen(to_message_func(std::move(func)));
+}
+//-------------------------------------------------------------------------------
+//! \param func [IN] -- Function that will be called when a message is received
+//!
+//! Non Blocking listen. Adapts func with to_message_func
+void ReqRep_Server::async_listen(ListenFunc func)
+{
+  async_listen(to_message_func(std::move(func)));
+}
+//-------------------------------------------------------------------------------
+//! Listens on another endpoint as well as the one given at construction
+//! \param endpoint [IN] -- Endpoint to bind, e.g. one of local_endpoints
+//! \return Error -- PFC_BAD_OPERATION when the server has no socket, else the result of nn_bind
+Error ReqRep_Server::bind(URI endpoint)
+{
+  if (_impl->socket < 0) {
+    return Error::Code::PFC_BAD_OPERATION;
+  }
+  if (nn_bind(_impl->socket, endpoint.c_str()) < 0) {
+    return nano_to_Error(nn_errno());
+  }
+  return Success();
+}
+//-------------------------------------------------------------------------------
+//! \return uint64_t -- Replies handed to nanomsg
+uint64_t ReqRep_Server::served() const
+{
+  return _impl->served_count;
+}
+//-------------------------------------------------------------------------------
+//! \return uint64_t -- Requests dropped because the worker queue was full
+uint64_t ReqRep_Server::shed() const
+{
+  return _impl->shed_count;
+}
+//-------------------------------------------------------------------------------
+//! \return uint64_t -- Requests dropped because they waited longer than Server_Options::deadline
+uint64_t ReqRep_Server::expired() const
+{
+  return _impl->expired_count;
 }
 //-------------------------------------------------------------------------------
 //! Part of the Pattern interface stands up all IO not handled by the RIIA
@@ -147,7 +439,7 @@ void ReqRep_Server::standup()
 //! Before the Surveyor goes out of scope.
 void ReqRep_Server::shutdown()
 {
-  _impl->running = false;
+  _impl->stop();
 }
 //-------------------------------------------------------------------------------
 }
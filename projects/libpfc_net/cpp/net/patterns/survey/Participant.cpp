@@ -14,11 +14,16 @@ specific language governing permissions and limitations under the license.
 
 #include <sustain/framework/net/patterns/survey/Participant.h>
 
+#include <atomic>
 #include <iostream>
 #include <thread>
+#include <vector>
 
 #include <nanomsg/survey.h>
 #include "../nanomsg_helper.h"
+#include <sustain/framework/net/Reactor.h>
+#include <sustain/framework/util/Mpsc_Queue.h>
+#include <sustain/framework/util/Wake_Signal.h>
 
 namespace pfc {
 
@@ -36,7 +41,7 @@ struct nn_buffer : std::streambuf {
 //! PIMPL Implementation for a Survey_Participant
 //!
 struct Survey_Participant::Implementation {
-  Implementation(URI&&);
+  Implementation(URI&&, Participant_Options&&);
   ~Implementation();
 
   Implementation(const Implementation&) = delete;
@@ -45,15 +50,32 @@ struct Survey_Participant::Implementation {
   Implementation& operator==(Implementation&&) = delete;
 
   URI uri;                   //!<  URI of the service to be given to nano_msg
-  int socket;                //!<  Socket the service runs 
+  int socket;                //!<  Socket the service runs
   int rv;                    //!<  return value of any nano_msg calls
   char* msg_buffer;          //!<  msg_buffer nano_messages internal buffer
-  bool running;              //!<  Run control for async threading
+  std::atomic<bool> running;  //!<  Run control for async threading
+  Reactor* reactor;          //!<  Reactor the socket is registered with by async_listen, else nullptr
 
   void listen();
+  void stop();
+  void react(int ready_socket);
+  void receive_surveys();
+  void enqueue(Routed_Request&);
+  void work();
+  bool expired(const Routed_Request&) const;
+  void answer(Routed_Request&);
 
   std::thread pubsub_main_thread; //!< Threading control or async read/write
-  ListenFunc handle_message_func; //!< Function used to handle inbound messages
+  MessageListenFunc handle_message_func; //!< Function used to handle inbound messages
+
+  Participant_Options options;
+  Mpsc_Queue<Routed_Request> queue; //!< Surveys read by the receive thread waiting for a worker
+  Wake_Signal work_signal; //!< Wakes idle workers when a survey is queued
+  std::vector<std::thread> workers;
+  std::atomic<size_t> in_flight; //!< Surveys queued or being answered, at most queue.capacity()
+  std::atomic<uint64_t> answered_count;
+  std::atomic<uint64_t> shed_count;
+  std::atomic<uint64_t> expired_count;
 
   Error ec; //!< Current Error code of the system else Success()
 };
@@ -61,31 +83,35 @@ struct Survey_Participant::Implementation {
 //!
 //! URI based constructor
 //! \param u [IN,OUT] Moves URI in to palce and stands up nn_socket and nn_bind
-Survey_Participant::Implementation::Implementation(URI&& u)
+//! \param o [IN] Worker pool configuration. A pool uses a raw RESPONDENT socket
+Survey_Participant::Implementation::Implementation(URI&& u, Participant_Options&& o)
   : uri(std::move(u))
-  , socket(0)
+  , socket(no_socket)
   , rv(0)
   , msg_buffer(nullptr)
   , running(false)
+  , reactor(nullptr)
+  , options(std::move(o))
+  , queue((options.workers) ? options.max_in_flight : 2)
+  , in_flight(0)
+  , answered_count(0)
+  , shed_count(0)
+  , expired_count(0)
 {
-  if ((socket = nn_socket(AF_SP, NN_RESPONDENT)) < 0) {
-    ec = nano_to_Error(socket);
+  if ((socket = nn_socket((options.workers) ? AF_SP_RAW : AF_SP, NN_RESPONDENT)) < 0) {
+    ec = nano_to_Error(nn_errno());
+    return;
   }
-  if (rv = nn_connect(socket, uri.c_str()) < 0) {
-    ec = nano_to_Error(socket);
+  if ((rv = nn_connect(socket, uri.c_str())) < 0) {
+    ec = nano_to_Error(nn_errno());
+    rv = 0;
   }
 }
     //-------------------------------------------------------------------------------
 //! Deconstructor for Implementation - Shutsdown all pending nn activity and clears memory
 Survey_Participant::Implementation::~Implementation()
 {
-  if (rv && socket) {
-    nn_shutdown(socket, rv);
-  }
-
-  if (socket) {
-    nn_close(socket);
-  }
+  stop();
   if (msg_buffer) {
     nn_freemsg(msg_buffer);
     msg_buffer = nullptr;
@@ -98,32 +124,170 @@ Survey_Participant::Implementation::~Implementation()
 //!
 void Survey_Participant::Implementation::listen()
 {
+  if (options.workers) {
+    Routed_Request survey;
+    if (receive_routed(socket, survey.body, survey.control) < 0) {
+      ec = nano_to_Error(nn_errno());
+      return;
+    }
+    survey.received = std::chrono::steady_clock::now();
+    answer(survey);
+    return;
+  }
+  message survey;
   do {
-    char* l_buffer = NULL;
-    int bytes;
-    if ((bytes = nn_recv(socket, &l_buffer, NN_MSG, 0)) < 0) {
-      ec = nano_to_Error(bytes);
+    if (receive_message(socket, survey) < 0) {
+      ec = nano_to_Error(nn_errno());
       continue;
     }
-    std::vector<char> response = handle_message_func(l_buffer, bytes);
-    nn_freemsg(l_buffer);
-    if ((bytes = nn_send(socket, response.data(), response.size(), 0)) < 0) {
-      ec = nano_to_Error(bytes);
+    auto response = handle_message_func(std::move(survey));
+    if (send_message(socket, response) < 0) {
+      ec = nano_to_Error(nn_errno());
     }
   } while (running);
 }
 //-----------------------------------------------------------------------------
+//! Stops every thread using the socket and closes it. The workers are joined while the socket is
+//! still open, so a survey being answered is never sent on a closed socket or one nanomsg reused
+void Survey_Participant::Implementation::stop()
+{
+  running = false;
+  if (reactor) {
+    reactor->remove(socket);
+    reactor = nullptr;
+  }
+  work_signal.notify();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  workers.clear();
+
+  //Closing the socket wakes the receive thread blocked in nn_recv. It is only cleared once joined
+  if (socket >= 0) {
+    if (rv) {
+      nn_shutdown(socket, rv);
+    }
+    nn_close(socket);
+  }
+  if (pubsub_main_thread.joinable()) {
+    pubsub_main_thread.join();
+  }
+  socket = no_socket;
+  rv = 0;
+}
+//-----------------------------------------------------------------------------
+//! Called by the Reactor when surveys are waiting. Answers up to reactor_batch without blocking
+//! \param ready_socket [IN] -- The respondent socket
+void Survey_Participant::Implementation::react(int ready_socket)
+{
+  message survey;
+  for (int count = 0; count < reactor_batch; ++count) {
+    if (options.workers) {
+      Routed_Request routed;
+      if (receive_routed(ready_socket, routed.body, routed.control, NN_DONTWAIT) < 0) {
+        if (nn_errno() != EAGAIN) {
+          ec = nano_to_Error(nn_errno());
+        }
+        return;
+      }
+      enqueue(routed);
+      continue;
+    }
+    if (receive_message(ready_socket, survey, NN_DONTWAIT) < 0) {
+      if (nn_errno() != EAGAIN) {
+        ec = nano_to_Error(nn_errno());
+      }
+      return;
+    }
+    auto response = handle_message_func(std::move(survey));
+    if (send_message(ready_socket, response) < 0) {
+      ec = nano_to_Error(nn_errno());
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+//! Receive thread of a worker pool. Only reads the socket so a heavy survey never delays the next
+//! read. When max_in_flight surveys are already queued or being answered the new survey is shed.
+void Survey_Participant::Implementation::receive_surveys()
+{
+  Routed_Request survey;
+  while (running) {
+    if (receive_routed(socket, survey.body, survey.control) < 0) {
+      ec = nano_to_Error(nn_errno());
+      continue;
+    }
+    enqueue(survey);
+  }
+}
+//-------------------------------------------------------------------------------
+//! Hands a survey to the worker pool, shedding it when too many are in flight
+//! \param survey [IN,OUT] -- Survey read from the raw socket. Empty afterwards
+void Survey_Participant::Implementation::enqueue(Routed_Request& survey)
+{
+  survey.received = std::chrono::steady_clock::now();
+  if (++in_flight > queue.capacity() || !queue.try_push(std::move(survey))) {
+    --in_flight;
+    ++shed_count;
+    survey.release();
+    return;
+  }
+  work_signal.notify();
+}
+//-------------------------------------------------------------------------------
+//! Worker thread. Answers queued surveys, each with the routing header it arrived with
+void Survey_Participant::Implementation::work()
+{
+  Routed_Request survey;
+  while (running) {
+    work_signal.wait([this]() { return !running || !queue.empty(); });
+    while (running && queue.try_pop(survey)) {
+      answer(survey);
+      --in_flight;
+    }
+  }
+}
+//-------------------------------------------------------------------------------
+//! \param survey [IN] -- Survey read from the raw socket
+//! \return bool -- true once the surveyor will have stopped collecting responses to survey
+bool Survey_Participant::Implementation::expired(const Routed_Request& survey) const
+{
+  return options.deadline.count() && std::chrono::steady_clock::now() - survey.received > options.deadline;
+}
+//-------------------------------------------------------------------------------
+//! Runs the ListenFunc and responds unless the survey expires first. The surveyor would discard
+//! a late response, so neither the work nor the send is spent on one
+//! \param survey [IN,OUT] -- Survey read from the raw socket. Its routing header is consumed
+void Survey_Participant::Implementation::answer(Routed_Request& survey)
+{
+  if (expired(survey)) {
+    ++expired_count;
+    survey.release();
+    return;
+  }
+  auto response = handle_message_func(std::move(survey.body));
+  if (expired(survey)) {
+    ++expired_count;
+    survey.release();
+    return;
+  }
+  if (send_routed(socket, response, survey.control) < 0) {
+    ec = nano_to_Error(nn_errno());
+    return;
+  }
+  ++answered_count;
+}
+//-----------------------------------------------------------------------------
 //!  URI based constructor. Takes a copy of a URI to setup networking information
 //! \param URI [IN]  Service configuration of the new Surveyor
-Survey_Participant::Survey_Participant(URI uri)
-  : _impl(std::make_unique<Implementation>(std::move(uri)))
+//! \param options [IN] Worker pool configuration. The default is a single threaded participant
+Survey_Participant::Survey_Participant(URI uri, Participant_Options options)
+  : _impl(std::make_unique<Implementation>(std::move(uri), std::move(options)))
 {
 }
 //-----------------------------------------------------------------------------
 //!  Shuts down async threading and fress all memory
 Survey_Participant::~Survey_Participant()
 {
-  nn_close(_impl->socket);
   _impl = nullptr;
 }
 //-----------------------------------------------------------------------------
@@ -131,7 +295,7 @@ Survey_Participant::~Survey_Participant()
 // \param func [IN] Function to use to react to a received message
 //
 //Blocks until message is received.
-void Survey_Participant::listen(ListenFunc func)
+void Survey_Participant::listen(MessageListenFunc func)
 {
   _impl->handle_message_func = func;
   _impl->running = false;
@@ -147,11 +311,74 @@ void Survey_Participant::listen(ListenFunc func)
 // Undefined behavior.
 //
 // Thead implementation will respond to multiple consecutive messages until stop is called
-void Survey_Participant::async_listen(ListenFunc func)
+void Survey_Participant::async_listen(MessageListenFunc func)
 {
   _impl->handle_message_func = func;
   _impl->running = true;
-  _impl->pubsub_main_thread = std::thread(&Implementation::listen, _impl.get());
+  if (_impl->options.workers) {
+    for (size_t worker = 0; worker < _impl->options.workers; ++worker) {
+      _impl->workers.emplace_back(&Implementation::work, _impl.get());
+    }
+    _impl->pubsub_main_thread = std::thread(&Implementation::receive_surveys, _impl.get());
+  } else {
+    _impl->pubsub_main_thread = std::thread(&Implementation::listen, _impl.get());
+  }
+}
+//-----------------------------------------------------------------------------
+//! \param reactor [IN] -- Reactor which polls the socket and runs func on one of its workers
+//! \param func [IN] -- Function to use to react to a received message
+//!
+//! Non Blocking listen without a thread of its own. Responds until shutdown or destruction.
+//! With Participant_Options::workers the Reactor only reads surveys and the workers still run func
+void Survey_Participant::async_listen(Reactor& reactor, MessageListenFunc func)
+{
+  _impl->handle_message_func = func;
+  _impl->running = true;
+  for (size_t worker = 0; worker < _impl->options.workers; ++worker) {
+    _impl->workers.emplace_back(&Implementation::work, _impl.get());
+  }
+  auto impl = _impl.get();
+  auto ec = reactor.add(_impl->socket, NN_POLLIN, [impl](int ready_socket, short) { impl->react(ready_socket); });
+  if (ec) {
+    _impl->ec = ec;
+    return;
+  }
+  _impl->reactor = &reactor;
+}
+//-----------------------------------------------------------------------------
+//!
+//! \param func [IN] -- Function that will be called when a message is received
+//!
+//! Blocking call for receiving a single message. Adapts func with to_message_func
+void Survey_Participant::listen(ListenFunc func)
+{
+  listen(to_message_func(std::move(func)));
+}
+//-----------------------------------------------------------------------------
+//! \param func [IN] -- Function that will be called when a message is received
+//!
+//! Non Blocking listen. Adapts func with to_message_func
+void Survey_Participant::async_listen(ListenFunc func)
+{
+  async_listen(to_message_func(std::move(func)));
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Responses handed to nanomsg by the worker pool
+uint64_t Survey_Participant::answered() const
+{
+  return _impl->answered_count;
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Surveys dropped because max_in_flight surveys were already in flight
+uint64_t Survey_Participant::shed() const
+{
+  return _impl->shed_count;
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Surveys left unanswered because Participant_Options::deadline passed
+uint64_t Survey_Participant::expired() const
+{
+  return _impl->expired_count;
 }
 //-----------------------------------------------------------------------------
 //! Part of the Pattern interface stands up all IO not handled by the RIIA
@@ -164,11 +391,7 @@ void Survey_Participant::standup()
 //Before the Surveyor goes out of scope.
 void Survey_Participant::shutdown()
 {
-  _impl->running = true;
-  if (_impl->socket) {
-    nn_close(_impl->socket);
-    _impl->socket = 0;
-  }
+  _impl->stop();
 }
 //-----------------------------------------------------------------------------
 }
@@ -14,7 +14,9 @@ specific language governing permissions and limitations under the license.
 
 #include <sustain/framework/net/patterns/survey/Surveyor.h>
 
+#include <atomic>
 #include <iostream>
+#include <mutex>
 #include <thread>
 
 #include "../nanomsg_helper.h"
@@ -51,15 +53,19 @@ struct Survey_Surveyor::Implementation {
   Implementation& operator==(Implementation&&) = delete;
 
   URI uri;                //!<  URI of the service to be given to nano_msg
-  int socket;             //!<  Socket the service runs 
+  int socket;             //!<  Socket the service runs
   int rv;                 //!<  return value of any nano_msg calls
   char* msg_buffer;       //!<  msg_buffer nano_messages internal buffer
-  bool running;           //!<  Run control for async threading
+  std::atomic<bool> running; //!<  Run control for async threading
 
   void listen();
+  void stop();
+
+  std::mutex survey_mutex;                //!< One survey, from survey or a broadcast, may be active on the socket at a time
+  std::chrono::milliseconds deadline;     //!< NN_SURVEYOR_DEADLINE the broadcasts run with, nanomsg's default. survey restores it before releasing survey_mutex
 
   std::thread pubsub_main_thread;         //!< Threading control or async read/write
-  BroadcastFunc generate_message_func;    //!< Function used to generate message needed for call back
+  MessageFunc generate_message_func;      //!< Function used to generate message needed for call back
   CallbackFunc response_callback_function; //!< Function used to respond to message used as callback in nanomssg
 
   Error ec;  //!< Current Error code of the system else Success()
@@ -70,30 +76,26 @@ struct Survey_Surveyor::Implementation {
 //! \param u [IN,OUT] Moves URI in to palce and stands up nn_socket and nn_bind
 Survey_Surveyor::Implementation::Implementation(URI&& u)
   : uri(std::move(u))
-  , socket(0)
+  , socket(no_socket)
   , rv(0)
   , msg_buffer(nullptr)
   , running(false)
+  , deadline(1000)
   , ec(Success())
 {
   if ((socket = nn_socket(AF_SP, NN_SURVEYOR)) < 0) {
-    ec = nano_to_Error(socket);
+    ec = nano_to_Error(nn_errno());
+    return;
   }
   if (nn_bind(socket, uri.c_str()) < 0) {
-    ec = nano_to_Error(socket);
+    ec = nano_to_Error(nn_errno());
   }
 }
 //-------------------------------------------------------------------------------
 //! Deconstructor for Implementation - Shutsdown all pending nn activity and clears memory
 Survey_Surveyor::Implementation::~Implementation()
 {
-  if (rv && socket) {
-    nn_shutdown(socket, rv);
-  }
-
-  if (socket) {
-    nn_close(socket);
-  }
+  stop();
   if (msg_buffer) {
     nn_freemsg(msg_buffer);
     msg_buffer = nullptr;
@@ -107,10 +109,12 @@ Survey_Surveyor::Implementation::~Implementation()
 void Survey_Surveyor::Implementation::listen()
 {
   do {
-    int bytes = 0;
     auto buffer = generate_message_func();
-    if ((bytes = nn_send(socket, &buffer[0], buffer.size(), 0)) < 0) {
-      ec = nano_to_Error(bytes);
+    //A survey started by survey() would otherwise cancel this one and read its responses
+    std::lock_guard<std::mutex> guard(survey_mutex);
+    int bytes = 0;
+    if ((bytes = send_message(socket, buffer)) < 0) {
+      ec = nano_to_Error(nn_errno());
       continue;
     }
 
@@ -118,11 +122,12 @@ void Survey_Surveyor::Implementation::listen()
       char* buf = NULL;
       int bytes = nn_recv(socket, &buf, NN_MSG, 0);
       if (bytes < 0) {
-        if (nn_errno() == ETIMEDOUT) {
-          break;
+        //ETIMEDOUT ends the survey. Anything else, such as a closed socket, would fail again
+        auto error = nn_errno();
+        if (error != ETIMEDOUT) {
+          ec = nano_to_Error(error);
         }
-        ec = nano_to_Error(bytes);
-        continue;
+        break;
       }
       if (response_callback_function) {
         nn_buffer stream_buffer{ buf, buf + bytes };
@@ -136,6 +141,74 @@ void Survey_Surveyor::Implementation::listen()
   } while (running);
 }
 //-----------------------------------------------------------------------------
+//! Stops the async_broadcast thread and closes the socket. Closing wakes the thread from nn_recv,
+//! and the socket is only cleared once the thread is joined
+void Survey_Surveyor::Implementation::stop()
+{
+  running = false;
+  if (socket >= 0) {
+    if (rv) {
+      nn_shutdown(socket, rv);
+    }
+    nn_close(socket);
+  }
+  if (pubsub_main_thread.joinable()) {
+    pubsub_main_thread.join();
+  }
+  socket = no_socket;
+  rv = 0;
+}
+//-----------------------------------------------------------------------------
+//! Sends one survey and collects responses until the quorum is met or the deadline passes.
+//! Responses to earlier surveys are discarded by nanomsg, so completing early is safe.
+//! Waits for a survey running on the async_broadcast thread to finish rather than cancel it,
+//! and leaves the socket with the deadline the broadcasts run with.
+//! \param question [IN] -- Serialized survey
+//! \param options [IN] -- Deadline and quorum
+//! \param on_response [IN] -- Called with each response. May be empty to only count respondents
+//! \return Survey_Tally -- How many participants responded and whether the quorum was met
+Survey_Tally Survey_Surveyor::survey(message question, const Survey_Options& options, ResponseFunc on_response)
+{
+  auto& impl = *_impl;
+  std::lock_guard<std::mutex> guard(impl.survey_mutex);
+
+  Survey_Tally tally;
+  auto set_deadline = [&impl](std::chrono::milliseconds value) {
+    int deadline = static_cast<int>(value.count());
+    return nn_setsockopt(impl.socket, NN_SURVEYOR, NN_SURVEYOR_DEADLINE, &deadline, sizeof(deadline));
+  };
+  if (options.deadline != impl.deadline && set_deadline(options.deadline) < 0) {
+    tally.ec = nano_to_Error(nn_errno());
+    return tally;
+  }
+
+  message response;
+  if (send_message(impl.socket, question) < 0) {
+    tally.ec = nano_to_Error(nn_errno());
+  }
+  while (tally.ec.is_ok() && (options.quorum == 0 || tally.responses < options.quorum)) {
+    if (receive_message(impl.socket, response) < 0) {
+      auto error = nn_errno();
+      if (error != ETIMEDOUT) {
+        tally.ec = nano_to_Error(error);
+      }
+      break;
+    }
+    ++tally.responses;
+    if (on_response) {
+      on_response(std::move(response));
+    }
+  }
+  if (options.deadline != impl.deadline && set_deadline(impl.deadline) < 0 && tally.ec.is_ok()) {
+    tally.ec = nano_to_Error(nn_errno());
+  }
+  tally.quorum_met = options.quorum && tally.responses >= options.quorum;
+  if (options.quorum && !tally.quorum_met && tally.ec.is_ok()) {
+    tally.ec = Error::Code::PFC_TIMEOUT;
+  }
+  return tally;
+}
+//-----------------------------------------------------------------------------
 //!  URI based constructor. Takes a copy of a URI to setup networking information
 //! \param uri [IN]  Service configuration of the new Surveyor
 Survey_Surveyor::Survey_Surveyor(URI uri)
@@ -146,7 +219,6 @@ Survey_Surveyor::Survey_Surveyor(URI uri)
 //!  Shuts down async threading and frees all memory
 Survey_Surveyor::~Survey_Surveyor()
 {
-  nn_close(_impl->socket);
   _impl = nullptr;
 }
 //-----------------------------------------------------------------------------
@@ -162,7 +234,7 @@ void Survey_Surveyor::set_response_callaback_func(CallbackFunc func)
 //!  \param func [IN] Function to use to generate Survey broadcast message
 //! 
 //! Blocking call to a single broadcast. Broadcast Func should return a valid seralized braodcast message that particpants will be able to deserialize. 
-void Survey_Surveyor::broadcast(BroadcastFunc func)
+void Survey_Surveyor::broadcast(MessageFunc func)
 {
   _impl->generate_message_func = func;
   _impl->running = false;
@@ -179,13 +251,30 @@ void Survey_Surveyor::broadcast(BroadcastFunc func)
 //! 
 //! Thread implementaiton will continue to respond to broadcast until the first
 //! Timeout occurs Then rebroad cast message until running is set to false
-void Survey_Surveyor::async_broadcast(BroadcastFunc func)
+void Survey_Surveyor::async_broadcast(MessageFunc func)
 {
   _impl->generate_message_func = func;
   _impl->running = true;
   _impl->pubsub_main_thread = std::thread(&Implementation::listen, _impl.get());
 }
 //-----------------------------------------------------------------------------
+//!
+//! \param func [IN] -- Function that will be called to generate broadcast message
+//!
+//! Copies each generated vector in to a nanomsg message and sends it with broadcast(MessageFunc)
+void Survey_Surveyor::broadcast(BroadcastFunc func)
+{
+  broadcast(to_message_func(std::move(func)));
+}
+//-----------------------------------------------------------------------------
+//! \param func [IN] -- Function that will be called to generate broadcast message
+//!
+//! Copies each generated vector in to a nanomsg message and sends it with async_broadcast(MessageFunc)
+void Survey_Surveyor::async_broadcast(BroadcastFunc func)
+{
+  async_broadcast(to_message_func(std::move(func)));
+}
+//-----------------------------------------------------------------------------
 //! Part of the Pattern interface stands up all IO not handled by the RIIA
 //
 void Survey_Surveyor::standup()
@@ -196,11 +285,7 @@ void Survey_Surveyor::standup()
 //! Before the Surveyor goes out of scope.
 void Survey_Surveyor::shutdown()
 {
-  _impl->running = false;
-  if (_impl->socket) {
-    nn_close(_impl->socket);
-    _impl->socket = 0;
-  }
+  _impl->stop();
 }
 //-----------------------------------------------------------------------------
 }
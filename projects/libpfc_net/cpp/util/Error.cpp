@@ -123,7 +123,7 @@ void Error::clear()
 //! \return std::ostream& - modified ostr to allow call chaining
 std::ostream& operator<<(std::ostream& ostr, const Error& e)
 {
-  switch (static_cast<uint64_t>(e)) {
+  switch (e._value) {
   case Error::PFC_NONE:
     ostr << "Error::"
          << "None";
@@ -144,10 +144,50 @@ std::ostream& operator<<(std::ostream& ostr, const Error& e)
     ostr << "Error::"
          << "Address_In_Use";
     break;
+  case Error::PFC_PROTOCOL_NOT_SUPPORTED:
+    ostr << "Error::"
+         << "Protocol_Not_Supported";
+    break;
+  case Error::PFC_IP_SERIALIZATION_ERROR:
+    ostr << "Error::"
+         << "Ip_Serialization_Error";
+    break;
+  case Error::PFC_SOCKET_LIMIT_REACHED:
+    ostr << "Error::"
+         << "Socket_Limit_Reached";
+    break;
+  case Error::PFC_LIBRARY_SHUTDOWN:
+    ostr << "Error::"
+         << "Library_Shutdown";
+    break;
+  case Error::PFC_INVALID_SOCKET:
+    ostr << "Error::"
+         << "Invalid_Socket";
+    break;
+  case Error::PFC_INVALID_ENDPOINT:
+    ostr << "Error::"
+         << "Invalid_Endpoint";
+    break;
+  case Error::PFC_BAD_OPERATION:
+    ostr << "Error::"
+         << "Bad_Operation";
+    break;
+  case Error::PFC_INTERUPT:
+    ostr << "Error::"
+         << "Interupt";
+    break;
+  case Error::PFC_TIMEOUT:
+    ostr << "Error::"
+         << "Timeout";
+    break;
   case Error::PFC_ADDRESS_NOT_AVAILABLE:
     ostr << "Error::"
          << "Address_Not_Avaliable";
     break;
+  case Error::PFC_QUEUE_FULL:
+    ostr << "Error::"
+         << "Queue_Full";
+    break;
   default:
     break;
   }
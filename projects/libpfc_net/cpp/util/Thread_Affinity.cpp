@@ -0,0 +1,80 @@
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+/*! \file */
+
+#include <sustain/framework/util/Thread_Affinity.h>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace pfc {
+namespace {
+  //!
+  //! Platform specific implementation shared by both overloads
+  //!
+  Error pin(std::thread::native_handle_type handle, int cpu)
+  {
+    if (cpu == g_pfc_any_cpu) {
+      return Success();
+    }
+    if (cpu < 0 || static_cast<unsigned int>(cpu) >= std::thread::hardware_concurrency()) {
+      return Error::Code::PFC_BAD_OPERATION;
+    }
+#if defined(_WIN32)
+    if (cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8)
+        || SetThreadAffinityMask(static_cast<HANDLE>(handle), DWORD_PTR(1) << cpu) == 0) {
+      return Error::Code::PFC_BAD_OPERATION;
+    }
+    return Success();
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return (pthread_setaffinity_np(handle, sizeof(set), &set) == 0) ? Success() : Error(Error::Code::PFC_BAD_OPERATION);
+#else
+    (void)handle;
+    return Error::Code::PFC_BAD_OPERATION;
+#endif
+  }
+}
+//-----------------------------------------------------------------------------
+//! \param thread [IN] -- Running thread to be pinned
+//! \param cpu [IN] -- Zero based cpu index or g_pfc_any_cpu to leave the thread unpinned
+//! \return Error -- PFC_BAD_OPERATION if the cpu does not exist or the platform does not support pinning
+Error set_thread_affinity(std::thread& thread, int cpu)
+{
+  if (!thread.joinable()) {
+    return Error::Code::PFC_BAD_OPERATION;
+  }
+  return pin(thread.native_handle(), cpu);
+}
+//-----------------------------------------------------------------------------
+//! Pins the calling thread. Useful for threads owned by another class such as the
+//! receive thread of a Multicast_Receiver which can pin itself on its first callback
+//! \param cpu [IN] -- Zero based cpu index or g_pfc_any_cpu to leave the thread unpinned
+//! \return Error -- PFC_BAD_OPERATION if the cpu does not exist or the platform does not support pinning
+Error set_thread_affinity(int cpu)
+{
+#if defined(_WIN32)
+  return pin(GetCurrentThread(), cpu);
+#elif defined(__linux__)
+  return pin(pthread_self(), cpu);
+#else
+  return pin(std::thread::native_handle_type(), cpu);
+#endif
+}
+}
@@ -92,6 +92,7 @@ struct SUSTAIN_FRAMEWORK_API pfc_message {
 //ICD 4. Message Layout.
 //-----------------------------------------------------------------------
 constexpr pfc_uint MESSAGE_TYPE_NOT_ASSIGNED = 0x00000000;       //!<  Default value of Type() for pfc_message for initialization
+constexpr size_t MAX_SEQUENCE_LENGTH = 0x00100000;               //!<  Largest element count accepted when inflating a sequence
 
 //-----------------------------------------------------------------------
 //ICD 1.0 -- UDP Multicast Messages
@@ -113,6 +114,9 @@ struct SUSTAIN_FRAMEWORK_API pfc_service_announcement : pfc_message {
   pfc_string _name;                                     //!< Human Readable Name of the Service                                                        
   pfc_string _address;                                  //!< Valid URI for communicating with the service. Depending on the protcol implementation may be an IP4/IP6 or System Socket
   pfc_string _brief;                                    //!< Human Description of the service and its feature set. 
+  pfc_string _endpoints;                                //!< Space separated URIs the service also listens on, such as inproc:// and ipc:// endpoints for co-located clients
+  pfc_string _host;                                     //!< Host the service runs on, see local_host(). Empty when unknown
+  pfc_uint _process = 0;                                //!< Process the service runs in, see local_process(). 0 when unknown
 
   ~pfc_service_announcement() override;
 
@@ -269,6 +273,305 @@ bool SUSTAIN_FRAMEWORK_API operator==(const pfc_heartbeat_response&, const pfc_h
 //! Implemented as ! operator==()
 bool SUSTAIN_FRAMEWORK_API operator!=(const pfc_heartbeat_response&, const pfc_heartbeat_response&);
 
+//-----------------------------------------------------------------------
+// Registry Replication Messages
+//-----------------------------------------------------------------------
+//
+// Registries sharing a multicast group replicate their tables by periodically
+// sending a pfc_registry_digest on g_pfc_registry_sync_port. A peer whose digest differs
+// answers with a pfc_registry_sync_request naming the buckets it wants and the owner of those
+// buckets replies with one pfc_registry_sync_response per entry.
+
+//-------------------------------------Registry Digest--------------------------------------------------------------------------
+constexpr pfc_uint REGISTRY_DIGEST_REQUEST = 0x00000005; //!<  value returned by type() from a pfc_registry_digest
+
+struct SUSTAIN_FRAMEWORK_API pfc_registry_digest : pfc_message {
+  pfc_uint _message_type = REGISTRY_DIGEST_REQUEST; //!< value returned by TYPE. Shoudld be constant for any specific message type unless a deseralization error has occured.
+  pfc_uint _registry_id = 0; //!< Random identifier of the registry which produced the digest
+  pfc_uint _entry_count = 0; //!< Number of services in the registry table
+  pfc_uint _root = 0; //!< Hash of all _buckets. Equal roots mean equal tables
+  std::vector<pfc_uint> _buckets; //!< XOR of the entry hashes that fall in to each bucket of the table
+
+  ~pfc_registry_digest() override;
+
+  size_t Length() const override; //!< Returns the length of the encoded message
+  pfc_uint Type() const override; //!< Returns teh _message_type of an encoded message
+  Error serialize(std::ostream& os) const override; //!< Sends teh seralized format of a pfc_registry_digest over the provided  ostream.
+  Error deserialize(std::istream& is) override; //!< Marshalls a seralized registry digest and inflates it the data binding.
+};
+//!< Stream Operator for converting a pfc_registry_digest over an ostream
+SUSTAIN_FRAMEWORK_API std::ostream& operator<<(std::ostream&, const pfc_registry_digest&);
+//-----------------------------------------------------------------------
+// Comparison Operators
+//-----------------------------------------------------------------------
+//! Equivalance Operator for pfc_registry_digests
+bool SUSTAIN_FRAMEWORK_API operator==(const pfc_registry_digest&, const pfc_registry_digest&);
+//! Implemented as ! operator==()
+bool SUSTAIN_FRAMEWORK_API operator!=(const pfc_registry_digest&, const pfc_registry_digest&);
+
+//-------------------------------------Registry Sync--------------------------------------------------------------------------
+constexpr pfc_uint REGISTRY_SYNC_REQUEST = 0x00000006; //!<  value returned by type() from a pfc_registry_sync_request
+constexpr pfc_uint REGISTRY_SYNC_RESPONSE = 0x10000006; //!<  value returned by type() from a pfc_registry_sync_response
+
+struct SUSTAIN_FRAMEWORK_API pfc_registry_sync_request : pfc_message {
+  pfc_uint _message_type = REGISTRY_SYNC_REQUEST; //!< value returned by TYPE. Shoudld be constant for any specific message type unless a deseralization error has occured.
+  pfc_uint _registry_id = 0; //!< Registry asking for the entries
+  pfc_uint _target_id = 0; //!< Registry which should answer the request
+  std::vector<pfc_uint> _buckets; //!< Digest buckets whose entries should be sent
+
+  ~pfc_registry_sync_request() override;
+
+  size_t Length() const override; //!< Returns the length of the encoded message
+  pfc_uint Type() const override; //!< Returns teh _message_type of an encoded message
+  Error serialize(std::ostream& os) const override; //!< Sends teh seralized format of a pfc_registry_sync_request over the provided  ostream.
+  Error deserialize(std::istream& is) override; //!< Marshalls a seralized sync request and inflates it the data binding.
+};
+//!< Stream Operator for converting a pfc_registry_sync_request over an ostream
+SUSTAIN_FRAMEWORK_API std::ostream& operator<<(std::ostream&, const pfc_registry_sync_request&);
+//-----------------------------------------------------------------------
+// Comparison Operators
+//-----------------------------------------------------------------------
+//! Equivalance Operator for pfc_registry_sync_requests
+bool SUSTAIN_FRAMEWORK_API operator==(const pfc_registry_sync_request&, const pfc_registry_sync_request&);
+//! Implemented as ! operator==()
+bool SUSTAIN_FRAMEWORK_API operator!=(const pfc_registry_sync_request&, const pfc_registry_sync_request&);
+
+struct SUSTAIN_FRAMEWORK_API pfc_registry_sync_response : pfc_message {
+  pfc_uint _message_type = REGISTRY_SYNC_RESPONSE; //!< value returned by TYPE. Shoudld be constant for any specific message type unless a deseralization error has occured.
+  pfc_uint _registry_id = 0; //!< Registry which sent the entry
+  pfc_uint _version = 0; //!< Version of the entry. Higher versions replace lower ones on merge
+  pfc_bool _removed = False; //!< True when the entry is a tombstone left by a pfc_service_signoff
+  pfc_ushort _port; //!< Stores a listinging port of the registered remote service
+  pfc_protocol _protacol = pfc_protocol::pub_sub; //!< Stores teh protacol used byt the registered service
+  pfc_string _name; //!< Human Readable Name of the Service
+  pfc_string _address; //!< Valid URI for communicating with the service. Depending on the protcol implementation may be an IP4/IP6 or System Socket
+  pfc_string _brief; //!< Human Description of the service and its feature set.
+
+  ~pfc_registry_sync_response() override;
+
+  size_t Length() const override; //!< Returns the length of the encoded message
+  pfc_uint Type() const override; //!< Returns teh _message_type of an encoded message
+  Error serialize(std::ostream& os) const override; //!< Sends teh seralized format of a pfc_registry_sync_response over the provided  ostream.
+  Error deserialize(std::istream& is) override; //!< Marshalls a seralized sync response and inflates it the data binding.
+};
+//!< Stream Operator for converting a pfc_registry_sync_response over an ostream
+SUSTAIN_FRAMEWORK_API std::ostream& operator<<(std::ostream&, const pfc_registry_sync_response&);
+//-----------------------------------------------------------------------
+// Comparison Operators
+//-----------------------------------------------------------------------
+//! Equivalance Operator for pfc_registry_sync_responses
+bool SUSTAIN_FRAMEWORK_API operator==(const pfc_registry_sync_response&, const pfc_registry_sync_response&);
+//! Implemented as ! operator==()
+bool SUSTAIN_FRAMEWORK_API operator!=(const pfc_registry_sync_response&, const pfc_registry_sync_response&);
+
+//-----------------------------------------------------------------------
+// Registry Watch Messages
+//-----------------------------------------------------------------------
+//
+// Registries publish every change to their table as a pfc_registry_delta over a PubSub feed.
+// Each published message is framed as a topic, a single '\0' and then the serialized delta.
+// The topic is "<protocol>/<name>" (see registry_topic) so subscribers can filter by protocol
+// or by any prefix of a service name.
+//
+// Deltas carry a sequence number which increases by one per change. A client subscribes to the feed,
+// then sends a pfc_registry_snapshot_request over ReqRep. The reply is a pfc_registry_snapshot_response
+// followed by _count registry_added deltas. Buffered feed deltas with a _sequence at or below the
+// snapshot _sequence are already reflected in the snapshot and can be dropped.
+
+//!
+//! Kind of change described by a pfc_registry_delta
+//!
+enum pfc_registry_change : pfc_byte { registry_added,
+                                      registry_updated,
+                                      registry_removed };
+
+//!
+//!  Operator for seralizing pfc_registry_change to ostreams
+//!
+SUSTAIN_FRAMEWORK_API std::ostream& operator<<(std::ostream&, const pfc_registry_change&);
+
+//!
+//!  \return pfc_string -- Watch feed topic of a service "<protocol>/<name>"
+//!
+SUSTAIN_FRAMEWORK_API pfc_string registry_topic(pfc_protocol, const pfc_string& name);
+
+//-------------------------------------Registry Delta--------------------------------------------------------------------------
+constexpr pfc_uint REGISTRY_DELTA_REQUEST = 0x00000007; //!<  value returned by type() from a pfc_registry_delta
+
+struct SUSTAIN_FRAMEWORK_API pfc_registry_delta : pfc_message {
+  pfc_uint _message_type = REGISTRY_DELTA_REQUEST; //!< value returned by TYPE. Shoudld be constant for any specific message type unless a deseralization error has occured.
+  pfc_uint _sequence = 0; //!< Position of the change in the registry change feed
+  pfc_registry_change _change = registry_added; //!< What happend to the service
+  pfc_uint _version = 0; //!< Version of the entry after the change
+  pfc_ushort _port; //!< Stores a listinging port of the registered remote service
+  pfc_protocol _protacol = pfc_protocol::pub_sub; //!< Stores teh protacol used byt the registered service
+  pfc_string _name; //!< Human Readable Name of the Service
+  pfc_string _address; //!< Valid URI for communicating with the service. Depending on the protcol implementation may be an IP4/IP6 or System Socket
+  pfc_string _brief; //!< Human Description of the service and its feature set.
+
+  ~pfc_registry_delta() override;
+
+  size_t Length() const override; //!< Returns the length of the encoded message
+  pfc_uint Type() const override; //!< Returns teh _message_type of an encoded message
+  Error serialize(std::ostream& os) const override; //!< Sends teh seralized format of a pfc_registry_delta over the provided  ostream.
+  Error deserialize(std::istream& is) override; //!< Marshalls a seralized registry delta and inflates it the data binding.
+};
+//!< Stream Operator for converting a pfc_registry_delta over an ostream
+SUSTAIN_FRAMEWORK_API std::ostream& operator<<(std::ostream&, const pfc_registry_delta&);
+//-----------------------------------------------------------------------
+// Comparison Operators
+//-----------------------------------------------------------------------
+//! Equivalance Operator for pfc_registry_deltas
+bool SUSTAIN_FRAMEWORK_API operator==(const pfc_registry_delta&, const pfc_registry_delta&);
+//! Implemented as ! operator==()
+bool SUSTAIN_FRAMEWORK_API operator!=(const pfc_registry_delta&, const pfc_registry_delta&);
+
+//-------------------------------------Registry Snapshot--------------------------------------------------------------------------
+constexpr pfc_uint REGISTRY_SNAPSHOT_REQUEST = 0x00000008; //!<  value returned by type() from a pfc_registry_snapshot_request
+constexpr pfc_uint REGISTRY_SNAPSHOT_RESPONSE = 0x10000008; //!<  value returned by type() from a pfc_registry_snapshot_response
+
+struct SUSTAIN_FRAMEWORK_API pfc_registry_snapshot_request : pfc_message {
+  pfc_uint _message_type = REGISTRY_SNAPSHOT_REQUEST; //!< value returned by TYPE. Shoudld be constant for any specific message type unless a deseralization error has occured.
+  pfc_string _topic; //!< Only services whose registry_topic starts with _topic are returned. Empty for all
+
+  ~pfc_registry_snapshot_request() override;
+
+  size_t Length() const override; //!< Returns the length of the encoded message
+  pfc_uint Type() const override; //!< Returns teh _message_type of an encoded message
+  Error serialize(std::ostream& os) const override; //!< Sends teh seralized format of a pfc_registry_snapshot_request over the provided  ostream.
+  Error deserialize(std::istream& is) override; //!< Marshalls a seralized snapshot request and inflates it the data binding.
+};
+//!< Stream Operator for converting a pfc_registry_snapshot_request over an ostream
+SUSTAIN_FRAMEWORK_API std::ostream& operator<<(std::ostream&, const pfc_registry_snapshot_request&);
+//-----------------------------------------------------------------------
+// Comparison Operators
+//-----------------------------------------------------------------------
+//! Equivalance Operator for pfc_registry_snapshot_requests
+bool SUSTAIN_FRAMEWORK_API operator==(const pfc_registry_snapshot_request&, const pfc_registry_snapshot_request&);
+//! Implemented as ! operator==()
+bool SUSTAIN_FRAMEWORK_API operator!=(const pfc_registry_snapshot_request&, const pfc_registry_snapshot_request&);
+
+struct SUSTAIN_FRAMEWORK_API pfc_registry_snapshot_response : pfc_message {
+  pfc_uint _message_type = REGISTRY_SNAPSHOT_RESPONSE; //!< value returned by TYPE. Shoudld be constant for any specific message type unless a deseralization error has occured.
+  pfc_uint _sequence = 0; //!< Sequence of the last change reflected in the snapshot
+  pfc_uint _count = 0; //!< Number of pfc_registry_delta messages which follow
+
+  ~pfc_registry_snapshot_response() override;
+
+  size_t Length() const override; //!< Returns the length of the encoded message
+  pfc_uint Type() const override; //!< Returns teh _message_type of an encoded message
+  Error serialize(std::ostream& os) const override; //!< Sends teh seralized format of a pfc_registry_snapshot_response over the provided  ostream.
+  Error deserialize(std::istream& is) override; //!< Marshalls a seralized snapshot response and inflates it the data binding.
+};
+//!< Stream Operator for converting a pfc_registry_snapshot_response over an ostream
+SUSTAIN_FRAMEWORK_API std::ostream& operator<<(std::ostream&, const pfc_registry_snapshot_response&);
+//-----------------------------------------------------------------------
+// Comparison Operators
+//-----------------------------------------------------------------------
+//! Equivalance Operator for pfc_registry_snapshot_responses
+bool SUSTAIN_FRAMEWORK_API operator==(const pfc_registry_snapshot_response&, const pfc_registry_snapshot_response&);
+//! Implemented as ! operator==()
+bool SUSTAIN_FRAMEWORK_API operator!=(const pfc_registry_snapshot_response&, const pfc_registry_snapshot_response&);
+
+//-----------------------------------------------------------------------
+// Reliable Multicast Messages
+//-----------------------------------------------------------------------
+//
+// A Reliable_Multicast_Sender numbers every pfc_reliable_data frame it multicasts on its data port
+// and keeps the latest frames in a history ring. Receivers deliver frames in sequence order. A
+// receiver which sees a gap multicasts a pfc_reliable_nack on the port above the data port and
+// the sender multicasts the missing frames again, so one repair serves every receiver which lost
+// them. A pfc_reliable_heartbeat advertises the newest sequence so a lost final frame is noticed,
+// and the oldest sequence still in the history so receivers stop asking for frames which are gone.
+//
+// _channel is a random identifier of the sender. A new _channel means the sender restarted and its
+// sequence numbers start again. Sequences wrap and are compared with serial number arithmetic.
+
+//-------------------------------------Reliable Data--------------------------------------------------------------------------
+constexpr pfc_uint RELIABLE_DATA_REQUEST = 0x00000009; //!<  value returned by type() from a pfc_reliable_data
+
+struct SUSTAIN_FRAMEWORK_API pfc_reliable_data : pfc_message {
+  pfc_uint _message_type = RELIABLE_DATA_REQUEST; //!< value returned by TYPE. Shoudld be constant for any specific message type unless a deseralization error has occured.
+  pfc_uint _channel = 0; //!< Random identifier of the sender
+  pfc_uint _sequence = 0; //!< Position of the frame in the sender stream. The first frame is 1
+  pfc_bool _retransmit = False; //!< True when the frame is a repair answering a pfc_reliable_nack
+  std::vector<pfc_byte> _payload; //!< Application data
+
+  ~pfc_reliable_data() override;
+
+  size_t Length() const override; //!< Returns the length of the encoded message
+  pfc_uint Type() const override; //!< Returns teh _message_type of an encoded message
+  Error serialize(std::ostream& os) const override; //!< Sends teh seralized format of a pfc_reliable_data over the provided  ostream.
+  Error deserialize(std::istream& is) override; //!< Marshalls a seralized reliable data frame and inflates it the data binding.
+};
+//!< Stream Operator for converting a pfc_reliable_data over an ostream
+SUSTAIN_FRAMEWORK_API std::ostream& operator<<(std::ostream&, const pfc_reliable_data&);
+//-----------------------------------------------------------------------
+// Comparison Operators
+//-----------------------------------------------------------------------
+//! Equivalance Operator for pfc_reliable_datas
+bool SUSTAIN_FRAMEWORK_API operator==(const pfc_reliable_data&, const pfc_reliable_data&);
+//! Implemented as ! operator==()
+bool SUSTAIN_FRAMEWORK_API operator!=(const pfc_reliable_data&, const pfc_reliable_data&);
+
+//-------------------------------------Reliable Heartbeat--------------------------------------------------------------------------
+constexpr pfc_uint RELIABLE_HEARTBEAT_REQUEST = 0x0000000A; //!<  value returned by type() from a pfc_reliable_heartbeat
+
+struct SUSTAIN_FRAMEWORK_API pfc_reliable_heartbeat : pfc_message {
+  pfc_uint _message_type = RELIABLE_HEARTBEAT_REQUEST; //!< value returned by TYPE. Shoudld be constant for any specific message type unless a deseralization error has occured.
+  pfc_uint _channel = 0; //!< Random identifier of the sender
+  pfc_uint _first = 0; //!< Oldest sequence the sender can still retransmit
+  pfc_uint _high_water = 0; //!< Newest sequence sent. 0 before the first frame
+
+  ~pfc_reliable_heartbeat() override;
+
+  size_t Length() const override; //!< Returns the length of the encoded message
+  pfc_uint Type() const override; //!< Returns teh _message_type of an encoded message
+  Error serialize(std::ostream& os) const override; //!< Sends teh seralized format of a pfc_reliable_heartbeat over the provided  ostream.
+  Error deserialize(std::istream& is) override; //!< Marshalls a seralized reliable heartbeat and inflates it the data binding.
+};
+//!< Stream Operator for converting a pfc_reliable_heartbeat over an ostream
+SUSTAIN_FRAMEWORK_API std::ostream& operator<<(std::ostream&, const pfc_reliable_heartbeat&);
+//-----------------------------------------------------------------------
+// Comparison Operators
+//-----------------------------------------------------------------------
+//! Equivalance Operator for pfc_reliable_heartbeats
+bool SUSTAIN_FRAMEWORK_API operator==(const pfc_reliable_heartbeat&, const pfc_reliable_heartbeat&);
+//! Implemented as ! operator==()
+bool SUSTAIN_FRAMEWORK_API operator!=(const pfc_reliable_heartbeat&, const pfc_reliable_heartbeat&);
+
+//-------------------------------------Reliable Nack--------------------------------------------------------------------------
+constexpr pfc_uint RELIABLE_NACK_REQUEST = 0x0000000B; //!<  value returned by type() from a pfc_reliable_nack
+
+struct SUSTAIN_FRAMEWORK_API pfc_reliable_nack : pfc_message {
+  pfc_uint _message_type = RELIABLE_NACK_REQUEST; //!< value returned by TYPE. Shoudld be constant for any specific message type unless a deseralization error has occured.
+  pfc_uint _channel = 0; //!< Sender the missing frames came from
+  pfc_uint _first = 0; //!< First missing sequence
+  pfc_uint _count = 0; //!< Number of consecutive missing sequences starting at _first
+
+  ~pfc_reliable_nack() override;
+
+  size_t Length() const override; //!< Returns the length of the encoded message
+  pfc_uint Type() const override; //!< Returns teh _message_type of an encoded message
+  Error serialize(std::ostream& os) const override; //!< Sends teh seralized format of a pfc_reliable_nack over the provided  ostream.
+  Error deserialize(std::istream& is) override; //!< Marshalls a seralized reliable nack and inflates it the data binding.
+};
+//!< Stream Operator for converting a pfc_reliable_nack over an ostream
+SUSTAIN_FRAMEWORK_API std::ostream& operator<<(std::ostream&, const pfc_reliable_nack&);
+//-----------------------------------------------------------------------
+// Comparison Operators
+//-----------------------------------------------------------------------
+//! Equivalance Operator for pfc_reliable_nacks
+bool SUSTAIN_FRAMEWORK_API operator==(const pfc_reliable_nack&, const pfc_reliable_nack&);
+//! Implemented as ! operator==()
+bool SUSTAIN_FRAMEWORK_API operator!=(const pfc_reliable_nack&, const pfc_reliable_nack&);
+
+//!
+//!  Reads the message type of the next message on the stream without consuming it.
+//!  Requires a seekable stream. Returns MESSAGE_TYPE_NOT_ASSIGNED when no type can be read
+//!
+SUSTAIN_FRAMEWORK_API pfc_uint peek_message_type(std::istream&);
+
 /**
   *!  sizeof for pfc_types
   *!  Most just call sizeof, but char[]
@@ -291,6 +594,17 @@ inline size_t size_of_pfc_type(const std::string& result)
   return result.length() * sizeof(std::string::value_type);
 }
 
+/**
+  *!  sizeof for pfc_types
+  *!  Overload of size_of_pfc_type for sequences of fixed width pfc_types
+  *!  return N * sizeof(T)
+  **/
+template <typename T>
+size_t size_of_pfc_type(const std::vector<T>& result)
+{
+  return result.size() * sizeof(T);
+}
+
 /**
   *!  sizeof for pfc_types
   *!  Template specialization for array types
@@ -361,11 +675,28 @@ inline Error serialize_pfc_type(std::ostream& os, const pfc_string& data)
 template <typename T, size_t N>
 Error serialize_pfc_type(std::ostream& is, T (&val)[N])
 {
-  constexpr size_t size = size_of_pfc_type(T) * N;
+  constexpr size_t size = sizeof(T) * N;
   is.write(reinterpret_cast<const char*>(&val[0]), size - 1);
   return Success();
 }
 
+/**
+  *!  Overload of serialize_pfc_type for sequences of fixed width pfc_types
+  *!  Sequences are written as a length prefix followed by the packed elements
+  **/
+template <typename T>
+Error serialize_pfc_type(std::ostream& os, const std::vector<T>& data)
+{
+  auto size = data.size();
+  os.write(reinterpret_cast<const char*>(&size), size_of_pfc_type(size));
+  os.write(reinterpret_cast<const char*>(data.data()), size_of_pfc_type(data));
+  if (os.good()) {
+    return Success();
+  } else {
+    return Error(Error::Code::PFC_IP_SERIALIZATION_ERROR);
+  }
+}
+
 
 /**
   *!  Veradic templte implementation of serialize_pfc_type
@@ -422,15 +753,34 @@ inline Error deserialize_pfc_type(std::istream& is, pfc_string& result)
 //!  Tempalte Specialization of deserailzie_pfc_type for array types
 //!
 template <typename T, int N>
-Error deserialize_pfc_type(std::istream& os, T (&result)[N])
+Error deserialize_pfc_type(std::istream& is, T (&result)[N])
 {
-  constexpr size_t size = size_of_pfc_type(T) * N;
+  constexpr size_t size = sizeof(T) * N;
 
-  os.write(&result[0], size);
-  os.write('\0', size_of_pfc_type('\0'));
+  is.read(reinterpret_cast<char*>(&result[0]), size - 1);
+  result[N - 1] = T();
   return Success();
 }
 
+//!
+//!  Overload of deserialize_pfc_type for sequences of fixed width pfc_types
+//!  Length prefixes larger then MAX_SEQUENCE_LENGTH are treated as corrupt messages
+//!
+template <typename T>
+Error deserialize_pfc_type(std::istream& is, std::vector<T>& result)
+{
+  size_t size = 0;
+  if (is.good()) {
+    is.read(reinterpret_cast<char*>(&size), size_of_pfc_type(size));
+    if (is.good() && size <= MAX_SEQUENCE_LENGTH) {
+      result.resize(size);
+      is.read(reinterpret_cast<char*>(result.data()), size_of_pfc_type(result));
+      return Success();
+    }
+  }
+  return Error(Error::Code::PFC_IP_SERIALIZATION_ERROR);
+}
+
 
 //!
 //!  Function overload of deserialize_pfc_type to allow veradic templates to call with no arguments. Returns Error::PFC_NONE
@@ -0,0 +1,453 @@
+#ifndef SUSTAIN_FRAMEWORK_NET_COROUTINES_H
+#define SUSTAIN_FRAMEWORK_NET_COROUTINES_H
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+/*! \file */
+
+//!
+//! \brief C++20 awaitable requests, subscriptions and surveys which resume on a Reactor
+//!
+//! The library itself is built as C++14, so everything here is header only and only defined when
+//! the including translation unit is compiled with coroutine support. PFC_HAS_COROUTINES reports
+//! which one it got.
+//!
+//!   pfc::task<int> poll_tick(pfc::ReqRep_Client& client, pfc::Reactor& reactor)
+//!   {
+//!     auto reply = co_await pfc::co_request(client, pfc::message("tick", 4), reactor);
+//!     co_return (reply.ec) ? -1 : parse_tick(reply.body);
+//!   }
+//!
+//! Every awaitable resumes its coroutine on a worker of the Reactor it was given, never on the
+//! internal thread which completed the operation, so thousands of interactions in flight cost
+//! frames on the heap rather than threads.
+//!
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define PFC_HAS_COROUTINES 1
+#else
+#define PFC_HAS_COROUTINES 0
+#endif
+
+#if PFC_HAS_COROUTINES
+
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <sustain/framework/net/Message.h>
+#include <sustain/framework/net/Reactor.h>
+#include <sustain/framework/net/patterns/pub_sub/Subscriber.h>
+#include <sustain/framework/net/patterns/req_rep/Client.h>
+#include <sustain/framework/net/patterns/survey/Surveyor.h>
+
+namespace pfc {
+
+template <typename T = void>
+class task;
+
+//-----------------------------------------------------------------------------
+//! Resumes a suspended coroutine on a worker of reactor. Resumes inline when the Reactor is
+//! stopped or its queue is full. Resumptions still queued when the Reactor stops run on the
+//! thread calling Reactor::stop, so a coroutine is never lost
+//! \param reactor [IN] -- Executor the coroutine continues on
+//! \param awaiting [IN] -- Suspended coroutine
+inline void resume_on(Reactor& reactor, std::coroutine_handle<> awaiting)
+{
+  if (reactor.post([awaiting]() { awaiting.resume(); })) {
+    awaiting.resume();
+  }
+}
+
+namespace coroutine_detail {
+  //!
+  //!  Promise behaviour shared by every task. Tasks start suspended and, when they finish, transfer
+  //!  control straight back to the coroutine which awaited them
+  //!
+  struct task_promise_base {
+    struct final_awaiter {
+      bool await_ready() const noexcept { return false; }
+      template <typename Promise>
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> finished) noexcept
+      {
+        return finished.promise().continuation;
+      }
+      void await_resume() const noexcept { }
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    final_awaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() const noexcept { std::terminate(); }
+
+    std::coroutine_handle<> continuation = std::noop_coroutine(); //!< Coroutine awaiting this task
+  };
+
+  template <typename T>
+  struct task_promise : task_promise_base {
+    task<T> get_return_object() noexcept;
+    void return_value(T value) { result.emplace(std::move(value)); }
+
+    std::optional<T> result;
+  };
+
+  template <>
+  struct task_promise<void> : task_promise_base {
+    task<void> get_return_object() noexcept;
+    void return_void() const noexcept { }
+  };
+
+  //!
+  //!  Coroutine type which starts immediately and frees itself when it finishes. Used by spawn
+  //!
+  struct detached {
+    struct promise_type {
+      detached get_return_object() const noexcept { return {}; }
+      std::suspend_never initial_suspend() const noexcept { return {}; }
+      std::suspend_never final_suspend() const noexcept { return {}; }
+      void return_void() const noexcept { }
+      void unhandled_exception() const noexcept { std::terminate(); }
+    };
+  };
+}
+
+//!
+//!  Lazily started coroutine producing a T. Runs when first awaited and resumes its awaiter when
+//!  it finishes. Start a task which nothing awaits with spawn, or block on one with sync_wait.
+//!
+template <typename T>
+class task {
+public:
+  using promise_type = coroutine_detail::task_promise<T>;
+
+  task(const task&) = delete;
+  task(task&& rhs) noexcept
+    : _handle(std::exchange(rhs._handle, nullptr))
+  {
+  }
+  ~task()
+  {
+    if (_handle) {
+      _handle.destroy();
+    }
+  }
+  task& operator=(const task&) = delete;
+  task& operator=(task&& rhs) noexcept
+  {
+    if (this != &rhs) {
+      if (_handle) {
+        _handle.destroy();
+      }
+      _handle = std::exchange(rhs._handle, nullptr);
+    }
+    return *this;
+  }
+
+  bool await_ready() const noexcept { return !_handle || _handle.done(); }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+  {
+    _handle.promise().continuation = awaiting;
+    return _handle;
+  }
+  T await_resume()
+  {
+    if constexpr (!std::is_void_v<T>) {
+      return std::move(*_handle.promise().result);
+    }
+  }
+
+private:
+  friend promise_type;
+  explicit task(std::coroutine_handle<promise_type> handle) noexcept
+    : _handle(handle)
+  {
+  }
+
+  std::coroutine_handle<promise_type> _handle;
+};
+
+template <typename T>
+task<T> coroutine_detail::task_promise<T>::get_return_object() noexcept
+{
+  return task<T>(std::coroutine_handle<task_promise<T>>::from_promise(*this));
+}
+inline task<void> coroutine_detail::task_promise<void>::get_return_object() noexcept
+{
+  return task<void>(std::coroutine_handle<task_promise<void>>::from_promise(*this));
+}
+
+namespace coroutine_detail {
+  inline detached run_detached(task<void> work)
+  {
+    co_await std::move(work);
+  }
+  template <typename T>
+  detached run_to_promise(task<T> work, std::promise<T>& done)
+  {
+    if constexpr (std::is_void_v<T>) {
+      co_await std::move(work);
+      done.set_value();
+    } else {
+      done.set_value(co_await std::move(work));
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+//! Starts a task on the calling thread without waiting for it. The task frees itself when it finishes
+//! \param work [IN] -- Task to run
+inline void spawn(task<void> work)
+{
+  coroutine_detail::run_detached(std::move(work));
+}
+//-----------------------------------------------------------------------------
+//! Runs a task and blocks the calling thread until it finishes. Must not be called on a worker of a
+//! Reactor the task resumes on, or the task may wait for the very thread it is blocking
+//! \param work [IN] -- Task to run
+//! \return T -- Value the task returned
+template <typename T>
+T sync_wait(task<T> work)
+{
+  std::promise<T> done;
+  auto result = done.get_future();
+  coroutine_detail::run_to_promise(std::move(work), done);
+  return result.get();
+}
+
+//!
+//!  Awaitable returned by co_request. Completes with the Client_Reply of ReqRep_Client::request
+//!
+class Request_Awaiter {
+public:
+  Request_Awaiter(ReqRep_Client& client, message body, Reactor& reactor, std::chrono::milliseconds timeout)
+    : _client(&client)
+    , _reactor(&reactor)
+    , _body(std::move(body))
+    , _timeout(timeout)
+  {
+  }
+
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> awaiting)
+  {
+    //The reply may arrive, and the coroutine resume, before request returns, so nothing of this
+    //awaiter is touched after the call
+    auto reactor = _reactor;
+    auto reply = &_reply;
+    _client->request(std::move(_body), [reactor, reply, awaiting](Client_Reply result) {
+      *reply = std::move(result);
+      resume_on(*reactor, awaiting);
+    },
+                     _timeout);
+  }
+  Client_Reply await_resume() { return std::move(_reply); }
+
+private:
+  ReqRep_Client* _client;
+  Reactor* _reactor;
+  message _body;
+  std::chrono::milliseconds _timeout;
+  Client_Reply _reply;
+};
+//-----------------------------------------------------------------------------
+//! \param client [IN] -- Client whose socket pool carries the request
+//! \param body [IN] -- Serialized request
+//! \param reactor [IN] -- Executor the awaiting coroutine resumes on
+//! \param timeout [IN] -- Time allowed for the reply. 0 uses Client_Options::timeout
+//! \return Request_Awaiter -- co_await yields the Client_Reply
+inline Request_Awaiter co_request(ReqRep_Client& client, message body, Reactor& reactor, std::chrono::milliseconds timeout = std::chrono::milliseconds(0))
+{
+  return Request_Awaiter(client, std::move(body), reactor, timeout);
+}
+
+//!
+//!  Awaitable returned by co_survey. Completes with the tally and every response received
+//!
+class Survey_Awaiter {
+public:
+  Survey_Awaiter(Survey_Surveyor& surveyor, message question, const Survey_Options& options, Reactor& reactor)
+    : _surveyor(&surveyor)
+    , _reactor(&reactor)
+    , _question(std::move(question))
+    , _options(options)
+  {
+  }
+
+  bool await_ready() const noexcept { return false; }
+  //! Surveyor::survey blocks until quorum or deadline, so it runs on a Reactor worker and the
+  //! coroutine resumes on that worker once it returns. Surveys inline if the Reactor refuses the job
+  bool await_suspend(std::coroutine_handle<> awaiting)
+  {
+    return !_reactor->post([this, awaiting]() {
+      conduct();
+      awaiting.resume();
+    });
+  }
+  Survey_Result<std::vector<message>> await_resume()
+  {
+    if (!_conducted) {
+      conduct();
+    }
+    return std::move(_result);
+  }
+
+private:
+  void conduct()
+  {
+    _conducted = true;
+    auto& responses = _result.value;
+    static_cast<Survey_Tally&>(_result) = _surveyor->survey(std::move(_question), _options, [&responses](message response) {
+      responses.push_back(std::move(response));
+    });
+  }
+
+  Survey_Surveyor* _surveyor;
+  Reactor* _reactor;
+  message _question;
+  Survey_Options _options;
+  bool _conducted = false;
+  Survey_Result<std::vector<message>> _result;
+};
+//-----------------------------------------------------------------------------
+//! \param surveyor [IN] -- Surveyor which sends the question
+//! \param question [IN] -- Serialized survey
+//! \param options [IN] -- Deadline and quorum
+//! \param reactor [IN] -- Executor the survey runs and the awaiting coroutine resumes on
+//! \return Survey_Awaiter -- co_await yields the tally and the responses in arrival order
+inline Survey_Awaiter co_survey(Survey_Surveyor& surveyor, message question, const Survey_Options& options, Reactor& reactor)
+{
+  return Survey_Awaiter(surveyor, std::move(question), options, reactor);
+}
+
+//!
+//!  Turns a PubSub_Subscriber in to a stream of messages read with co_await subscription.next().
+//!
+//!  The subscriber is registered with the Reactor, so it needs no thread of its own. Messages which
+//!  arrive while nothing is awaiting are buffered up to capacity; beyond that the oldest are dropped
+//!  and counted, as a slow consumer of a publisher would lose them anyway. Only one coroutine may
+//!  await next at a time, and the Subscription must outlive it.
+//!
+class Subscription {
+  struct State;
+
+public:
+  //!
+  //!  Awaitable returned by next
+  //!
+  class Next_Awaiter {
+  public:
+    bool await_ready()
+    {
+      std::lock_guard<std::mutex> guard(_state->mutex);
+      return take();
+    }
+    bool await_suspend(std::coroutine_handle<> awaiting)
+    {
+      std::lock_guard<std::mutex> guard(_state->mutex);
+      if (take()) {
+        return false;
+      }
+      _state->waiter = awaiting;
+      _state->slot = &_result;
+      return true;
+    }
+    message await_resume() { return std::move(_result); }
+
+  private:
+    friend class Subscription;
+    explicit Next_Awaiter(std::shared_ptr<State> state)
+      : _state(std::move(state))
+    {
+    }
+    bool take()
+    {
+      if (_state->pending.empty()) {
+        return false;
+      }
+      _result = std::move(_state->pending.front());
+      _state->pending.pop_front();
+      return true;
+    }
+
+    std::shared_ptr<State> _state;
+    message _result;
+  };
+
+  //! \param subscriber [IN] -- Subscriber to read. Its async_listen is called with reactor
+  //! \param reactor [IN] -- Reactor polling the subscriber and resuming the awaiting coroutine
+  //! \param capacity [IN] -- Messages buffered while nothing awaits next
+  Subscription(PubSub_Subscriber& subscriber, Reactor& reactor, size_t capacity = 1024)
+    : _state(std::make_shared<State>())
+  {
+    _state->reactor = &reactor;
+    _state->capacity = capacity;
+    auto state = _state;
+    subscriber.async_listen(reactor, [state](message published) {
+      state->deliver(std::move(published));
+      return message();
+    });
+  }
+
+  //! \return Next_Awaiter -- co_await yields the next published message
+  Next_Awaiter next() { return Next_Awaiter(_state); }
+
+  //! \return uint64_t -- Messages dropped because the buffer was full
+  uint64_t dropped() const
+  {
+    std::lock_guard<std::mutex> guard(_state->mutex);
+    return _state->dropped;
+  }
+
+private:
+  struct State {
+    void deliver(message published)
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      if (waiter) {
+        *slot = std::move(published);
+        auto awaiting = std::exchange(waiter, nullptr);
+        slot = nullptr;
+        lock.unlock();
+        resume_on(*reactor, awaiting);
+        return;
+      }
+      if (pending.size() >= capacity) {
+        pending.pop_front();
+        ++dropped;
+      }
+      pending.push_back(std::move(published));
+    }
+
+    std::mutex mutex;
+    std::deque<message> pending; //!< Messages which arrived while nothing awaited next
+    std::coroutine_handle<> waiter; //!< Coroutine suspended in next
+    message* slot = nullptr; //!< Where the waiter expects its message
+    Reactor* reactor = nullptr;
+    size_t capacity = 0;
+    uint64_t dropped = 0;
+  };
+
+  std::shared_ptr<State> _state;
+};
+} //namespace pfc
+
+#endif //PFC_HAS_COROUTINES
+
+#endif //SUSTAIN_FRAMEWORK_NET_COROUTINES_H
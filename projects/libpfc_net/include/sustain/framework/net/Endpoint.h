@@ -0,0 +1,54 @@
+#ifndef SUSTAIN_FRAMEWORK_NET_ENDPOINT_H
+#define SUSTAIN_FRAMEWORK_NET_ENDPOINT_H
+
+/*! \file */
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+//!
+//! \brief Transport selection for co-located services
+//!
+//! A service advertises inproc:// and ipc:// endpoints next to its tcp address, along with the host and
+//! process it runs in. A client built from the announcement connects over inproc when it shares the
+//! process, over ipc when it shares the host and over tcp otherwise, so co-located peers never pay for
+//! the loopback tcp stack.
+//!
+//!   Service::Config config{ Service::Config::pub_sub, 5600, "vitals", URI("tcp://10.0.0.4:5600"), "" };
+//!   config.local_endpoints = local_endpoints(config.name, config.port);
+//!   PubSub_Publisher publisher(config.address);
+//!   for (auto& endpoint : config.local_endpoints) { publisher.bind(endpoint); }
+//!
+//!   //In the client, on hearing the announcement
+//!   PubSub_Subscriber subscriber(announcement);
+//!
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sustain/framework/Exports.h>
+#include <sustain/framework/Protocol.h>
+#include <sustain/framework/net/Uri.h>
+
+namespace pfc {
+
+SUSTAIN_FRAMEWORK_API pfc_string local_host();
+SUSTAIN_FRAMEWORK_API pfc_uint local_process();
+
+SUSTAIN_FRAMEWORK_API std::vector<URI> local_endpoints(const std::string& service_name, uint16_t port);
+SUSTAIN_FRAMEWORK_API void advertise_endpoints(pfc_service_announcement& announcement, const std::vector<URI>& endpoints);
+SUSTAIN_FRAMEWORK_API URI select_endpoint(const pfc_service_announcement& announcement);
+
+} //namespace pfc
+
+#endif //SUSTAIN_FRAMEWORK_NET_ENDPOINT_H
@@ -0,0 +1,200 @@
+#ifndef SUSTAIN_FRAMEWORK_NET_MESSAGE_H
+#define SUSTAIN_FRAMEWORK_NET_MESSAGE_H
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+/*! \file */
+
+//!
+//! \brief Move only message buffer which can be handed to nanomsg without a copy
+//!
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+
+#include <sustain/framework/Exports.h>
+
+namespace pfc {
+
+//!
+//!  Owned, contiguous message buffer.
+//!
+//!  By default the memory comes from nn_allocmsg so a pattern can send it with NN_MSG and
+//!  nanomsg takes ownership instead of copying. When nanomsg memory can not be used, either because
+//!  the allocation failed or the message is bound for a transport that does not take ownership,
+//!  the memory comes from a per thread pool of power of two blocks so steady state sends still
+//!  do not touch the heap.
+//!
+//!  Serialize in place with message_ostream:
+//!
+//!    message msg(announcement.Length());
+//!    { message_ostream os(msg); announcement.serialize(os); }
+//!    publisher.broadcast([&msg]() { return std::move(msg); });
+//!
+class SUSTAIN_FRAMEWORK_API message {
+public:
+  //! Where the bytes of a message live
+  enum class Storage : uint8_t { none,
+                                 nanomsg, //!< nn_allocmsg chunk, may be sent with NN_MSG
+                                 pooled }; //!< Block from the message pool, always copied by nanomsg
+
+  message() noexcept;
+  explicit message(size_t capacity, Storage preferred = Storage::nanomsg);
+  message(const char* data, size_t size, Storage preferred = Storage::nanomsg);
+  message(const message&) = delete;
+  message(message&&) noexcept;
+  ~message();
+
+  static message adopt(void* chunk, size_t size);
+  void* release_chunk();
+
+  char* data() noexcept { return _data; } //!< First byte of the message
+  const char* data() const noexcept { return _data; } //!< First byte of the message
+  size_t size() const noexcept { return _size; } //!< Bytes in use
+  size_t capacity() const noexcept { return _capacity; } //!< Bytes available without reallocating
+  bool empty() const noexcept { return _size == 0; } //!< True when no bytes are in use
+  Storage storage() const noexcept { return _storage; } //!< Where the bytes live
+
+  void reserve(size_t capacity);
+  void resize(size_t size);
+  void append(const char* data, size_t size);
+  void clear() noexcept;
+
+  message& operator=(const message&) = delete;
+  message& operator=(message&&) noexcept;
+
+private:
+  void reset() noexcept;
+
+  char* _data;
+  size_t _size;
+  size_t _capacity;
+  Storage _storage;
+};
+
+//!
+//! streambuf which appends to a message, growing it as needed. The message size is updated on
+//! every sync and when the buffer is destroyed.
+//!
+class message_streambuf : public std::streambuf {
+public:
+  explicit message_streambuf(message& target)
+    : _target(target)
+  {
+    reset_put_area();
+  }
+  ~message_streambuf() override { sync(); }
+
+protected:
+  int_type overflow(int_type ch) override
+  {
+    sync();
+    _target.reserve((_target.capacity() < 64) ? 128 : _target.capacity() * 2);
+    reset_put_area();
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(ch);
+      pbump(1);
+    }
+    return traits_type::not_eof(ch);
+  }
+  std::streamsize xsputn(const char* data, std::streamsize count) override
+  {
+    if (epptr() - pptr() < count) {
+      sync();
+      _target.append(data, static_cast<size_t>(count));
+      reset_put_area();
+      return count;
+    }
+    std::char_traits<char>::copy(pptr(), data, static_cast<size_t>(count));
+    pbump(static_cast<int>(count));
+    return count;
+  }
+  int sync() override
+  {
+    if (pbase()) {
+      _target.resize(static_cast<size_t>(pptr() - _target.data()));
+    }
+    return 0;
+  }
+
+private:
+  void reset_put_area()
+  {
+    setp(_target.data(), _target.data() + _target.capacity());
+    pbump(static_cast<int>(_target.size()));
+  }
+
+  message& _target;
+};
+
+//!
+//! ostream which serializes directly in to a message. Anything written is appended to the message
+//!
+class message_ostream : public std::ostream {
+public:
+  explicit message_ostream(message& target)
+    : std::ostream(nullptr)
+    , _buffer(target)
+  {
+    rdbuf(&_buffer);
+  }
+  ~message_ostream() override { _buffer.pubsync(); }
+
+private:
+  message_streambuf _buffer;
+};
+
+//!
+//! streambuf which reads a message in place
+//!
+class message_istreambuf : public std::streambuf {
+public:
+  explicit message_istreambuf(const message& source)
+    : message_istreambuf(source.data(), source.size())
+  {
+  }
+  //! Reads part of a message, such as the payload after a topic
+  message_istreambuf(const char* data, size_t size)
+  {
+    auto begin = const_cast<char*>(data);
+    setg(begin, begin, begin + size);
+  }
+};
+
+//!
+//! istream which deserializes directly from a message without copying it
+//!
+class message_istream : public std::istream {
+public:
+  explicit message_istream(const message& source)
+    : std::istream(nullptr)
+    , _buffer(source)
+  {
+    rdbuf(&_buffer);
+  }
+  message_istream(const char* data, size_t size)
+    : std::istream(nullptr)
+    , _buffer(data, size)
+  {
+    rdbuf(&_buffer);
+  }
+
+private:
+  message_istreambuf _buffer;
+};
+} //namespace pfc
+
+#endif //SUSTAIN_FRAMEWORK_NET_MESSAGE_H
@@ -21,9 +21,11 @@ specific language governing permissions and limitations under the license.
 #include <vector>
 
 #include <sustain/framework/Exports.h>
+#include <sustain/framework/net/Message.h>
 
 namespace pfc {
 
+class Reactor;
 
 //!
 //! Abstract interface Pattern defines
@@ -53,6 +55,13 @@ public:
   //! \brief lambda signiture for functions used by listen and async_listen
   using ListenFunc = std::function<std::vector<char>(char*, size_t size)>;
 
+  //! \brief Zero copy callback used by listen and async_listen
+  //!
+  //! Receives ownership of the nanomsg buffer the message arrived in, so it can be kept past the callback without a copy.
+  //! The returned message is the reply for patterns which reply. Clearing the request and serializing the reply in to it,
+  //! or using a Storage::pooled message, keeps a server free of allocations in steady state. Return message() for no payload.
+  using MessageListenFunc = std::function<message(message request)>;
+
   ~Listiner() override = default;
 
   //! \brief Blocking listen on underpending impementation. control will not return until timeout or a message is received
@@ -61,6 +70,16 @@ public:
   //! \brief non blocking listen that will execute ListenFunc once a message is received
   virtual void async_listen(ListenFunc) = 0;
 
+  //! \brief Zero copy blocking listen. control will not return until timeout or a message is received
+  virtual void listen(MessageListenFunc) = 0;
+
+  //! \brief Zero copy non blocking listen that will execute MessageListenFunc once a message is received
+  virtual void async_listen(MessageListenFunc) = 0;
+
+  //! \brief Non blocking listen driven by a shared Reactor instead of a thread per Listiner.
+  //! The Reactor must outlive the Listiner
+  virtual void async_listen(Reactor&, MessageListenFunc) = 0;
+
   //! \brief Part of the Pattern Interface
   void standup() override = 0;
 
@@ -82,6 +101,11 @@ public:
   //! If a user is worried about allocation/deallocaiton performance they should overload the vectors  allocator type inside the
   //! Lambda  The return of this function  should always be a PFC seralized message format
   using BroadcastFunc = std::function<std::vector<char>()>;
+  //! \brief Zero copy callback for generating outbound messages
+  //!
+  //! The returned message is serialized in place by the caller. When it holds nanomsg storage it is sent
+  //! with NN_MSG and nanomsg takes ownership of the memory, so the bytes are never copied after serialization.
+  using MessageFunc = std::function<message()>;
   //! \brief Standard Callback for handeling received messages on a bounded port
   //!
   //!  This function will take in a istream which contains an arbitary amount of data and consume the message returning
@@ -95,6 +119,8 @@ public:
 
   virtual void broadcast(BroadcastFunc) = 0;       //!< Interface for performing syncronized braodcast
   virtual void async_broadcast(BroadcastFunc) = 0; //!< Interface for performing asyncronized broadcast
+  virtual void broadcast(MessageFunc) = 0;       //!< Zero copy syncronized braodcast
+  virtual void async_broadcast(MessageFunc) = 0; //!< Zero copy asyncronized broadcast
 
 
   void standup() override = 0;          //!< Inherited from Pattern
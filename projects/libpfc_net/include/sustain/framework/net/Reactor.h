@@ -0,0 +1,77 @@
+#ifndef SUSTAIN_FRAMEWORK_NET_REACTOR_H
+#define SUSTAIN_FRAMEWORK_NET_REACTOR_H
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+/*! \file */
+
+//!
+//! \brief Waits on many nanomsg sockets with one thread and dispatches readiness to a small pool
+//!
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+#include <sustain/framework/Exports.h>
+#include <sustain/framework/util/Error.h>
+
+namespace pfc {
+
+//!
+//!  One poll thread waits on every registered socket with nn_poll. When a socket becomes ready it
+//!  is taken out of the poll set and its handler runs on one of the worker threads; the socket is
+//!  polled again once the handler returns. A handler therefore never runs twice at once for the same
+//!  socket, but handlers of different sockets run in parallel on the workers.
+//!
+//!  post runs any other job on the same workers, which makes a Reactor the executor coroutines
+//!  resume on (see Coroutines.h).
+//!
+//!  Listeners accept a Reactor in async_listen so an application subscribing to hundreds of
+//!  publishers needs the poll thread and a few workers instead of a thread per socket.
+//!  The Reactor must outlive every pattern registered with it.
+//!
+class SUSTAIN_FRAMEWORK_API Reactor {
+public:
+  //! Called with the socket and the NN_POLLIN / NN_POLLOUT events which are ready.
+  //! Should read or write with NN_DONTWAIT until EAGAIN or a small batch, then return
+  using ReadyFunc = std::function<void(int socket, short events)>;
+  //! Job queued with post
+  using JobFunc = std::function<void()>;
+
+  explicit Reactor(size_t workers = 1);
+  Reactor(const Reactor&) = delete;
+  Reactor& operator=(const Reactor&) = delete;
+  ~Reactor();
+
+  Error add(int socket, short events, ReadyFunc handler);
+  Error remove(int socket);
+  Error post(JobFunc job);
+  void stop();
+
+  size_t size() const;
+  size_t workers() const;
+
+private:
+#pragma warning(push, 0)
+  //!
+  //!  @struct Reactor::Implementation
+  //!  Private PIMPL implementation of Reactor
+  //!
+  struct Implementation;
+  std::unique_ptr<Implementation> _impl;
+#pragma warning(pop)
+};
+} //namespace pfc
+
+#endif //SUSTAIN_FRAMEWORK_NET_REACTOR_H
@@ -0,0 +1,70 @@
+#ifndef SUSTAIN_FRAMEWORK_NET_RELIABLE_MULTICAST_RECEIVER_H
+#define SUSTAIN_FRAMEWORK_NET_RELIABLE_MULTICAST_RECEIVER_H
+
+/*! \file */
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <sustain/framework/Exports.h>
+#include <sustain/framework/net/Reliable_Multicast_Sender.h>
+#include <sustain/framework/util/Error.h>
+
+namespace pfc {
+
+//!
+//! Receives the frames of a Reliable_Multicast_Sender in sequence order.
+//!
+//! A gap is NACKed as soon as it is seen and again every nack_interval while heartbeats or later
+//! frames show it is still open. Frames after a gap are held, up to the history, until the gap
+//! is repaired. Frames the sender can no longer repair are skipped and counted by lost().
+//!
+//! A receiver which joins late starts with the first frame it sees, or after the newest frame
+//! when a heartbeat arrives first. It does not replay the history. When the sender restarts with
+//! a new channel the receiver starts over with it.
+//!
+class SUSTAIN_FRAMEWORK_API Reliable_Multicast_Receiver {
+public:
+  Reliable_Multicast_Receiver(std::string bind_address, std::string multicast_address, uint16_t port, Reliable_Multicast_Options options = {});
+  Reliable_Multicast_Receiver(const Reliable_Multicast_Receiver&) = delete;
+  Reliable_Multicast_Receiver& operator=(const Reliable_Multicast_Receiver&) = delete;
+  ~Reliable_Multicast_Receiver();
+
+  void async_receive(std::function<void(std::istream&)>);
+  void stop();
+  void join();
+
+  uint64_t delivered() const;
+  uint64_t lost() const;
+  uint64_t nacks() const;
+
+  bool is_valid() const;
+  Error error() const;
+
+private:
+#pragma warning(push, 0)
+  //!
+  //!  @struct Reliable_Multicast_Receiver::Implementation
+  //!  Private PIMPL implementation of Reliable_Multicast_Receiver
+  //!
+  struct Implementation;
+  std::unique_ptr<Implementation> _impl;
+#pragma warning(pop)
+};
+} //namespace pfc
+
+#endif //SUSTAIN_FRAMEWORK_NET_RELIABLE_MULTICAST_RECEIVER_H
@@ -0,0 +1,90 @@
+#ifndef SUSTAIN_FRAMEWORK_NET_RELIABLE_MULTICAST_SENDER_H
+#define SUSTAIN_FRAMEWORK_NET_RELIABLE_MULTICAST_SENDER_H
+
+/*! \file */
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <sustain/framework/Exports.h>
+#include <sustain/framework/Protocol.h>
+#include <sustain/framework/util/Error.h>
+
+namespace pfc {
+
+//!
+//! Tuning shared by both ends of a reliable multicast channel
+//!
+struct Reliable_Multicast_Options {
+  size_t history = 4096; //!< Frames the sender keeps for retransmission and the receiver holds out of order
+  std::chrono::milliseconds heartbeat = std::chrono::milliseconds(100); //!< How often the sender advertises its newest sequence
+  std::chrono::milliseconds nack_interval = std::chrono::milliseconds(20); //!< Minimum time before a gap is NACKed again and a frame is repaired again
+};
+
+//!
+//! \param from [IN] -- Earlier sequence
+//! \param to [IN] -- Later sequence
+//! \return int32_t -- Frames from from to to, negative when to is older. Correct across wraparound
+inline int32_t sequence_distance(pfc_uint from, pfc_uint to)
+{
+  return static_cast<int32_t>(to - from);
+}
+
+//!
+//! Multicast sender which numbers its frames so Reliable_Multicast_Receivers can deliver them in
+//! order and ask for lost ones again.
+//!
+//! Frames go to the multicast group on port and NACKs are heard on port + 1. A NACKed frame is
+//! multicast again, so one repair reaches every receiver which lost it. Frames older than the
+//! history can not be repaired; heartbeats tell receivers to skip past them.
+//!
+//! Each frame is one datagram, so a payload must fit in a single UDP datagram. send may be called
+//! from any thread.
+//!
+class SUSTAIN_FRAMEWORK_API Reliable_Multicast_Sender {
+public:
+  Reliable_Multicast_Sender(std::string multicast_address, uint16_t port, Reliable_Multicast_Options options = {});
+  Reliable_Multicast_Sender(const Reliable_Multicast_Sender&) = delete;
+  Reliable_Multicast_Sender& operator=(const Reliable_Multicast_Sender&) = delete;
+  ~Reliable_Multicast_Sender();
+
+  Error send(std::function<void(std::ostream&)>);
+  void stop();
+  void join();
+
+  pfc_uint channel() const;
+  pfc_uint high_water() const;
+  uint64_t sent() const;
+  uint64_t retransmitted() const;
+
+  bool is_valid() const;
+  Error error() const;
+
+private:
+#pragma warning(push, 0)
+  //!
+  //!  @struct Reliable_Multicast_Sender::Implementation
+  //!  Private PIMPL implementation of Reliable_Multicast_Sender
+  //!
+  struct Implementation;
+  std::unique_ptr<Implementation> _impl;
+#pragma warning(pop)
+};
+} //namespace pfc
+
+#endif //SUSTAIN_FRAMEWORK_NET_RELIABLE_MULTICAST_SENDER_H
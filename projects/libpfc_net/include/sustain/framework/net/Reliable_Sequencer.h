@@ -0,0 +1,79 @@
+#ifndef SUSTAIN_FRAMEWORK_NET_RELIABLE_SEQUENCER_H
+#define SUSTAIN_FRAMEWORK_NET_RELIABLE_SEQUENCER_H
+
+/*! \file */
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <sustain/framework/Exports.h>
+#include <sustain/framework/Protocol.h>
+#include <sustain/framework/net/Reliable_Multicast_Sender.h>
+
+namespace pfc {
+
+//!
+//! Sequencing state of a Reliable_Multicast_Receiver, without its sockets.
+//!
+//! Frames and heartbeats are fed in as they arrive. Payloads come out of DeliverFunc in sequence
+//! order and each run of missing frames comes out of NackFunc, so the gap hold, heartbeat skips,
+//! sequence wraparound and NACK pacing can be driven directly:
+//!
+//!   Reliable_Sequencer sequencer(options, [](std::vector<pfc_byte>& payload) { ... },
+//!                                [](pfc_uint first, pfc_uint count) { ... });
+//!   sequencer.handle_data(frame, std::chrono::steady_clock::now());
+//!
+//! Only one thread may feed a sequencer. The counters may be read from any thread.
+//!
+class SUSTAIN_FRAMEWORK_API Reliable_Sequencer {
+public:
+  using DeliverFunc = std::function<void(std::vector<pfc_byte>& payload)>;
+  using NackFunc = std::function<void(pfc_uint first, pfc_uint count)>;
+  using time_point = std::chrono::steady_clock::time_point;
+
+  Reliable_Sequencer(Reliable_Multicast_Options options, DeliverFunc deliver, NackFunc nack);
+  Reliable_Sequencer(const Reliable_Sequencer&) = delete;
+  Reliable_Sequencer& operator=(const Reliable_Sequencer&) = delete;
+  ~Reliable_Sequencer();
+
+  void handle_data(pfc_reliable_data& frame, time_point now);
+  void handle_heartbeat(const pfc_reliable_heartbeat& heartbeat, time_point now);
+
+  bool synced() const;
+  pfc_uint channel() const;
+  pfc_uint next() const;
+  pfc_uint high_water() const;
+  size_t held() const;
+
+  uint64_t delivered() const;
+  uint64_t lost() const;
+  uint64_t nacks() const;
+
+private:
+#pragma warning(push, 0)
+  //!
+  //!  @struct Reliable_Sequencer::Implementation
+  //!  Private PIMPL implementation of Reliable_Sequencer
+  //!
+  struct Implementation;
+  std::unique_ptr<Implementation> _impl;
+#pragma warning(pop)
+};
+} //namespace pfc
+
+#endif //SUSTAIN_FRAMEWORK_NET_RELIABLE_SEQUENCER_H
@@ -26,6 +26,7 @@ specific language governing permissions and limitations under the license.
 #include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <sustain/framework/util/Constants.h>
 #include <sustain/framework/util/Error.h>
@@ -62,6 +63,7 @@ public:
     std::string name;            //!< Human friendly name of the service
     URI address;                 //!< Service URI other clients will use to connect to this service
     std::string brief;           //!< Details the expected purpose of this service and possibly a guide on how to interact with it or where documentation can be found.
+    std::vector<URI> local_endpoints; //!< inproc:// and ipc:// URIs the service also listens on, see local_endpoints in Endpoint.h. Co-located clients prefer them to address
   };
 
   Service(const Config service, const std::string& multicast_bind_address, const std::string& registry_multicast_address);
@@ -0,0 +1,82 @@
+#ifndef SUSTAIN_FRAMEWORK_NET_SHM_RING_H
+#define SUSTAIN_FRAMEWORK_NET_SHM_RING_H
+
+/*! \file */
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <sustain/framework/Exports.h>
+#include <sustain/framework/net/Message.h>
+#include <sustain/framework/util/Error.h>
+
+namespace pfc {
+
+constexpr size_t g_pfc_shm_ring_bytes = size_t(1) << 22; //!< Default data size of a shm:// ring, enough for about a second of a high rate waveform
+
+//!
+//! Which end of a Shm_Ring an object is
+//!
+enum class Shm_Role {
+  writer, //!< Creates the ring. Exactly one per name
+  reader //!< Attaches to the ring of a writer. Any number per name, in any process
+};
+
+//!
+//! Single writer, many reader broadcast ring in shared memory. The transport behind shm:// URIs.
+//!
+//! The writer never waits for readers. Each reader keeps its own cursor and copies records straight
+//! out of the mapping, so a message crosses processes with one memcpy and no system call unless a
+//! reader is asleep. A reader which falls more than the ring size behind is overrun: it drops what is
+//! buffered, resumes with the next message written and counts what it missed in lost().
+//!
+//! Readers may be created before their writer; they attach when the writer appears and reattach when
+//! it is replaced. Sleeping readers are woken through a futex in the mapping. write may be called from
+//! any thread; each reader is read by one thread at a time.
+//!
+//! Only Linux is supported. Elsewhere every Shm_Ring reports PFC_PROTOCOL_NOT_SUPPORTED.
+//!
+class SUSTAIN_FRAMEWORK_API Shm_Ring {
+public:
+  Shm_Ring(const std::string& name, Shm_Role role, size_t capacity = g_pfc_shm_ring_bytes);
+  Shm_Ring(const Shm_Ring&) = delete;
+  Shm_Ring& operator=(const Shm_Ring&) = delete;
+  ~Shm_Ring();
+
+  bool write(const char* data, size_t size);
+  bool read(message& next);
+  bool read(message& next, std::chrono::milliseconds timeout);
+  void close();
+
+  size_t capacity() const;
+  uint64_t lost() const;
+  bool is_valid() const;
+  Error error() const;
+
+private:
+#pragma warning(push, 0)
+  //!
+  //!  @struct Shm_Ring::Implementation
+  //!  Private PIMPL implementation of Shm_Ring
+  //!
+  struct Implementation;
+  std::unique_ptr<Implementation> _impl;
+#pragma warning(pop)
+};
+} //namespace pfc
+
+#endif //SUSTAIN_FRAMEWORK_NET_SHM_RING_H
@@ -28,6 +28,10 @@ namespace pfc {
 //!  Class for encoding Universal Resource Indentifiers 
 //! <a href="https://en.wikipedia.org/wiki/Uniform_Resource_Identifier">Wikipedia Entry</a>
 //! <a href="https://tools.ietf.org/html/rfc3986">Full Specification</a>
+//!
+//! Transports are those of nanomsg (tcp, ipc, inproc, ws) plus shm, whose address names a same host
+//! shared memory ring used by the pub/sub patterns, e.g. shm://waveforms. Addresses may be paths so
+//! ipc sockets can be named absolutely, e.g. ipc:///tmp/pfc_vitals.ipc
 class SUSTAIN_FRAMEWORK_API URI {
 public:
   URI(std::string uri);
@@ -45,7 +49,7 @@ public:
   std::string address() const { return _address; }           //!< Returns the current address as a string
   std::string port() const { return _port; }                 //!< Returns the current port as a string
   int port_i() const { return std::stoi(_port); } //!< Returns the current port as a string
-  const char* c_str() const; //!< Returns the current port as an int
+  const char* c_str() const; //!< Returns the full endpoint string
 
   Error error() const;
   bool is_valid() const;
@@ -69,14 +73,14 @@ std::ostream& operator<<(std::ostream&, const URI&);
 inline URI::URI(std::string uri)
   : _port("80")
 {
-  std::regex rx(R"REGEX((\w+)://([A-Za-z0-9_.]+)(:(\d+)){0,1})REGEX");
+  std::regex rx(R"REGEX((\w+)://(\[[0-9A-Fa-f:.]+\]|[A-Za-z0-9_.*/-]+)(:(\d+)){0,1})REGEX");
   std::smatch matches;
 
   if (std::regex_match(uri, matches, rx)) {
-    _transport = matches[0];
-    _address = matches[1];
-    if (matches.size() == 4) {
-      _port = matches[0];
+    _transport = matches[1];
+    _address = matches[2];
+    if (matches[4].matched) {
+      _port = matches[4];
     }
     _endpoint = std::move(uri);
   } else {
@@ -100,7 +104,7 @@ inline URI::URI(std::string transport, std::string address, uint16_t port)
     _endpoint = _transport + "://" + _address;
   }
 
-  std::regex rx(R"REGEX((\w+)://([A-Za-z0-9_.]+)(:(\d+)){0,1})REGEX");
+  std::regex rx(R"REGEX((\w+)://(\[[0-9A-Fa-f:.]+\]|[A-Za-z0-9_.*/-]+)(:(\d+)){0,1})REGEX");
   std::smatch matches;
 
   if (!std::regex_match(_endpoint, matches, rx)) {
@@ -124,10 +128,11 @@ inline bool URI::operator!=(const URI& rhs) const
   return !(*this == rhs);
 }
 //-----------------------------------------------------------------------------
-//! \return char const* - Valid until next call to address(std::string)
+//! \return char const* - Full endpoint transport://address[:port] as given to nn_bind and nn_connect.
+//!                        Valid for the lifetime of the URI
 inline const char* URI::c_str() const
 {
-  return _address.c_str();
+  return _endpoint.c_str();
 }
 //-----------------------------------------------------------------------------
 //! \return Error - Success() or the last Error State of the URI
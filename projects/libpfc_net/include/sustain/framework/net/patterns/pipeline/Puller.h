@@ -0,0 +1,81 @@
+#ifndef SUSTAIN_FRAMEWORK_NET_PATTERNS_PIPELINE_PULLER_H
+#define SUSTAIN_FRAMEWORK_NET_PATTERNS_PIPELINE_PULLER_H
+
+/*! \file */
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+#include <sustain/framework/net/Patterns.h>
+
+#include <cstdint>
+#include <memory>
+
+#include <sustain/framework/net/Uri.h>
+#include <sustain/framework/util/Error.h>
+
+namespace pfc {
+
+//!
+//! Thread pool of a Pipeline_Puller
+//!
+struct Puller_Options {
+  size_t workers = 0; //!< Threads running the ListenFunc. 0 uses one per hardware thread
+  size_t prefetch = 8; //!< Messages a worker reads from the socket at once. Those it can not start yet are left for idle workers to steal
+  size_t deque_depth = 256; //!< Work each worker can hold. Rounded up to a power of two
+};
+
+//!
+//! Worker end of a Push/Pull pipeline
+//! <a href="https://nanomsg.org/gettingstarted/pipeline.html"> Documentation </a>
+//!
+//! Connects to a Pipeline_Pusher and runs the ListenFunc for each message it is given. The reply
+//! of the ListenFunc is discarded; push results to a second pipeline to collect them.
+//!
+//! async_listen starts Puller_Options::workers threads. Each reads up to prefetch messages at a time
+//! in to its own Work_Stealing_Deque and works through them newest first. A worker with nothing left
+//! steals the oldest work of a busy sibling before it goes back to the socket, so the cores of a
+//! node stay busy when work items vary in cost. The ListenFunc must be safe to call from several
+//! threads at once. Work still queued at shutdown is dropped.
+//!
+//! async_listen with a Reactor runs the ListenFunc on the Reactor thread instead, without a pool.
+//!
+class SUSTAIN_FRAMEWORK_API Pipeline_Puller : public Listiner {
+public:
+  Pipeline_Puller(URI, Puller_Options = Puller_Options());
+  ~Pipeline_Puller() final;
+
+  uint64_t processed() const;
+  uint64_t stolen() const;
+
+  void listen(ListenFunc) final;
+  void async_listen(ListenFunc) final;
+  void listen(MessageListenFunc) final;
+  void async_listen(MessageListenFunc) final;
+  void async_listen(Reactor&, MessageListenFunc) final;
+
+  void standup() final;
+  void shutdown() final;
+
+private:
+#pragma warning(push, 0)
+  //!
+  //!  @struct Pipeline_Puller::Implementation
+  //!  Private PIMPL implementation of Pipeline_Puller
+  //!
+  struct Implementation;
+  std::unique_ptr<Implementation> _impl;
+#pragma warning(pop)
+};
+} //namespace pfc
+
+#endif //SUSTAIN_FRAMEWORK_NET_PATTERNS_PIPELINE_PULLER_H
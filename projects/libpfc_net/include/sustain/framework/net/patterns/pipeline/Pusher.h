@@ -0,0 +1,75 @@
+#ifndef SUSTAIN_FRAMEWORK_NET_PATTERNS_PIPELINE_PUSHER_H
+#define SUSTAIN_FRAMEWORK_NET_PATTERNS_PIPELINE_PUSHER_H
+
+/*! \file */
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+#include <sustain/framework/net/Patterns.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <sustain/framework/net/Uri.h>
+#include <sustain/framework/util/Error.h>
+
+namespace pfc {
+
+//!
+//! Source of work for a Push/Pull pipeline
+//! <a href="https://nanomsg.org/gettingstarted/pipeline.html"> Documentation </a>
+//!
+//! The pusher binds and any number of Pipeline_Puller workers connect to it. Each message goes to
+//! exactly one worker; nanomsg round robins between workers with room in their pipe, so a batch
+//! sweep (e.g. Monte-Carlo patient runs) spreads over every worker node without a scheduler.
+//!
+//! push blocks while every worker is full, which throttles the sweep to the speed of the workers.
+//! try_push fails instead so the caller can do something else. broadcast and async_broadcast
+//! push whatever a generator returns, matching the other Broadcasters.
+//!
+class SUSTAIN_FRAMEWORK_API Pipeline_Pusher : public Broadcaster {
+public:
+  Pipeline_Pusher(URI);
+  ~Pipeline_Pusher() final;
+
+  Error push(message work);
+  Error push(const std::vector<char>& buffer);
+  bool try_push(message& work);
+
+  Error bind(URI endpoint);
+  uint64_t pushed() const;
+
+  void set_response_callaback_func(CallbackFunc) final;
+
+  void broadcast(BroadcastFunc) final;
+  void async_broadcast(BroadcastFunc) final;
+  void broadcast(MessageFunc) final;
+  void async_broadcast(MessageFunc) final;
+
+  void standup() final;
+  void shutdown() final;
+
+private:
+#pragma warning(push, 0)
+  //!
+  //!  @struct Pipeline_Pusher::Implementation
+  //!  Private PIMPL implementation of Pipeline_Pusher
+  //!
+  struct Implementation;
+  std::unique_ptr<Implementation> _impl;
+#pragma warning(pop)
+};
+} //namespace pfc
+
+#endif //SUSTAIN_FRAMEWORK_NET_PATTERNS_PIPELINE_PUSHER_H
@@ -0,0 +1,75 @@
+#ifndef SUSTAIN_FRAMEWORK_NET_PATTERNS_PUBSUB_FORWARDER_H
+#define SUSTAIN_FRAMEWORK_NET_PATTERNS_PUBSUB_FORWARDER_H
+
+/*! \file */
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+#include <sustain/framework/net/Patterns.h>
+
+#include <memory>
+#include <string>
+
+#include <sustain/framework/net/Uri.h>
+#include <sustain/framework/util/Error.h>
+
+namespace pfc {
+
+//!
+//! Re-fans a Pub/Sub feed so the publisher only sends each message once
+//! <a href="https://nanomsg.org/v1.1.5/nn_device.html"> Documentation </a>
+//!
+//! A raw SUB socket connects upstream to a PubSub_Publisher and a raw PUB socket binds downstream for
+//! subscribers. nn_device moves each message between them without a copy or a decode, so the cost of
+//! a hundred dashboards lands on the forwarder instead of a 60 Hz simulator.
+//!
+//! Forwarders chain: connect one to the downstream endpoint of another to build a fan out tree, one
+//! per site or rack. connect adds upstreams, so one forwarder can also merge several publishers, and
+//! bind adds downstream endpoints such as those of local_endpoints (see Endpoint.h).
+//!
+//! The topic passed at construction, and any added with subscribe, limit what is forwarded. nanomsg
+//! never tells a publisher what its subscribers want, so the default forwards everything.
+//!
+class SUSTAIN_FRAMEWORK_API PubSub_Forwarder : public Pattern {
+public:
+  PubSub_Forwarder(URI upstream, URI downstream, std::string topic = "");
+  PubSub_Forwarder(const PubSub_Forwarder&) = delete;
+  PubSub_Forwarder& operator=(const PubSub_Forwarder&) = delete;
+  ~PubSub_Forwarder() final;
+
+  Error connect(URI upstream);
+  Error bind(URI downstream);
+  Error subscribe(const std::string& topic);
+
+  Error forward();
+  void async_forward();
+
+  bool is_valid() const;
+  Error error() const;
+
+  void standup() final;
+  void shutdown() final;
+
+private:
+#pragma warning(push, 0)
+  //!
+  //!  @struct PubSub_Forwarder::Implementation
+  //!  Private PIMPL implementation of PubSub_Forwarder
+  //!
+  struct Implementation;
+  std::unique_ptr<Implementation> _impl;
+#pragma warning(pop)
+};
+} //namespace pfc
+
+#endif //SUSTAIN_FRAMEWORK_NET_PATTERNS_PUBSUB_FORWARDER_H
@@ -0,0 +1,67 @@
+#ifndef SUSTAIN_FRAMEWORK_NET_PATTERNS_PUBSUB_LAST_VALUE_CACHE_H
+#define SUSTAIN_FRAMEWORK_NET_PATTERNS_PUBSUB_LAST_VALUE_CACHE_H
+
+/*! \file */
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include <sustain/framework/Exports.h>
+#include <sustain/framework/net/Message.h>
+
+namespace pfc {
+
+//!
+//! Latest topic framed message (see Topic.h) per topic.
+//!
+//! A PubSub_Publisher with Publish_Options::last_value_cache records every message it sends here and
+//! answers snapshot requests from it, so a late joining subscriber starts from the current state.
+//! A conflating PubSub_Subscriber keeps the messages it has not delivered yet here; a newer message
+//! replaces an undelivered one of the same topic, so a slow listener only ever sees current values.
+//!
+//! Snapshots are the matching messages each preceded by its length as four big endian bytes.
+//! Filters match the leading bytes of a framed message exactly as NN_SUB_SUBSCRIBE does.
+//!
+class SUSTAIN_FRAMEWORK_API Last_Value_Cache {
+public:
+  Last_Value_Cache();
+  Last_Value_Cache(const Last_Value_Cache&) = delete;
+  Last_Value_Cache& operator=(const Last_Value_Cache&) = delete;
+  ~Last_Value_Cache();
+
+  bool store(const message& framed);
+  bool conflate(message& framed, bool only_if_absent = false);
+  bool take_changed(message& latest);
+
+  message snapshot(const char* filter, size_t size) const;
+  static bool unpack(const message& snapshot, const std::function<void(message)>& each);
+
+  size_t size() const;
+  uint64_t conflated() const;
+
+private:
+#pragma warning(push, 0)
+  //!
+  //!  @struct Last_Value_Cache::Implementation
+  //!  Private PIMPL implementation of Last_Value_Cache
+  //!
+  struct Implementation;
+  std::unique_ptr<Implementation> _impl;
+#pragma warning(pop)
+};
+} //namespace pfc
+
+#endif //SUSTAIN_FRAMEWORK_NET_PATTERNS_PUBSUB_LAST_VALUE_CACHE_H
@@ -17,27 +17,96 @@ specific language governing permissions and limitations under the license.
 
 #include <sustain/framework/net/Patterns.h>
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
 
+#include <sustain/framework/net/Shm_Ring.h>
 #include <sustain/framework/net/Uri.h>
+#include <sustain/framework/util/Error.h>
 
 namespace pfc {
 
+//!
+//! What publish does when the publish queue is full
+//!
+enum class Overflow_Policy {
+  drop_newest, //!< Discard the message being published
+  drop_oldest, //!< Discard the oldest queued message to make room
+  block //!< Wait for the publisher thread to make room
+};
+
+//!
+//! Tuning for the publish queue of a PubSub_Publisher
+//!
+struct Publish_Options {
+  size_t capacity = 1024; //!< Messages which may be queued before the overflow policy applies. Rounded up to a power of two
+  size_t max_batch = 64; //!< Messages sent per wake up of the publisher thread before it checks for shutdown
+  Overflow_Policy overflow = Overflow_Policy::drop_newest;
+  bool last_value_cache = false; //!< Keep a copy of the latest topic framed message per topic so serve_snapshots can answer late joiners
+  size_t ring_bytes = g_pfc_shm_ring_bytes; //!< Size of the shared memory ring of a shm:// publisher. Messages larger than the ring are dropped
+  size_t batch_bytes = 0; //!< Pack topic framed messages of one topic in to topic batches of up to this many bytes (see Topic.h). 0 sends each message on its own
+  std::chrono::microseconds batch_window = std::chrono::microseconds(500); //!< Longest a message waits for others of its topic to join its batch
+};
+
 //!
 //! Publisher class for Pub/Sub mechanics
 //! A publisher is a source of messages that a
 //! subscriber will register with to receive publushed events.
 //! Follows the Broadcaster interface
 //!
+//! Applications which produce data on their own schedule should push it with publish or try_publish.
+//! Messages are queued in a bounded lock free queue and sent by a publisher thread which sleeps while
+//! the queue is empty, so any number of threads may publish without a thread spinning per publisher.
+//! broadcast and async_broadcast keep the pull model where the publisher calls a generator.
+//!
+//! Messages framed with a topic (see Topic.h) let subscribers filter inside nanomsg. Publish with
+//! publish(topic, payload, size), or serialize straight after the topic of a topic_message.
+//!
+//! With Publish_Options::last_value_cache the publisher thread also records the latest message of every
+//! topic it sends from the queue. serve_snapshots answers requests for those values on a ReqRep endpoint,
+//! which a conflating PubSub_Subscriber asks with request_snapshot when it joins late.
+//!
+//! A shm:// URI publishes in to a shared memory ring (see Shm_Ring) instead of a nanomsg socket, so
+//! subscribers on the same host receive each message with a single copy and no system call. The
+//! publisher never waits for them; a subscriber which falls a whole ring behind skips ahead.
+//!
+//! bind adds endpoints to the same socket, so a service can offer the inproc:// and ipc:// endpoints of
+//! local_endpoints (see Endpoint.h) alongside its tcp address.
+//!
+//! With Publish_Options::batch_bytes the publisher thread holds each topic framed message for up to
+//! batch_window and sends the messages of a topic which arrive meanwhile as one topic batch, so a burst
+//! of small updates costs one send instead of one per message. Subscribers unpack batches before
+//! delivery. Order is kept within a topic but not between topics. A message alone in its window, one
+//! without a topic and one larger than batch_bytes are sent unchanged.
+//!
 class SUSTAIN_FRAMEWORK_API PubSub_Publisher : public Broadcaster {
 public:
-  PubSub_Publisher(URI);
+  PubSub_Publisher(URI, Publish_Options = Publish_Options());
   ~PubSub_Publisher() final;
 
+  Error publish(message msg);
+  Error publish(const std::vector<char>& buffer);
+  Error publish(const std::string& topic, const char* payload, size_t size);
+  bool try_publish(message& msg);
+  bool try_publish(std::vector<char>& buffer);
+
+  Error bind(URI endpoint);
+  Error serve_snapshots(URI snapshot_uri);
+
+  size_t queued() const;
+  uint64_t sent() const;
+  uint64_t dropped() const;
+  uint64_t batched() const;
+
   void set_response_callaback_func(CallbackFunc) final;
 
   void broadcast(BroadcastFunc) final;
   void async_broadcast(BroadcastFunc) final;
+  void broadcast(MessageFunc) final;
+  void async_broadcast(MessageFunc) final;
 
   void standup() final;
   void shutdown() final;
@@ -18,22 +18,80 @@ specific language governing permissions and limitations under the license.
 
 #include <sustain/framework/net/Patterns.h>
 #include <sustain/framework/net/Uri.h>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <string>
 
 namespace pfc {
+struct pfc_service_announcement;
+
+//!
+//! Delivery behavior of a PubSub_Subscriber
+//!
+struct Subscribe_Options {
+  bool conflate = false; //!< Deliver only the newest undelivered message of each topic. Requires topic framed messages (see Topic.h)
+  size_t dispatch_workers = 0; //!< Threads running the listener. 0 runs it on the thread which receives
+  size_t dispatch_capacity = 1024; //!< Messages each dispatch worker may have waiting. Rounded up to a power of two
+  bool dispatch_block = false; //!< Wait for a full dispatch worker to make room instead of dropping the message
+  std::function<size_t(const message&)> dispatch_key; //!< Hash choosing the worker of a message. Empty hashes the topic
+};
+
 //!
 //! This class creates a Subscriber to a Pub/Sub style service
 //! <a href="https://nanomsg.org/gettingstarted/nng/pubsub.html"> Documentation </a>
 //!
 //! Subscribers are normally passive consumers of Published information choosing to log
 //! All messages as they see fit but not sending anything to the Publisher after registering.
+//!
+//! Messages are filtered by prefix. A Subscriber constructed with the default empty topic
+//! receives everything, otherwise only messages begining with one of its subscribed topics.
+//!
+//! async_listen with a Reactor registers the socket with the Reactor instead of starting a thread,
+//! so a monitor subscribed to hundreds of publishers still runs on a handful of threads.
+//!
+//! A shm:// URI reads from the shared memory ring of a PubSub_Publisher on the same host (see Shm_Ring)
+//! instead of a nanomsg socket. Topics are then matched by the subscriber, and async_listen always
+//! starts a thread because there is no socket for a Reactor to poll.
+//!
+//! With Subscribe_Options::dispatch_workers the listener runs on a pool of dispatch workers instead of the
+//! receive thread, so expensive processing does not hold up the socket. Each message is queued to the worker
+//! its dispatch_key hashes to, by default its topic, so messages of a topic are delivered in order and one at
+//! a time while different topics are processed in parallel. A full worker queue drops the message, or with
+//! dispatch_block holds up the receive thread until there is room. Messages already queued are still
+//! delivered by shutdown.
+//!
+//! Topic batches from a batching PubSub_Publisher (see Publish_Options::batch_bytes) are unpacked and each
+//! message they carry is delivered on its own, in the order it was published.
+//!
+//! A conflating subscriber reads everything nanomsg has buffered before each delivery and keeps only the
+//! newest message per topic, so a slow listener sees current state instead of a backlog and nanomsg never
+//! has to drop messages for it. request_snapshot fetches the current values from a publisher with a last
+//! value cache, so a late joiner does not wait for the next publish of each topic.
+//!
+//! Constructed from a pfc_service_announcement the subscriber connects to the cheapest endpoint the
+//! service advertises, inproc:// in the same process and ipc:// on the same host (see Endpoint.h).
 
 class SUSTAIN_FRAMEWORK_API PubSub_Subscriber : public Listiner {
-  PubSub_Subscriber(URI);
+public:
+  PubSub_Subscriber(URI, std::string topic = "", Subscribe_Options = Subscribe_Options());
+  PubSub_Subscriber(const pfc_service_announcement&, std::string topic = "", Subscribe_Options = Subscribe_Options());
   ~PubSub_Subscriber() final;
 
+  Error subscribe(const std::string& topic);
+  Error unsubscribe(const std::string& topic);
+  Error request_snapshot(URI snapshot_uri, std::chrono::milliseconds timeout = std::chrono::milliseconds(1000));
+  uint64_t conflated() const;
+  size_t dispatch_queued() const;
+  size_t dispatch_high_water() const;
+  uint64_t dispatch_dropped() const;
+
   void listen(ListenFunc) final;
   void async_listen(ListenFunc) final;
+  void listen(MessageListenFunc) final;
+  void async_listen(MessageListenFunc) final;
+  void async_listen(Reactor&, MessageListenFunc) final;
 
   void standup() final;
   void shutdown() final;
@@ -0,0 +1,158 @@
+#ifndef SUSTAIN_FRAMEWORK_NET_PATTERNS_PUBSUB_TOPIC_H
+#define SUSTAIN_FRAMEWORK_NET_PATTERNS_PUBSUB_TOPIC_H
+
+/*! \file */
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <string>
+
+#include <sustain/framework/net/Message.h>
+
+namespace pfc {
+//!
+//! Topic framing of published messages
+//!
+//! A framed message is the topic, a single '\0' and then the payload. nanomsg subscriptions match
+//! raw leading bytes, so subscribing to a topic receives every topic it prefixes while subscribing to
+//! the topic followed by '\0' receives only that exact topic. The registry watch feed uses the same
+//! framing (see registry_topic).
+//!
+//! A batching PubSub_Publisher packs several messages of one topic in to a single topic batch: the
+//! topic, the separator, topic_batch_marker and then each payload preceded by its length. The batch
+//! starts with the topic, so nanomsg filters it like the messages it carries, and PubSub_Subscriber
+//! unpacks it before delivery. Payloads beginning with topic_batch_marker are therefore reserved.
+//!
+
+constexpr char topic_separator = '\0'; //!< Ends the topic of a framed message
+constexpr char topic_batch_marker[] = { '\0', 'P', 'F', 'B' }; //!< Starts the payload of a topic batch
+constexpr size_t topic_batch_length_size = 4; //!< Bytes of the big endian length before each payload of a topic batch
+
+//!
+//! Topic and payload of a framed message. Points in to the message, so only valid while it lives
+//!
+struct Topic_Frame {
+  const char* topic = nullptr;
+  size_t topic_size = 0;
+  const char* payload = nullptr;
+  size_t payload_size = 0;
+
+  std::string topic_string() const { return std::string(topic, topic_size); } //!< Copy of the topic
+};
+
+//-----------------------------------------------------------------------------
+//! Starts a framed message. Serialize the payload after the topic with message_ostream or append
+//! \param topic [IN] -- Topic subscribers filter on. Must not contain '\0'
+//! \param payload_capacity [IN] -- Bytes to reserve for the payload so it is serialized without reallocating
+//! \return message -- The topic and separator in nanomsg storage
+inline message topic_message(const std::string& topic, size_t payload_capacity = 0)
+{
+  message framed(topic.size() + 1 + payload_capacity);
+  framed.append(topic.data(), topic.size());
+  framed.append(&topic_separator, 1);
+  return framed;
+}
+//-----------------------------------------------------------------------------
+//! \param framed [IN] -- Message built with topic_message
+//! \param frame [OUT] -- Topic and payload of framed
+//! \return bool -- false when framed has no topic separator
+inline bool split_topic(const message& framed, Topic_Frame& frame)
+{
+  if (framed.empty()) {
+    return false;
+  }
+  auto separator = static_cast<const char*>(std::memchr(framed.data(), topic_separator, framed.size()));
+  if (!separator) {
+    return false;
+  }
+  frame.topic = framed.data();
+  frame.topic_size = static_cast<size_t>(separator - framed.data());
+  frame.payload = separator + 1;
+  frame.payload_size = framed.size() - frame.topic_size - 1;
+  return true;
+}
+//-----------------------------------------------------------------------------
+//! Starts a topic batch. Add payloads with append_topic_batch
+//! \param topic [IN] -- Topic of every message in the batch
+//! \param capacity [IN] -- Bytes to reserve for the whole batch
+//! \return message -- The topic, separator and batch marker in nanomsg storage
+inline message topic_batch(const std::string& topic, size_t capacity = 0)
+{
+  auto header = topic.size() + 1 + sizeof(topic_batch_marker);
+  auto batch = topic_message(topic, std::max(capacity, header) - topic.size() - 1);
+  batch.append(topic_batch_marker, sizeof(topic_batch_marker));
+  return batch;
+}
+//-----------------------------------------------------------------------------
+//! \param batch [IN,OUT] -- Message built with topic_batch
+//! \param payload [IN] -- Payload of one message, without its topic
+//! \param size [IN] -- Length of payload
+inline void append_topic_batch(message& batch, const char* payload, size_t size)
+{
+  char length[topic_batch_length_size] = { static_cast<char>(size >> 24), static_cast<char>(size >> 16),
+                                           static_cast<char>(size >> 8), static_cast<char>(size) };
+  batch.append(length, topic_batch_length_size);
+  batch.append(payload, size);
+}
+//-----------------------------------------------------------------------------
+//! \param frame [IN] -- Result of split_topic
+//! \return bool -- true when the framed message is a topic batch
+inline bool is_topic_batch(const Topic_Frame& frame)
+{
+  return frame.payload_size >= sizeof(topic_batch_marker)
+    && std::memcmp(frame.payload, topic_batch_marker, sizeof(topic_batch_marker)) == 0;
+}
+//-----------------------------------------------------------------------------
+//! Splits a topic batch back in to topic framed messages
+//! \param frame [IN] -- Result of split_topic on a topic batch
+//! \param each [IN] -- Called with each message of the batch in the order it was published
+//! \return bool -- false if the batch was truncated. Messages before the damage are still passed to each
+inline bool unpack_topic_batch(const Topic_Frame& frame, const std::function<void(message)>& each)
+{
+  auto position = reinterpret_cast<const unsigned char*>(frame.payload) + sizeof(topic_batch_marker);
+  auto remaining = frame.payload_size - sizeof(topic_batch_marker);
+  while (remaining) {
+    if (remaining < topic_batch_length_size) {
+      return false;
+    }
+    size_t length = (size_t(position[0]) << 24) | (size_t(position[1]) << 16) | (size_t(position[2]) << 8) | size_t(position[3]);
+    position += topic_batch_length_size;
+    remaining -= topic_batch_length_size;
+    if (length > remaining) {
+      return false;
+    }
+    message framed(frame.topic_size + 1 + length, message::Storage::pooled);
+    framed.append(frame.topic, frame.topic_size);
+    framed.append(&topic_separator, 1);
+    framed.append(reinterpret_cast<const char*>(position), length);
+    each(std::move(framed));
+    position += length;
+    remaining -= length;
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+//! \param topic [IN] -- Topic as passed to topic_message
+//! \return std::string -- Subscription which matches topic exactly rather than every topic it prefixes
+inline std::string exact_topic(const std::string& topic)
+{
+  auto filter = topic;
+  filter.push_back(topic_separator);
+  return filter;
+}
+} //namespace pfc
+
+#endif //SUSTAIN_FRAMEWORK_NET_PATTERNS_PUBSUB_TOPIC_H
@@ -0,0 +1,110 @@
+#ifndef SUSTAIN_FRAMEWORK_NET_PATTERNS_PUBSUB_TOPIC_DISPATCHER_H
+#define SUSTAIN_FRAMEWORK_NET_PATTERNS_PUBSUB_TOPIC_DISPATCHER_H
+
+/*! \file */
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <sustain/framework/net/Patterns.h>
+#include <sustain/framework/net/patterns/pub_sub/Subscriber.h>
+#include <sustain/framework/net/patterns/pub_sub/Topic.h>
+#include <sustain/framework/util/Error.h>
+
+namespace pfc {
+
+//!
+//! How a Topic_Dispatcher handler matches the topic of a message
+//!
+enum class Topic_Match {
+  prefix, //!< Every topic starting with the handler topic
+  exact //!< Only the handler topic itself
+};
+
+//!
+//! Routes topic framed messages from a PubSub_Subscriber to a handler per topic.
+//!
+//! Each handler adds a nanomsg subscription, so messages on other topics are dropped inside nanomsg and
+//! never wake the listener. The dispatcher owns the subscriptions of its subscriber: the catch all ""
+//! subscription made by the default constructor of PubSub_Subscriber is removed.
+//!
+//!   PubSub_Subscriber vitals(uri);
+//!   Topic_Dispatcher dispatcher(vitals);
+//!   dispatcher.on<Heart_Rate>("vitals/heart_rate", [](const Topic_Frame&, Heart_Rate& rate) { ... });
+//!   dispatcher.on<Blood_Pressure>("vitals/blood_pressure", [](const Topic_Frame&, Blood_Pressure& bp) { ... });
+//!   vitals.async_listen(reactor, dispatcher.listener());
+//!
+//! When several prefix handlers match, the longest one is called. Handlers may be added and removed
+//! while messages are being dispatched.
+//!
+class SUSTAIN_FRAMEWORK_API Topic_Dispatcher {
+public:
+  //! Called with the topic and payload of a message. The frame is only valid during the call
+  using FrameFunc = std::function<void(const Topic_Frame&)>;
+
+  explicit Topic_Dispatcher(PubSub_Subscriber& subscriber);
+  Topic_Dispatcher(const Topic_Dispatcher&) = delete;
+  Topic_Dispatcher& operator=(const Topic_Dispatcher&) = delete;
+  ~Topic_Dispatcher();
+
+  Error on_frame(const std::string& topic, FrameFunc handler, Topic_Match match = Topic_Match::exact);
+  template <typename Type, typename Handler>
+  Error on(const std::string& topic, Handler handler, Topic_Match match = Topic_Match::exact);
+  Error off(const std::string& topic, Topic_Match match = Topic_Match::exact);
+
+  void dispatch(const message& framed);
+  Listiner::MessageListenFunc listener();
+
+  uint64_t dispatched() const;
+  uint64_t unmatched() const;
+  uint64_t malformed() const;
+
+private:
+  void count_malformed();
+
+#pragma warning(push, 0)
+  //!
+  //!  @struct Topic_Dispatcher::Implementation
+  //!  Private PIMPL implementation of Topic_Dispatcher
+  //!
+  struct Implementation;
+  std::unique_ptr<Implementation> _impl;
+#pragma warning(pop)
+};
+//-----------------------------------------------------------------------------
+//! Registers a handler which receives the payload deserialized in to a Type
+//! \param topic [IN] -- Topic the publisher framed the message with
+//! \param handler [IN] -- void(const Topic_Frame&, Type&). Not called for payloads Type fails to deserialize
+//! \param match [IN] -- Exact topic or every topic topic prefixes
+//! \return Error -- As on_frame
+template <typename Type, typename Handler>
+Error Topic_Dispatcher::on(const std::string& topic, Handler handler, Topic_Match match)
+{
+  return on_frame(topic, [this, handler](const Topic_Frame& frame) {
+    Type value;
+    message_istream is(frame.payload, frame.payload_size);
+    if (value.deserialize(is).is_not_ok() || is.fail()) {
+      count_malformed();
+      return;
+    }
+    handler(frame, value);
+  },
+                  match);
+}
+} //namespace pfc
+
+#endif //SUSTAIN_FRAMEWORK_NET_PATTERNS_PUBSUB_TOPIC_DISPATCHER_H
@@ -18,21 +18,104 @@ specific language governing permissions and limitations under the license.
 
 #include <sustain/framework/net/Patterns.h>
 
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+
 #include <sustain/framework/net/Uri.h>
+#include <sustain/framework/util/Constants.h>
+#include <sustain/framework/util/Error.h>
 
 namespace pfc {
+struct pfc_service_announcement;
+
+//!
+//! How request chooses among the replicas of a service
+//!
+enum class Balance_Policy {
+  least_outstanding, //!< Replica with the fewest requests on the wire
+  ewma_latency //!< Replica with the lowest average reply time weighted by its requests on the wire
+};
+
+//!
+//! Tuning for the asynchronous requests of a ReqRep_Client
+//!
+struct Client_Options {
+  size_t sockets = 4; //!< REQ sockets used by request per replica. Each carries one request at a time, so this is the most requests in flight to a replica
+  size_t max_pending = 1024; //!< Requests waiting for a free socket before request fails with PFC_QUEUE_FULL. Rounded up to a power of two
+  std::chrono::milliseconds timeout = std::chrono::milliseconds(0); //!< Default time allowed for a reply. 0 waits forever
+  std::chrono::milliseconds resend_interval = std::chrono::milliseconds(0); //!< NN_REQ_RESEND_IVL of the sockets. 0 keeps the nanomsg default of one minute
+  Balance_Policy balance = Balance_Policy::least_outstanding; //!< How request picks a replica
+  double hedge_percentile = 0; //!< Reply time percentile, such as 0.95, after which a request is also sent to a second replica. 0 never hedges
+  std::chrono::microseconds hedge_min_delay = std::chrono::microseconds(1000); //!< Shortest wait before hedging, also used until enough replies have been timed
+  double hedge_budget = 0.05; //!< Most hedges as a fraction of requests, so a struggling service is not sent twice the load
+};
+
+//!
+//! Registry change feed a ReqRep_Client follows to find the replicas of a service
+//!
+struct Replica_Discovery {
+  std::string service; //!< Name the replicas register under
+  URI watch = URI("tcp", "127.0.0.1", g_pfc_registry_watch_port); //!< PubSub change feed of the registry
+  URI snapshot = URI("tcp", "127.0.0.1", g_pfc_registry_snapshot_port); //!< ReqRep snapshot server of the registry
+};
+
+//!
+//! Outcome of an asynchronous request
+//!
+struct Client_Reply {
+  uint64_t id = 0; //!< Value request returned for the call
+  Error ec; //!< PFC_TIMEOUT, PFC_QUEUE_FULL, PFC_LIBRARY_SHUTDOWN or a nanomsg error. Success() when body holds the reply
+  message body;
+};
+
 //!
 //!  Request / Reply client used to connect to Request / Reply Servers
 //!
+//!  broadcast and async_broadcast keep one request in flight at a time. request is asynchronous:
+//!  calls are queued and a dispatch thread spreads them over a pool of REQ sockets, so up to
+//!  Client_Options::sockets requests are on the wire at once and the request rate is no longer
+//!  bound to one round trip. Each socket matches its reply to its request and resends after
+//!  resend_interval, so a reply is never handed to the wrong call.
+//!
+//!  Constructed from a pfc_service_announcement the client connects to the cheapest endpoint the
+//!  service advertises, inproc:// in the same process and ipc:// on the same host (see Endpoint.h).
+//!
+//!  A client may send to several replicas of a service. add_replica and remove_replica change them at
+//!  any time, and a client constructed from a Replica_Discovery follows the registry change feed so
+//!  replicas are added as they register and removed as they sign off. Each replica gets its own pool
+//!  of sockets and request sends each call to the replica Client_Options::balance prefers. Requests
+//!  queue while there are no replicas. With Client_Options::hedge_percentile a request still waiting
+//!  after that percentile of recent reply times is sent to a second replica as well and the first
+//!  reply wins, which trims the tail left by a slow or stalled replica.
+//!
 class SUSTAIN_FRAMEWORK_API ReqRep_Client : public Broadcaster {
 public:
-  ReqRep_Client(URI);
+  //! Called on the dispatch thread when a request completes. Must not block
+  using ReplyFunc = std::function<void(Client_Reply)>;
+
+  ReqRep_Client(URI, Client_Options = Client_Options());
+  ReqRep_Client(const pfc_service_announcement&, Client_Options = Client_Options());
+  ReqRep_Client(Replica_Discovery, Client_Options = Client_Options());
   ~ReqRep_Client() final;
 
+  uint64_t request(message, ReplyFunc, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+  std::future<Client_Reply> request(message, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+  size_t in_flight() const;
+
+  Error add_replica(URI);
+  Error remove_replica(const URI&);
+  size_t replicas() const;
+  uint64_t hedged() const;
+
   void set_response_callaback_func(CallbackFunc) final;
 
   void broadcast(BroadcastFunc) final;
   void async_broadcast(BroadcastFunc) final;
+  void broadcast(MessageFunc) final;
+  void async_broadcast(MessageFunc) final;
 
   void standup() final;
   void shutdown() final;
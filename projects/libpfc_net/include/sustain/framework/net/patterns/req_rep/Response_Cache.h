@@ -0,0 +1,86 @@
+#ifndef SUSTAIN_FRAMEWORK_NET_PATTERNS_REQREP_RESPONSE_CACHE_H
+#define SUSTAIN_FRAMEWORK_NET_PATTERNS_REQREP_RESPONSE_CACHE_H
+
+/*! \file */
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include <sustain/framework/Exports.h>
+#include <sustain/framework/net/Message.h>
+
+namespace pfc {
+
+//!
+//! Size and lifetime of the entries of a Response_Cache
+//!
+struct Response_Cache_Options {
+  size_t shards = 16; //!< Independently locked LRU lists. Requests are spread over them by hash
+  size_t max_bytes = 16 * 1024 * 1024; //!< Request and response bytes kept over all shards. The least recently used entries are evicted beyond it
+  std::chrono::milliseconds ttl = std::chrono::milliseconds(0); //!< Age after which an entry is no longer used. 0 keeps entries until evicted or invalidated
+};
+
+//!
+//! Replies of a ReqRep_Server keyed by the exact bytes of the request.
+//!
+//! Only idempotent requests, whose reply depends on nothing but the request, may be cached. A server
+//! with Server_Options::cache answers a request found here on its receive thread without calling its
+//! ListenFunc and caches the replies it computes. The application calls invalidate, invalidate_if or
+//! clear when the state behind the replies changes; a reply computed while an invalidation ran is not
+//! stored, as it may already be stale (see generation).
+//!
+//! Entries are spread over shards by a hash of the request so threads looking up different requests
+//! rarely contend. Each shard evicts its least recently used entries to stay within its share of
+//! max_bytes. All members are safe to call from any thread.
+//!
+class SUSTAIN_FRAMEWORK_API Response_Cache {
+public:
+  //! Tests the bytes of a cached request
+  using RequestPredicate = std::function<bool(const char* request, size_t size)>;
+
+  Response_Cache(Response_Cache_Options = Response_Cache_Options());
+  Response_Cache(const Response_Cache&) = delete;
+  Response_Cache& operator=(const Response_Cache&) = delete;
+  ~Response_Cache();
+
+  bool lookup(const message& request, message& response);
+  bool store(const message& request, const message& response, uint64_t generation);
+  uint64_t generation() const;
+
+  bool invalidate(const message& request);
+  size_t invalidate_if(RequestPredicate);
+  void clear();
+
+  size_t size() const;
+  size_t bytes() const;
+  uint64_t hits() const;
+  uint64_t misses() const;
+  uint64_t evictions() const;
+
+private:
+#pragma warning(push, 0)
+  //!
+  //!  @struct Response_Cache::Implementation
+  //!  Private PIMPL implementation of Response_Cache
+  //!
+  struct Implementation;
+  std::unique_ptr<Implementation> _impl;
+#pragma warning(pop)
+};
+} //namespace pfc
+
+#endif //SUSTAIN_FRAMEWORK_NET_PATTERNS_REQREP_RESPONSE_CACHE_H
@@ -18,13 +18,29 @@ specific language governing permissions and limitations under the license.
 
 #include <sustain/framework/net/Patterns.h>
 
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <cstdint>
 #include <string>
 
 #include <sustain/framework/net/Uri.h>
+#include <sustain/framework/net/patterns/req_rep/Response_Cache.h>
+#include <sustain/framework/util/Error.h>
 
 namespace pfc {
+
+//!
+//! Concurrency of a ReqRep_Server
+//!
+struct Server_Options {
+  size_t workers = 0; //!< Threads running the ListenFunc. 0 keeps a single threaded server on a normal REP socket
+  size_t queue_depth = 256; //!< Requests waiting for a worker before new requests are shed. Rounded up to a power of two
+  std::chrono::milliseconds deadline = std::chrono::milliseconds(0); //!< Requests which waited longer than this for a worker are dropped unanswered. 0 never drops
+  std::shared_ptr<Response_Cache> cache; //!< Answers repeated requests on the receive thread without calling the ListenFunc. Empty disables caching
+  std::function<bool(const message& request, const message& response)> cacheable; //!< Whether a computed reply may be cached. Empty caches every non empty reply
+};
+
 //!
 //! This class creates a Server to a Req/Rep style service
 //! <a href="https://nanomsg.org/gettingstarted/nng/reqrep.htmll"> Documentation </a>
@@ -32,15 +48,39 @@ namespace pfc {
 //! Servers are traditional TCP/IP http response based implementations. 
 //! They can receive multiple messages from multiple clients and will dispatch appropriate
 //! responses in the order they are processed. Timeouts can occur if the server is to busy
+//!
+//! With Server_Options::workers set the server reads an AF_SP_RAW REP socket on one thread and
+//! hands each request, with its nanomsg routing header, to a pool of workers. Replies are sent
+//! as each worker finishes, so a slow request no longer blocks other clients. The ListenFunc
+//! must then be safe to call from several threads at once. Shed and expired requests get no
+//! reply; the REQ socket of the client resends them after its NN_REQ_RESEND_IVL.
+//!
+//! With Server_Options::cache a request whose bytes match a cached one is answered with the cached
+//! reply on the thread which read it, before it would be queued for a worker, and the ListenFunc is
+//! not called. Only servers whose replies depend on nothing but the request should share a cache;
+//! Server_Options::cacheable can exclude the rest, and the application invalidates the cache when
+//! the state behind the replies changes (see Response_Cache).
+//!
+//! bind adds endpoints to the same socket, so a service can offer the inproc:// and ipc:// endpoints of
+//! local_endpoints (see Endpoint.h) alongside its tcp address.
 
 class SUSTAIN_FRAMEWORK_API ReqRep_Server : public Listiner {
 public:
 
-  ReqRep_Server(URI);
+  ReqRep_Server(URI, Server_Options = Server_Options());
   ~ReqRep_Server() final;
 
   void listen(ListenFunc) final;
   void async_listen(ListenFunc) final;
+  void listen(MessageListenFunc) final;
+  void async_listen(MessageListenFunc) final;
+  void async_listen(Reactor&, MessageListenFunc) final;
+
+  Error bind(URI endpoint);
+
+  uint64_t served() const;
+  uint64_t shed() const;
+  uint64_t expired() const;
 
   void standup() final;
   void shutdown() final;
@@ -18,11 +18,23 @@ specific language governing permissions and limitations under the license.
 
 #include <sustain/framework/net/Patterns.h>
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 
 #include <sustain/framework/net/Uri.h>
 
 namespace pfc {
+
+//!
+//! Concurrency of a Survey_Participant
+//!
+struct Participant_Options {
+  size_t workers = 0; //!< Threads running the ListenFunc. 0 keeps a single threaded participant on a normal RESPONDENT socket
+  size_t max_in_flight = 64; //!< Surveys waiting for or held by a worker before new surveys are shed. Rounded up to a power of two
+  std::chrono::milliseconds deadline = std::chrono::milliseconds(0); //!< Survey_Options::deadline of the surveyors. Surveys older than this are dropped unanswered. 0 answers every survey
+};
+
 //!
 //! This class creates a responder to a Survey style service
 //! <a href="https://nanomsg.org/gettingstarted/nng/survey.html"> Documentation </a>
@@ -30,14 +42,29 @@ namespace pfc {
 //! A Participant is free to respond to any Survey request and the sub ttotal of responses
 //! before a timeout will be used to determine the correct behavior on the Survetor
 //! This is usually a multicast style protocol
+//!
+//! With Participant_Options::workers set the participant reads an AF_SP_RAW RESPONDENT socket on one
+//! thread and hands each survey, with the nanomsg header carrying its survey id, to a pool of workers.
+//! Surveys are answered concurrently and each response goes back with the header of its own survey,
+//! so a heavy tick no longer makes the participant miss the surveys behind it. A survey the surveyor
+//! will have given up on by Participant_Options::deadline is dropped before the ListenFunc runs, and
+//! a response finished after it is not sent. The ListenFunc must then be safe to call from several
+//! threads at once.
 
 class SUSTAIN_FRAMEWORK_API Survey_Participant : public Listiner {
-
-  Survey_Participant(URI);
+public:
+  Survey_Participant(URI, Participant_Options = Participant_Options());
   ~Survey_Participant() final;
 
   void listen(ListenFunc) final;
   void async_listen(ListenFunc) final;
+  void listen(MessageListenFunc) final;
+  void async_listen(MessageListenFunc) final;
+  void async_listen(Reactor&, MessageListenFunc) final;
+
+  uint64_t answered() const;
+  uint64_t shed() const;
+  uint64_t expired() const;
 
   void standup() final;
   void shutdown() final;
@@ -18,23 +18,76 @@ specific language governing permissions and limitations under the license.
 
 #include <sustain/framework/net/Patterns.h>
 
+#include <chrono>
+#include <memory>
+#include <utility>
+
 #include <sustain/framework/net/Uri.h>
+#include <sustain/framework/util/Error.h>
 namespace pfc {
+
+//!
+//! Limits of a single survey
+//!
+struct Survey_Options {
+  std::chrono::milliseconds deadline = std::chrono::milliseconds(1000); //!< NN_SURVEYOR_DEADLINE. Responses after this are ignored
+  size_t quorum = 0; //!< Responses after which the survey completes without waiting for the deadline. 0 always waits for the deadline
+};
+
+//!
+//! Outcome of a survey
+//!
+struct Survey_Tally {
+  size_t responses = 0; //!< Responses received before the survey completed
+  bool quorum_met = false; //!< True when the survey completed early because quorum responses arrived
+  Error ec; //!< PFC_TIMEOUT when a quorum was requested but not met, a nanomsg error if the survey failed, else Success()
+};
+
+//!
+//! Outcome of a survey whose responses were reduced to a single value
+//!
+template <typename Result>
+struct Survey_Result : Survey_Tally {
+  Result value; //!< The initial value folded with every response
+};
+
 //!
 //! This class creates a Surveyor to a Survey style service
 //! <a href="https://nanomsg.org/gettingstarted/nng/survey.html"> Documentation </a>
 //!
 //! Surveyors broadcast questions to all particpants and gather the responses before continuing
-
-
+//!
+//! survey sends one question and returns as soon as Survey_Options::quorum responses arrive or the
+//! deadline passes, so a poll of a known number of participants costs one round trip to the
+//! slowest of them instead of the whole deadline. The reducing overload folds the responses in to
+//! a single value:
+//!
+//!   Survey_Options options;
+//!   options.quorum = simulators;
+//!   auto at_tick = surveyor.survey(question, options, true,
+//!     [tick](bool all, const message& response) { return all && parse_tick(response) >= tick; });
+//!   if (at_tick.quorum_met && at_tick.value) { ... }
+//!
+//! survey may be called while async_broadcast runs. Each waits for the survey the other has
+//! active on the socket, as a new survey would cancel it and read its responses.
+//!
 class SUSTAIN_FRAMEWORK_API Survey_Surveyor : public Broadcaster {
+public:
+  //! Called on the surveying thread for each response
+  using ResponseFunc = std::function<void(message)>;
 
   Survey_Surveyor(URI);
   ~Survey_Surveyor() final;
 
+  Survey_Tally survey(message question, const Survey_Options& options, ResponseFunc on_response);
+  template <typename Result, typename Reducer>
+  Survey_Result<Result> survey(message question, const Survey_Options& options, Result initial, Reducer reduce);
+
   void set_response_callaback_func(CallbackFunc) final;
   void broadcast(BroadcastFunc) final;
   void async_broadcast(BroadcastFunc) final;
+  void broadcast(MessageFunc) final;
+  void async_broadcast(MessageFunc) final;
 
   void standup() final;
   void shutdown() final;
@@ -45,6 +98,23 @@ class SUSTAIN_FRAMEWORK_API Survey_Surveyor : public Broadcaster {
   std::unique_ptr<Implementation> _impl;
 #pragma warning(pop)
 };
+//-----------------------------------------------------------------------------
+//! Surveys the participants and folds their responses in to one value
+//! \param question [IN] -- Serialized survey
+//! \param options [IN] -- Deadline and quorum
+//! \param initial [IN] -- Value the responses are folded in to
+//! \param reduce [IN] -- Result(Result, const message&) applied to each response in arrival order
+//! \return Survey_Result<Result> -- The folded value and how the survey completed
+template <typename Result, typename Reducer>
+Survey_Result<Result> Survey_Surveyor::survey(message question, const Survey_Options& options, Result initial, Reducer reduce)
+{
+  Survey_Result<Result> result;
+  result.value = std::move(initial);
+  static_cast<Survey_Tally&>(result) = survey(std::move(question), options, [&result, &reduce](message response) {
+    result.value = reduce(std::move(result.value), response);
+  });
+  return result;
+}
 } //namespace pfc
 
 #endif //SUSTAIN_FRAMEWORK_NET_PATTERNS_SURVEY_SURVEYOR_H
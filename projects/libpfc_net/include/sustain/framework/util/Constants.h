@@ -27,6 +27,9 @@ namespace pfc {
 //! Networking Constants
 constexpr short g_pfc_registry_reg_port = 30001;        //!< PFC Registry Port Constant
 constexpr short g_pfc_registry_announce_port = 30002;   //!< PFC Service Announcment Port Constant
+constexpr short g_pfc_registry_sync_port = 30003;       //!< PFC Registry replication Port Constant
+constexpr short g_pfc_registry_watch_port = 30004;      //!< PFC Registry change feed Port Constant
+constexpr short g_pfc_registry_snapshot_port = 30005;   //!< PFC Registry change feed snapshot Port Constant
 };
 
 #endif //SUSTAIN_PFCNW_CONSTANTS_H
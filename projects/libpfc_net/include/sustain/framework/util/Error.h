@@ -50,7 +50,8 @@ public:
     PFC_BAD_OPERATION = 1 << 10,
     PFC_INTERUPT = 1 << 11,
     PFC_TIMEOUT = 1 << 12,
-    PFC_ADDRESS_NOT_AVAILABLE = 1 << 13
+    PFC_ADDRESS_NOT_AVAILABLE = 1 << 13,
+    PFC_QUEUE_FULL = 1 << 14
   };
 
   Error();
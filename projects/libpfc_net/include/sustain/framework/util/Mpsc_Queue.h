@@ -0,0 +1,188 @@
+#ifndef SUSTAIN_PFCNW_MPSC_QUEUE_H
+#define SUSTAIN_PFCNW_MPSC_QUEUE_H
+
+/*! \file */
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+//!
+//! \brief Bounded lock free multiple producer, multiple consumer ring buffer
+//!        Used to hand work from any number of application threads to IO threads and worker pools
+//!
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace pfc {
+
+//!
+//!  Bounded ring buffer which any number of threads may push to. Every slot carries a sequence
+//!  number which tells a thread whether the slot is ready to be written or read, so producers only
+//!  contend on a single compare and swap of the tail and never on each others data.
+//!
+//!  Despite the name, try_pop is safe to call from any number of threads at once: consumers claim
+//!  the head with a compare and swap just as producers claim the tail. Worker pools, such as
+//!  that of ReqRep_Server, pop one queue from several threads, and producers evict the oldest element when
+//!  they find the queue full, so the queue must stay multiple consumer. Do not replace it with a
+//!  single consumer design.
+//!
+template <typename T>
+class Mpsc_Queue {
+public:
+  explicit Mpsc_Queue(size_t capacity);
+  Mpsc_Queue(const Mpsc_Queue&) = delete;
+  Mpsc_Queue& operator=(const Mpsc_Queue&) = delete;
+
+  bool try_push(const T& value);
+  bool try_push(T&& value);
+  bool try_pop(T& value);
+
+  bool empty() const;
+  size_t size() const;
+  size_t capacity() const;
+
+private:
+  static constexpr size_t cache_line = 64;
+  static size_t round_up(size_t);
+
+  template <typename U>
+  bool emplace(U&& value);
+
+  struct Slot {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  std::vector<Slot> _ring;
+  size_t _mask;
+
+  alignas(cache_line) std::atomic<size_t> _head; //!< Next slot to be read
+  alignas(cache_line) std::atomic<size_t> _tail; //!< Next slot to be claimed by a producer
+};
+//-----------------------------------------------------------------------------
+//! \param capacity [IN] -- Minimum number of elements the queue can hold
+template <typename T>
+Mpsc_Queue<T>::Mpsc_Queue(size_t capacity)
+  : _ring(round_up(capacity))
+  , _mask(_ring.size() - 1)
+  , _head(0)
+  , _tail(0)
+{
+  for (size_t index = 0; index < _ring.size(); ++index) {
+    _ring[index].sequence.store(index, std::memory_order_relaxed);
+  }
+}
+//-----------------------------------------------------------------------------
+template <typename T>
+size_t Mpsc_Queue<T>::round_up(size_t capacity)
+{
+  size_t result = 2;
+  while (result < capacity) {
+    result <<= 1;
+  }
+  return result;
+}
+//-----------------------------------------------------------------------------
+//! Safe from any thread
+//! \return bool -- false if the queue was full and value was not added
+template <typename T>
+bool Mpsc_Queue<T>::try_push(const T& value)
+{
+  return emplace(value);
+}
+//-----------------------------------------------------------------------------
+//! Safe from any thread
+//! \return bool -- false if the queue was full. value is left untouched when the push fails
+template <typename T>
+bool Mpsc_Queue<T>::try_push(T&& value)
+{
+  return emplace(std::move(value));
+}
+//-----------------------------------------------------------------------------
+//! A slot whose sequence equals the tail is free. Claim it, fill it, then publish it by
+//! advancing its sequence so the consumer sees a fully written value.
+template <typename T>
+template <typename U>
+bool Mpsc_Queue<T>::emplace(U&& value)
+{
+  auto tail = _tail.load(std::memory_order_relaxed);
+  for (;;) {
+    auto& slot = _ring[tail & _mask];
+    auto sequence = slot.sequence.load(std::memory_order_acquire);
+    auto lag = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(tail);
+    if (lag == 0) {
+      if (_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+        slot.value = std::forward<U>(value);
+        slot.sequence.store(tail + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (lag < 0) {
+      return false;
+    } else {
+      tail = _tail.load(std::memory_order_relaxed);
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+//! \param value [OUT] -- Receives the oldest element when one is available
+//! \return bool -- false if the queue was empty
+template <typename T>
+bool Mpsc_Queue<T>::try_pop(T& value)
+{
+  auto head = _head.load(std::memory_order_relaxed);
+  for (;;) {
+    auto& slot = _ring[head & _mask];
+    auto sequence = slot.sequence.load(std::memory_order_acquire);
+    auto lag = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(head + 1);
+    if (lag == 0) {
+      if (_head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed)) {
+        value = std::move(slot.value);
+        slot.sequence.store(head + _mask + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (lag < 0) {
+      return false;
+    } else {
+      head = _head.load(std::memory_order_relaxed);
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+//! \return bool -- true when no elements are waiting. Approximate while producers are active
+template <typename T>
+bool Mpsc_Queue<T>::empty() const
+{
+  return size() == 0;
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Approximate number of queued elements. Includes slots claimed but not yet written
+template <typename T>
+size_t Mpsc_Queue<T>::size() const
+{
+  auto head = _head.load(std::memory_order_acquire);
+  auto tail = _tail.load(std::memory_order_acquire);
+  return (tail > head) ? tail - head : 0;
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Maximum number of elements the queue can hold
+template <typename T>
+size_t Mpsc_Queue<T>::capacity() const
+{
+  return _ring.size();
+}
+} //namespace pfc
+
+#endif //SUSTAIN_PFCNW_MPSC_QUEUE_H
@@ -0,0 +1,181 @@
+#ifndef SUSTAIN_PFCNW_SPSC_QUEUE_H
+#define SUSTAIN_PFCNW_SPSC_QUEUE_H
+
+/*! \file */
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+//!
+//! \brief Bounded lock free single producer single consumer ring buffer
+//!        Used to connect the stages of a threaded pipeline
+//!
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace pfc {
+
+//!
+//!  Bounded ring buffer which is safe for exactly one producer thread and one consumer thread.
+//!  Capacity is rounded up to a power of two. Neither side ever blocks, try_push fails when the
+//!  ring is full and try_pop fails when it is empty so the caller decides how to back off.
+//!
+//!  head and tail live on seperate cache lines and each side caches the others index so
+//!  the shared atomics are only read when the cached copy says the ring is full or empty.
+//!
+template <typename T>
+class Spsc_Queue {
+public:
+  explicit Spsc_Queue(size_t capacity);
+  Spsc_Queue(const Spsc_Queue&) = delete;
+  Spsc_Queue& operator=(const Spsc_Queue&) = delete;
+
+  bool try_push(const T& value);
+  bool try_push(T&& value);
+  bool try_pop(T& value);
+
+  bool empty() const;
+  size_t size() const;
+  size_t capacity() const;
+  size_t high_water() const;
+
+private:
+  static constexpr size_t cache_line = 64;
+  static size_t round_up(size_t);
+
+  template <typename U>
+  bool emplace(U&& value);
+
+  std::vector<T> _ring;
+  size_t _mask;
+
+  alignas(cache_line) std::atomic<size_t> _head; //!< Next slot to be read. Written by the consumer
+  size_t _cached_tail; //!< Consumer copy of _tail
+
+  alignas(cache_line) std::atomic<size_t> _tail; //!< Next slot to be written. Written by the producer
+  size_t _cached_head; //!< Producer copy of _head
+  std::atomic<size_t> _high_water; //!< Deepest the queue has been since construction. Producer view so it may overestimate slightly
+};
+//-----------------------------------------------------------------------------
+//! \param capacity [IN] -- Minimum number of elements the queue can hold
+template <typename T>
+Spsc_Queue<T>::Spsc_Queue(size_t capacity)
+  : _ring(round_up(capacity))
+  , _mask(_ring.size() - 1)
+  , _head(0)
+  , _cached_tail(0)
+  , _tail(0)
+  , _cached_head(0)
+  , _high_water(0)
+{
+}
+//-----------------------------------------------------------------------------
+template <typename T>
+size_t Spsc_Queue<T>::round_up(size_t capacity)
+{
+  size_t result = 2;
+  while (result < capacity) {
+    result <<= 1;
+  }
+  return result;
+}
+//-----------------------------------------------------------------------------
+//! Producer only
+//! \return bool -- false if the queue was full and value was not added
+template <typename T>
+bool Spsc_Queue<T>::try_push(const T& value)
+{
+  return emplace(value);
+}
+//-----------------------------------------------------------------------------
+//! Producer only
+//! \return bool -- false if the queue was full. value is left untouched when the push fails
+template <typename T>
+bool Spsc_Queue<T>::try_push(T&& value)
+{
+  return emplace(std::move(value));
+}
+//-----------------------------------------------------------------------------
+template <typename T>
+template <typename U>
+bool Spsc_Queue<T>::emplace(U&& value)
+{
+  auto tail = _tail.load(std::memory_order_relaxed);
+  if (tail - _cached_head > _mask) {
+    _cached_head = _head.load(std::memory_order_acquire);
+    if (tail - _cached_head > _mask) {
+      return false;
+    }
+  }
+  _ring[tail & _mask] = std::forward<U>(value);
+  _tail.store(tail + 1, std::memory_order_release);
+
+  auto depth = tail + 1 - _cached_head;
+  if (depth > _high_water.load(std::memory_order_relaxed)) {
+    _high_water.store(depth, std::memory_order_relaxed);
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+//! Consumer only
+//! \param value [OUT] -- Receives the oldest element when one is available
+//! \return bool -- false if the queue was empty
+template <typename T>
+bool Spsc_Queue<T>::try_pop(T& value)
+{
+  auto head = _head.load(std::memory_order_relaxed);
+  if (head == _cached_tail) {
+    _cached_tail = _tail.load(std::memory_order_acquire);
+    if (head == _cached_tail) {
+      return false;
+    }
+  }
+  value = std::move(_ring[head & _mask]);
+  _head.store(head + 1, std::memory_order_release);
+  return true;
+}
+//-----------------------------------------------------------------------------
+//! \return bool -- true when no elements are waiting. Exact only when called from the consumer
+template <typename T>
+bool Spsc_Queue<T>::empty() const
+{
+  return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Approximate number of queued elements. Safe from any thread
+template <typename T>
+size_t Spsc_Queue<T>::size() const
+{
+  auto head = _head.load(std::memory_order_acquire);
+  auto tail = _tail.load(std::memory_order_acquire);
+  return (tail > head) ? tail - head : 0;
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Maximum number of elements the queue can hold
+template <typename T>
+size_t Spsc_Queue<T>::capacity() const
+{
+  return _ring.size();
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Deepest the queue has been. Useful for sizing and finding the slow stage of a pipeline
+template <typename T>
+size_t Spsc_Queue<T>::high_water() const
+{
+  return _high_water.load(std::memory_order_relaxed);
+}
+} //namespace pfc
+
+#endif //SUSTAIN_PFCNW_SPSC_QUEUE_H
@@ -0,0 +1,35 @@
+#ifndef SUSTAIN_PFCNW_THREAD_AFFINITY_H
+#define SUSTAIN_PFCNW_THREAD_AFFINITY_H
+
+/*! \file */
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+//!
+//! \brief Helpers for pinning pipeline threads to a single cpu
+//!
+
+#include <thread>
+
+#include <sustain/framework/Exports.h>
+#include <sustain/framework/util/Error.h>
+
+namespace pfc {
+
+constexpr int g_pfc_any_cpu = -1; //!< Cpu index meaning the scheduler may place the thread anywhere
+
+SUSTAIN_FRAMEWORK_API Error set_thread_affinity(std::thread& thread, int cpu);
+SUSTAIN_FRAMEWORK_API Error set_thread_affinity(int cpu);
+} //namespace pfc
+
+#endif //SUSTAIN_PFCNW_THREAD_AFFINITY_H
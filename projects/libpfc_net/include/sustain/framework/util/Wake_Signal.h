@@ -0,0 +1,111 @@
+#ifndef SUSTAIN_PFCNW_WAKE_SIGNAL_H
+#define SUSTAIN_PFCNW_WAKE_SIGNAL_H
+
+/*! \file */
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+//!
+//! \brief Wake up for threads consuming from the lock free queues
+//!
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace pfc {
+
+//!
+//!  Waiters spin briefly while their condition is false and then park on a condition variable.
+//!  Notifiers only pay for a lock and notify when a waiter is actually parked, so a busy queue
+//!  costs one fence per push. A parked waiter also wakes after park_timeout to recheck its
+//!  condition, which bounds the damage of a condition that changed without a notify.
+//!
+class Wake_Signal {
+public:
+  explicit Wake_Signal(int spin_count = 64, std::chrono::milliseconds park_timeout = std::chrono::milliseconds(100));
+  Wake_Signal(const Wake_Signal&) = delete;
+  Wake_Signal& operator=(const Wake_Signal&) = delete;
+
+  void notify();
+  template <typename Predicate>
+  void wait(Predicate ready);
+  template <typename Predicate>
+  void wait_until(Predicate ready, std::chrono::steady_clock::time_point deadline);
+
+private:
+  int _spin_count;
+  std::chrono::milliseconds _park_timeout;
+  std::mutex _mutex;
+  std::condition_variable _condition;
+  std::atomic<int> _parked; //!< Number of parked waiters
+};
+//-----------------------------------------------------------------------------
+//! \param spin_count [IN] -- Times a waiter yields before parking
+//! \param park_timeout [IN] -- Upper bound on how long a parked waiter sleeps
+inline Wake_Signal::Wake_Signal(int spin_count, std::chrono::milliseconds park_timeout)
+  : _spin_count(spin_count)
+  , _park_timeout(park_timeout)
+  , _parked(0)
+{
+}
+//-----------------------------------------------------------------------------
+//! Called after making a waiters condition true. Wakes every parked waiter
+inline void Wake_Signal::notify()
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (_parked.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> guard(_mutex);
+    _condition.notify_all();
+  }
+}
+//-----------------------------------------------------------------------------
+//! Returns once ready() is true or park_timeout expires. Callers must recheck their condition
+template <typename Predicate>
+void Wake_Signal::wait(Predicate ready)
+{
+  for (int spin = 0; spin < _spin_count; ++spin) {
+    if (ready()) {
+      return;
+    }
+    std::this_thread::yield();
+  }
+  std::unique_lock<std::mutex> lock(_mutex);
+  _parked.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  _condition.wait_for(lock, _park_timeout, ready);
+  _parked.fetch_sub(1, std::memory_order_relaxed);
+}
+//-----------------------------------------------------------------------------
+//! As wait, but also returns at deadline. Used by waiters which have work of their own due then
+template <typename Predicate>
+void Wake_Signal::wait_until(Predicate ready, std::chrono::steady_clock::time_point deadline)
+{
+  for (int spin = 0; spin < _spin_count; ++spin) {
+    if (ready() || std::chrono::steady_clock::now() >= deadline) {
+      return;
+    }
+    std::this_thread::yield();
+  }
+  std::unique_lock<std::mutex> lock(_mutex);
+  _parked.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  _condition.wait_until(lock, std::min<std::chrono::steady_clock::time_point>(deadline, std::chrono::steady_clock::now() + _park_timeout), ready);
+  _parked.fetch_sub(1, std::memory_order_relaxed);
+}
+} //namespace pfc
+
+#endif //SUSTAIN_PFCNW_WAKE_SIGNAL_H
@@ -0,0 +1,172 @@
+#ifndef SUSTAIN_PFCNW_WORK_STEALING_DEQUE_H
+#define SUSTAIN_PFCNW_WORK_STEALING_DEQUE_H
+
+/*! \file */
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+//!
+//! \brief Bounded lock free work stealing deque (Chase-Lev)
+//!        Each worker owns one and idle workers steal from the others
+//!
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+namespace pfc {
+
+//!
+//!  Deque owned by one worker thread. The owner pushes and pops at the bottom, so it works on what
+//!  it queued most recently while that is still in cache. Any other thread may steal from the top,
+//!  taking the oldest work. Owner operations only contend with thieves for the last element.
+//!
+//!  Capacity is rounded up to a power of two and try_push fails when the deque is full. A thief
+//!  reads its element before claiming it, so T is restricted to trivially copyable types; queue
+//!  pointers to larger work items.
+//!
+template <typename T>
+class Work_Stealing_Deque {
+  static_assert(std::is_trivially_copyable<T>::value, "Work_Stealing_Deque holds trivially copyable values, queue pointers to larger items");
+
+public:
+  explicit Work_Stealing_Deque(size_t capacity);
+  Work_Stealing_Deque(const Work_Stealing_Deque&) = delete;
+  Work_Stealing_Deque& operator=(const Work_Stealing_Deque&) = delete;
+
+  bool try_push(T value);
+  bool try_pop(T& value);
+  bool try_steal(T& value);
+
+  bool empty() const;
+  size_t size() const;
+  size_t capacity() const;
+
+private:
+  static constexpr size_t cache_line = 64;
+  static size_t round_up(size_t);
+
+  std::unique_ptr<std::atomic<T>[]> _ring;
+  size_t _mask;
+
+  alignas(cache_line) std::atomic<int64_t> _top; //!< Oldest element. Advanced by thieves and by the owner taking the last element
+  alignas(cache_line) std::atomic<int64_t> _bottom; //!< Next slot to be written. Written by the owner
+};
+//-----------------------------------------------------------------------------
+//! \param capacity [IN] -- Minimum number of elements the deque can hold
+template <typename T>
+Work_Stealing_Deque<T>::Work_Stealing_Deque(size_t capacity)
+  : _ring(new std::atomic<T>[round_up(capacity)])
+  , _mask(round_up(capacity) - 1)
+  , _top(0)
+  , _bottom(0)
+{
+}
+//-----------------------------------------------------------------------------
+template <typename T>
+size_t Work_Stealing_Deque<T>::round_up(size_t capacity)
+{
+  size_t result = 2;
+  while (result < capacity) {
+    result <<= 1;
+  }
+  return result;
+}
+//-----------------------------------------------------------------------------
+//! Owner only
+//! \return bool -- false if the deque was full and value was not added
+template <typename T>
+bool Work_Stealing_Deque<T>::try_push(T value)
+{
+  auto bottom = _bottom.load(std::memory_order_relaxed);
+  auto top = _top.load(std::memory_order_acquire);
+  if (bottom - top > static_cast<int64_t>(_mask)) {
+    return false;
+  }
+  _ring[bottom & _mask].store(value, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  _bottom.store(bottom + 1, std::memory_order_relaxed);
+  return true;
+}
+//-----------------------------------------------------------------------------
+//! Owner only
+//! \param value [OUT] -- Receives the newest element when one is available
+//! \return bool -- false if the deque was empty or a thief took the last element
+template <typename T>
+bool Work_Stealing_Deque<T>::try_pop(T& value)
+{
+  auto bottom = _bottom.load(std::memory_order_relaxed) - 1;
+  _bottom.store(bottom, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  auto top = _top.load(std::memory_order_relaxed);
+  if (top > bottom) {
+    _bottom.store(bottom + 1, std::memory_order_relaxed);
+    return false;
+  }
+  value = _ring[bottom & _mask].load(std::memory_order_relaxed);
+  if (top == bottom) {
+    //Last element, race any thief for it
+    auto won = _top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    _bottom.store(bottom + 1, std::memory_order_relaxed);
+    return won;
+  }
+  return true;
+}
+//-----------------------------------------------------------------------------
+//! Any thread
+//! \param value [OUT] -- Receives the oldest element when one is available
+//! \return bool -- false if the deque was empty or another thread claimed the element first
+template <typename T>
+bool Work_Stealing_Deque<T>::try_steal(T& value)
+{
+  auto top = _top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  auto bottom = _bottom.load(std::memory_order_acquire);
+  if (top >= bottom) {
+    return false;
+  }
+  auto candidate = _ring[top & _mask].load(std::memory_order_relaxed);
+  if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+    return false;
+  }
+  value = candidate;
+  return true;
+}
+//-----------------------------------------------------------------------------
+//! \return bool -- true when no elements are waiting. Approximate from threads other than the owner
+template <typename T>
+bool Work_Stealing_Deque<T>::empty() const
+{
+  return size() == 0;
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Approximate number of queued elements. Safe from any thread
+template <typename T>
+size_t Work_Stealing_Deque<T>::size() const
+{
+  auto top = _top.load(std::memory_order_acquire);
+  auto bottom = _bottom.load(std::memory_order_acquire);
+  return (bottom > top) ? static_cast<size_t>(bottom - top) : 0;
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Maximum number of elements the deque can hold
+template <typename T>
+size_t Work_Stealing_Deque<T>::capacity() const
+{
+  return _mask + 1;
+}
+} //namespace pfc
+
+#endif //SUSTAIN_PFCNW_WORK_STEALING_DEQUE_H
@@ -0,0 +1,70 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+//Built as C++20 in to its own executable, the rest of the library and tests are C++14
+#include <sustain/framework/net/Coroutines.h>
+#include <sustain/framework/net/patterns/req_rep/Server.h>
+
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#ifdef DISABLE_SUSTAIN_Coroutines_TEST
+#define TEST_FIXTURE_NAME DISABLED_Coroutines_Fixture
+#else
+#define TEST_FIXTURE_NAME Coroutines_Fixture
+#endif
+
+static_assert(PFC_HAS_COROUTINES, "test_pfc_nw_coroutines.cpp must be compiled with coroutine support");
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+namespace {
+pfc::message text(const std::string& value)
+{
+  return pfc::message(value.data(), value.size());
+}
+std::string text(const pfc::message& value)
+{
+  return std::string(value.data(), value.size());
+}
+//! Asks twice in a row and reports the thread the second reply resumed on
+pfc::task<std::string> ask_twice(pfc::ReqRep_Client& client, pfc::Reactor& reactor, std::thread::id& resumed_on)
+{
+  auto first = co_await pfc::co_request(client, text("first"), reactor);
+  auto second = co_await pfc::co_request(client, text("second"), reactor);
+  resumed_on = std::this_thread::get_id();
+  if (first.ec || second.ec) {
+    co_return std::string();
+  }
+  co_return text(first.body) + " " + text(second.body);
+}
+}
+
+TEST_F(TEST_FIXTURE_NAME, co_request)
+{
+  using namespace pfc;
+
+  ReqRep_Server server(URI("inproc://coroutines_request"));
+  server.async_listen(Listiner::MessageListenFunc([](message request) { return text("echo " + text(request)); }));
+  ReqRep_Client client(URI("inproc://coroutines_request"));
+  Reactor reactor(1);
+
+  std::thread::id resumed_on;
+  EXPECT_EQ("echo first echo second", sync_wait(ask_twice(client, reactor, resumed_on)));
+  EXPECT_NE(std::this_thread::get_id(), resumed_on);
+}
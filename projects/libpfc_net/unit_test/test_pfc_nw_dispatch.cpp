@@ -0,0 +1,148 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include <sustain/framework/net/patterns/pub_sub/Publisher.h>
+#include <sustain/framework/net/patterns/pub_sub/Subscriber.h>
+#include <sustain/framework/net/patterns/pub_sub/Topic.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#ifdef DISABLE_SUSTAIN_Dispatch_TEST
+#define TEST_FIXTURE_NAME DISABLED_Dispatch_Fixture
+#else
+#define TEST_FIXTURE_NAME Dispatch_Fixture
+#endif
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+TEST_F(TEST_FIXTURE_NAME, per_topic_order)
+{
+  using namespace pfc;
+
+  constexpr int topics = 8;
+  constexpr int per_topic = 200;
+
+  Publish_Options publish_options;
+  publish_options.capacity = topics * per_topic;
+  PubSub_Publisher publisher(URI("inproc://pfc_dispatch_test"), publish_options);
+  Subscribe_Options options;
+  options.dispatch_workers = 4;
+  options.dispatch_capacity = 16;
+  options.dispatch_block = true;
+  PubSub_Subscriber subscriber(URI("inproc://pfc_dispatch_test"), "", options);
+
+  std::mutex received_mutex;
+  std::map<std::string, std::vector<int>> received;
+  std::map<std::string, int> running;
+  std::atomic<int> total { 0 };
+  std::atomic<bool> overlapped { false };
+  subscriber.async_listen(Listiner::MessageListenFunc([&](message published) {
+    Topic_Frame frame;
+    if (!split_topic(published, frame)) {
+      return message();
+    }
+    auto topic = frame.topic_string();
+    {
+      std::lock_guard<std::mutex> guard(received_mutex);
+      if (running[topic]++) {
+        overlapped = true;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+    std::lock_guard<std::mutex> guard(received_mutex);
+    --running[topic];
+    received[topic].push_back(std::stoi(std::string(frame.payload, frame.payload_size)));
+    ++total;
+    return message();
+  }));
+
+  for (int i = 0; i < topics * per_topic; ++i) {
+    auto topic = "vitals/" + std::to_string(i % topics);
+    auto payload = std::to_string(i / topics);
+    auto framed = topic_message(topic);
+    message pooled(framed.size() + payload.size(), message::Storage::pooled);
+    pooled.append(framed.data(), framed.size());
+    pooled.append(payload.data(), payload.size());
+    EXPECT_EQ(Success(), publisher.publish(std::move(pooled)));
+  }
+
+  for (int wait = 0; wait < 500 && total < topics * per_topic; ++wait) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  subscriber.shutdown();
+  publisher.shutdown();
+
+  EXPECT_EQ(topics * per_topic, total);
+  EXPECT_FALSE(overlapped);
+  EXPECT_EQ(0u, subscriber.dispatch_dropped());
+  EXPECT_LE(subscriber.dispatch_high_water(), 16u);
+  ASSERT_EQ(size_t(topics), received.size());
+  for (auto& topic : received) {
+    ASSERT_EQ(size_t(per_topic), topic.second.size());
+    for (int i = 0; i < per_topic; ++i) {
+      EXPECT_EQ(i, topic.second[i]);
+    }
+  }
+}
+
+TEST_F(TEST_FIXTURE_NAME, restart_after_shutdown)
+{
+  using namespace pfc;
+  using namespace std::chrono;
+
+  PubSub_Publisher publisher(URI("inproc://pfc_dispatch_restart"));
+  Subscribe_Options options;
+  options.dispatch_workers = 2;
+  PubSub_Subscriber subscriber(URI("inproc://pfc_dispatch_restart"), "", options);
+
+  //Publishes until count moves, since a subscriber may miss what is sent before it connects
+  auto publish_until = [&publisher](std::atomic<int>& count) {
+    auto deadline = steady_clock::now() + seconds(5);
+    while (count == 0 && steady_clock::now() < deadline) {
+      publisher.publish("restart", "x", 1);
+      std::this_thread::sleep_for(milliseconds(5));
+    }
+    return count > 0;
+  };
+
+  std::atomic<int> first { 0 };
+  subscriber.async_listen(Listiner::MessageListenFunc([&](message) {
+    ++first;
+    return message();
+  }));
+  ASSERT_TRUE(publish_until(first));
+  subscriber.shutdown();
+  EXPECT_EQ(0u, subscriber.dispatch_queued());
+
+  //A second listen starts a new pool and only the new listener is called
+  auto stopped = first.load();
+  std::atomic<int> second { 0 };
+  subscriber.async_listen(Listiner::MessageListenFunc([&](message) {
+    ++second;
+    return message();
+  }));
+  EXPECT_TRUE(publish_until(second));
+  subscriber.shutdown();
+  EXPECT_EQ(stopped, first.load());
+}
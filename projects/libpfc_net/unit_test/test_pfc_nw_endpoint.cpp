@@ -0,0 +1,69 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include <sustain/framework/Protocol.h>
+#include <sustain/framework/net/Endpoint.h>
+
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#ifdef DISABLE_SUSTAIN_Endpoint_TEST
+#define TEST_FIXTURE_NAME DISABLED_Endpoint_Fixture
+#else
+#define TEST_FIXTURE_NAME Endpoint_Fixture
+#endif
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+TEST_F(TEST_FIXTURE_NAME, select_endpoint)
+{
+  using namespace pfc;
+
+  auto endpoints = local_endpoints("physiology vitals", 5600);
+  ASSERT_EQ(2u, endpoints.size());
+  EXPECT_EQ("inproc", endpoints[0].transport());
+  EXPECT_EQ("ipc", endpoints[1].transport());
+  EXPECT_TRUE(endpoints[0].is_valid());
+  EXPECT_TRUE(endpoints[1].is_valid());
+
+  pfc_service_announcement service;
+  service._protacol = pfc_protocol::pub_sub;
+  service._address = "192.168.1.1";
+  service._port = 5600;
+  service._name = "physiology vitals";
+  advertise_endpoints(service, endpoints);
+
+  std::stringstream ss;
+  EXPECT_EQ(Error(Error::Code::PFC_NONE), service.serialize(ss));
+  pfc_service_announcement inbound;
+  inbound.deserialize(ss);
+  EXPECT_EQ(service, inbound);
+
+  EXPECT_EQ(endpoints[0], select_endpoint(inbound));
+
+  inbound._process = local_process() + 1;
+  EXPECT_EQ(endpoints[1], select_endpoint(inbound));
+
+  inbound._host = local_host() + ".elsewhere";
+  EXPECT_EQ(URI("tcp://192.168.1.1:5600"), select_endpoint(inbound));
+
+  pfc_service_announcement legacy;
+  legacy._address = "192.168.1.2";
+  legacy._port = 80;
+  EXPECT_EQ(URI("tcp://192.168.1.2:80"), select_endpoint(legacy));
+}
@@ -0,0 +1,114 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include <sustain/framework/net/patterns/pub_sub/Forwarder.h>
+#include <sustain/framework/net/patterns/pub_sub/Publisher.h>
+#include <sustain/framework/net/patterns/pub_sub/Subscriber.h>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#ifdef DISABLE_SUSTAIN_Forwarder_TEST
+#define TEST_FIXTURE_NAME DISABLED_Forwarder_Fixture
+#else
+#define TEST_FIXTURE_NAME Forwarder_Fixture
+#endif
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+namespace {
+pfc::message text(const std::string& value)
+{
+  return pfc::message(value.data(), value.size());
+}
+std::string text(const pfc::message& value)
+{
+  return std::string(value.data(), value.size());
+}
+//! Collects what a subscriber receives
+struct Received {
+  std::mutex mutex;
+  std::vector<std::string> messages;
+
+  pfc::Listiner::MessageListenFunc listener()
+  {
+    return [this](pfc::message published) {
+      std::lock_guard<std::mutex> guard(mutex);
+      messages.push_back(text(published));
+      return pfc::message();
+    };
+  }
+  bool contains(const std::string& value)
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    return std::find(messages.begin(), messages.end(), value) != messages.end();
+  }
+};
+//! Publishes value until received has it. PUB drops messages sent before a subscriber is connected
+bool publish_until(pfc::PubSub_Publisher& publisher, const std::string& value, Received& received)
+{
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!received.contains(value) && std::chrono::steady_clock::now() < deadline) {
+    publisher.publish(text(value));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return received.contains(value);
+}
+}
+
+TEST_F(TEST_FIXTURE_NAME, forward_topics)
+{
+  using namespace pfc;
+
+  PubSub_Publisher simulator(URI("inproc://forwarder_simulator"));
+  PubSub_Publisher monitor(URI("inproc://forwarder_monitor"));
+  PubSub_Forwarder forwarder(URI("inproc://forwarder_simulator"), URI("inproc://forwarder_fanout"), "tick");
+  ASSERT_TRUE(forwarder.is_valid());
+  EXPECT_TRUE(forwarder.connect(URI("inproc://forwarder_monitor")).is_ok());
+  EXPECT_TRUE(forwarder.bind(URI("inproc://forwarder_fanout_local")).is_ok());
+  EXPECT_TRUE(forwarder.subscribe("alarm").is_ok());
+  forwarder.async_forward();
+
+  Received remote;
+  Received local;
+  PubSub_Subscriber remote_subscriber(URI("inproc://forwarder_fanout"));
+  PubSub_Subscriber local_subscriber(URI("inproc://forwarder_fanout_local"));
+  remote_subscriber.async_listen(remote.listener());
+  local_subscriber.async_listen(local.listener());
+
+  //Both upstreams are merged and every downstream endpoint gets the forwarded topics
+  EXPECT_TRUE(publish_until(simulator, "tick ready", remote));
+  EXPECT_TRUE(publish_until(simulator, "tick local", local));
+  EXPECT_TRUE(publish_until(monitor, "alarm ready", remote));
+
+  //Topics the forwarder did not subscribe to never reach a subscriber, even one subscribed to everything
+  EXPECT_TRUE(simulator.publish(text("vitals 1")).is_ok());
+  EXPECT_TRUE(monitor.publish(text("vitals 2")).is_ok());
+  EXPECT_TRUE(publish_until(simulator, "tick end", remote));
+  EXPECT_TRUE(publish_until(simulator, "tick end", local));
+  EXPECT_FALSE(remote.contains("vitals 1"));
+  EXPECT_FALSE(remote.contains("vitals 2"));
+  EXPECT_FALSE(local.contains("vitals 1"));
+
+  forwarder.shutdown();
+  EXPECT_FALSE(forwarder.connect(URI("inproc://forwarder_monitor")).is_ok());
+}
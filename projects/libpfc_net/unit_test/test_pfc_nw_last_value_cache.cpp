@@ -0,0 +1,110 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include <sustain/framework/net/patterns/pub_sub/Last_Value_Cache.h>
+#include <sustain/framework/net/patterns/pub_sub/Topic.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#ifdef DISABLE_SUSTAIN_Last_Value_Cache_TEST
+#define TEST_FIXTURE_NAME DISABLED_Last_Value_Cache_Fixture
+#else
+#define TEST_FIXTURE_NAME Last_Value_Cache_Fixture
+#endif
+
+namespace {
+pfc::message framed(const std::string& topic, const std::string& payload)
+{
+  auto result = pfc::topic_message(topic, payload.size());
+  result.append(payload.data(), payload.size());
+  return result;
+}
+
+std::string payload(const pfc::message& framed)
+{
+  pfc::Topic_Frame frame;
+  return pfc::split_topic(framed, frame) ? std::string(frame.payload, frame.payload_size) : std::string();
+}
+}
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+TEST_F(TEST_FIXTURE_NAME, last_value_snapshot)
+{
+  using namespace pfc;
+
+  Last_Value_Cache cache;
+  EXPECT_TRUE(cache.store(framed("vitals/heart_rate", "70")));
+  EXPECT_TRUE(cache.store(framed("vitals/heart_rate", "72")));
+  EXPECT_TRUE(cache.store(framed("vitals/spo2", "98")));
+  EXPECT_TRUE(cache.store(framed("labs/lactate", "1.1")));
+  EXPECT_FALSE(cache.store(message("no topic", 8)));
+  EXPECT_EQ(3u, cache.size());
+
+  std::vector<std::string> values;
+  auto snapshot = cache.snapshot("vitals/", 7);
+  EXPECT_TRUE(Last_Value_Cache::unpack(snapshot, [&values](message value) { values.push_back(payload(value)); }));
+  ASSERT_EQ(2u, values.size());
+  EXPECT_EQ("72", values[0]);
+  EXPECT_EQ("98", values[1]);
+
+  values.clear();
+  EXPECT_TRUE(Last_Value_Cache::unpack(cache.snapshot("", 0), [&values](message value) { values.push_back(payload(value)); }));
+  EXPECT_EQ(3u, values.size());
+
+  values.clear();
+  message truncated(snapshot.data(), snapshot.size() - 1);
+  EXPECT_FALSE(Last_Value_Cache::unpack(truncated, [&values](message value) { values.push_back(payload(value)); }));
+  EXPECT_EQ(1u, values.size());
+}
+
+TEST_F(TEST_FIXTURE_NAME, last_value_conflation)
+{
+  using namespace pfc;
+
+  Last_Value_Cache cache;
+  auto first = framed("vitals/heart_rate", "70");
+  auto second = framed("vitals/spo2", "98");
+  auto third = framed("vitals/heart_rate", "72");
+  EXPECT_TRUE(cache.conflate(first));
+  EXPECT_TRUE(cache.conflate(second));
+  EXPECT_TRUE(cache.conflate(third));
+  EXPECT_EQ(1u, cache.conflated());
+
+  //A snapshot value never replaces one which arrived live
+  auto stale = framed("vitals/heart_rate", "65");
+  EXPECT_FALSE(cache.conflate(stale, true));
+  EXPECT_EQ("65", payload(stale));
+  auto unframed = message("no topic", 8);
+  EXPECT_FALSE(cache.conflate(unframed));
+  EXPECT_EQ(8u, unframed.size());
+
+  message latest;
+  ASSERT_TRUE(cache.take_changed(latest));
+  EXPECT_EQ("72", payload(latest));
+  ASSERT_TRUE(cache.take_changed(latest));
+  EXPECT_EQ("98", payload(latest));
+  EXPECT_FALSE(cache.take_changed(latest));
+
+  auto next = framed("vitals/spo2", "97");
+  EXPECT_TRUE(cache.conflate(next));
+  ASSERT_TRUE(cache.take_changed(latest));
+  EXPECT_EQ("97", payload(latest));
+  EXPECT_EQ(1u, cache.conflated());
+}
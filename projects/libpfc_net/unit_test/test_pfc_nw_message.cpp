@@ -0,0 +1,104 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include <sustain/framework/net/Message.h>
+
+#include <cstring>
+#include <string>
+
+#include <nanomsg/nn.h>
+
+#include <gtest/gtest.h>
+
+#ifdef DISABLE_SUSTAIN_Message_TEST
+#define TEST_FIXTURE_NAME DISABLED_Message_Fixture
+#else
+#define TEST_FIXTURE_NAME Message_Fixture
+#endif
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+TEST_F(TEST_FIXTURE_NAME, message_pooled)
+{
+  using namespace pfc;
+
+  message msg(10, message::Storage::pooled);
+  EXPECT_EQ(message::Storage::pooled, msg.storage());
+  EXPECT_TRUE(msg.empty());
+  EXPECT_GE(msg.capacity(), 10u);
+  EXPECT_EQ(nullptr, msg.release_chunk());
+
+  std::string text(1000, 'x');
+  msg.append(text.data(), text.size());
+  EXPECT_EQ(text.size(), msg.size());
+  EXPECT_EQ(text, std::string(msg.data(), msg.size()));
+
+  //Freed blocks are reused by the next message of the same size class
+  auto block = msg.data();
+  msg = message();
+  message reused(text.size(), message::Storage::pooled);
+  EXPECT_EQ(block, reused.data());
+}
+
+TEST_F(TEST_FIXTURE_NAME, message_nanomsg_chunk)
+{
+  using namespace pfc;
+
+  message msg("header", 6);
+  EXPECT_EQ(message::Storage::nanomsg, msg.storage());
+  {
+    message_ostream os(msg);
+    os << ":" << 42 << std::string(300, 'y');
+  }
+  ASSERT_EQ(6u + 3u + 300u, msg.size());
+  EXPECT_EQ(0, std::memcmp("header:42y", msg.data(), 10));
+
+  message moved(std::move(msg));
+  EXPECT_EQ(message::Storage::none, msg.storage());
+  EXPECT_EQ(309u, moved.size());
+
+  auto size = moved.size();
+  auto chunk = moved.release_chunk();
+  ASSERT_NE(nullptr, chunk);
+  EXPECT_EQ(message::Storage::none, moved.storage());
+
+  auto adopted = message::adopt(chunk, size);
+  EXPECT_EQ(message::Storage::nanomsg, adopted.storage());
+  EXPECT_EQ(0, std::memcmp("header:42y", adopted.data(), 10));
+}
+
+TEST_F(TEST_FIXTURE_NAME, message_reply_in_place)
+{
+  using namespace pfc;
+
+  //Servers may serialize a reply in to the request they were handed
+  auto request = message("ping 7", 6);
+  std::string verb;
+  int id = 0;
+  {
+    message_istream is(request);
+    is >> verb >> id;
+  }
+  EXPECT_EQ("ping", verb);
+  EXPECT_EQ(7, id);
+
+  request.clear();
+  {
+    message_ostream os(request);
+    os << "pong " << id;
+  }
+  EXPECT_EQ("pong 7", std::string(request.data(), request.size()));
+}
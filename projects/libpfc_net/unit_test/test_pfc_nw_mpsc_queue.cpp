@@ -0,0 +1,148 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include <sustain/framework/util/Mpsc_Queue.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#ifdef DISABLE_SUSTAIN_Mpsc_Queue_TEST
+#define TEST_FIXTURE_NAME DISABLED_Mpsc_Queue_Fixture
+#else
+#define TEST_FIXTURE_NAME Mpsc_Queue_Fixture
+#endif
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+TEST_F(TEST_FIXTURE_NAME, mpsc_queue_bounded)
+{
+  using namespace pfc;
+
+  Mpsc_Queue<std::string> queue(3);
+  EXPECT_EQ(4u, queue.capacity());
+  EXPECT_TRUE(queue.empty());
+
+  std::string value;
+  EXPECT_FALSE(queue.try_pop(value));
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 4; ++i) {
+      EXPECT_TRUE(queue.try_push(std::to_string(i)));
+    }
+    std::string overflow = "overflow";
+    EXPECT_FALSE(queue.try_push(std::move(overflow)));
+    EXPECT_EQ("overflow", overflow);
+    EXPECT_EQ(4u, queue.size());
+    for (int i = 0; i < 4; ++i) {
+      EXPECT_TRUE(queue.try_pop(value));
+      EXPECT_EQ(std::to_string(i), value);
+    }
+    EXPECT_TRUE(queue.empty());
+  }
+}
+
+TEST_F(TEST_FIXTURE_NAME, mpsc_queue_threaded)
+{
+  using namespace pfc;
+
+  constexpr size_t producers = 4;
+  constexpr size_t count = 250000;
+  Mpsc_Queue<size_t> queue(64);
+
+  std::vector<std::thread> threads;
+  for (size_t producer = 0; producer < producers; ++producer) {
+    threads.emplace_back([&queue, producer]() {
+      for (size_t i = 0; i < count;) {
+        if (queue.try_push(producer * count + i)) {
+          ++i;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  //Each producer's values must arrive in the order that producer pushed them
+  std::vector<size_t> next(producers, 0);
+  size_t received = 0;
+  size_t value = 0;
+  while (received < producers * count) {
+    if (queue.try_pop(value)) {
+      auto producer = value / count;
+      ASSERT_LT(producer, producers);
+      ASSERT_EQ(next[producer], value % count);
+      ++next[producer];
+      ++received;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST_F(TEST_FIXTURE_NAME, mpsc_queue_many_consumers)
+{
+  using namespace pfc;
+
+  constexpr size_t producers = 2;
+  constexpr size_t consumers = 4;
+  constexpr size_t count = 100000;
+  Mpsc_Queue<size_t> queue(64);
+
+  //Worker pools pop one queue from several threads, so every value must be taken exactly once
+  std::vector<std::atomic<int>> taken(producers * count);
+  std::atomic<size_t> received(0);
+  std::vector<std::thread> threads;
+  for (size_t consumer = 0; consumer < consumers; ++consumer) {
+    threads.emplace_back([&]() {
+      size_t value = 0;
+      while (received < producers * count) {
+        if (queue.try_pop(value)) {
+          ++taken[value];
+          ++received;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (size_t producer = 0; producer < producers; ++producer) {
+    threads.emplace_back([&queue, producer]() {
+      for (size_t i = 0; i < count;) {
+        if (queue.try_push(producer * count + i)) {
+          ++i;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  size_t once = 0;
+  for (auto& value : taken) {
+    once += (value == 1);
+  }
+  EXPECT_EQ(producers * count, once);
+  EXPECT_TRUE(queue.empty());
+}
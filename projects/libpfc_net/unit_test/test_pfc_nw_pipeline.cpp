@@ -0,0 +1,177 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include <sustain/framework/net/patterns/pipeline/Puller.h>
+#include <sustain/framework/net/patterns/pipeline/Pusher.h>
+#include <sustain/framework/util/Work_Stealing_Deque.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#ifdef DISABLE_SUSTAIN_Pipeline_TEST
+#define TEST_FIXTURE_NAME DISABLED_Pipeline_Fixture
+#else
+#define TEST_FIXTURE_NAME Pipeline_Fixture
+#endif
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+TEST_F(TEST_FIXTURE_NAME, work_stealing_deque)
+{
+  using namespace pfc;
+
+  Work_Stealing_Deque<size_t> deque(4);
+  EXPECT_EQ(4u, deque.capacity());
+  for (size_t i = 0; i < 4; ++i) {
+    EXPECT_TRUE(deque.try_push(i));
+  }
+  EXPECT_FALSE(deque.try_push(4));
+
+  size_t value = 0;
+  EXPECT_TRUE(deque.try_steal(value));
+  EXPECT_EQ(0u, value);
+  EXPECT_TRUE(deque.try_pop(value));
+  EXPECT_EQ(3u, value);
+  EXPECT_EQ(2u, deque.size());
+
+  EXPECT_TRUE(deque.try_pop(value));
+  EXPECT_TRUE(deque.try_steal(value));
+  EXPECT_FALSE(deque.try_pop(value));
+  EXPECT_TRUE(deque.empty());
+
+  //Every item is taken exactly once while thieves race the owner
+  constexpr size_t items = 200000;
+  std::vector<std::atomic<int>> taken(items);
+  std::atomic<bool> done(false);
+  std::vector<std::thread> thieves;
+  for (int t = 0; t < 3; ++t) {
+    thieves.emplace_back([&]() {
+      size_t stolen = 0;
+      while (!done) {
+        if (deque.try_steal(stolen)) {
+          ++taken[stolen];
+        }
+      }
+    });
+  }
+  for (size_t i = 0; i < items; ++i) {
+    while (!deque.try_push(i)) {
+      if (deque.try_pop(value)) {
+        ++taken[value];
+      }
+    }
+    if (i % 3 == 0 && deque.try_pop(value)) {
+      ++taken[value];
+    }
+  }
+  while (!deque.empty()) {
+    if (deque.try_pop(value)) {
+      ++taken[value];
+    }
+  }
+  done = true;
+  for (auto& thief : thieves) {
+    thief.join();
+  }
+  size_t once = 0;
+  for (auto& count : taken) {
+    once += (count == 1) ? 1 : 0;
+  }
+  EXPECT_EQ(items, once);
+}
+
+TEST_F(TEST_FIXTURE_NAME, pipeline_push_pull)
+{
+  using namespace pfc;
+  using namespace std::chrono;
+
+  Pipeline_Pusher pusher(URI("inproc://pipeline_test"));
+  Puller_Options options;
+  options.workers = 4;
+  options.prefetch = 16;
+  Pipeline_Puller puller(URI("inproc://pipeline_test"), options);
+
+  constexpr int items = 400;
+  std::vector<std::atomic<int>> seen(items);
+  std::atomic<int> count(0);
+  puller.async_listen(Listiner::MessageListenFunc([&](message work) {
+    int index = 0;
+    std::memcpy(&index, work.data(), sizeof(index));
+    //Uneven cost so workers finish their prefetch at different times
+    std::this_thread::sleep_for(microseconds((index % 8 == 0) ? 2000 : 10));
+    ++seen[index];
+    ++count;
+    return message();
+  }));
+
+  for (int i = 0; i < items; ++i) {
+    EXPECT_EQ(Error(Error::Code::PFC_NONE), pusher.push(message(reinterpret_cast<const char*>(&i), sizeof(i), message::Storage::pooled)));
+  }
+  auto deadline = steady_clock::now() + seconds(10);
+  while (count < items && steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(milliseconds(5));
+  }
+  puller.shutdown();
+
+  EXPECT_EQ(items, count.load());
+  EXPECT_EQ(uint64_t(items), puller.processed());
+  EXPECT_EQ(uint64_t(items), pusher.pushed());
+  for (auto& item : seen) {
+    EXPECT_EQ(1, item.load());
+  }
+}
+
+TEST_F(TEST_FIXTURE_NAME, shutdown_joins_workers)
+{
+  using namespace pfc;
+  using namespace std::chrono;
+
+  Pipeline_Pusher pusher(URI("inproc://pipeline_shutdown"));
+  Puller_Options options;
+  options.workers = 4;
+  Pipeline_Puller puller(URI("inproc://pipeline_shutdown"), options);
+
+  std::atomic<int> running(0);
+  std::atomic<int> finished(0);
+  puller.async_listen(Listiner::MessageListenFunc([&](message) {
+    ++running;
+    std::this_thread::sleep_for(milliseconds(50));
+    ++finished;
+    --running;
+    return message();
+  }));
+  for (int i = 0; i < 8; ++i) {
+    pusher.push(message(reinterpret_cast<const char*>(&i), sizeof(i), message::Storage::pooled));
+  }
+  auto deadline = steady_clock::now() + seconds(5);
+  while (running == 0 && steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+
+  //Workers finish the item they are running before shutdown returns, and none starts afterwards
+  puller.shutdown();
+  EXPECT_EQ(0, running.load());
+  auto done = finished.load();
+  EXPECT_GT(done, 0);
+  EXPECT_EQ(uint64_t(done), puller.processed());
+  std::this_thread::sleep_for(milliseconds(100));
+  EXPECT_EQ(done, finished.load());
+}
@@ -11,6 +11,7 @@ specific language governing permissions and limitations under the License.
 **************************************************************************************/
 
 #include <sustain/framework/Protocol.h>
+#include <sustain/framework/net/Reliable_Multicast_Sender.h>
 
 
 #include <limits>
@@ -80,3 +81,144 @@ TEST_F(TEST_FIXTURE_NAME, pfc_service_registry_request)
 
   EXPECT_EQ(inbound,outbound);
 }
+
+TEST_F(TEST_FIXTURE_NAME, pfc_registry_digest)
+{
+  using namespace pfc;
+
+  pfc_registry_digest outbound;
+  outbound._registry_id = 0xBEEF;
+  outbound._entry_count = 3;
+  outbound._root = 0xCAFE;
+  outbound._buckets = { 1, 2, 3, 0xFFFFFFFF };
+  pfc_registry_digest inbound;
+
+  std::stringstream ss;
+  auto error = outbound.serialize(ss);
+
+  EXPECT_EQ(Error::Code::PFC_NONE, error);
+  EXPECT_EQ(REGISTRY_DIGEST_REQUEST, peek_message_type(ss));
+
+  inbound.deserialize(ss);
+
+  EXPECT_EQ(inbound, outbound);
+}
+
+TEST_F(TEST_FIXTURE_NAME, pfc_registry_sync)
+{
+  using namespace pfc;
+
+  pfc_registry_sync_request request;
+  request._registry_id = 1;
+  request._target_id = 2;
+  request._buckets = { 7, 11 };
+
+  pfc_registry_sync_response response;
+  response._registry_id = 2;
+  response._version = 42;
+  response._removed = True;
+  response._protacol = pfc_protocol::req_req;
+  response._port = 0xDEAD;
+  response._address = "192.168.1.1";
+  response._name = "Unit Test Service";
+  response._brief = "is this the right thing";
+
+  std::stringstream ss;
+  EXPECT_EQ(Error::Code::PFC_NONE, request.serialize(ss));
+  EXPECT_EQ(Error::Code::PFC_NONE, response.serialize(ss));
+
+  pfc_registry_sync_request inbound_request;
+  pfc_registry_sync_response inbound_response;
+  EXPECT_EQ(REGISTRY_SYNC_REQUEST, peek_message_type(ss));
+  inbound_request.deserialize(ss);
+  EXPECT_EQ(REGISTRY_SYNC_RESPONSE, peek_message_type(ss));
+  inbound_response.deserialize(ss);
+
+  EXPECT_EQ(inbound_request, request);
+  EXPECT_EQ(inbound_response, response);
+}
+
+TEST_F(TEST_FIXTURE_NAME, pfc_registry_snapshot)
+{
+  using namespace pfc;
+
+  pfc_registry_snapshot_request request;
+  request._topic = registry_topic(pfc_protocol::pub_sub, "physiology");
+  EXPECT_EQ("pub_sub/physiology", request._topic);
+
+  pfc_registry_snapshot_response response;
+  response._sequence = 1234;
+  response._count = 1;
+
+  pfc_registry_delta delta;
+  delta._sequence = 1200;
+  delta._change = registry_removed;
+  delta._version = 3;
+  delta._protacol = pfc_protocol::pub_sub;
+  delta._port = 0xBEEF;
+  delta._address = "192.168.1.1";
+  delta._name = "physiology.cardiovascular";
+  delta._brief = "heart rate";
+
+  std::stringstream ss;
+  EXPECT_EQ(Error::Code::PFC_NONE, request.serialize(ss));
+  EXPECT_EQ(Error::Code::PFC_NONE, response.serialize(ss));
+  EXPECT_EQ(Error::Code::PFC_NONE, delta.serialize(ss));
+
+  pfc_registry_snapshot_request inbound_request;
+  pfc_registry_snapshot_response inbound_response;
+  pfc_registry_delta inbound_delta;
+  EXPECT_EQ(REGISTRY_SNAPSHOT_REQUEST, peek_message_type(ss));
+  inbound_request.deserialize(ss);
+  EXPECT_EQ(REGISTRY_SNAPSHOT_RESPONSE, peek_message_type(ss));
+  inbound_response.deserialize(ss);
+  EXPECT_EQ(REGISTRY_DELTA_REQUEST, peek_message_type(ss));
+  inbound_delta.deserialize(ss);
+
+  EXPECT_EQ(inbound_request, request);
+  EXPECT_EQ(inbound_response, response);
+  EXPECT_EQ(inbound_delta, delta);
+}
+
+TEST_F(TEST_FIXTURE_NAME, pfc_reliable_multicast)
+{
+  using namespace pfc;
+
+  pfc_reliable_data data;
+  data._channel = 0xC0FFEE;
+  data._sequence = 0xFFFFFFFF;
+  data._retransmit = True;
+  data._payload = { 'v', 'i', 't', 'a', 'l', 's' };
+
+  pfc_reliable_heartbeat heartbeat;
+  heartbeat._channel = 0xC0FFEE;
+  heartbeat._first = 0xFFFFF000;
+  heartbeat._high_water = 0xFFFFFFFF;
+
+  pfc_reliable_nack nack;
+  nack._channel = 0xC0FFEE;
+  nack._first = 0xFFFFFFFE;
+  nack._count = 2;
+
+  std::stringstream ss;
+  EXPECT_EQ(Error::Code::PFC_NONE, data.serialize(ss));
+  EXPECT_EQ(Error::Code::PFC_NONE, heartbeat.serialize(ss));
+  EXPECT_EQ(Error::Code::PFC_NONE, nack.serialize(ss));
+
+  pfc_reliable_data inbound_data;
+  pfc_reliable_heartbeat inbound_heartbeat;
+  pfc_reliable_nack inbound_nack;
+  EXPECT_EQ(RELIABLE_DATA_REQUEST, peek_message_type(ss));
+  inbound_data.deserialize(ss);
+  EXPECT_EQ(RELIABLE_HEARTBEAT_REQUEST, peek_message_type(ss));
+  inbound_heartbeat.deserialize(ss);
+  EXPECT_EQ(RELIABLE_NACK_REQUEST, peek_message_type(ss));
+  inbound_nack.deserialize(ss);
+
+  EXPECT_EQ(inbound_data, data);
+  EXPECT_EQ(inbound_heartbeat, heartbeat);
+  EXPECT_EQ(inbound_nack, nack);
+
+  EXPECT_EQ(2, sequence_distance(0xFFFFFFFFu, 1u));
+  EXPECT_EQ(-2, sequence_distance(1u, 0xFFFFFFFFu));
+}
@@ -0,0 +1,83 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include <sustain/framework/net/patterns/pub_sub/Publisher.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#ifdef DISABLE_SUSTAIN_Publisher_TEST
+#define TEST_FIXTURE_NAME DISABLED_Publisher_Fixture
+#else
+#define TEST_FIXTURE_NAME Publisher_Fixture
+#endif
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+namespace {
+pfc::message text(const std::string& value)
+{
+  return pfc::message(value.data(), value.size());
+}
+}
+
+TEST_F(TEST_FIXTURE_NAME, publish_races_shutdown)
+{
+  using namespace pfc;
+  using namespace std::chrono;
+
+  //Every message publish accepted is sent or counted as dropped, even when shutdown drains the queue meanwhile
+  for (int round = 0; round < 50; ++round) {
+    Publish_Options options;
+    options.overflow = (round % 2) ? Overflow_Policy::drop_oldest : Overflow_Policy::drop_newest;
+    options.capacity = 64;
+    PubSub_Publisher publisher(URI("inproc://publisher_shutdown_race"), options);
+    std::atomic<uint64_t> accepted(0);
+    std::atomic<uint64_t> refused(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> producers;
+    for (int producer = 0; producer < 4; ++producer) {
+      producers.emplace_back([&]() {
+        while (!go) {
+          std::this_thread::yield();
+        }
+        for (int i = 0; i < 500; ++i) {
+          auto result = publisher.publish(text("race"));
+          if (result.is_ok() || result == Error(Error::Code::PFC_QUEUE_FULL)) {
+            ++accepted;
+          } else {
+            EXPECT_EQ(Error(Error::Code::PFC_BAD_OPERATION), result);
+            ++refused;
+          }
+        }
+      });
+    }
+    go = true;
+    std::this_thread::sleep_for(microseconds(50 * (round % 10)));
+    publisher.shutdown();
+    for (auto& producer : producers) {
+      producer.join();
+    }
+    EXPECT_EQ(2000u, accepted + refused);
+    EXPECT_EQ(accepted.load(), publisher.sent() + publisher.dropped());
+    EXPECT_EQ(Error(Error::Code::PFC_BAD_OPERATION), publisher.publish(text("closed")));
+  }
+}
@@ -0,0 +1,139 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include <sustain/framework/net/Reactor.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nanomsg/nn.h>
+#include <nanomsg/pipeline.h>
+
+#include <gtest/gtest.h>
+
+#ifdef DISABLE_SUSTAIN_Reactor_TEST
+#define TEST_FIXTURE_NAME DISABLED_Reactor_Fixture
+#else
+#define TEST_FIXTURE_NAME Reactor_Fixture
+#endif
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+namespace {
+bool wait_for(const std::atomic<int>& value, int expected)
+{
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (value < expected && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return value == expected;
+}
+}
+
+TEST_F(TEST_FIXTURE_NAME, reactor_many_sockets)
+{
+  using namespace pfc;
+
+  constexpr int sockets = 32;
+  constexpr int messages = 20;
+  std::vector<int> senders;
+  std::vector<int> receivers;
+  std::atomic<int> received { 0 };
+  std::atomic<int> overlapping { 0 };
+  std::vector<std::atomic<int>> busy(sockets);
+
+  Reactor reactor(2);
+  for (int index = 0; index < sockets; ++index) {
+    auto endpoint = "inproc://pfc_reactor_test_" + std::to_string(index);
+    receivers.push_back(nn_socket(AF_SP, NN_PULL));
+    ASSERT_LE(0, nn_bind(receivers.back(), endpoint.c_str()));
+    senders.push_back(nn_socket(AF_SP, NN_PUSH));
+    ASSERT_LE(0, nn_connect(senders.back(), endpoint.c_str()));
+
+    auto& in_handler = busy[index];
+    EXPECT_FALSE(reactor.add(receivers.back(), NN_POLLIN, [&received, &overlapping, &in_handler](int socket, short) {
+      if (in_handler++) {
+        ++overlapping;
+      }
+      void* chunk = nullptr;
+      while (nn_recv(socket, &chunk, NN_MSG, NN_DONTWAIT) >= 0) {
+        nn_freemsg(chunk);
+        ++received;
+      }
+      --in_handler;
+    }));
+  }
+  EXPECT_TRUE(reactor.add(receivers.front(), NN_POLLIN, [](int, short) {}));
+  EXPECT_EQ(static_cast<size_t>(sockets), reactor.size());
+
+  for (int round = 0; round < messages; ++round) {
+    for (auto sender : senders) {
+      ASSERT_EQ(4, nn_send(sender, "ping", 4, 0));
+    }
+  }
+  EXPECT_TRUE(wait_for(received, sockets * messages));
+  EXPECT_EQ(0, overlapping.load());
+
+  //Removed sockets are never dispatched again, so they may be closed right away
+  for (int index = 0; index < sockets / 2; ++index) {
+    EXPECT_FALSE(reactor.remove(receivers[index]));
+  }
+  EXPECT_TRUE(reactor.remove(receivers.front()));
+  EXPECT_EQ(static_cast<size_t>(sockets / 2), reactor.size());
+  for (auto sender : senders) {
+    ASSERT_EQ(4, nn_send(sender, "ping", 4, 0));
+  }
+  EXPECT_TRUE(wait_for(received, sockets * messages + sockets / 2));
+
+  reactor.stop();
+  for (auto socket : senders) {
+    nn_close(socket);
+  }
+  for (auto socket : receivers) {
+    nn_close(socket);
+  }
+}
+
+TEST_F(TEST_FIXTURE_NAME, stop_runs_accepted_jobs)
+{
+  //A job accepted by post runs exactly once, even when stop races the post
+  for (int round = 0; round < 50; ++round) {
+    for (size_t workers : { 0, 2 }) {
+      pfc::Reactor reactor(workers);
+      std::atomic<int> accepted { 0 };
+      std::atomic<int> ran { 0 };
+      std::vector<std::thread> posters;
+      for (int poster = 0; poster < 4; ++poster) {
+        posters.emplace_back([&]() {
+          for (int job = 0; job < 200; ++job) {
+            if (!reactor.post([&ran]() { ++ran; })) {
+              ++accepted;
+            }
+          }
+        });
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(round * 20));
+      reactor.stop();
+      for (auto& poster : posters) {
+        poster.join();
+      }
+      EXPECT_EQ(accepted.load(), ran.load());
+    }
+  }
+}
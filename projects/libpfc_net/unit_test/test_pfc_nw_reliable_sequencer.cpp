@@ -0,0 +1,184 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include <sustain/framework/net/Reliable_Sequencer.h>
+
+#include <chrono>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#ifdef DISABLE_SUSTAIN_Reliable_Sequencer_TEST
+#define TEST_FIXTURE_NAME DISABLED_Reliable_Sequencer_Fixture
+#else
+#define TEST_FIXTURE_NAME Reliable_Sequencer_Fixture
+#endif
+
+//!
+//! Drives a Reliable_Sequencer with hand made frames and a clock of its own
+//!
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  using Nack = std::pair<pfc::pfc_uint, pfc::pfc_uint>;
+
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+
+  std::unique_ptr<pfc::Reliable_Sequencer> make_sequencer(size_t history)
+  {
+    pfc::Reliable_Multicast_Options options;
+    options.history = history;
+    options.nack_interval = std::chrono::milliseconds(20);
+    return std::make_unique<pfc::Reliable_Sequencer>(
+      options,
+      [this](std::vector<pfc::pfc_byte>& payload) {
+        pfc::pfc_uint sequence = 0;
+        std::memcpy(&sequence, payload.data(), sizeof(sequence));
+        delivered.push_back(sequence);
+      },
+      [this](pfc::pfc_uint first, pfc::pfc_uint count) { nacks.emplace_back(first, count); });
+  }
+  void data(pfc::Reliable_Sequencer& sequencer, pfc::pfc_uint sequence, pfc::pfc_uint channel = 7)
+  {
+    pfc::pfc_reliable_data frame;
+    frame._channel = channel;
+    frame._sequence = sequence;
+    frame._payload.resize(sizeof(sequence));
+    std::memcpy(frame._payload.data(), &sequence, sizeof(sequence));
+    sequencer.handle_data(frame, now);
+  }
+  void heartbeat(pfc::Reliable_Sequencer& sequencer, pfc::pfc_uint first, pfc::pfc_uint high_water, pfc::pfc_uint channel = 7)
+  {
+    pfc::pfc_reliable_heartbeat beat;
+    beat._channel = channel;
+    beat._first = first;
+    beat._high_water = high_water;
+    sequencer.handle_heartbeat(beat, now);
+  }
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::vector<pfc::pfc_uint> delivered;
+  std::vector<Nack> nacks;
+};
+
+TEST_F(TEST_FIXTURE_NAME, reordering)
+{
+  auto sequencer = make_sequencer(16);
+  data(*sequencer, 1);
+  data(*sequencer, 3);
+  data(*sequencer, 4);
+  data(*sequencer, 6);
+
+  //Frames after a gap are held and each new gap is NACKed as soon as it is seen
+  EXPECT_EQ(std::vector<pfc::pfc_uint>({ 1 }), delivered);
+  EXPECT_EQ(3u, sequencer->held());
+  EXPECT_EQ(std::vector<Nack>({ { 2, 1 }, { 5, 1 } }), nacks);
+
+  //The repair releases every held frame up to the next gap
+  data(*sequencer, 2);
+  EXPECT_EQ(std::vector<pfc::pfc_uint>({ 1, 2, 3, 4 }), delivered);
+  EXPECT_EQ(1u, sequencer->held());
+
+  //Duplicates of delivered frames are dropped
+  data(*sequencer, 3);
+  data(*sequencer, 5);
+  EXPECT_EQ(std::vector<pfc::pfc_uint>({ 1, 2, 3, 4, 5, 6 }), delivered);
+  EXPECT_EQ(0u, sequencer->held());
+  EXPECT_EQ(7u, sequencer->next());
+  EXPECT_EQ(6u, sequencer->delivered());
+  EXPECT_EQ(0u, sequencer->lost());
+}
+
+TEST_F(TEST_FIXTURE_NAME, nack_runs)
+{
+  auto sequencer = make_sequencer(64);
+  data(*sequencer, 1);
+  data(*sequencer, 10);
+  EXPECT_EQ(std::vector<Nack>({ { 2, 8 } }), nacks);
+
+  //Within nack_interval only runs past those already NACKed are requested
+  data(*sequencer, 5);
+  heartbeat(*sequencer, 1, 10);
+  EXPECT_EQ(1u, nacks.size());
+
+  //Once it passes every open run is NACKed again, split around the frames already held
+  now += std::chrono::milliseconds(25);
+  heartbeat(*sequencer, 1, 12);
+  EXPECT_EQ(std::vector<Nack>({ { 2, 8 }, { 2, 3 }, { 6, 4 }, { 11, 2 } }), nacks);
+  EXPECT_EQ(4u, sequencer->nacks());
+  EXPECT_EQ(12u, sequencer->high_water());
+}
+
+TEST_F(TEST_FIXTURE_NAME, loss)
+{
+  auto sequencer = make_sequencer(8);
+  data(*sequencer, 1);
+  data(*sequencer, 3);
+
+  //The sender can no longer repair 2 or 4, so held 3 is delivered and they are counted as lost
+  heartbeat(*sequencer, 5, 6);
+  EXPECT_EQ(std::vector<pfc::pfc_uint>({ 1, 3 }), delivered);
+  EXPECT_EQ(2u, sequencer->lost());
+  EXPECT_EQ(5u, sequencer->next());
+  EXPECT_EQ(Nack(5, 2), nacks.back());
+
+  //A frame further ahead than the history skips what could no longer be held
+  data(*sequencer, 20);
+  EXPECT_EQ(10u, sequencer->lost());
+  EXPECT_EQ(13u, sequencer->next());
+  EXPECT_EQ(1u, sequencer->held());
+  EXPECT_EQ(Nack(13, 7), nacks.back());
+}
+
+TEST_F(TEST_FIXTURE_NAME, wrap_past_zero)
+{
+  auto sequencer = make_sequencer(16);
+  data(*sequencer, 0xFFFFFFFE);
+  data(*sequencer, 1);
+
+  //0 is never sent, so only 0xFFFFFFFF is missing
+  EXPECT_EQ(std::vector<Nack>({ { 0xFFFFFFFF, 1 } }), nacks);
+  data(*sequencer, 0xFFFFFFFF);
+  EXPECT_EQ(std::vector<pfc::pfc_uint>({ 0xFFFFFFFE, 0xFFFFFFFF, 1 }), delivered);
+  EXPECT_EQ(2u, sequencer->next());
+
+  //Skipping across the wrap counts 0xFFFFFFFE, 0xFFFFFFFF and 1 as lost, but not 0
+  auto skipping = make_sequencer(16);
+  data(*skipping, 0xFFFFFFFD);
+  heartbeat(*skipping, 2, 2);
+  EXPECT_EQ(3u, skipping->lost());
+  EXPECT_EQ(2u, skipping->next());
+}
+
+TEST_F(TEST_FIXTURE_NAME, join_and_restart)
+{
+  auto sequencer = make_sequencer(16);
+  EXPECT_FALSE(sequencer->synced());
+
+  //A heartbeat first joins at the live edge without replaying the history
+  heartbeat(*sequencer, 50, 100);
+  EXPECT_TRUE(sequencer->synced());
+  EXPECT_EQ(101u, sequencer->next());
+  data(*sequencer, 100);
+  data(*sequencer, 102);
+  EXPECT_TRUE(delivered.empty());
+  EXPECT_EQ(1u, sequencer->held());
+
+  //A new channel is a restarted sender, followed from its first frame
+  data(*sequencer, 5, 8);
+  EXPECT_EQ(8u, sequencer->channel());
+  EXPECT_EQ(std::vector<pfc::pfc_uint>({ 5 }), delivered);
+  EXPECT_EQ(0u, sequencer->held());
+  EXPECT_EQ(0u, sequencer->lost());
+}
@@ -0,0 +1,458 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include <sustain/framework/net/patterns/req_rep/Client.h>
+#include <sustain/framework/net/patterns/req_rep/Server.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <nanomsg/nn.h>
+#include <nanomsg/reqrep.h>
+
+#ifdef DISABLE_SUSTAIN_Req_Rep_TEST
+#define TEST_FIXTURE_NAME DISABLED_Req_Rep_Fixture
+#else
+#define TEST_FIXTURE_NAME Req_Rep_Fixture
+#endif
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+namespace {
+pfc::message text(const std::string& value)
+{
+  return pfc::message(value.data(), value.size());
+}
+std::string text(const pfc::message& value)
+{
+  return std::string(value.data(), value.size());
+}
+//! Sends body on a REQ socket of its own and waits up to timeout ms for the reply. Empty when none came
+std::future<std::string> ask(const std::string& endpoint, const std::string& body, int timeout)
+{
+  return std::async(std::launch::async, [endpoint, body, timeout]() {
+    std::string reply;
+    int socket = nn_socket(AF_SP, NN_REQ);
+    if (socket < 0) {
+      return reply;
+    }
+    nn_setsockopt(socket, NN_SOL_SOCKET, NN_RCVTIMEO, &timeout, sizeof(timeout));
+    char* buffer = nullptr;
+    int bytes = -1;
+    if (nn_connect(socket, endpoint.c_str()) >= 0 && nn_send(socket, body.data(), body.size(), 0) >= 0) {
+      bytes = nn_recv(socket, &buffer, NN_MSG, 0);
+    }
+    if (bytes >= 0) {
+      reply.assign(buffer, bytes);
+      nn_freemsg(buffer);
+    }
+    nn_close(socket);
+    return reply;
+  });
+}
+}
+
+TEST_F(TEST_FIXTURE_NAME, worker_pool_routing)
+{
+  using namespace pfc;
+  using namespace std::chrono;
+
+  Server_Options options;
+  options.workers = 4;
+  ReqRep_Server server(URI("inproc://req_rep_workers"), options);
+  std::atomic<int> running(0);
+  std::atomic<int> overlap(0);
+  server.async_listen(Listiner::MessageListenFunc([&](message request) {
+    auto now = ++running;
+    overlap = std::max(overlap.load(), now);
+    //Later requests finish first, so replies leave in a different order than requests arrived
+    std::this_thread::sleep_for(milliseconds(40 - 2 * std::stoi(text(request))));
+    --running;
+    return text("echo " + text(request));
+  }));
+
+  std::vector<std::future<std::string>> replies;
+  for (int i = 0; i < 16; ++i) {
+    replies.push_back(ask("inproc://req_rep_workers", std::to_string(i), 10000));
+  }
+  for (int i = 0; i < 16; ++i) {
+    EXPECT_EQ("echo " + std::to_string(i), replies[i].get());
+  }
+  EXPECT_GT(overlap.load(), 1);
+  //served counts a reply once nanomsg took it, which can be after the client already has it
+  auto deadline = steady_clock::now() + seconds(5);
+  while (server.served() < 16 && steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  EXPECT_EQ(16u, server.served());
+  EXPECT_EQ(0u, server.shed());
+}
+
+TEST_F(TEST_FIXTURE_NAME, worker_pool_shedding)
+{
+  using namespace pfc;
+  using namespace std::chrono;
+
+  Server_Options options;
+  options.workers = 1;
+  options.queue_depth = 2;
+  ReqRep_Server server(URI("inproc://req_rep_shedding"), options);
+  std::atomic<bool> gate(false);
+  server.async_listen(Listiner::MessageListenFunc([&](message request) {
+    while (!gate) {
+      std::this_thread::sleep_for(milliseconds(1));
+    }
+    return request;
+  }));
+
+  //One request holds the worker and at most two wait in the queue, so the rest are shed and never answered
+  std::vector<std::future<std::string>> replies;
+  for (int i = 0; i < 12; ++i) {
+    replies.push_back(ask("inproc://req_rep_shedding", std::to_string(i), 1000));
+  }
+  auto deadline = steady_clock::now() + seconds(5);
+  while (server.shed() < 9 && steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  gate = true;
+
+  size_t answered = 0;
+  size_t timed_out = 0;
+  for (auto& reply : replies) {
+    auto result = reply.get();
+    answered += !result.empty();
+    timed_out += result.empty();
+  }
+  EXPECT_GE(server.shed(), 9u);
+  EXPECT_EQ(12u - server.shed(), answered);
+  EXPECT_EQ(server.shed(), timed_out);
+  EXPECT_EQ(answered, server.served());
+}
+
+TEST_F(TEST_FIXTURE_NAME, worker_pool_deadline)
+{
+  using namespace pfc;
+  using namespace std::chrono;
+
+  Server_Options options;
+  options.workers = 1;
+  options.deadline = milliseconds(20);
+  ReqRep_Server server(URI("inproc://req_rep_deadline"), options);
+  std::atomic<int> calls(0);
+  server.async_listen(Listiner::MessageListenFunc([&](message request) {
+    ++calls;
+    std::this_thread::sleep_for(milliseconds(100));
+    return request;
+  }));
+
+  //The first request keeps the only worker busy past the deadline of the three queued behind it
+  std::vector<std::future<std::string>> replies;
+  for (int i = 0; i < 4; ++i) {
+    replies.push_back(ask("inproc://req_rep_deadline", std::to_string(i), 1000));
+  }
+  size_t answered = 0;
+  for (auto& reply : replies) {
+    answered += !reply.get().empty();
+  }
+  EXPECT_EQ(1u, answered);
+  EXPECT_EQ(1, calls.load());
+  EXPECT_EQ(3u, server.expired());
+}
+
+TEST_F(TEST_FIXTURE_NAME, shutdown_joins_workers)
+{
+  using namespace pfc;
+  using namespace std::chrono;
+
+  Server_Options options;
+  options.workers = 2;
+  ReqRep_Server server(URI("inproc://req_rep_shutdown"), options);
+  std::atomic<int> started(0);
+  std::atomic<int> finished(0);
+  server.async_listen(Listiner::MessageListenFunc([&](message request) {
+    ++started;
+    std::this_thread::sleep_for(milliseconds(100));
+    ++finished;
+    return request;
+  }));
+
+  //Both workers are answering when shutdown starts. Their replies still go out on the open socket
+  auto first = ask("inproc://req_rep_shutdown", "first", 2000);
+  auto second = ask("inproc://req_rep_shutdown", "second", 2000);
+  auto deadline = steady_clock::now() + seconds(5);
+  while (started < 2 && steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  server.shutdown();
+  EXPECT_EQ(2, finished.load());
+  EXPECT_EQ(2u, server.served());
+  EXPECT_EQ("first", first.get());
+  EXPECT_EQ("second", second.get());
+
+  //An idle single threaded server stops within the receive poll
+  ReqRep_Server idle(URI("inproc://req_rep_shutdown_idle"));
+  idle.async_listen(Listiner::MessageListenFunc([](message request) { return request; }));
+  auto stopping = steady_clock::now();
+  idle.shutdown();
+  EXPECT_LT(steady_clock::now() - stopping, seconds(1));
+  EXPECT_TRUE(ask("inproc://req_rep_shutdown_idle", "late", 50).get().empty());
+}
+
+TEST_F(TEST_FIXTURE_NAME, pipelined_requests)
+{
+  using namespace pfc;
+  using namespace std::chrono;
+
+  ReqRep_Server server(URI("inproc://req_rep_pipelined"));
+  server.async_listen(Listiner::MessageListenFunc([](message request) { return text("echo " + text(request)); }));
+
+  Client_Options options;
+  options.sockets = 4;
+  ReqRep_Client client(URI("inproc://req_rep_pipelined"), options);
+  constexpr int requests = 200;
+  std::vector<std::string> replies(requests);
+  std::vector<uint64_t> ids(requests);
+  std::atomic<int> done(0);
+  std::atomic<int> failed(0);
+  for (int i = 0; i < requests; ++i) {
+    ids[i] = client.request(text(std::to_string(i)), [&, i](Client_Reply reply) {
+      failed += (reply.ec.is_not_ok() || reply.id != ids[i]);
+      replies[i] = text(reply.body);
+      ++done;
+    });
+  }
+  auto deadline = steady_clock::now() + seconds(10);
+  while (done < requests && steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  ASSERT_EQ(requests, done.load());
+  EXPECT_EQ(0, failed.load());
+  EXPECT_EQ(0u, client.in_flight());
+  for (int i = 0; i < requests; ++i) {
+    EXPECT_EQ("echo " + std::to_string(i), replies[i]);
+  }
+}
+
+TEST_F(TEST_FIXTURE_NAME, timeout_and_queue_full)
+{
+  using namespace pfc;
+  using namespace std::chrono;
+
+  ReqRep_Server server(URI("inproc://req_rep_stalled"));
+  std::atomic<bool> gate(false);
+  server.async_listen(Listiner::MessageListenFunc([&](message request) {
+    while (!gate) {
+      std::this_thread::sleep_for(milliseconds(1));
+    }
+    return request;
+  }));
+
+  //One request occupies the only socket and two wait for it, the rest are refused
+  Client_Options options;
+  options.sockets = 1;
+  options.max_pending = 2;
+  ReqRep_Client client(URI("inproc://req_rep_stalled"), options);
+  auto started = steady_clock::now();
+  std::vector<std::future<Client_Reply>> replies;
+  for (int i = 0; i < 10; ++i) {
+    replies.push_back(client.request(text(std::to_string(i)), milliseconds(100)));
+  }
+  size_t full = 0;
+  size_t timed_out = 0;
+  for (auto& reply : replies) {
+    auto result = reply.get();
+    full += (result.ec == Error(Error::Code::PFC_QUEUE_FULL));
+    timed_out += (result.ec == Error(Error::Code::PFC_TIMEOUT));
+  }
+  EXPECT_GE(full, 7u);
+  EXPECT_EQ(10u, full + timed_out);
+  EXPECT_LT(steady_clock::now() - started, seconds(5));
+  EXPECT_EQ(0u, client.in_flight());
+
+  //Requests still queued at shutdown fail rather than wait for their timeout
+  auto pending = client.request(text("late"), seconds(60));
+  client.shutdown();
+  EXPECT_EQ(Error(Error::Code::PFC_LIBRARY_SHUTDOWN), pending.get().ec);
+  EXPECT_EQ(Error(Error::Code::PFC_LIBRARY_SHUTDOWN), client.request(text("closed")).get().ec);
+  gate = true;
+}
+
+TEST_F(TEST_FIXTURE_NAME, request_races_shutdown)
+{
+  using namespace pfc;
+  using namespace std::chrono;
+
+  ReqRep_Server server(URI("inproc://req_rep_shutdown_race"));
+  server.async_listen(Listiner::MessageListenFunc([](message request) { return request; }));
+
+  //Requests pushed while shutdown drains the queue must still complete, with a reply or PFC_LIBRARY_SHUTDOWN
+  Client_Options options;
+  options.max_pending = 2048;
+  for (int round = 0; round < 50; ++round) {
+    ReqRep_Client client(URI("inproc://req_rep_shutdown_race"), options);
+    std::atomic<int> completed(0);
+    std::atomic<int> sent(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> senders;
+    for (int sender = 0; sender < 8; ++sender) {
+      senders.emplace_back([&]() {
+        while (!go) {
+          std::this_thread::yield();
+        }
+        for (int i = 0; i < 200; ++i) {
+          ++sent;
+          client.request(text("race"), [&](Client_Reply reply) {
+            EXPECT_TRUE(reply.ec.is_ok() || reply.ec == Error(Error::Code::PFC_LIBRARY_SHUTDOWN));
+            ++completed;
+          });
+        }
+      });
+    }
+    go = true;
+    std::this_thread::sleep_for(microseconds(50 * (round % 10)));
+    client.shutdown();
+    for (auto& sender : senders) {
+      sender.join();
+    }
+    EXPECT_EQ(sent.load(), completed.load());
+    EXPECT_EQ(0u, client.in_flight());
+  }
+}
+
+TEST_F(TEST_FIXTURE_NAME, timeout_without_replicas)
+{
+  using namespace pfc;
+  using namespace std::chrono;
+
+  //No registry answers, so discovery never finds a replica and every request stays queued
+  Replica_Discovery discovery;
+  discovery.service = "missing";
+  discovery.watch = URI("inproc://req_rep_no_registry_watch");
+  discovery.snapshot = URI("inproc://req_rep_no_registry_snapshot");
+  ReqRep_Client client(discovery);
+
+  auto forever = client.request(text("forever"));
+  std::promise<Error> callback;
+  client.request(text("callback"), [&](Client_Reply reply) { callback.set_value(reply.ec); }, milliseconds(50));
+  auto future = client.request(text("future"), milliseconds(100));
+
+  auto called = callback.get_future();
+  ASSERT_EQ(std::future_status::ready, called.wait_for(seconds(5)));
+  EXPECT_EQ(Error(Error::Code::PFC_TIMEOUT), called.get());
+  ASSERT_EQ(std::future_status::ready, future.wait_for(seconds(5)));
+  EXPECT_EQ(Error(Error::Code::PFC_TIMEOUT), future.get().ec);
+
+  //A request without a timeout keeps waiting until shutdown
+  EXPECT_EQ(std::future_status::timeout, forever.wait_for(milliseconds(50)));
+  EXPECT_EQ(1u, client.in_flight());
+  client.shutdown();
+  EXPECT_EQ(Error(Error::Code::PFC_LIBRARY_SHUTDOWN), forever.get().ec);
+}
+
+TEST_F(TEST_FIXTURE_NAME, replica_balancing)
+{
+  using namespace pfc;
+  using namespace std::chrono;
+
+  std::atomic<int> first_calls(0);
+  std::atomic<int> second_calls(0);
+  ReqRep_Server first(URI("inproc://req_rep_replica_1"));
+  first.async_listen(Listiner::MessageListenFunc([&](message request) {
+    ++first_calls;
+    std::this_thread::sleep_for(milliseconds(2));
+    return request;
+  }));
+  ReqRep_Server second(URI("inproc://req_rep_replica_2"));
+  second.async_listen(Listiner::MessageListenFunc([&](message request) {
+    ++second_calls;
+    std::this_thread::sleep_for(milliseconds(2));
+    return request;
+  }));
+
+  ReqRep_Client client(URI("inproc://req_rep_replica_1"));
+  EXPECT_EQ(1u, client.replicas());
+  EXPECT_TRUE(client.add_replica(URI("inproc://req_rep_replica_2")).is_ok());
+  EXPECT_EQ(2u, client.replicas());
+
+  //Requests in flight together are spread over both replicas
+  std::vector<std::future<Client_Reply>> replies;
+  for (int i = 0; i < 40; ++i) {
+    replies.push_back(client.request(text(std::to_string(i)), seconds(5)));
+  }
+  for (int i = 0; i < 40; ++i) {
+    auto reply = replies[i].get();
+    EXPECT_TRUE(reply.ec.is_ok());
+    EXPECT_EQ(std::to_string(i), text(reply.body));
+  }
+  EXPECT_EQ(40, first_calls + second_calls);
+  EXPECT_GT(first_calls.load(), 0);
+  EXPECT_GT(second_calls.load(), 0);
+
+  //Once a replica is removed every request goes to the other
+  EXPECT_TRUE(client.remove_replica(URI("inproc://req_rep_replica_1")).is_ok());
+  EXPECT_EQ(1u, client.replicas());
+  first_calls = 0;
+  replies.clear();
+  for (int i = 0; i < 10; ++i) {
+    replies.push_back(client.request(text(std::to_string(i)), seconds(5)));
+  }
+  for (auto& reply : replies) {
+    EXPECT_TRUE(reply.get().ec.is_ok());
+  }
+  EXPECT_EQ(0, first_calls.load());
+}
+
+TEST_F(TEST_FIXTURE_NAME, hedged_requests)
+{
+  using namespace pfc;
+  using namespace std::chrono;
+
+  std::atomic<bool> gate(false);
+  ReqRep_Server stalled(URI("inproc://req_rep_hedge_stalled"));
+  stalled.async_listen(Listiner::MessageListenFunc([&](message) {
+    while (!gate) {
+      std::this_thread::sleep_for(milliseconds(1));
+    }
+    return text("stalled");
+  }));
+  ReqRep_Server fast(URI("inproc://req_rep_hedge_fast"));
+  fast.async_listen(Listiner::MessageListenFunc([](message request) { return request; }));
+
+  Client_Options options;
+  options.sockets = 2;
+  options.hedge_percentile = 0.5;
+  options.hedge_min_delay = milliseconds(5);
+  options.hedge_budget = 1.0;
+  ReqRep_Client client(URI("inproc://req_rep_hedge_stalled"), options);
+  client.add_replica(URI("inproc://req_rep_hedge_fast"));
+
+  //A request sent to the stalled replica is answered by its hedge well before its timeout
+  auto started = steady_clock::now();
+  for (int i = 0; i < 6; ++i) {
+    auto reply = client.request(text(std::to_string(i)), seconds(5)).get();
+    EXPECT_TRUE(reply.ec.is_ok());
+    EXPECT_EQ(std::to_string(i), text(reply.body));
+  }
+  EXPECT_LT(steady_clock::now() - started, seconds(2));
+  EXPECT_GT(client.hedged(), 0u);
+  gate = true;
+}
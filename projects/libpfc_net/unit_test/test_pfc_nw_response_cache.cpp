@@ -0,0 +1,97 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include <sustain/framework/net/patterns/req_rep/Response_Cache.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#ifdef DISABLE_SUSTAIN_Response_Cache_TEST
+#define TEST_FIXTURE_NAME DISABLED_Response_Cache_Fixture
+#else
+#define TEST_FIXTURE_NAME Response_Cache_Fixture
+#endif
+
+namespace {
+pfc::message bytes(const std::string& text)
+{
+  return pfc::message(text.data(), text.size(), pfc::message::Storage::pooled);
+}
+
+std::string text(const pfc::message& value)
+{
+  return std::string(value.data(), value.size());
+}
+}
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+TEST_F(TEST_FIXTURE_NAME, lru_and_invalidation)
+{
+  using namespace pfc;
+
+  Response_Cache_Options options;
+  options.shards = 1;
+  options.max_bytes = 3 * (64 + 8);
+  Response_Cache cache(options);
+
+  message response;
+  EXPECT_FALSE(cache.lookup(bytes("get/hr"), response));
+  EXPECT_TRUE(cache.store(bytes("get/hr"), bytes("72"), cache.generation()));
+  EXPECT_TRUE(cache.store(bytes("get/bp"), bytes("12"), cache.generation()));
+  EXPECT_TRUE(cache.store(bytes("get/rr"), bytes("16"), cache.generation()));
+  ASSERT_TRUE(cache.lookup(bytes("get/hr"), response));
+  EXPECT_EQ("72", text(response));
+
+  //get/bp is now the least recently used and makes room for get/o2
+  EXPECT_TRUE(cache.store(bytes("get/o2"), bytes("98"), cache.generation()));
+  EXPECT_EQ(3u, cache.size());
+  EXPECT_EQ(1u, cache.evictions());
+  EXPECT_FALSE(cache.lookup(bytes("get/bp"), response));
+  EXPECT_TRUE(cache.lookup(bytes("get/rr"), response));
+
+  EXPECT_TRUE(cache.invalidate(bytes("get/rr")));
+  EXPECT_FALSE(cache.invalidate(bytes("get/rr")));
+  EXPECT_EQ(1u, cache.invalidate_if([](const char* request, size_t size) { return size == 6 && std::string(request, size) == "get/o2"; }));
+  EXPECT_EQ(1u, cache.size());
+
+  //A reply computed across an invalidation may be stale and is not kept
+  auto generation = cache.generation();
+  cache.clear();
+  EXPECT_FALSE(cache.store(bytes("get/hr"), bytes("70"), generation));
+  EXPECT_EQ(0u, cache.size());
+  EXPECT_EQ(0u, cache.bytes());
+  EXPECT_EQ(2u, cache.hits());
+}
+
+TEST_F(TEST_FIXTURE_NAME, time_to_live)
+{
+  using namespace pfc;
+
+  Response_Cache_Options options;
+  options.ttl = std::chrono::milliseconds(20);
+  Response_Cache cache(options);
+
+  message response;
+  EXPECT_TRUE(cache.store(bytes("config"), bytes("{}"), cache.generation()));
+  EXPECT_TRUE(cache.lookup(bytes("config"), response));
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  EXPECT_FALSE(cache.lookup(bytes("config"), response));
+  EXPECT_EQ(0u, cache.size());
+}
@@ -0,0 +1,99 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include <sustain/framework/net/Shm_Ring.h>
+#include <sustain/framework/net/patterns/pub_sub/Publisher.h>
+#include <sustain/framework/net/patterns/pub_sub/Subscriber.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#if defined(DISABLE_SUSTAIN_Shm_Ring_TEST) || !defined(__linux__)
+#define TEST_FIXTURE_NAME DISABLED_Shm_Ring_Fixture
+#else
+#define TEST_FIXTURE_NAME Shm_Ring_Fixture
+#endif
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+TEST_F(TEST_FIXTURE_NAME, shm_ring_overrun)
+{
+  using namespace pfc;
+  using std::chrono::milliseconds;
+
+  Shm_Ring reader("pfc_unit_test_ring", Shm_Role::reader);
+  message next;
+  EXPECT_FALSE(reader.read(next, milliseconds(0)));
+
+  Shm_Ring writer("pfc_unit_test_ring", Shm_Role::writer, 4096);
+  ASSERT_TRUE(writer.is_valid());
+  Shm_Ring second("pfc_unit_test_ring", Shm_Role::writer);
+  EXPECT_EQ(Error(Error::Code::PFC_ADDRESS_IN_USE), second.error());
+  EXPECT_FALSE(writer.write(std::string(8192, 'x').data(), 8192));
+
+  //Attaches at the newest record, so only what is written afterwards is read
+  EXPECT_FALSE(reader.read(next, milliseconds(20)));
+  ASSERT_TRUE(writer.write("first", 5));
+  ASSERT_TRUE(reader.read(next, milliseconds(100)));
+  EXPECT_EQ("first", std::string(next.data(), next.size()));
+
+  //Forty 112 byte records lap a 4096 byte ring
+  std::string payload(96, 'p');
+  for (int i = 0; i < 40; ++i) {
+    ASSERT_TRUE(writer.write(payload.data(), payload.size()));
+  }
+  EXPECT_FALSE(reader.read(next, milliseconds(0)));
+  ASSERT_TRUE(writer.write("last", 4));
+  ASSERT_TRUE(reader.read(next, milliseconds(100)));
+  EXPECT_EQ("last", std::string(next.data(), next.size()));
+  EXPECT_EQ(40u, reader.lost());
+}
+
+TEST_F(TEST_FIXTURE_NAME, shm_pub_sub)
+{
+  using namespace pfc;
+
+  PubSub_Subscriber vitals(URI("shm://pfc_unit_test_pub_sub"), "vitals/");
+  PubSub_Publisher publisher(URI("shm://pfc_unit_test_pub_sub"));
+
+  std::atomic<int> received(0);
+  std::atomic<int> unwanted(0);
+  vitals.async_listen([&](message published) {
+    if (std::string(published.data(), published.size()).compare(0, 7, "vitals/") == 0) {
+      ++received;
+    } else {
+      ++unwanted;
+    }
+    return message();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_FALSE(publisher.publish(message(i % 2 ? "vitals/hr" : "labs/lact", 9)));
+  }
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (received < 500 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  vitals.shutdown();
+  EXPECT_EQ(500, received);
+  EXPECT_EQ(0, unwanted);
+}
@@ -0,0 +1,87 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include <sustain/framework/util/Spsc_Queue.h>
+
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#ifdef DISABLE_SUSTAIN_Spsc_Queue_TEST
+#define TEST_FIXTURE_NAME DISABLED_Spsc_Queue_Fixture
+#else
+#define TEST_FIXTURE_NAME Spsc_Queue_Fixture
+#endif
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+TEST_F(TEST_FIXTURE_NAME, spsc_queue_bounded)
+{
+  using namespace pfc;
+
+  Spsc_Queue<std::string> queue(3);
+  EXPECT_EQ(4u, queue.capacity());
+  EXPECT_TRUE(queue.empty());
+
+  std::string value;
+  EXPECT_FALSE(queue.try_pop(value));
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 4; ++i) {
+      EXPECT_TRUE(queue.try_push(std::to_string(i)));
+    }
+    EXPECT_FALSE(queue.try_push("overflow"));
+    EXPECT_EQ(4u, queue.size());
+    for (int i = 0; i < 4; ++i) {
+      EXPECT_TRUE(queue.try_pop(value));
+      EXPECT_EQ(std::to_string(i), value);
+    }
+    EXPECT_TRUE(queue.empty());
+  }
+  EXPECT_EQ(4u, queue.high_water());
+}
+
+TEST_F(TEST_FIXTURE_NAME, spsc_queue_threaded)
+{
+  using namespace pfc;
+
+  constexpr size_t count = 1000000;
+  Spsc_Queue<size_t> queue(64);
+
+  std::thread producer([&queue]() {
+    for (size_t i = 0; i < count;) {
+      if (queue.try_push(i)) {
+        ++i;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  size_t expected = 0;
+  size_t value = 0;
+  while (expected < count) {
+    if (queue.try_pop(value)) {
+      ASSERT_EQ(expected, value);
+      ++expected;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+  EXPECT_TRUE(queue.empty());
+  EXPECT_LE(queue.high_water(), queue.capacity());
+}
@@ -0,0 +1,89 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include <sustain/framework/net/patterns/pub_sub/Publisher.h>
+#include <sustain/framework/net/patterns/pub_sub/Subscriber.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#ifdef DISABLE_SUSTAIN_Subscriber_TEST
+#define TEST_FIXTURE_NAME DISABLED_Subscriber_Fixture
+#else
+#define TEST_FIXTURE_NAME Subscriber_Fixture
+#endif
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+namespace {
+pfc::message text(const std::string& value)
+{
+  return pfc::message(value.data(), value.size());
+}
+std::string text(const pfc::message& value)
+{
+  return std::string(value.data(), value.size());
+}
+template <typename Predicate>
+bool wait_for(Predicate ready, std::chrono::milliseconds timeout = std::chrono::milliseconds(5000))
+{
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (!ready() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return ready();
+}
+}
+
+TEST_F(TEST_FIXTURE_NAME, subscribe_on_first_socket)
+{
+  using namespace pfc;
+
+  //nanomsg reuses the most recently closed socket first, so holding more subscribers than the
+  //process has ever had sockets open at once guarantees one of them is socket 0. They connect
+  //before the publisher binds so it can not take socket 0 first
+  constexpr size_t subscribers = 128;
+  std::vector<std::unique_ptr<PubSub_Subscriber>> subscribed;
+  std::atomic<size_t> ticks(0);
+  std::atomic<size_t> ends(0);
+  for (size_t i = 0; i < subscribers; ++i) {
+    subscribed.push_back(std::make_unique<PubSub_Subscriber>(URI("inproc://subscriber_first_socket"), "end"));
+    EXPECT_TRUE(subscribed.back()->subscribe("tick").is_ok());
+    subscribed.back()->async_listen(Listiner::MessageListenFunc([&](message published) {
+      ((text(published).compare(0, 4, "tick") == 0) ? ticks : ends)++;
+      return message();
+    }));
+  }
+  PubSub_Publisher publisher(URI("inproc://subscriber_first_socket"));
+
+  EXPECT_TRUE(publisher.publish(text("tick 1")).is_ok());
+  EXPECT_TRUE(wait_for([&]() { return ticks == subscribers; }));
+
+  //Once every subscriber dropped the topic, only the end marker published after it is delivered
+  for (auto& subscriber : subscribed) {
+    EXPECT_TRUE(subscriber->unsubscribe("tick").is_ok());
+  }
+  EXPECT_TRUE(publisher.publish(text("tick 2")).is_ok());
+  EXPECT_TRUE(publisher.publish(text("end")).is_ok());
+  EXPECT_TRUE(wait_for([&]() { return ends == subscribers; }));
+  EXPECT_EQ(subscribers, ticks.load());
+}
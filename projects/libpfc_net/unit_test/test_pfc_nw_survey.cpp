@@ -0,0 +1,321 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include <sustain/framework/net/patterns/survey/Participant.h>
+#include <sustain/framework/net/patterns/survey/Surveyor.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <nanomsg/nn.h>
+#include <nanomsg/survey.h>
+
+#ifdef DISABLE_SUSTAIN_Survey_TEST
+#define TEST_FIXTURE_NAME DISABLED_Survey_Fixture
+#else
+#define TEST_FIXTURE_NAME Survey_Fixture
+#endif
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+namespace {
+pfc::message text(const std::string& value)
+{
+  return pfc::message(value.data(), value.size());
+}
+std::string text(const pfc::message& value)
+{
+  return std::string(value.data(), value.size());
+}
+template <typename Predicate>
+bool wait_for(Predicate ready, std::chrono::milliseconds timeout = std::chrono::milliseconds(5000))
+{
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (!ready() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return ready();
+}
+//! Answers every survey on a plain RESPONDENT socket until destroyed
+class Respondent {
+public:
+  Respondent(const std::string& endpoint, std::function<std::string(const std::string&)> answer)
+    : socket(nn_socket(AF_SP, NN_RESPONDENT))
+  {
+    int timeout = 20;
+    nn_setsockopt(socket, NN_SOL_SOCKET, NN_RCVTIMEO, &timeout, sizeof(timeout));
+    nn_connect(socket, endpoint.c_str());
+    thread = std::thread([this, answer]() {
+      while (running) {
+        char* buffer = nullptr;
+        int bytes = nn_recv(socket, &buffer, NN_MSG, 0);
+        if (bytes < 0) {
+          continue;
+        }
+        auto response = answer(std::string(buffer, bytes));
+        nn_freemsg(buffer);
+        nn_send(socket, response.data(), response.size(), 0);
+      }
+    });
+  }
+  ~Respondent()
+  {
+    running = false;
+    thread.join();
+    nn_close(socket);
+  }
+
+private:
+  int socket;
+  std::atomic<bool> running { true };
+  std::thread thread;
+};
+}
+
+TEST_F(TEST_FIXTURE_NAME, quorum_and_deadline)
+{
+  using namespace pfc;
+  using namespace std::chrono;
+
+  Survey_Surveyor surveyor(URI("inproc://survey_quorum"));
+
+  //The first deadline requested is 0 ms, which must still replace the socket default of a second
+  Survey_Options immediate;
+  immediate.deadline = milliseconds(0);
+  auto started = steady_clock::now();
+  EXPECT_TRUE(surveyor.survey(text("nobody"), immediate, nullptr).ec.is_ok());
+  EXPECT_LT(steady_clock::now() - started, milliseconds(500));
+
+  std::vector<std::unique_ptr<Respondent>> participants;
+  for (int i = 0; i < 3; ++i) {
+    participants.push_back(std::make_unique<Respondent>("inproc://survey_quorum", [i](const std::string&) {
+      return std::to_string(i + 1);
+    }));
+  }
+
+  //Every participant answering ends the survey long before its deadline
+  Survey_Options options;
+  options.deadline = milliseconds(2000);
+  options.quorum = 3;
+  started = steady_clock::now();
+  auto sum = surveyor.survey(text("count"), options, 0, [](int total, const message& response) {
+    return total + std::stoi(text(response));
+  });
+  EXPECT_LT(steady_clock::now() - started, milliseconds(1000));
+  EXPECT_TRUE(sum.quorum_met);
+  EXPECT_TRUE(sum.ec.is_ok());
+  EXPECT_EQ(3u, sum.responses);
+  EXPECT_EQ(6, sum.value);
+
+  //A quorum that can not be met runs to the deadline and reports PFC_TIMEOUT
+  options.deadline = milliseconds(50);
+  options.quorum = 4;
+  started = steady_clock::now();
+  auto short_tally = surveyor.survey(text("count"), options, nullptr);
+  EXPECT_GE(steady_clock::now() - started, milliseconds(40));
+  EXPECT_FALSE(short_tally.quorum_met);
+  EXPECT_EQ(3u, short_tally.responses);
+  EXPECT_EQ(Error(Error::Code::PFC_TIMEOUT), short_tally.ec);
+
+  //Without a quorum every response before the deadline is collected and the survey succeeds
+  options.quorum = 0;
+  auto all = surveyor.survey(text("count"), options, nullptr);
+  EXPECT_FALSE(all.quorum_met);
+  EXPECT_EQ(3u, all.responses);
+  EXPECT_TRUE(all.ec.is_ok());
+}
+
+TEST_F(TEST_FIXTURE_NAME, survey_during_async_broadcast)
+{
+  using namespace pfc;
+  using namespace std::chrono;
+
+  Survey_Surveyor surveyor(URI("inproc://survey_mixed"));
+  std::vector<std::unique_ptr<Respondent>> participants;
+  for (int i = 0; i < 2; ++i) {
+    participants.push_back(std::make_unique<Respondent>("inproc://survey_mixed", [](const std::string& survey) {
+      return "answer " + survey;
+    }));
+  }
+
+  Survey_Options options;
+  options.deadline = milliseconds(30);
+  options.quorum = 2;
+
+  std::mutex broadcast_mutex;
+  std::vector<std::string> broadcast_responses;
+  surveyor.set_response_callaback_func([&](std::istream& response) {
+    std::lock_guard<std::mutex> guard(broadcast_mutex);
+    broadcast_responses.emplace_back(std::istreambuf_iterator<char>(response), std::istreambuf_iterator<char>());
+  });
+  surveyor.async_broadcast(Broadcaster::MessageFunc([]() { return text("broadcast"); }));
+
+  //Neither side may cancel the others survey or read its responses
+  for (int i = 0; i < 2; ++i) {
+    auto tally = surveyor.survey(text("survey"), options, [](message response) {
+      EXPECT_EQ("answer survey", text(response));
+    });
+    EXPECT_TRUE(tally.quorum_met);
+    EXPECT_EQ(2u, tally.responses);
+  }
+  surveyor.shutdown();
+
+  std::lock_guard<std::mutex> guard(broadcast_mutex);
+  EXPECT_FALSE(broadcast_responses.empty());
+  for (auto& response : broadcast_responses) {
+    EXPECT_EQ("answer broadcast", response);
+  }
+}
+
+TEST_F(TEST_FIXTURE_NAME, survey_restores_broadcast_deadline)
+{
+  using namespace pfc;
+  using namespace std::chrono;
+
+  Survey_Surveyor surveyor(URI("inproc://survey_restore"));
+
+  //A short survey must not shorten the broadcasts, which run with the default deadline of a second
+  Survey_Options options;
+  options.deadline = milliseconds(10);
+  EXPECT_TRUE(surveyor.survey(text("nobody"), options, nullptr).ec.is_ok());
+
+  auto started = steady_clock::now();
+  surveyor.broadcast(Broadcaster::MessageFunc([]() { return text("broadcast"); }));
+  EXPECT_GE(steady_clock::now() - started, milliseconds(900));
+}
+
+TEST_F(TEST_FIXTURE_NAME, worker_pool_concurrency)
+{
+  using namespace pfc;
+  using namespace std::chrono;
+
+  Survey_Surveyor surveyor(URI("inproc://survey_workers"));
+  Participant_Options options;
+  options.workers = 2;
+  Survey_Participant participant(URI("inproc://survey_workers"), options);
+  std::atomic<int> running(0);
+  std::atomic<int> overlap(0);
+  participant.async_listen(Listiner::MessageListenFunc([&](message survey) {
+    auto now = ++running;
+    overlap = std::max(overlap.load(), now);
+    if (text(survey) == "slow") {
+      std::this_thread::sleep_for(milliseconds(300));
+    }
+    --running;
+    return text("answer " + text(survey));
+  }));
+
+  //The slow survey holds one worker well past its deadline, the other worker still answers the next survey
+  Survey_Options slow;
+  slow.deadline = milliseconds(10);
+  EXPECT_EQ(0u, surveyor.survey(text("slow"), slow, nullptr).responses);
+
+  Survey_Options fast;
+  fast.deadline = milliseconds(1000);
+  fast.quorum = 1;
+  std::string answer;
+  auto started = steady_clock::now();
+  auto tally = surveyor.survey(text("fast"), fast, [&](message response) { answer = text(response); });
+  EXPECT_TRUE(tally.quorum_met);
+  EXPECT_TRUE(tally.ec.is_ok());
+  EXPECT_EQ("answer fast", answer);
+  EXPECT_LT(steady_clock::now() - started, milliseconds(200));
+  EXPECT_EQ(2, overlap.load());
+
+  //Without a deadline the late answer to the slow survey is still sent, and nanomsg discards it
+  EXPECT_TRUE(wait_for([&]() { return participant.answered() == 2; }));
+  EXPECT_EQ(0u, participant.expired());
+  EXPECT_EQ(0u, participant.shed());
+
+  //Shutdown waits for the worker inside the ListenFunc, which still sends on the open socket
+  surveyor.survey(text("slow"), slow, nullptr);
+  EXPECT_TRUE(wait_for([&]() { return running == 1; }));
+  participant.shutdown();
+  EXPECT_EQ(0, running.load());
+  EXPECT_EQ(3u, participant.answered());
+}
+
+TEST_F(TEST_FIXTURE_NAME, worker_pool_deadline)
+{
+  using namespace pfc;
+  using namespace std::chrono;
+
+  Survey_Surveyor surveyor(URI("inproc://survey_deadline"));
+  Participant_Options options;
+  options.workers = 1;
+  options.deadline = milliseconds(20);
+  Survey_Participant participant(URI("inproc://survey_deadline"), options);
+  std::atomic<int> calls(0);
+  participant.async_listen(Listiner::MessageListenFunc([&](message survey) {
+    ++calls;
+    std::this_thread::sleep_for(milliseconds(100));
+    return survey;
+  }));
+
+  //The first survey outlives its deadline in the ListenFunc, the rest expire waiting behind it
+  Survey_Options survey_options;
+  survey_options.deadline = milliseconds(20);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(0u, surveyor.survey(text(std::to_string(i)), survey_options, nullptr).responses);
+  }
+  EXPECT_TRUE(wait_for([&]() { return participant.expired() == 3; }));
+  EXPECT_EQ(1, calls.load());
+  EXPECT_EQ(0u, participant.answered());
+}
+
+TEST_F(TEST_FIXTURE_NAME, worker_pool_shedding)
+{
+  using namespace pfc;
+  using namespace std::chrono;
+
+  Survey_Surveyor surveyor(URI("inproc://survey_shedding"));
+  Participant_Options options;
+  options.workers = 1;
+  options.max_in_flight = 2;
+  Survey_Participant participant(URI("inproc://survey_shedding"), options);
+  std::atomic<bool> gate(false);
+  participant.async_listen(Listiner::MessageListenFunc([&](message survey) {
+    while (!gate) {
+      std::this_thread::sleep_for(milliseconds(1));
+    }
+    return survey;
+  }));
+
+  //The held survey and one queued behind it are in flight, so every later survey is shed
+  Survey_Options survey_options;
+  survey_options.deadline = milliseconds(5);
+  for (int i = 0; i < 5; ++i) {
+    surveyor.survey(text(std::to_string(i)), survey_options, nullptr);
+  }
+  EXPECT_TRUE(wait_for([&]() { return participant.shed() == 3; }));
+  gate = true;
+  EXPECT_TRUE(wait_for([&]() { return participant.answered() == 2; }));
+  EXPECT_EQ(3u, participant.shed());
+
+  //Shutdown joins the workers before the socket closes, after which the participant is inert
+  participant.shutdown();
+  survey_options.deadline = milliseconds(20);
+  EXPECT_EQ(0u, surveyor.survey(text("closed"), survey_options, nullptr).responses);
+}
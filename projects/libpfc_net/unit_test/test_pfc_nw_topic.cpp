@@ -0,0 +1,142 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include <sustain/framework/Protocol.h>
+#include <sustain/framework/net/patterns/pub_sub/Topic_Dispatcher.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#ifdef DISABLE_SUSTAIN_Topic_TEST
+#define TEST_FIXTURE_NAME DISABLED_Topic_Fixture
+#else
+#define TEST_FIXTURE_NAME Topic_Fixture
+#endif
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+TEST_F(TEST_FIXTURE_NAME, topic_framing)
+{
+  using namespace pfc;
+
+  auto framed = topic_message("vitals/heart_rate", 3);
+  framed.append("072", 3);
+
+  Topic_Frame frame;
+  ASSERT_TRUE(split_topic(framed, frame));
+  EXPECT_EQ("vitals/heart_rate", frame.topic_string());
+  EXPECT_EQ("072", std::string(frame.payload, frame.payload_size));
+
+  //nanomsg matches leading bytes, so the separator turns a prefix filter in to an exact one
+  auto filter = exact_topic("vitals/heart_rate");
+  EXPECT_EQ(0, std::string(framed.data(), framed.size()).compare(0, filter.size(), filter));
+  EXPECT_NE(0, std::string("vitals/heart_rate_variability").compare(0, filter.size(), filter));
+
+  EXPECT_FALSE(split_topic(message("no topic", 8), frame));
+}
+
+TEST_F(TEST_FIXTURE_NAME, topic_typed_dispatch)
+{
+  using namespace pfc;
+
+  PubSub_Subscriber subscriber(URI("inproc://pfc_topic_dispatch_test"));
+  Topic_Dispatcher dispatcher(subscriber);
+
+  std::vector<std::string> calls;
+  EXPECT_FALSE(dispatcher.on<pfc_registry_delta>(registry_topic(pfc_protocol::pub_sub, "physiology"),
+                                                  [&calls](const Topic_Frame& frame, pfc_registry_delta& delta) {
+                                                    calls.push_back("delta " + frame.topic_string() + " " + delta._name);
+                                                  }));
+  EXPECT_FALSE(dispatcher.on_frame("pub_sub/", [&calls](const Topic_Frame& frame) { calls.push_back("pub_sub " + frame.topic_string()); },
+                                   Topic_Match::prefix));
+  EXPECT_FALSE(dispatcher.on_frame("pub_sub/physiology.", [&calls](const Topic_Frame& frame) { calls.push_back("physiology " + frame.topic_string()); },
+                                   Topic_Match::prefix));
+
+  pfc_registry_delta delta;
+  delta._protacol = pfc_protocol::pub_sub;
+  delta._name = "physiology";
+  auto framed = topic_message(registry_topic(delta._protacol, delta._name), delta.Length());
+  {
+    message_ostream os(framed);
+    delta.serialize(os);
+  }
+  dispatcher.dispatch(framed);
+  dispatcher.dispatch(topic_message("pub_sub/physiology.cardiovascular"));
+  dispatcher.dispatch(topic_message("pub_sub/respiratory"));
+  dispatcher.dispatch(topic_message("req_rep/physiology"));
+
+  //The exact topic with an undeserializable payload
+  auto truncated = topic_message("pub_sub/physiology");
+  truncated.append("\x07", 1);
+  dispatcher.dispatch(truncated);
+
+  ASSERT_EQ(3u, calls.size());
+  EXPECT_EQ("delta pub_sub/physiology physiology", calls[0]);
+  EXPECT_EQ("physiology pub_sub/physiology.cardiovascular", calls[1]);
+  EXPECT_EQ("pub_sub pub_sub/respiratory", calls[2]);
+  EXPECT_EQ(4u, dispatcher.dispatched());
+  EXPECT_EQ(1u, dispatcher.unmatched());
+  EXPECT_EQ(1u, dispatcher.malformed());
+
+  EXPECT_FALSE(dispatcher.off("pub_sub/", Topic_Match::prefix));
+  EXPECT_TRUE(dispatcher.off("pub_sub/", Topic_Match::prefix));
+  dispatcher.dispatch(topic_message("pub_sub/respiratory"));
+  EXPECT_EQ(2u, dispatcher.unmatched());
+}
+
+TEST_F(TEST_FIXTURE_NAME, topic_batch)
+{
+  using namespace pfc;
+
+  auto batch = topic_batch("vitals/heart_rate", 64);
+  append_topic_batch(batch, "072", 3);
+  append_topic_batch(batch, "", 0);
+  append_topic_batch(batch, "075", 3);
+
+  //The batch is filtered by nanomsg exactly like the messages it carries
+  auto filter = exact_topic("vitals/heart_rate");
+  EXPECT_EQ(0, std::string(batch.data(), batch.size()).compare(0, filter.size(), filter));
+
+  Topic_Frame frame;
+  ASSERT_TRUE(split_topic(batch, frame));
+  ASSERT_TRUE(is_topic_batch(frame));
+
+  std::vector<std::string> unpacked;
+  EXPECT_TRUE(unpack_topic_batch(frame, [&unpacked](message framed) {
+    Topic_Frame inner;
+    ASSERT_TRUE(split_topic(framed, inner));
+    EXPECT_EQ("vitals/heart_rate", inner.topic_string());
+    unpacked.emplace_back(inner.payload, inner.payload_size);
+  }));
+  ASSERT_EQ(3u, unpacked.size());
+  EXPECT_EQ("072", unpacked[0]);
+  EXPECT_EQ("", unpacked[1]);
+  EXPECT_EQ("075", unpacked[2]);
+
+  //A truncated batch still yields the messages before the damage
+  message truncated(batch.data(), batch.size() - 1, message::Storage::pooled);
+  ASSERT_TRUE(split_topic(truncated, frame));
+  unpacked.clear();
+  EXPECT_FALSE(unpack_topic_batch(frame, [&unpacked](message framed) { unpacked.emplace_back(framed.data(), framed.size()); }));
+  EXPECT_EQ(2u, unpacked.size());
+
+  auto single = topic_message("vitals/heart_rate");
+  single.append("072", 3);
+  ASSERT_TRUE(split_topic(single, frame));
+  EXPECT_FALSE(is_topic_batch(frame));
+}
@@ -0,0 +1,59 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include <sustain/framework/net/Uri.h>
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#ifdef DISABLE_SUSTAIN_Uri_TEST
+#define TEST_FIXTURE_NAME DISABLED_Uri_Fixture
+#else
+#define TEST_FIXTURE_NAME Uri_Fixture
+#endif
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+TEST_F(TEST_FIXTURE_NAME, parse_endpoints)
+{
+  using namespace pfc;
+
+  URI any("tcp://*:30004");
+  EXPECT_TRUE(any.is_valid());
+  EXPECT_EQ("tcp", any.transport());
+  EXPECT_EQ("*", any.address());
+  EXPECT_EQ(30004, any.port_i());
+  EXPECT_EQ(std::string("tcp://*:30004"), any.c_str());
+
+  URI ipv6("tcp://[::1]:30005");
+  EXPECT_TRUE(ipv6.is_valid());
+  EXPECT_EQ("[::1]", ipv6.address());
+  EXPECT_EQ("30005", ipv6.port());
+
+  //Without a port the default is kept and c_str is still the endpoint nanomsg expects
+  URI local("inproc://registry-feed");
+  EXPECT_TRUE(local.is_valid());
+  EXPECT_EQ("registry-feed", local.address());
+  EXPECT_EQ("80", local.port());
+  EXPECT_EQ(std::string("inproc://registry-feed"), local.c_str());
+
+  URI built("tcp", "10.0.0.1", 30001);
+  EXPECT_TRUE(built.is_valid());
+  EXPECT_EQ(std::string("tcp://10.0.0.1:30001"), built.c_str());
+
+  EXPECT_FALSE(URI("tcp:/missing").is_valid());
+}
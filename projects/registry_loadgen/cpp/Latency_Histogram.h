@@ -0,0 +1,138 @@
+#ifndef SUSTAIN_LOADGEN_LATENCY_HISTOGRAM_H
+#define SUSTAIN_LOADGEN_LATENCY_HISTOGRAM_H
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+//!
+//! \brief Fixed memory latency histogram used to report percentiles of the registry echo
+//!
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace pfc {
+
+//!
+//!  Log linear histogram of microsecond samples. Every power of two is split in to 16 buckets
+//!  so any percentile is reported within about 6% of the true value no matter the range.
+//!  record is lock free so the receive thread never waits on the reporting thread.
+//!
+class Latency_Histogram {
+public:
+  static constexpr size_t sub_buckets = 16;
+  static constexpr size_t bucket_count = 38 * sub_buckets; //!< Covers up to 2^41us, about 25 days
+
+  //! Copy of the counters at one point in time. Subtract two snapshots for the samples in between
+  struct Snapshot {
+    std::array<uint64_t, bucket_count> counts {};
+    uint64_t total = 0;
+
+    double percentile(double fraction) const;
+    Snapshot operator-(const Snapshot&) const;
+  };
+
+  Latency_Histogram();
+  Latency_Histogram(const Latency_Histogram&) = delete;
+  Latency_Histogram& operator=(const Latency_Histogram&) = delete;
+
+  void record(uint64_t microseconds);
+  Snapshot snapshot() const;
+
+  static size_t bucket_of(uint64_t microseconds);
+  static uint64_t upper_bound(size_t bucket);
+
+private:
+  std::array<std::atomic<uint64_t>, bucket_count> _counts;
+};
+//-----------------------------------------------------------------------------
+inline Latency_Histogram::Latency_Histogram()
+{
+  for (auto& count : _counts) {
+    count.store(0, std::memory_order_relaxed);
+  }
+}
+//-----------------------------------------------------------------------------
+//! \param microseconds [IN] -- Sample to add. Samples past the last bucket are clamped in to it
+inline void Latency_Histogram::record(uint64_t microseconds)
+{
+  _counts[bucket_of(microseconds)].fetch_add(1, std::memory_order_relaxed);
+}
+//-----------------------------------------------------------------------------
+//! \return Snapshot -- Counters as of now. Samples recorded during the copy may or may not be included
+inline Latency_Histogram::Snapshot Latency_Histogram::snapshot() const
+{
+  Snapshot result;
+  for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+    result.counts[bucket] = _counts[bucket].load(std::memory_order_relaxed);
+    result.total += result.counts[bucket];
+  }
+  return result;
+}
+//-----------------------------------------------------------------------------
+//! Values below sub_buckets get a bucket each, after that every power of two gets sub_buckets buckets
+inline size_t Latency_Histogram::bucket_of(uint64_t microseconds)
+{
+  if (microseconds < sub_buckets) {
+    return static_cast<size_t>(microseconds);
+  }
+  size_t msb = 0;
+  for (auto value = microseconds; value > 1; value >>= 1) {
+    ++msb;
+  }
+  auto shift = msb - 4;
+  auto bucket = (shift + 1) * sub_buckets + static_cast<size_t>((microseconds >> shift) & (sub_buckets - 1));
+  return (bucket < bucket_count) ? bucket : bucket_count - 1;
+}
+//-----------------------------------------------------------------------------
+//! \return uint64_t -- Largest value which falls in to bucket
+inline uint64_t Latency_Histogram::upper_bound(size_t bucket)
+{
+  if (bucket < sub_buckets) {
+    return bucket;
+  }
+  auto shift = bucket / sub_buckets - 1;
+  auto sub = bucket % sub_buckets;
+  return ((sub_buckets + sub + 1) << shift) - 1;
+}
+//-----------------------------------------------------------------------------
+//! \param fraction [IN] -- Percentile as a fraction ex 0.99
+//! \return double -- Upper bound in microseconds of the bucket holding the percentile or 0 when empty
+inline double Latency_Histogram::Snapshot::percentile(double fraction) const
+{
+  if (total == 0) {
+    return 0.0;
+  }
+  auto rank = static_cast<uint64_t>(fraction * static_cast<double>(total - 1)) + 1;
+  uint64_t seen = 0;
+  for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+    seen += counts[bucket];
+    if (seen >= rank) {
+      return static_cast<double>(upper_bound(bucket));
+    }
+  }
+  return static_cast<double>(upper_bound(bucket_count - 1));
+}
+//-----------------------------------------------------------------------------
+inline Latency_Histogram::Snapshot Latency_Histogram::Snapshot::operator-(const Snapshot& rhs) const
+{
+  Snapshot result;
+  for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+    result.counts[bucket] = counts[bucket] - rhs.counts[bucket];
+  }
+  result.total = total - rhs.total;
+  return result;
+}
+} //namespace pfc
+
+#endif //SUSTAIN_LOADGEN_LATENCY_HISTOGRAM_H
@@ -0,0 +1,361 @@
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+#include "Load_Generator.h"
+#include "Latency_Histogram.h"
+#include "Process_Usage.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <sustain/framework/Protocol.h>
+#include <sustain/framework/net/Multicast_Receiver.h>
+#include <sustain/framework/net/Multicast_Sender.h>
+#include <sustain/framework/util/Constants.h>
+
+namespace pfc {
+namespace {
+  constexpr char g_service_prefix[] = "loadgen-"; //!< Simulated services are named loadgen-<id>
+  constexpr pfc_ushort g_service_port = 20000; //!< Port every simulated service announces
+  constexpr size_t g_echo_buffer_size = 65536; //!< Receive buffer large enough for any UDP datagram
+  constexpr auto g_pacing_tick = std::chrono::milliseconds(1); //!< Sleep between paced sends when ahead of schedule
+  constexpr auto g_drain_time = std::chrono::seconds(2); //!< Time allowed for echos still in flight when the run ends
+
+  //! \return pfc_string -- Unique IPv4 address of a simulated service. Services are keyed by address
+  pfc_string address_of(size_t id)
+  {
+    std::ostringstream os;
+    os << "10." << ((id >> 16) & 0xff) << "." << ((id >> 8) & 0xff) << "." << (id & 0xff);
+    return os.str();
+  }
+  //! \return std::string -- Wire format of a message, built once so the send loop does not serialize
+  std::string wire(const pfc_message& message)
+  {
+    std::ostringstream os;
+    message.serialize(os);
+    return os.str();
+  }
+  //! \return int64_t -- Monotonic nanoseconds. Never 0 so 0 can mean no announcement outstanding
+  int64_t now_ns()
+  {
+    auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    return (now != 0) ? now : 1;
+  }
+}
+
+//!
+//! Counters at one point in time. Reports are the difference of two Totals
+//!
+struct Load_Totals {
+  std::chrono::steady_clock::time_point time;
+  uint64_t announced = 0;
+  uint64_t signoffs = 0;
+  uint64_t echoed = 0;
+  uint64_t lost = 0;
+  uint64_t unmatched = 0;
+  Latency_Histogram::Snapshot latency;
+  bool sampled = false;
+  Process_Sample registry;
+};
+
+struct Load_Generator::Implementation {
+  explicit Implementation(Load_Config&&);
+
+  void send_cycles();
+  void send(size_t id, bool signoff);
+  bool wait_until(std::chrono::steady_clock::time_point);
+  void process_echo(std::istream&);
+  Load_Totals collect();
+  Load_Report difference(const Load_Totals& first, const Load_Totals& second) const;
+
+  Load_Config config;
+  Multicast_Sender sender;
+  Multicast_Receiver receiver;
+
+  std::vector<std::string> announcements; //!< Serialized announcement of each service
+  std::vector<std::string> signoffs; //!< Serialized signoff of each service
+  std::vector<std::atomic<int64_t>> pending; //!< Send time of the outstanding announcement of each service or 0
+
+  std::atomic<uint64_t> announced;
+  std::atomic<uint64_t> signed_off;
+  std::atomic<uint64_t> echoed;
+  std::atomic<uint64_t> lost;
+  std::atomic<uint64_t> unmatched;
+  Latency_Histogram latency;
+
+  std::mutex stop_mutex;
+  std::condition_variable stop_condition;
+  std::atomic<bool> running;
+  std::thread sender_thread;
+};
+//-----------------------------------------------------------------------------
+Load_Generator::Implementation::Implementation(Load_Config&& c)
+  : config(std::move(c))
+  , sender(config.multicast_address, g_pfc_registry_reg_port)
+  , receiver(config.bind_address, config.multicast_address, g_pfc_registry_announce_port)
+  , pending(config.services)
+  , announced(0)
+  , signed_off(0)
+  , echoed(0)
+  , lost(0)
+  , unmatched(0)
+  , running(false)
+{
+  receiver.buffer_legth(g_echo_buffer_size);
+  announcements.reserve(config.services);
+  signoffs.reserve(config.services);
+  for (size_t id = 0; id < config.services; ++id) {
+    pfc_service_announcement announcement;
+    announcement._port = g_service_port;
+    announcement._protacol = pfc_protocol::pub_sub;
+    announcement._name = g_service_prefix + std::to_string(id);
+    announcement._address = address_of(id);
+    announcement._brief = "Simulated by pfc_registry_loadgen";
+    announcements.push_back(wire(announcement));
+
+    pfc_service_signoff signoff;
+    signoff._port = announcement._port;
+    signoff._protacol = announcement._protacol;
+    signoff._name = announcement._name;
+    signoff._address = announcement._address;
+    signoff._brief = announcement._brief;
+    signoffs.push_back(wire(signoff));
+
+    pending[id] = 0;
+  }
+}
+//-----------------------------------------------------------------------------
+//! Sender thread. Every cycle each service sends one announcement, or a signoff when it churns.
+//! Paced cycles spread the sends evenly, burst cycles send back to back.
+void Load_Generator::Implementation::send_cycles()
+{
+  auto service_count = config.services;
+  auto per_second = (config.rate > 0.0) ? config.rate : service_count / config.interval;
+  auto cycle_length = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(service_count / per_second));
+  auto churn_count = static_cast<size_t>(config.churn * service_count + 0.5);
+
+  std::vector<bool> offline(service_count, false);
+  std::vector<bool> churning(service_count, false);
+  std::mt19937 random(std::random_device {}());
+  std::uniform_int_distribution<size_t> pick(0, (service_count) ? service_count - 1 : 0);
+
+  for (uint64_t cycle = 0; running; ++cycle) {
+    auto cycle_start = std::chrono::steady_clock::now();
+    auto burst = config.burst_every > 0 && (cycle % config.burst_every) == static_cast<uint64_t>(config.burst_every - 1);
+
+    std::fill(churning.begin(), churning.end(), false);
+    for (size_t chosen = 0; chosen < churn_count; ++chosen) {
+      churning[pick(random)] = true;
+    }
+
+    for (size_t id = 0; id < service_count && running; ++id) {
+      while (!burst && running) {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - cycle_start;
+        if (id < elapsed.count() * per_second + 1.0) {
+          break;
+        }
+        std::this_thread::sleep_for(g_pacing_tick);
+      }
+      if (offline[id]) {
+        offline[id] = false;
+        send(id, false);
+      } else if (churning[id]) {
+        offline[id] = true;
+        send(id, true);
+      } else {
+        send(id, false);
+      }
+    }
+    wait_until(cycle_start + cycle_length);
+  }
+}
+//-----------------------------------------------------------------------------
+//! An announcement still outstanding when the same service sends again was never echoed and counts as lost
+void Load_Generator::Implementation::send(size_t id, bool signoff)
+{
+  if (pending[id].exchange((signoff) ? 0 : now_ns())) {
+    ++lost;
+  }
+  auto& message = (signoff) ? signoffs[id] : announcements[id];
+  sender.send([&message](std::ostream& os) { os.write(message.data(), message.size()); });
+  if (signoff) {
+    ++signed_off;
+  } else {
+    ++announced;
+  }
+}
+//-----------------------------------------------------------------------------
+//! \return bool -- false when stop() interrupted the wait
+bool Load_Generator::Implementation::wait_until(std::chrono::steady_clock::time_point deadline)
+{
+  std::unique_lock<std::mutex> lock(stop_mutex);
+  return !stop_condition.wait_until(lock, deadline, [this]() { return !running; });
+}
+//-----------------------------------------------------------------------------
+//! Receive thread. The registry packs several announcements in to each datagram
+void Load_Generator::Implementation::process_echo(std::istream& is)
+{
+  pfc_service_announcement announcement;
+  while (peek_message_type(is) == SERVICE_Announcement_REQUEST && announcement.deserialize(is).is_ok() && !is.fail()) {
+    auto& name = announcement._name;
+    auto prefix_length = sizeof(g_service_prefix) - 1;
+    if (name.compare(0, prefix_length, g_service_prefix) != 0) {
+      continue;
+    }
+    auto id = std::strtoull(name.c_str() + prefix_length, nullptr, 10);
+    if (id >= pending.size()) {
+      continue;
+    }
+    auto sent = pending[id].exchange(0);
+    if (sent) {
+      latency.record(static_cast<uint64_t>(now_ns() - sent) / 1000);
+      ++echoed;
+    } else {
+      ++unmatched;
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+Load_Totals Load_Generator::Implementation::collect()
+{
+  Load_Totals totals;
+  totals.time = std::chrono::steady_clock::now();
+  totals.announced = announced;
+  totals.signoffs = signed_off;
+  totals.echoed = echoed;
+  totals.lost = lost;
+  totals.unmatched = unmatched;
+  totals.latency = latency.snapshot();
+  if (config.registry_pid) {
+    totals.sampled = sample_process(config.registry_pid, totals.registry).is_ok();
+  }
+  return totals;
+}
+//-----------------------------------------------------------------------------
+Load_Report Load_Generator::Implementation::difference(const Load_Totals& first, const Load_Totals& second) const
+{
+  Load_Report report;
+  report.elapsed = std::chrono::duration<double>(second.time - first.time).count();
+  report.announced = second.announced - first.announced;
+  report.signoffs = second.signoffs - first.signoffs;
+  report.echoed = second.echoed - first.echoed;
+  report.lost = second.lost - first.lost;
+  report.unmatched = second.unmatched - first.unmatched;
+
+  auto window = second.latency - first.latency;
+  report.p50 = window.percentile(0.50) / 1000.0;
+  report.p90 = window.percentile(0.90) / 1000.0;
+  report.p99 = window.percentile(0.99) / 1000.0;
+  report.p999 = window.percentile(0.999) / 1000.0;
+  report.max = window.percentile(1.0) / 1000.0;
+
+  report.registry_sampled = first.sampled && second.sampled;
+  if (report.registry_sampled) {
+    report.registry_cpu = cpu_percent(first.registry, second.registry);
+    report.registry_bytes = second.registry.resident_bytes;
+  }
+  return report;
+}
+//-----------------------------------------------------------------------------
+//! \param config [IN] -- Shape of the load. Messages for every service are built up front
+Load_Generator::Load_Generator(Load_Config config)
+  : _impl(std::make_unique<Implementation>(std::move(config)))
+{
+}
+//-----------------------------------------------------------------------------
+Load_Generator::~Load_Generator()
+{
+  stop();
+  if (_impl->sender_thread.joinable()) {
+    _impl->sender_thread.join();
+  }
+  _impl->receiver.stop();
+  _impl->receiver.join();
+}
+//-----------------------------------------------------------------------------
+//! Generates load for config.duration seconds or until stop() is called
+//! \param on_report [IN] -- Called with the counters of each report window from the calling thread
+//! \return Load_Report -- Counters for the whole run. Announcements still outstanding after a short drain count as lost
+Load_Report Load_Generator::run(ReportFunc on_report)
+{
+  using namespace std::placeholders;
+  auto& impl = *_impl;
+  if (impl.config.services == 0) {
+    return {};
+  }
+  impl.running = true;
+  impl.receiver.async_receive(std::bind(&Implementation::process_echo, _impl.get(), _1));
+
+  auto first = impl.collect();
+  auto last = first;
+  auto end = first.time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(impl.config.duration));
+  auto report_interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(impl.config.report_interval));
+  impl.sender_thread = std::thread(&Implementation::send_cycles, _impl.get());
+
+  while (impl.running) {
+    impl.wait_until(std::min(last.time + report_interval, end));
+    auto current = impl.collect();
+    if (on_report) {
+      on_report(impl.difference(last, current));
+    }
+    last = current;
+    if (current.time >= end) {
+      stop();
+    }
+  }
+  if (impl.sender_thread.joinable()) {
+    impl.sender_thread.join();
+  }
+  auto generation_end = std::chrono::steady_clock::now();
+
+  std::this_thread::sleep_for(g_drain_time);
+  impl.receiver.stop();
+  impl.receiver.join();
+  for (auto& outstanding : impl.pending) {
+    if (outstanding.exchange(0)) {
+      ++impl.lost;
+    }
+  }
+  auto result = impl.difference(first, impl.collect());
+  result.elapsed = std::chrono::duration<double>(generation_end - first.time).count();
+  return result;
+}
+//-----------------------------------------------------------------------------
+//! Ends run() early. Safe to call from any thread
+void Load_Generator::stop()
+{
+  {
+    std::lock_guard<std::mutex> guard(_impl->stop_mutex);
+    _impl->running = false;
+  }
+  _impl->stop_condition.notify_all();
+}
+//-----------------------------------------------------------------------------
+bool Load_Generator::is_valid()
+{
+  return _impl->sender.is_valid() && _impl->receiver.is_valid();
+}
+//-----------------------------------------------------------------------------
+Error Load_Generator::error()
+{
+  return _impl->sender.error() | _impl->receiver.error();
+}
+} //namespace pfc
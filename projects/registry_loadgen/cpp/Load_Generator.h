@@ -0,0 +1,98 @@
+#ifndef SUSTAIN_LOADGEN_LOAD_GENERATOR_H
+#define SUSTAIN_LOADGEN_LOAD_GENERATOR_H
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+//!
+//! \brief Simulates a population of services announcing themselves to a pfc_registry
+//!        and measures how quickly the registry echos them back
+//!
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <sustain/framework/util/Error.h>
+
+namespace pfc {
+
+//!
+//! Shape of the simulated load
+//!
+struct Load_Config {
+  std::string bind_address = "0::0";
+  std::string multicast_address = "ff31::8000:1234";
+  size_t services = 1000;       //!< Number of simulated services
+  double interval = 1.0;        //!< Seconds between two announcements of the same service
+  double rate = 0.0;            //!< Announcements per second across every service. 0 spreads services evenly over interval
+  double churn = 0.0;           //!< Fraction of services which sign off each cycle and return on the next one
+  int burst_every = 0;          //!< Every Nth cycle is sent as fast as possible instead of paced. 0 disables
+  double duration = 30.0;       //!< Seconds to generate load for
+  double report_interval = 1.0; //!< Seconds between reports
+  int registry_pid = 0;         //!< Registry process to sample for cpu and memory. 0 disables sampling
+};
+
+//!
+//! Counters for one report window or for the whole run.
+//! Latency is the time from sending an announcement to hearing the registry echo it.
+//!
+struct Load_Report {
+  double elapsed = 0.0;          //!< Seconds covered by the report
+  uint64_t announced = 0;        //!< Announcements sent
+  uint64_t signoffs = 0;         //!< Signoffs sent by churning services
+  uint64_t echoed = 0;           //!< Announcements the registry echoed
+  uint64_t lost = 0;             //!< Announcements never echoed before the service announced again or the run ended
+  uint64_t unmatched = 0;        //!< Echos which did not answer an outstanding announcement
+  double p50 = 0.0;              //!< Echo latency percentiles in milliseconds
+  double p90 = 0.0;
+  double p99 = 0.0;
+  double p999 = 0.0;
+  double max = 0.0;
+  bool registry_sampled = false; //!< false when registry_pid was not set or could not be read
+  double registry_cpu = 0.0;     //!< Percent of one cpu used by the registry
+  size_t registry_bytes = 0;     //!< Registry resident memory
+
+  double announce_rate() const { return (elapsed > 0.0) ? announced / elapsed : 0.0; } //!< Announcements sent per second
+  double echo_rate() const { return (elapsed > 0.0) ? echoed / elapsed : 0.0; } //!< Echos received per second
+};
+
+//!
+//!  Sends announcements for every simulated service from a single thread over multicast and
+//!  listens on the registry announce port for the echo. Each service announces once per cycle,
+//!  paced evenly through the cycle unless the cycle is a burst. Churning services send a signoff
+//!  in place of their announcement and come back on the following cycle, which the registry sees
+//!  as a remove followed by an add.
+//!
+class Load_Generator {
+public:
+  using ReportFunc = std::function<void(const Load_Report&)>;
+
+  explicit Load_Generator(Load_Config config);
+  Load_Generator(const Load_Generator&) = delete;
+  Load_Generator& operator=(const Load_Generator&) = delete;
+  ~Load_Generator();
+
+  Load_Report run(ReportFunc);
+  void stop();
+
+  bool is_valid();
+  Error error();
+
+private:
+  struct Implementation;
+  std::unique_ptr<Implementation> _impl;
+};
+} //namespace pfc
+
+#endif //SUSTAIN_LOADGEN_LOAD_GENERATOR_H
@@ -0,0 +1,95 @@
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+#include "Process_Usage.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include <Psapi.h>
+#elif defined(__linux__)
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#endif
+
+namespace pfc {
+//-----------------------------------------------------------------------------
+//! \param pid [IN] -- Process to sample
+//! \param sample [OUT] -- Usage of the process as of now
+//! \return Error -- PFC_BAD_OPERATION if the process does not exist or the platform is not supported
+Error sample_process(int pid, Process_Sample& sample)
+{
+  sample.time = std::chrono::steady_clock::now();
+#if defined(_WIN32)
+  auto process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, static_cast<DWORD>(pid));
+  if (process == nullptr) {
+    return Error::Code::PFC_BAD_OPERATION;
+  }
+  FILETIME creation, exit, kernel, user;
+  PROCESS_MEMORY_COUNTERS memory;
+  auto ok = GetProcessTimes(process, &creation, &exit, &kernel, &user)
+    && GetProcessMemoryInfo(process, &memory, sizeof(memory));
+  CloseHandle(process);
+  if (!ok) {
+    return Error::Code::PFC_BAD_OPERATION;
+  }
+  auto ticks = [](const FILETIME& time) { return (static_cast<unsigned long long>(time.dwHighDateTime) << 32) | time.dwLowDateTime; };
+  sample.cpu_seconds = static_cast<double>(ticks(kernel) + ticks(user)) / 1e7;
+  sample.resident_bytes = memory.WorkingSetSize;
+  return Success();
+#elif defined(__linux__)
+  std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+  std::string line;
+  if (!std::getline(stat, line)) {
+    return Error::Code::PFC_BAD_OPERATION;
+  }
+  //The command name may contain spaces so fields are counted from the closing parenthesis.
+  //utime and stime are fields 14 and 15, rss in pages is field 24
+  auto end_of_name = line.rfind(')');
+  if (end_of_name == std::string::npos) {
+    return Error::Code::PFC_BAD_OPERATION;
+  }
+  std::istringstream fields(line.substr(end_of_name + 2));
+  std::string skip;
+  for (int field = 3; field < 14; ++field) {
+    fields >> skip;
+  }
+  unsigned long long user = 0, kernel = 0;
+  long long resident_pages = 0;
+  fields >> user >> kernel;
+  for (int field = 16; field < 24; ++field) {
+    fields >> skip;
+  }
+  fields >> resident_pages;
+  if (fields.fail()) {
+    return Error::Code::PFC_BAD_OPERATION;
+  }
+  sample.cpu_seconds = static_cast<double>(user + kernel) / static_cast<double>(sysconf(_SC_CLK_TCK));
+  sample.resident_bytes = static_cast<size_t>(resident_pages) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return Success();
+#else
+  (void)pid;
+  return Error::Code::PFC_BAD_OPERATION;
+#endif
+}
+//-----------------------------------------------------------------------------
+//! \return double -- Average utilization between two samples where 100 is one fully used cpu
+double cpu_percent(const Process_Sample& first, const Process_Sample& second)
+{
+  std::chrono::duration<double> wall = second.time - first.time;
+  if (wall.count() <= 0.0) {
+    return 0.0;
+  }
+  return 100.0 * (second.cpu_seconds - first.cpu_seconds) / wall.count();
+}
+} //namespace pfc
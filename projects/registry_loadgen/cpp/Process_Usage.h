@@ -0,0 +1,41 @@
+#ifndef SUSTAIN_LOADGEN_PROCESS_USAGE_H
+#define SUSTAIN_LOADGEN_PROCESS_USAGE_H
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+//!
+//! \brief Samples the cpu time and resident memory of another process
+//!
+
+#include <chrono>
+#include <cstddef>
+
+#include <sustain/framework/util/Error.h>
+
+namespace pfc {
+
+//!
+//! Cumulative usage of a process. cpu_seconds of two samples divided by the time between them gives utilization
+//!
+struct Process_Sample {
+  std::chrono::steady_clock::time_point time;
+  double cpu_seconds = 0.0; //!< User plus kernel time since the process started
+  size_t resident_bytes = 0; //!< Current working set
+};
+
+Error sample_process(int pid, Process_Sample& sample);
+double cpu_percent(const Process_Sample& first, const Process_Sample& second);
+
+} //namespace pfc
+
+#endif //SUSTAIN_LOADGEN_PROCESS_USAGE_H
@@ -0,0 +1,129 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "Load_Generator.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/signal_set.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/program_options.hpp>
+
+namespace {
+//! \return std::string -- Single line summary of a report
+std::string format(const pfc::Load_Report& report)
+{
+  std::ostringstream os;
+  os << std::fixed << std::setprecision(1)
+     << "announce/s=" << report.announce_rate() << " echo/s=" << report.echo_rate()
+     << " signoffs=" << report.signoffs << " lost=" << report.lost << " unmatched=" << report.unmatched
+     << std::setprecision(3)
+     << " p50=" << report.p50 << "ms p90=" << report.p90 << "ms p99=" << report.p99
+     << "ms p99.9=" << report.p999 << "ms max=" << report.max << "ms";
+  if (report.registry_sampled) {
+    os << std::setprecision(1) << " registry_cpu=" << report.registry_cpu << "% registry_rss=" << report.registry_bytes / (1024.0 * 1024.0) << "MB";
+  }
+  return os.str();
+}
+//! Appends the run to a csv file so runs can be compared across builds. Writes a header to new files
+void append_csv(const std::string& path, const pfc::Load_Config& config, const pfc::Load_Report& report)
+{
+  bool is_new = !std::ifstream(path).good();
+  std::ofstream csv(path, std::ios::app);
+  if (is_new) {
+    csv << "services,interval,rate,churn,burst_every,duration,announced,signoffs,echoed,lost,unmatched,"
+           "announce_rate,echo_rate,p50_ms,p90_ms,p99_ms,p999_ms,max_ms,registry_cpu,registry_bytes\n";
+  }
+  csv << config.services << "," << config.interval << "," << config.rate << "," << config.churn << "," << config.burst_every << ","
+      << report.elapsed << "," << report.announced << "," << report.signoffs << "," << report.echoed << "," << report.lost << ","
+      << report.unmatched << "," << report.announce_rate() << "," << report.echo_rate() << "," << report.p50 << "," << report.p90 << ","
+      << report.p99 << "," << report.p999 << "," << report.max << ",";
+  if (report.registry_sampled) {
+    csv << report.registry_cpu << "," << report.registry_bytes;
+  } else {
+    csv << ",";
+  }
+  csv << "\n";
+}
+}
+
+int main(int argc, const char* argv[])
+{
+  namespace bpo = boost::program_options;
+  pfc::Load_Config config;
+  bpo::options_description options("Allowed options");
+  options.add_options()("help,h", "Produce help message") //
+    ("bind,b", bpo::value<std::string>(&config.bind_address)->default_value(config.bind_address), "Echo listener bind address") //
+    ("multicast,m", bpo::value<std::string>(&config.multicast_address)->default_value(config.multicast_address), "Registry multicast address") //
+    ("services,n", bpo::value<size_t>(&config.services)->default_value(config.services), "Number of simulated services") //
+    ("interval,i", bpo::value<double>(&config.interval)->default_value(config.interval), "Seconds between announcements of each service") //
+    ("rate,r", bpo::value<double>(&config.rate)->default_value(config.rate), "Total announcements per second. 0 uses services/interval") //
+    ("churn,c", bpo::value<double>(&config.churn)->default_value(config.churn), "Fraction of services which sign off each cycle and return the next") //
+    ("burst", bpo::value<int>(&config.burst_every)->default_value(config.burst_every), "Send every Nth cycle unpaced. 0 disables") //
+    ("duration,d", bpo::value<double>(&config.duration)->default_value(config.duration), "Seconds to generate load") //
+    ("report", bpo::value<double>(&config.report_interval)->default_value(config.report_interval), "Seconds between progress reports") //
+    ("pid,p", bpo::value<int>(&config.registry_pid)->default_value(0), "pfc_registry process id to sample cpu and memory") //
+    ("csv", bpo::value<std::string>(), "Append the run summary to this csv file");
+
+  bpo::variables_map vm;
+  bpo::store(bpo::parse_command_line(argc, argv, options), vm);
+  bpo::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << options << "\n";
+    return 1;
+  }
+  if (config.interval <= 0.0 || config.rate < 0.0 || config.churn < 0.0 || config.churn > 1.0 || config.report_interval <= 0.0) {
+    std::cerr << "interval and report must be positive, rate must not be negative and churn must be between 0 and 1\n";
+    return 1;
+  }
+
+  pfc::Load_Generator generator(config);
+  if (!generator.is_valid()) {
+    BOOST_LOG_TRIVIAL(error) << "Unable to open multicast sockets on " << config.multicast_address << " " << generator.error();
+    return 1;
+  }
+
+  boost::asio::io_context context;
+  boost::asio::signal_set signals(context);
+  signals.add(SIGINT);
+  signals.add(SIGTERM);
+#if defined(SIGQUIT)
+  signals.add(SIGQUIT);
+#endif
+  signals.async_wait([&](const boost::system::error_code& ec, int /*no*/) {
+    if (!ec) {
+      BOOST_LOG_TRIVIAL(info) << "Stopping load generator";
+      generator.stop();
+    }
+  });
+  std::thread signal_thread([&context]() { context.run(); });
+
+  BOOST_LOG_TRIVIAL(info) << "Simulating " << config.services << " services against " << config.multicast_address << " for " << config.duration << "s";
+  auto total = generator.run([](const pfc::Load_Report& report) {
+    BOOST_LOG_TRIVIAL(info) << format(report);
+  });
+  BOOST_LOG_TRIVIAL(info) << "Total announced=" << total.announced << " echoed=" << total.echoed << " " << format(total);
+
+  if (vm.count("csv")) {
+    append_csv(vm["csv"].as<std::string>(), config, total);
+  }
+
+  context.stop();
+  signal_thread.join();
+  return 0;
+}
@@ -0,0 +1,207 @@
+#ifndef SUSTAIN_REGISTRY_FLAT_MAP_H
+#define SUSTAIN_REGISTRY_FLAT_MAP_H
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+//!
+//! \brief Open addressing hash map used for the registry table
+//!
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace pfc {
+
+//!
+//!  Hash map which stores its elements densely in a single vector and locates them through
+//!  an open addressing index of 32bit positions. The index is cheap to keep sparse so probes
+//!  stay short while the elements themselves carry no per slot overhead.
+//!
+//!  Collisions are resolved by linear probing and erase uses backward shift so the index
+//!  never accumulates tombstones. Erase moves the last element in to the erased position.
+//!
+//!  Pointers returned by find and emplace are invalidated by the next emplace or erase.
+//!
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class Flat_Map {
+public:
+  explicit Flat_Map(size_t capacity = 16);
+
+  Value* find(const Key&);
+  const Value* find(const Key&) const;
+  std::pair<Value*, bool> emplace(const Key&);
+  bool erase(const Key&);
+  void clear();
+
+  template <typename Function>
+  void for_each(Function) const;
+
+  size_t size() const { return _elements.size(); } //!< Number of stored elements
+  size_t memory_usage() const;
+
+private:
+  static constexpr uint32_t empty = 0xFFFFFFFF;
+
+  size_t probe(const Key&) const;
+  void rebuild(size_t);
+
+  std::vector<std::pair<Key, Value>> _elements; //!< Dense storage in insertion order until an erase
+  std::vector<uint32_t> _index; //!< Position in _elements or empty
+  size_t _mask;
+  Hash _hash;
+};
+//-----------------------------------------------------------------------------
+template <typename Key, typename Value, typename Hash>
+constexpr uint32_t Flat_Map<Key, Value, Hash>::empty;
+//-----------------------------------------------------------------------------
+//! \param capacity [IN] -- Number of elements to reserve space for
+template <typename Key, typename Value, typename Hash>
+Flat_Map<Key, Value, Hash>::Flat_Map(size_t capacity)
+{
+  _elements.reserve(capacity);
+  rebuild(capacity);
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Slot of _index referencing key or the empty slot where it would be inserted
+template <typename Key, typename Value, typename Hash>
+size_t Flat_Map<Key, Value, Hash>::probe(const Key& key) const
+{
+  auto slot = _hash(key) & _mask;
+  while (_index[slot] != empty && !(_elements[_index[slot]].first == key)) {
+    slot = (slot + 1) & _mask;
+  }
+  return slot;
+}
+//-----------------------------------------------------------------------------
+//! \return Value* -- Value stored for key or nullptr
+template <typename Key, typename Value, typename Hash>
+Value* Flat_Map<Key, Value, Hash>::find(const Key& key)
+{
+  auto position = _index[probe(key)];
+  return (position != empty) ? &_elements[position].second : nullptr;
+}
+//-----------------------------------------------------------------------------
+//! \return const Value* -- Value stored for key or nullptr
+template <typename Key, typename Value, typename Hash>
+const Value* Flat_Map<Key, Value, Hash>::find(const Key& key) const
+{
+  auto position = _index[probe(key)];
+  return (position != empty) ? &_elements[position].second : nullptr;
+}
+//-----------------------------------------------------------------------------
+//! Inserts a default constructed Value when key is not already present
+//! \return std::pair<Value*,bool> -- Value stored for key and true if it was inserted
+template <typename Key, typename Value, typename Hash>
+std::pair<Value*, bool> Flat_Map<Key, Value, Hash>::emplace(const Key& key)
+{
+  auto slot = probe(key);
+  if (_index[slot] != empty) {
+    return { &_elements[_index[slot]].second, false };
+  }
+  if ((_elements.size() + 1) * 2 > _index.size()) {
+    rebuild(_elements.size() + 1);
+    slot = probe(key);
+  }
+  _index[slot] = static_cast<uint32_t>(_elements.size());
+  _elements.emplace_back(key, Value());
+  return { &_elements.back().second, true };
+}
+//-----------------------------------------------------------------------------
+//! Removes key and shifts the rest of its probe chain back so lookups never need tombstones
+//! \return bool -- true if key was present
+template <typename Key, typename Value, typename Hash>
+bool Flat_Map<Key, Value, Hash>::erase(const Key& key)
+{
+  auto hole = probe(key);
+  auto position = _index[hole];
+  if (position == empty) {
+    return false;
+  }
+  _index[hole] = empty;
+
+  auto slot = hole;
+  for (;;) {
+    slot = (slot + 1) & _mask;
+    if (_index[slot] == empty) {
+      break;
+    }
+    //An element may move back to the hole only if its home slot is not cyclically within (hole, slot]
+    auto home = _hash(_elements[_index[slot]].first) & _mask;
+    auto stays = (hole <= slot) ? (hole < home && home <= slot) : (hole < home || home <= slot);
+    if (!stays) {
+      _index[hole] = _index[slot];
+      _index[slot] = empty;
+      hole = slot;
+    }
+  }
+
+  //Keep _elements dense by moving the last element in to the vacated position
+  auto last = static_cast<uint32_t>(_elements.size() - 1);
+  if (position != last) {
+    slot = _hash(_elements[last].first) & _mask;
+    while (_index[slot] != last) {
+      slot = (slot + 1) & _mask;
+    }
+    _index[slot] = position;
+    _elements[position] = std::move(_elements[last]);
+  }
+  _elements.pop_back();
+  return true;
+}
+//-----------------------------------------------------------------------------
+//! Removes every element but keeps the allocated storage
+template <typename Key, typename Value, typename Hash>
+void Flat_Map<Key, Value, Hash>::clear()
+{
+  _elements.clear();
+  std::fill(_index.begin(), _index.end(), empty);
+}
+//-----------------------------------------------------------------------------
+//! \param function [IN] -- Called as function(const Key&, const Value&) for every element
+template <typename Key, typename Value, typename Hash>
+template <typename Function>
+void Flat_Map<Key, Value, Hash>::for_each(Function function) const
+{
+  for (auto& element : _elements) {
+    function(element.first, element.second);
+  }
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Bytes allocated for elements and the index
+template <typename Key, typename Value, typename Hash>
+size_t Flat_Map<Key, Value, Hash>::memory_usage() const
+{
+  return _elements.capacity() * sizeof(std::pair<Key, Value>) + _index.capacity() * sizeof(uint32_t);
+}
+//-----------------------------------------------------------------------------
+//! Resizes the index so count elements fill at most a quarter of it and reindexes every element
+template <typename Key, typename Value, typename Hash>
+void Flat_Map<Key, Value, Hash>::rebuild(size_t count)
+{
+  size_t slots = 16;
+  while (slots < count * 4) {
+    slots <<= 1;
+  }
+  _index.assign(slots, empty);
+  _mask = slots - 1;
+  for (uint32_t position = 0; position < _elements.size(); ++position) {
+    _index[probe(_elements[position].first)] = position;
+  }
+}
+} //namespace pfc
+
+#endif //SUSTAIN_REGISTRY_FLAT_MAP_H
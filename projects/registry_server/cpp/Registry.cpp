@@ -11,17 +11,97 @@ specific language governing permissions and limitations under the License.
 **************************************************************************************/
 
 #include "Registry.h"
+#include "Registry_Table.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
 #include <mutex>
-#include <queue>
-#include <unordered_map>
+#include <random>
+#include <sstream>
+#include <thread>
 
 #include <sustain/framework/Protocol.h>
 #include <sustain/framework/net/Multicast_Receiver.h>
 #include <sustain/framework/net/Multicast_Sender.h>
+#include <sustain/framework/net/patterns/pub_sub/Publisher.h>
+#include <sustain/framework/net/patterns/pub_sub/Topic.h>
+#include <sustain/framework/net/patterns/req_rep/Server.h>
 #include <sustain/framework/util/Constants.h>
+#include <sustain/framework/util/Spsc_Queue.h>
+#include <sustain/framework/util/Thread_Affinity.h>
+#include <sustain/framework/util/Wake_Signal.h>
 
 namespace pfc {
+namespace {
+  constexpr size_t g_digest_bucket_count = 256; //!< Number of leaves in the anti-entropy digest
+  constexpr auto g_digest_interval = std::chrono::seconds(2); //!< How often a registry multicast its digest
+  constexpr auto g_peer_timeout = std::chrono::seconds(6); //!< Peers which have not sent a digest for this long are dropped
+  constexpr size_t g_replication_datagram_size = 8192; //!< Replication messages are packed in to datagrams up to this size
+  constexpr size_t g_replication_buffer_size = 65536; //!< Receive buffer large enough for any UDP datagram
+  constexpr size_t g_pipeline_queue_capacity = 4096; //!< Capacity of each queue between pipeline stages
+  constexpr size_t g_broadcast_datagram_size = 1024; //!< Announcements are packed up to the default Multicast_Receiver buffer size
+  constexpr size_t g_table_batch_size = 256; //!< Updates applied per acquisition of the table lock
+  constexpr auto g_tombstone_lifetime = std::chrono::seconds(60); //!< Signoffs are kept this long so they reach every peer before being forgotten
+  constexpr auto g_tombstone_interval = std::chrono::seconds(1); //!< How often the table stage looks for expired tombstones
+
+}
+
+//!
+//! Element passed from the receive stages to the table stage
+//!
+struct Registry_Update {
+  pfc_service_announcement announcement;
+  pfc_uint version = 0; //!< 0 for announcements heard directly from a service, else the replicated version
+  bool removed = false; //!< true for a signoff or a replicated tombstone
+};
+
+//!
+//! Queue between two pipeline stages along with the counters reported by Registry::metrics
+//!
+template <typename T>
+struct Pipeline_Queue {
+  explicit Pipeline_Queue(const char* name);
+  Registry::Queue_Metrics metrics() const;
+
+  const char* name;
+  Spsc_Queue<T> queue;
+  std::atomic<uint64_t> processed;
+  std::atomic<uint64_t> dropped;
+};
+//-----------------------------------------------------------------------------
+template <typename T>
+Pipeline_Queue<T>::Pipeline_Queue(const char* name)
+  : name(name)
+  , queue(g_pipeline_queue_capacity)
+  , processed(0)
+  , dropped(0)
+{
+}
+//-----------------------------------------------------------------------------
+template <typename T>
+Registry::Queue_Metrics Pipeline_Queue<T>::metrics() const
+{
+  return { name, queue.size(), queue.capacity(), queue.high_water(), processed.load(), dropped.load() };
+}
+
+//!
+//! The registry is a three stage pipeline connected by single producer single consumer queues
+//!
+//!   receive   (Multicast_Receiver thread) decodes announcements      -> ingest
+//!   table     (table_thread)              merges updates in to table -> outbound, changes
+//!   broadcast (broadcast_thread)          packs announcements in to datagrams and sends them
+//!   watch     (watch_thread)              publishes each change once on the PubSub watch feed
+//!
+//! The watch stage only runs when Registry::watch has been called. Its snapshot server answers on the
+//! ReqRep server thread and reads the table under the table lock along with the current sequence.
+//!
+//! The replication listener feeds the table stage through its own replica queue so every queue keeps
+//! exactly one producer. No stage blocks on the next, when a queue is full the update is dropped and
+//! counted. Services re-announce periodically so a dropped update is recovered on the next cycle.
+//!
 struct Registry::Implementation {
   Implementation(std::string& bind_address, std::string& multicast_address);
   ~Implementation();
@@ -31,59 +111,526 @@ struct Registry::Implementation {
   Implementation& operator=(Implementation&&) = default;
 
   void process_subscription_message(std::istream&);
-  void broadcast_service_subscription(std::ostream&);
+  void update_table();
+  void record_change(Table_Change, const pfc_service_announcement&, pfc_uint version);
+  void broadcast_services();
+  void publish_changes();
+  message process_snapshot_request(message);
+  template <typename T>
+  void enqueue(Pipeline_Queue<T>&, Wake_Signal&, T&&);
+
+  bool owns(pfc_uint key_hash);
+  pfc_registry_digest make_digest();
+
+  void process_replication_message(std::istream&);
+  void handle_digest(const pfc_registry_digest&);
+  void handle_sync_request(const pfc_registry_sync_request&);
+  void handle_sync_response(const pfc_registry_sync_response&);
+  void queue_replication(const pfc_message&);
+  void replicate();
+
+  pfc_uint registry_id;
 
   Multicast_Receiver subscription_listiner;
   Multicast_Sender service_broadcaster;
+  Multicast_Receiver replication_listiner;
+  Multicast_Sender replication_broadcaster;
 
-  std::mutex broadcast_mutex;
-  std::condition_variable broadcast_condition;
+  Pipeline_Queue<Registry_Update> ingest;
+  Pipeline_Queue<Registry_Update> replica;
+  Pipeline_Queue<pfc_service_announcement> outbound;
+  Pipeline_Queue<pfc_registry_delta> changes;
+  Wake_Signal table_signal; //!< Parks the table stage which consumes both ingest and replica
+  Wake_Signal broadcast_signal;
+  Wake_Signal watch_signal;
 
-  std::unordered_map<std::string, pfc_service_announcement> services;
-  std::queue<std::string> pending_broadcast;
+  int receive_cpu;
+  int table_cpu;
+  int broadcast_cpu;
+  std::atomic<bool> receive_pinned;
+  std::thread table_thread;
+  std::thread broadcast_thread;
+  std::thread watch_thread;
+
+  std::mutex table_mutex; //!< Guards table and sequence. Written only by the table stage
+  Registry_Table table;
+  pfc_uint sequence; //!< Sequence of the last change made to table
+
+  std::unique_ptr<PubSub_Publisher> watch_feed; //!< Null unless Registry::watch was called
+  std::unique_ptr<ReqRep_Server> snapshot_server;
+
+  std::mutex replication_mutex;
+  std::condition_variable replication_condition;
+  std::deque<std::string> pending_replication;
+  std::map<pfc_uint, std::chrono::steady_clock::time_point> peers;
+  std::atomic<bool> running;
+  std::thread replication_thread;
 };
 //-----------------------------------------------------------------------------
 Registry::Implementation::Implementation(std::string& bind_address, std::string& multicast_address)
-  : subscription_listiner(bind_address, multicast_address, g_pfc_registry_reg_port)
+  : registry_id(0)
+  , subscription_listiner(bind_address, multicast_address, g_pfc_registry_reg_port)
   , service_broadcaster(multicast_address, g_pfc_registry_announce_port)
+  , replication_listiner(bind_address, multicast_address, g_pfc_registry_sync_port)
+  , replication_broadcaster(multicast_address, g_pfc_registry_sync_port)
+  , ingest("receive->table")
+  , replica("replication->table")
+  , outbound("table->broadcast")
+  , changes("table->watch")
+  , receive_cpu(g_pfc_any_cpu)
+  , table_cpu(g_pfc_any_cpu)
+  , broadcast_cpu(g_pfc_any_cpu)
+  , receive_pinned(false)
+  , table(g_digest_bucket_count)
+  , sequence(0)
+  , running(false)
 {
+  std::random_device device;
+  while (registry_id == 0) {
+    registry_id = device();
+  }
+  replication_listiner.buffer_legth(g_replication_buffer_size);
 }
 //-----------------------------------------------------------------------------
 Registry::Implementation::~Implementation()
 {
+  running = false;
+  replication_condition.notify_all();
+  table_signal.notify();
+  broadcast_signal.notify();
+  watch_signal.notify();
   subscription_listiner.stop();
   service_broadcaster.stop();
+  replication_listiner.stop();
+  replication_broadcaster.stop();
+  for (auto thread : { &replication_thread, &table_thread, &broadcast_thread, &watch_thread }) {
+    if (thread->joinable()) {
+      thread->join();
+    }
+  }
+  snapshot_server = nullptr;
+  watch_feed = nullptr;
 }
 //-----------------------------------------------------------------------------
+//! Receive stage. Runs on the Multicast_Receiver thread and does nothing but decode.
+//! Signoffs travel through the pipeline as announcements flagged as removed
 void Registry::Implementation::process_subscription_message(std::istream& is)
 {
-  pfc_service_announcement message;
-  if (message.deserialize(is).is_ok()) {
-    auto key = message._address + ":" + std::to_string(message._port);
-    std::cout << "Received: " << message << "\n";
-    //TODO: We likely need to move towards more conccurent_safe data structures
-    //      So we can remove these locks
-    broadcast_mutex.lock();
-    services[key] = message;
-    pending_broadcast.push(key);
-    broadcast_mutex.unlock();
-
-    service_broadcaster.send(std::bind(&Implementation::broadcast_service_subscription, this, std::placeholders::_1));
+  if (!receive_pinned.exchange(true)) {
+    set_thread_affinity(receive_cpu);
+  }
+  for (;;) {
+    Registry_Update update;
+    switch (peek_message_type(is)) {
+    case SERVICE_Announcement_REQUEST: {
+      if (update.announcement.deserialize(is).is_not_ok() || is.fail()) {
+        return;
+      }
+    } break;
+    case SERVICE_signoff_REQUEST: {
+      pfc_service_signoff signoff;
+      if (signoff.deserialize(is).is_not_ok() || is.fail()) {
+        return;
+      }
+      update.announcement._port = signoff._port;
+      update.announcement._protacol = signoff._protacol;
+      update.announcement._name = std::move(signoff._name);
+      update.announcement._address = std::move(signoff._address);
+      update.announcement._brief = std::move(signoff._brief);
+      update.removed = true;
+    } break;
+    default:
+      return;
+    }
+    enqueue(ingest, table_signal, std::move(update));
+  }
+}
+//-----------------------------------------------------------------------------
+//! Non blocking hand off to the next stage. Updates which do not fit are counted and dropped
+template <typename T>
+void Registry::Implementation::enqueue(Pipeline_Queue<T>& next, Wake_Signal& signal, T&& value)
+{
+  if (next.queue.try_push(std::move(value))) {
+    signal.notify();
   } else {
+    ++next.dropped;
+  }
+}
+//-----------------------------------------------------------------------------
+//! Table stage. The only writer of services. Applies updates in batches so the table lock
+//! is taken once per batch and digest readers on the replication threads are not starved.
+void Registry::Implementation::update_table()
+{
+  set_thread_affinity(table_cpu);
+
+  std::vector<Registry_Update> batch;
+  batch.reserve(g_table_batch_size);
+  Registry_Update update;
+  auto next_expiry = std::chrono::steady_clock::now() + g_tombstone_interval;
+  while (running) {
+    table_signal.wait([this]() { return !running || !ingest.queue.empty() || !replica.queue.empty(); });
+
+    auto now = std::chrono::steady_clock::now();
+    if (now >= next_expiry) {
+      std::lock_guard<std::mutex> guard(table_mutex);
+      table.expire(now - g_tombstone_lifetime);
+      next_expiry = now + g_tombstone_interval;
+    }
+
+    batch.clear();
+    while (batch.size() < g_table_batch_size && ingest.queue.try_pop(update)) {
+      batch.push_back(std::move(update));
+    }
+    ingest.processed += batch.size();
+    auto local_count = batch.size();
+    while (batch.size() < g_table_batch_size && replica.queue.try_pop(update)) {
+      batch.push_back(std::move(update));
+    }
+    replica.processed += batch.size() - local_count;
+    if (batch.empty()) {
+      continue;
+    }
+
+    std::lock_guard<std::mutex> guard(table_mutex);
+    for (auto& item : batch) {
+      auto& announcement = item.announcement;
+      pfc_uint key_hash = 0;
+      pfc_uint version = item.version;
+      auto change = table.apply(announcement, version, item.removed, key_hash);
+      if (change != Table_Change::unchanged) {
+        std::cout << ((item.removed) ? "Removed: " : "Received: ") << announcement << "\n";
+        record_change(change, announcement, version);
+      }
+      //Every registry hears the same announcement, but only the owner of a key echos it.
+      //Local announcements are always echoed by the owner as they double as a refresh.
+      //Removals reach peers through replication, services simply stop hearing the echo.
+      if (!item.removed && (change != Table_Change::unchanged || item.version == 0) && owns(key_hash)) {
+        enqueue(outbound, broadcast_signal, std::move(announcement));
+      }
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+//! Called by the table stage with table_mutex held. Numbers the change and hands it to the watch stage.
+//! The sequence advances even when the change can not be queued so subscribers see the gap and resync.
+void Registry::Implementation::record_change(Table_Change change, const pfc_service_announcement& announcement, pfc_uint version)
+{
+  ++sequence;
+  if (!watch_feed) {
+    return;
+  }
+  pfc_registry_delta delta;
+  delta._sequence = sequence;
+  delta._change = (change == Table_Change::added) ? registry_added
+    : (change == Table_Change::updated)           ? registry_updated
+                                                  : registry_removed;
+  delta._version = version;
+  delta._port = announcement._port;
+  delta._protacol = announcement._protacol;
+  delta._name = announcement._name;
+  delta._address = announcement._address;
+  delta._brief = announcement._brief;
+  enqueue(changes, watch_signal, std::move(delta));
+}
+//-----------------------------------------------------------------------------
+//! Broadcast stage. Packs as many announcements as fit in to each datagram and is the
+//! only thread which touches service_broadcaster
+void Registry::Implementation::broadcast_services()
+{
+  set_thread_affinity(broadcast_cpu);
+
+  pfc_service_announcement announcement;
+  std::ostringstream os;
+  std::string datagram;
+  std::string pending;
+  while (running) {
+    broadcast_signal.wait([this, &pending]() { return !running || !pending.empty() || !outbound.queue.empty(); });
+
+    datagram.clear();
+    while (pending.size() || outbound.queue.try_pop(announcement)) {
+      if (pending.empty()) {
+        ++outbound.processed;
+        os.str("");
+        os.clear();
+        if (announcement.serialize(os).is_not_ok()) {
+          continue;
+        }
+        pending = os.str();
+      }
+      if (!datagram.empty() && datagram.size() + pending.size() > g_broadcast_datagram_size) {
+        break;
+      }
+      datagram += pending;
+      pending.clear();
+    }
+    if (!datagram.empty()) {
+      service_broadcaster.send([&datagram](std::ostream& os) { os.write(datagram.data(), datagram.size()); });
+    }
   }
 }
 //-----------------------------------------------------------------------------
-void Registry::Implementation::broadcast_service_subscription(std::ostream& os)
+//! Watch stage. Serializes each change once and lets the PubSub socket fan it out.
+//! Subscribers filter on the topic prefix inside nanomsg so uninterested clients cost nothing extra.
+void Registry::Implementation::publish_changes()
 {
+  pfc_registry_delta delta;
+  while (running) {
+    watch_signal.wait([this]() { return !running || !changes.queue.empty(); });
 
-  if (!pending_broadcast.empty()) {
-    pfc_service_announcement service = services[pending_broadcast.front()];
-    pending_broadcast.pop();
+    while (changes.queue.try_pop(delta)) {
+      ++changes.processed;
+      //Serialized straight in to nanomsg memory which the publisher hands over without a copy
+      auto framed = topic_message(registry_topic(delta._protacol, delta._name), delta.Length());
+      {
+        message_ostream os(framed);
+        if (delta.serialize(os).is_not_ok()) {
+          continue;
+        }
+      }
+      watch_feed->broadcast([&framed]() { return std::move(framed); });
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+//! Snapshot server. Replies with every live service whose topic starts with the requested prefix
+//! and the sequence of the last change they reflect.
+//! The reply is serialized in to the request buffer, which nanomsg takes back when it is sent.
+message Registry::Implementation::process_snapshot_request(message buffer)
+{
+  pfc_registry_snapshot_request request;
+  pfc_registry_snapshot_response response;
+  std::vector<pfc_registry_delta> services;
+  bool parsed = false;
+  {
+    message_istream is(buffer);
+    parsed = request.deserialize(is).is_ok() && !is.fail();
+  }
+  if (parsed) {
+    std::lock_guard<std::mutex> guard(table_mutex);
+    response._sequence = sequence;
+    table.for_each([&](const Service_Key& key, const Registry_Entry& entry) {
+      if (entry.removed) {
+        return;
+      }
+      auto announcement = table.announcement(key, entry);
+      if (registry_topic(announcement._protacol, announcement._name).compare(0, request._topic.size(), request._topic) != 0) {
+        return;
+      }
+      pfc_registry_delta delta;
+      delta._sequence = sequence;
+      delta._change = registry_added;
+      delta._version = entry.version;
+      delta._port = announcement._port;
+      delta._protacol = announcement._protacol;
+      delta._name = std::move(announcement._name);
+      delta._address = std::move(announcement._address);
+      delta._brief = std::move(announcement._brief);
+      services.push_back(std::move(delta));
+    });
+  }
+  response._count = static_cast<pfc_uint>(services.size());
 
-    if (service.serialize(os).is_not_ok()) {
-      os.clear();
+  buffer.clear();
+  {
+    message_ostream os(buffer);
+    response.serialize(os);
+    for (auto& service : services) {
+      service.serialize(os);
+    }
+  }
+  return buffer;
+}
+//-----------------------------------------------------------------------------
+//! Rendezvous hashing over this registry and every live peer.
+//! \return bool -- true when this registry is responsible for rebroadcasting the key
+bool Registry::Implementation::owns(pfc_uint key_hash)
+{
+  std::lock_guard<std::mutex> guard(replication_mutex);
+  auto best = fnv1a(&registry_id, sizeof(registry_id), key_hash);
+  for (auto& peer : peers) {
+    auto score = fnv1a(&peer.first, sizeof(peer.first), key_hash);
+    if (score > best || (score == best && peer.first > registry_id)) {
+      return false;
     }
   }
+  return true;
+}
+//-----------------------------------------------------------------------------
+//! \return pfc_registry_digest -- Current summary of the table
+pfc_registry_digest Registry::Implementation::make_digest()
+{
+  pfc_registry_digest digest;
+  digest._registry_id = registry_id;
+
+  std::lock_guard<std::mutex> guard(table_mutex);
+  digest._entry_count = static_cast<pfc_uint>(table.size());
+  digest._buckets = table.buckets();
+  digest._root = table.root();
+  return digest;
+}
+//-----------------------------------------------------------------------------
+//! Replication datagrams contain one or more messages back to back
+void Registry::Implementation::process_replication_message(std::istream& is)
+{
+  for (;;) {
+    switch (peek_message_type(is)) {
+    case REGISTRY_DIGEST_REQUEST: {
+      pfc_registry_digest message;
+      if (message.deserialize(is).is_not_ok() || is.fail()) {
+        return;
+      }
+      handle_digest(message);
+    } break;
+    case REGISTRY_SYNC_REQUEST: {
+      pfc_registry_sync_request message;
+      if (message.deserialize(is).is_not_ok() || is.fail()) {
+        return;
+      }
+      handle_sync_request(message);
+    } break;
+    case REGISTRY_SYNC_RESPONSE: {
+      pfc_registry_sync_response message;
+      if (message.deserialize(is).is_not_ok() || is.fail()) {
+        return;
+      }
+      handle_sync_response(message);
+    } break;
+    default:
+      return;
+    }
+  }
+}
+//-----------------------------------------------------------------------------
+//! Compares a peer digest against our own and asks for the entries of every bucket that differs
+void Registry::Implementation::handle_digest(const pfc_registry_digest& digest)
+{
+  if (digest._registry_id == registry_id) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> guard(replication_mutex);
+    peers[digest._registry_id] = std::chrono::steady_clock::now();
+  }
+
+  pfc_registry_sync_request request;
+  request._registry_id = registry_id;
+  request._target_id = digest._registry_id;
+  {
+    std::lock_guard<std::mutex> guard(table_mutex);
+    auto& buckets = table.buckets();
+    if (digest._buckets.size() != buckets.size() || digest._root == table.root()) {
+      return;
+    }
+    for (pfc_uint index = 0; index < buckets.size(); ++index) {
+      if (buckets[index] != digest._buckets[index]) {
+        request._buckets.push_back(index);
+      }
+    }
+  }
+  if (!request._buckets.empty()) {
+    queue_replication(request);
+  }
+}
+//-----------------------------------------------------------------------------
+//! Sends every entry which falls in to one of the requested buckets
+void Registry::Implementation::handle_sync_request(const pfc_registry_sync_request& request)
+{
+  if (request._target_id != registry_id) {
+    return;
+  }
+  std::vector<bool> requested(g_digest_bucket_count, false);
+  for (auto index : request._buckets) {
+    if (index < g_digest_bucket_count) {
+      requested[index] = true;
+    }
+  }
+
+  std::lock_guard<std::mutex> guard(table_mutex);
+  table.for_each([&](const Service_Key& key, const Registry_Entry& entry) {
+    if (!requested[key.hash % g_digest_bucket_count]) {
+      return;
+    }
+    auto announcement = table.announcement(key, entry);
+    pfc_registry_sync_response response;
+    response._registry_id = registry_id;
+    response._version = entry.version;
+    response._removed = entry.removed;
+    response._port = announcement._port;
+    response._protacol = announcement._protacol;
+    response._name = std::move(announcement._name);
+    response._address = std::move(announcement._address);
+    response._brief = std::move(announcement._brief);
+    queue_replication(response);
+  });
+}
+//-----------------------------------------------------------------------------
+//! Hands a replicated entry to the table stage. Entries that change the table are rebroadcast by their owner
+void Registry::Implementation::handle_sync_response(const pfc_registry_sync_response& response)
+{
+  if (response._registry_id == registry_id) {
+    return;
+  }
+  pfc_service_announcement announcement;
+  announcement._port = response._port;
+  announcement._protacol = response._protacol;
+  announcement._name = response._name;
+  announcement._address = response._address;
+  announcement._brief = response._brief;
+
+  Registry_Update update;
+  update.announcement = std::move(announcement);
+  update.version = response._version;
+  update.removed = response._removed;
+  enqueue(replica, table_signal, std::move(update));
+}
+//-----------------------------------------------------------------------------
+//! Serializes a message on to the replication queue and wakes the replication thread
+void Registry::Implementation::queue_replication(const pfc_message& message)
+{
+  std::ostringstream os;
+  if (message.serialize(os).is_ok()) {
+    std::lock_guard<std::mutex> guard(replication_mutex);
+    pending_replication.push_back(os.str());
+  }
+  replication_condition.notify_one();
+}
+//-----------------------------------------------------------------------------
+//! Replication thread. Sends our digest every g_digest_interval, expires silent peers
+//! and packs queued replication messages in to as few datagrams as possible.
+void Registry::Implementation::replicate()
+{
+  auto next_digest = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock(replication_mutex);
+  while (running) {
+    replication_condition.wait_until(lock, next_digest, [this]() { return !running || !pending_replication.empty(); });
+    if (!running) {
+      break;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now >= next_digest) {
+      for (auto peer = peers.begin(); peer != peers.end();) {
+        peer = (now - peer->second > g_peer_timeout) ? peers.erase(peer) : std::next(peer);
+      }
+      lock.unlock();
+      std::ostringstream os;
+      make_digest().serialize(os);
+      lock.lock();
+      pending_replication.push_front(os.str());
+      next_digest = now + g_digest_interval;
+    }
+
+    std::string datagram;
+    while (!pending_replication.empty()
+           && (datagram.empty() || datagram.size() + pending_replication.front().size() <= g_replication_datagram_size)) {
+      datagram += pending_replication.front();
+      pending_replication.pop_front();
+    }
+
+    lock.unlock();
+    replication_broadcaster.send([&datagram](std::ostream& os) { os.write(datagram.data(), datagram.size()); });
+    lock.lock();
+  }
 }
 //-----------------------------------------------------------------------------
 Registry::Registry(std::string bind_address, std::string multicast_address)
@@ -101,35 +648,102 @@ Registry::~Registry()
   _impl = nullptr;
 }
 //-----------------------------------------------------------------------------
+//! Pins each stage of the pipeline to a cpu. Must be called before start()
+//! \param receive_cpu [IN] -- cpu for the thread decoding inbound announcements or g_pfc_any_cpu
+//! \param table_cpu [IN] -- cpu for the thread updating the registry table or g_pfc_any_cpu
+//! \param broadcast_cpu [IN] -- cpu for the thread sending outbound announcements or g_pfc_any_cpu
+void Registry::thread_affinity(int receive_cpu, int table_cpu, int broadcast_cpu)
+{
+  _impl->receive_cpu = receive_cpu;
+  _impl->table_cpu = table_cpu;
+  _impl->broadcast_cpu = broadcast_cpu;
+}
+//-----------------------------------------------------------------------------
+//! Enables the watch feed and its snapshot server. Must be called before start()
+//! \param feed_endpoint [IN] -- PubSub endpoint deltas are published on ex tcp://*:30004. Empty disables the feed
+//! \param snapshot_endpoint [IN] -- ReqRep endpoint answering pfc_registry_snapshot_request. Empty disables snapshots
+void Registry::watch(std::string feed_endpoint, std::string snapshot_endpoint)
+{
+  if (!feed_endpoint.empty()) {
+    _impl->watch_feed = std::make_unique<PubSub_Publisher>(URI(feed_endpoint));
+  }
+  if (!snapshot_endpoint.empty()) {
+    _impl->snapshot_server = std::make_unique<ReqRep_Server>(URI(snapshot_endpoint));
+  }
+}
+//-----------------------------------------------------------------------------
 void Registry::start()
 {
   using namespace std::placeholders;
+  _impl->running = true;
+  _impl->table_thread = std::thread(&Implementation::update_table, _impl.get());
+  _impl->broadcast_thread = std::thread(&Implementation::broadcast_services, _impl.get());
+  if (_impl->watch_feed) {
+    _impl->watch_thread = std::thread(&Implementation::publish_changes, _impl.get());
+  }
+  if (_impl->snapshot_server) {
+    _impl->snapshot_server->async_listen([this](message request) { return _impl->process_snapshot_request(std::move(request)); });
+  }
+  _impl->replication_thread = std::thread(&Implementation::replicate, _impl.get());
   _impl->subscription_listiner.async_receive(std::bind(&Implementation::process_subscription_message, _impl.get(), _1));
+  _impl->replication_listiner.async_receive(std::bind(&Implementation::process_replication_message, _impl.get(), _1));
 }
+//-----------------------------------------------------------------------------
 void Registry::wait()
 {
   _impl->subscription_listiner.join();
   _impl->service_broadcaster.join();
+  _impl->replication_listiner.join();
+  for (auto thread : { &_impl->replication_thread, &_impl->table_thread, &_impl->broadcast_thread, &_impl->watch_thread }) {
+    if (thread->joinable()) {
+      thread->join();
+    }
+  }
 }
 //-----------------------------------------------------------------------------
 void Registry::shutdown()
 {
+  _impl->running = false;
+  _impl->replication_condition.notify_all();
+  _impl->table_signal.notify();
+  _impl->broadcast_signal.notify();
+  _impl->watch_signal.notify();
+  if (_impl->snapshot_server) {
+    _impl->snapshot_server->shutdown();
+  }
+
   _impl->subscription_listiner.stop();
   _impl->service_broadcaster.stop();
+  _impl->replication_listiner.stop();
+  _impl->replication_broadcaster.stop();
 
-  _impl->subscription_listiner.join();
-  _impl->service_broadcaster.join();
+  wait();
+}
+//-----------------------------------------------------------------------------
+//! \return std::vector<Queue_Metrics> -- Depth and throughput of every queue in the pipeline. Safe to call while running
+std::vector<Registry::Queue_Metrics> Registry::metrics() const
+{
+  return { _impl->ingest.metrics(), _impl->replica.metrics(), _impl->outbound.metrics(), _impl->changes.metrics() };
+}
+//-----------------------------------------------------------------------------
+//! \return Table_Metrics -- Size of the service table. Safe to call while running
+Registry::Table_Metrics Registry::table_metrics() const
+{
+  std::lock_guard<std::mutex> guard(_impl->table_mutex);
+  return { _impl->table.size(), _impl->table.tombstones(), _impl->table.string_count(), _impl->table.memory_usage(), _impl->sequence };
 }
 
 //-----------------------------------------------------------------------------
 bool Registry::is_valid()
 {
-  return _impl->subscription_listiner.is_valid() && _impl->service_broadcaster.is_valid();
+  return _impl->subscription_listiner.is_valid() && _impl->service_broadcaster.is_valid()
+    && _impl->replication_listiner.is_valid() && _impl->replication_broadcaster.is_valid();
 }
 //-----------------------------------------------------------------------------
 Error Registry::error()
 {
-  return _impl->subscription_listiner.error() | _impl->service_broadcaster.error();
+  return _impl->subscription_listiner.error() | _impl->service_broadcaster.error()
+    | _impl->replication_listiner.error() | _impl->replication_broadcaster.error();
 }
 //-----------------------------------------------------------------------------
 Registry& Registry::operator=(Registry&& obj)
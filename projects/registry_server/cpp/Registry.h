@@ -22,8 +22,10 @@ specific language governing permissions and limitations under the license.
 //!        Class meets the speficiation of the Sustain Framework
 //!
 
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <sustain/framework/Exports.h>
 #include <sustain/framework/util/Error.h>
@@ -32,15 +34,44 @@ specific language governing permissions and limitations under the license.
 namespace pfc {
 class Registry {
 public:
+  //!
+  //! Snapshot of one queue connecting two stages of the registry pipeline.
+  //! A queue which sits near capacity marks its consumer as the slowest stage.
+  //!
+  struct Queue_Metrics {
+    std::string name;       //!< producer->consumer stage names
+    size_t depth;           //!< Elements waiting when the snapshot was taken
+    size_t capacity;        //!< Maximum elements the queue holds before the producer drops
+    size_t high_water;      //!< Deepest the queue has been since start
+    uint64_t processed;     //!< Elements consumed by the downstream stage
+    uint64_t dropped;       //!< Elements discarded because the queue was full
+  };
+
+  //!
+  //! Snapshot of the service table footprint
+  //!
+  struct Table_Metrics {
+    size_t entries;         //!< Registered services including tombstones
+    size_t tombstones;      //!< Signed off services kept until every peer has seen the removal
+    size_t strings;         //!< Distinct interned names, addresses and briefs
+    size_t bytes;           //!< Memory allocated by the table and its string pool
+    uint32_t sequence;      //!< Sequence of the last change published on the watch feed
+  };
+
   Registry(std::string bind_address, std::string multicast_address);
   Registry(const Registry&) = delete;
   Registry(Registry&&);
   ~Registry();
 
+  void thread_affinity(int receive_cpu, int table_cpu, int broadcast_cpu);
+  void watch(std::string feed_endpoint, std::string snapshot_endpoint);
   void start();
   void wait();
   void shutdown();
 
+  std::vector<Queue_Metrics> metrics() const;
+  Table_Metrics table_metrics() const;
+
   bool is_valid();
   Error error();
 
@@ -0,0 +1,268 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include "Registry_Table.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <boost/asio/ip/address.hpp>
+
+namespace pfc {
+namespace {
+  //-----------------------------------------------------------------------------
+  //! Hash of the parts of an announcement which are not part of its key
+  pfc_uint content_hash_of(const pfc_service_announcement& announcement, bool removed)
+  {
+    auto hash = fnv1a(&announcement._protacol, sizeof(announcement._protacol));
+    hash = fnv1a(announcement._name, hash);
+    hash = fnv1a(announcement._brief, hash);
+    hash = fnv1a(announcement._endpoints, hash);
+    hash = fnv1a(announcement._host, hash);
+    hash = fnv1a(&announcement._process, sizeof(announcement._process), hash);
+    return fnv1a(&removed, sizeof(removed), hash);
+  }
+}
+//-----------------------------------------------------------------------------
+//!
+//! 32bit FNV-1a. Digests are compared between registries so this must be identical on every peer
+//!
+pfc_uint fnv1a(const void* data, size_t length, pfc_uint hash)
+{
+  auto bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < length; ++i) {
+    hash ^= bytes[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+//-----------------------------------------------------------------------------
+pfc_uint fnv1a(const std::string& value, pfc_uint hash)
+{
+  return fnv1a(value.data(), value.size(), hash);
+}
+//-----------------------------------------------------------------------------
+bool operator==(const Service_Key& lhs, const Service_Key& rhs)
+{
+  return lhs.hash == rhs.hash && lhs.port == rhs.port && lhs.kind == rhs.kind && lhs.address == rhs.address;
+}
+//-----------------------------------------------------------------------------
+//! \param bucket_count [IN] -- Number of digest buckets rows are spread across
+Registry_Table::Registry_Table(size_t bucket_count)
+  : _buckets(bucket_count, 0)
+{
+}
+//-----------------------------------------------------------------------------
+//! Packs address and port in to a key. Names which have never been interned get an
+//! id of npos which can not match any stored row
+Service_Key Registry_Table::key_of(const std::string& address, pfc_ushort port) const
+{
+  Service_Key key;
+  key.address.fill(0);
+  key.port = port;
+
+  boost::system::error_code ec;
+  auto ip = boost::asio::ip::make_address(address, ec);
+  if (!ec && ip.is_v4()) {
+    auto bytes = ip.to_v4().to_bytes();
+    std::copy(bytes.begin(), bytes.end(), key.address.begin());
+    key.kind = Service_Key::ip4;
+    key.hash = fnv1a(bytes.data(), bytes.size(), fnv1a(&port, sizeof(port)));
+  } else if (!ec) {
+    auto bytes = ip.to_v6().to_bytes();
+    std::copy(bytes.begin(), bytes.end(), key.address.begin());
+    key.kind = Service_Key::ip6;
+    key.hash = fnv1a(bytes.data(), bytes.size(), fnv1a(&port, sizeof(port)));
+  } else {
+    auto id = _strings.find(address);
+    std::memcpy(key.address.data(), &id, sizeof(id));
+    key.kind = Service_Key::name;
+    key.hash = fnv1a(address, fnv1a(&port, sizeof(port)));
+  }
+  return key;
+}
+//-----------------------------------------------------------------------------
+//! Merges an announcement in to the table
+//!
+//! \param announcement [IN] -- announced service details
+//! \param version [IN,OUT] -- Version of a replicated entry or 0 for announcements received directly from a service.
+//!                       Set to the version of the row when the table was modified.
+//!                       Local announcements bump the version only when the content changed.
+//!                       Replicated entries win when their version is higher, ties go to the higher content hash.
+//! \param removed [IN] -- true for a signoff. The row is kept as a tombstone until expire() drops it
+//! \param key_hash [OUT] -- Hash of the announcements key, used for ownership
+//! \return Table_Change -- How the row changed from the point of view of a client which ignores tombstones
+Table_Change Registry_Table::apply(const pfc_service_announcement& announcement, pfc_uint& version, bool removed, pfc_uint& key_hash)
+{
+  auto key = key_of(announcement._address, announcement._port);
+  key_hash = key.hash;
+  auto content_hash = content_hash_of(announcement, removed);
+  auto& bucket = _buckets[key.hash % _buckets.size()];
+
+  auto change = Table_Change::added;
+  auto entry = _entries.find(key);
+  if (entry) {
+    if (version == 0) {
+      if (entry->content_hash == content_hash || (removed && entry->removed)) {
+        return Table_Change::unchanged;
+      }
+      version = entry->version + 1;
+    } else if (version < entry->version || (version == entry->version && content_hash <= entry->content_hash)) {
+      return Table_Change::unchanged;
+    }
+    if (removed) {
+      change = (entry->removed) ? Table_Change::unchanged : Table_Change::removed;
+    } else {
+      change = (entry->removed) ? Table_Change::added : Table_Change::updated;
+    }
+    bucket ^= entry->digest;
+
+    //Intern the new strings before releasing the old ones so unchanged strings are never dropped
+    auto name = _strings.intern(announcement._name);
+    auto brief = _strings.intern(announcement._brief);
+    auto endpoints = _strings.intern(announcement._endpoints);
+    auto host = _strings.intern(announcement._host);
+    _strings.release(entry->name);
+    _strings.release(entry->brief);
+    _strings.release(entry->endpoints);
+    _strings.release(entry->host);
+    entry->name = name;
+    entry->brief = brief;
+    entry->endpoints = endpoints;
+    entry->host = host;
+  } else {
+    if (removed) {
+      //Nothing to remove. Accepting it would only leave a tombstone for a service we never knew
+      return Table_Change::unchanged;
+    }
+    if (version == 0) {
+      version = 1;
+    }
+    //IP addresses are recovered from the key, only names need a copy of their text
+    auto address = String_Pool::npos;
+    if (key.kind == Service_Key::name) {
+      address = _strings.intern(announcement._address);
+      std::memcpy(key.address.data(), &address, sizeof(address));
+    }
+    entry = _entries.emplace(key).first;
+    entry->address = address;
+    entry->name = _strings.intern(announcement._name);
+    entry->brief = _strings.intern(announcement._brief);
+    entry->endpoints = _strings.intern(announcement._endpoints);
+    entry->host = _strings.intern(announcement._host);
+  }
+
+  entry->protocol = announcement._protacol;
+  entry->process = announcement._process;
+  entry->version = version;
+  entry->content_hash = content_hash;
+  entry->removed = removed;
+  entry->digest = fnv1a(&version, sizeof(version), fnv1a(&content_hash, sizeof(content_hash), key.hash));
+  bucket ^= entry->digest;
+  if (removed) {
+    _tombstones.push_back({ std::chrono::steady_clock::now(), key, version });
+  }
+  return change;
+}
+//-----------------------------------------------------------------------------
+//! Drops tombstones which have been in the table since before cutoff.
+//! \param cutoff [IN] -- Tombstones created before this point are removed
+//! \return size_t -- Number of rows dropped
+size_t Registry_Table::expire(std::chrono::steady_clock::time_point cutoff)
+{
+  size_t expired = 0;
+  while (!_tombstones.empty() && _tombstones.front().time < cutoff) {
+    auto& tombstone = _tombstones.front();
+    auto entry = _entries.find(tombstone.key);
+    if (entry && entry->removed && entry->version == tombstone.version) {
+      _buckets[tombstone.key.hash % _buckets.size()] ^= entry->digest;
+      _strings.release(entry->name);
+      _strings.release(entry->brief);
+      _strings.release(entry->endpoints);
+      _strings.release(entry->host);
+      if (entry->address != String_Pool::npos) {
+        _strings.release(entry->address);
+      }
+      _entries.erase(tombstone.key);
+      ++expired;
+    }
+    _tombstones.pop_front();
+  }
+  return expired;
+}
+//-----------------------------------------------------------------------------
+//! \return pfc_service_announcement -- Inflated copy of a row. IP addresses are returned in their canonical text form
+pfc_service_announcement Registry_Table::announcement(const Service_Key& key, const Registry_Entry& entry) const
+{
+  pfc_service_announcement result;
+  result._port = key.port;
+  result._protacol = entry.protocol;
+  result._name = _strings.str(entry.name);
+  result._brief = _strings.str(entry.brief);
+  result._endpoints = _strings.str(entry.endpoints);
+  result._host = _strings.str(entry.host);
+  result._process = entry.process;
+  switch (key.kind) {
+  case Service_Key::ip4: {
+    boost::asio::ip::address_v4::bytes_type bytes;
+    std::copy(key.address.begin(), key.address.begin() + bytes.size(), bytes.begin());
+    result._address = boost::asio::ip::address_v4(bytes).to_string();
+  } break;
+  case Service_Key::ip6: {
+    boost::asio::ip::address_v6::bytes_type bytes;
+    std::copy(key.address.begin(), key.address.end(), bytes.begin());
+    result._address = boost::asio::ip::address_v6(bytes).to_string();
+  } break;
+  default:
+    result._address = _strings.str(entry.address);
+  }
+  return result;
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Number of rows
+size_t Registry_Table::size() const
+{
+  return _entries.size();
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Number of rows which are tombstones awaiting expiry
+size_t Registry_Table::tombstones() const
+{
+  size_t count = 0;
+  _entries.for_each([&count](const Service_Key&, const Registry_Entry& entry) { count += entry.removed; });
+  return count;
+}
+//-----------------------------------------------------------------------------
+//! \return const std::vector<pfc_uint>& -- XOR of the digests of every row in each bucket
+const std::vector<pfc_uint>& Registry_Table::buckets() const
+{
+  return _buckets;
+}
+//-----------------------------------------------------------------------------
+//! \return pfc_uint -- Hash of every bucket. Equal roots mean equal tables
+pfc_uint Registry_Table::root() const
+{
+  return fnv1a(_buckets.data(), _buckets.size() * sizeof(pfc_uint));
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Number of distinct interned strings
+size_t Registry_Table::string_count() const
+{
+  return _strings.count();
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Bytes allocated by the rows, the string pool and the digest
+size_t Registry_Table::memory_usage() const
+{
+  return _entries.memory_usage() + _strings.memory_usage() + _buckets.capacity() * sizeof(pfc_uint);
+}
+} //namespace pfc
@@ -0,0 +1,135 @@
+#ifndef SUSTAIN_REGISTRY_TABLE_H
+#define SUSTAIN_REGISTRY_TABLE_H
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+//!
+//! \brief Compact storage for the rows of the service registry
+//!
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <sustain/framework/Protocol.h>
+
+#include "Flat_Map.h"
+#include "String_Pool.h"
+
+namespace pfc {
+
+pfc_uint fnv1a(const void* data, size_t length, pfc_uint hash = 2166136261u);
+pfc_uint fnv1a(const std::string& value, pfc_uint hash = 2166136261u);
+
+//!
+//! Fixed size key of a registry row. IP addresses are stored packed in network order,
+//! anything else (host names, socket paths) is interned and referenced by id.
+//! hash only depends on the announced address and port so it is identical on every registry
+//! and can be used for digest buckets and ownership.
+//!
+struct Service_Key {
+  enum Kind : uint8_t { ip4,
+                        ip6,
+                        name };
+
+  std::array<uint8_t, 16> address; //!< Address bytes or the String_Pool::Id of the name in the first four bytes
+  pfc_ushort port;
+  Kind kind;
+  pfc_uint hash;
+};
+bool operator==(const Service_Key&, const Service_Key&);
+
+//! Service_Key caches its hash so Flat_Map never rehashes the address
+struct Service_Key_Hash {
+  size_t operator()(const Service_Key& key) const { return key.hash; }
+};
+
+//!
+//! Single row of the registry table.
+//! version increases every time the announced content of a key changes and is used to
+//! resolve conflicts between registries. digest is the contribution of the row to its digest bucket.
+//! removed rows are tombstones left by a signoff. They replicate like any other version of the row
+//! so a signoff is not undone by a peer which still holds the live row, and are expired after a grace period.
+//!
+struct Registry_Entry {
+  String_Pool::Id name = String_Pool::npos;
+  String_Pool::Id address = String_Pool::npos; //!< Only set for Service_Key::name keys
+  String_Pool::Id brief = String_Pool::npos;
+  String_Pool::Id endpoints = String_Pool::npos; //!< Co-located endpoints, see pfc_service_announcement::_endpoints
+  String_Pool::Id host = String_Pool::npos;
+  pfc_uint process = 0;
+  pfc_uint version = 0;
+  pfc_uint content_hash = 0;
+  pfc_uint digest = 0;
+  pfc_protocol protocol = pfc_protocol::pub_sub;
+  bool removed = false;
+};
+
+//!
+//! Effect of Registry_Table::apply as seen by a client watching the table
+//!
+enum class Table_Change : uint8_t { unchanged,
+                                    added,
+                                    updated,
+                                    removed };
+
+//!
+//!  Service table of a registry along with its anti-entropy digest buckets.
+//!  Each row is a fixed size key and entry held inline in a Flat_Map. Names, addresses
+//!  and briefs are shared through a String_Pool since most deployments repeat them heavily.
+//!
+//!  Not thread safe. The registry guards the table with its table lock.
+//!
+class Registry_Table {
+public:
+  explicit Registry_Table(size_t bucket_count);
+  Registry_Table(const Registry_Table&) = delete;
+  Registry_Table& operator=(const Registry_Table&) = delete;
+
+  Table_Change apply(const pfc_service_announcement&, pfc_uint& version, bool removed, pfc_uint& key_hash);
+  size_t expire(std::chrono::steady_clock::time_point cutoff);
+  pfc_service_announcement announcement(const Service_Key&, const Registry_Entry&) const;
+
+  //! \param function [IN] -- Called as function(const Service_Key&, const Registry_Entry&) for every row
+  template <typename Function>
+  void for_each(Function function) const { _entries.for_each(function); }
+
+  size_t size() const;
+  size_t tombstones() const;
+  const std::vector<pfc_uint>& buckets() const;
+  pfc_uint root() const;
+
+  size_t string_count() const;
+  size_t memory_usage() const;
+
+private:
+  //! Removal awaiting expiry. Ignored if the row has been revived or replaced since
+  struct Tombstone {
+    std::chrono::steady_clock::time_point time;
+    Service_Key key;
+    pfc_uint version;
+  };
+
+  Service_Key key_of(const std::string& address, pfc_ushort port) const;
+
+  String_Pool _strings;
+  Flat_Map<Service_Key, Registry_Entry, Service_Key_Hash> _entries;
+  std::vector<pfc_uint> _buckets;
+  std::deque<Tombstone> _tombstones; //!< Oldest first
+};
+} //namespace pfc
+
+#endif //SUSTAIN_REGISTRY_TABLE_H
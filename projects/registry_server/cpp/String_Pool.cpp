@@ -0,0 +1,196 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include "String_Pool.h"
+
+#include <cstring>
+
+namespace pfc {
+namespace {
+  constexpr size_t g_minimum_compact_size = 64 * 1024; //!< Arenas smaller than this are never compacted
+
+  uint32_t hash_of(const char* data, size_t length)
+  {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+      hash ^= static_cast<unsigned char>(data[i]);
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+}
+constexpr String_Pool::Id String_Pool::npos;
+constexpr String_Pool::Id String_Pool::empty;
+constexpr String_Pool::Id String_Pool::tombstone;
+//-----------------------------------------------------------------------------
+String_Pool::String_Pool()
+  : _index(64, empty)
+  , _index_used(0)
+  , _dead_bytes(0)
+{
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Slot of _index holding the string or the first empty slot of its chain
+size_t String_Pool::probe(const char* data, size_t length, uint32_t hash) const
+{
+  auto mask = _index.size() - 1;
+  auto index = hash & mask;
+  while (_index[index] != empty) {
+    auto id = _index[index];
+    if (id != tombstone) {
+      auto& slice = _slices[id];
+      if (slice.hash == hash && slice.length == length && std::memcmp(_arena.data() + slice.offset, data, length) == 0) {
+        return index;
+      }
+    }
+    index = (index + 1) & mask;
+  }
+  return index;
+}
+//-----------------------------------------------------------------------------
+//! Adds a reference to value, storing it in the arena if this is the first
+//! \return Id -- Handle which must be released once the caller no longer needs it
+String_Pool::Id String_Pool::intern(const std::string& value)
+{
+  auto hash = hash_of(value.data(), value.size());
+  auto index = probe(value.data(), value.size(), hash);
+  if (_index[index] != empty) {
+    ++_slices[_index[index]].references;
+    return _index[index];
+  }
+
+  if ((_index_used + 1) * 4 > _index.size() * 3) {
+    rehash();
+  }
+
+  Slice slice { static_cast<uint32_t>(_arena.size()), static_cast<uint32_t>(value.size()), hash, 1 };
+  _arena.insert(_arena.end(), value.begin(), value.end());
+
+  Id id;
+  if (_free.empty()) {
+    id = static_cast<Id>(_slices.size());
+    _slices.push_back(slice);
+  } else {
+    id = _free.back();
+    _free.pop_back();
+    _slices[id] = slice;
+  }
+
+  //Tombstones are skipped by probe so the first empty slot is where the chain ends
+  index = probe(value.data(), value.size(), hash);
+  _index[index] = id;
+  ++_index_used;
+  return id;
+}
+//-----------------------------------------------------------------------------
+//! \return Id -- Id of an interned copy of value or npos. Does not add a reference
+String_Pool::Id String_Pool::find(const std::string& value) const
+{
+  auto hash = hash_of(value.data(), value.size());
+  auto id = _index[probe(value.data(), value.size(), hash)];
+  return (id == empty) ? npos : id;
+}
+//-----------------------------------------------------------------------------
+//! Adds a reference to an id which is already held
+void String_Pool::retain(Id id)
+{
+  ++_slices[id].references;
+}
+//-----------------------------------------------------------------------------
+//! Drops a reference. The string is forgotten when the last reference is released
+void String_Pool::release(Id id)
+{
+  auto& slice = _slices[id];
+  if (--slice.references != 0) {
+    return;
+  }
+  auto mask = _index.size() - 1;
+  auto index = slice.hash & mask;
+  while (_index[index] != id) {
+    index = (index + 1) & mask;
+  }
+  _index[index] = tombstone;
+  _free.push_back(id);
+  _dead_bytes += slice.length;
+
+  if (_dead_bytes > g_minimum_compact_size && _dead_bytes * 2 > _arena.size()) {
+    compact();
+  }
+}
+//-----------------------------------------------------------------------------
+//! \return std::string -- Copy of the interned string
+std::string String_Pool::str(Id id) const
+{
+  auto& slice = _slices[id];
+  return std::string(_arena.data() + slice.offset, slice.length);
+}
+//-----------------------------------------------------------------------------
+//! \return bool -- true when id refers to a string equal to value
+bool String_Pool::equals(Id id, const std::string& value) const
+{
+  auto& slice = _slices[id];
+  return slice.length == value.size() && std::memcmp(_arena.data() + slice.offset, value.data(), value.size()) == 0;
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Number of distinct strings currently interned
+size_t String_Pool::count() const
+{
+  return _slices.size() - _free.size();
+}
+//-----------------------------------------------------------------------------
+//! \return size_t -- Bytes allocated by the pool
+size_t String_Pool::memory_usage() const
+{
+  return _arena.capacity() + _slices.capacity() * sizeof(Slice) + _index.capacity() * sizeof(Id) + _free.capacity() * sizeof(Id);
+}
+//-----------------------------------------------------------------------------
+//! Rebuilds the index dropping tombstones and sizing it so live strings fill at most half of it
+void String_Pool::rehash()
+{
+  size_t size = 64;
+  while ((count() + 1) * 2 > size) {
+    size *= 2;
+  }
+  _index.assign(size, empty);
+  _index_used = 0;
+  auto mask = size - 1;
+  for (Id id = 0; id < _slices.size(); ++id) {
+    if (_slices[id].references == 0) {
+      continue;
+    }
+    auto index = _slices[id].hash & mask;
+    while (_index[index] != empty) {
+      index = (index + 1) & mask;
+    }
+    _index[index] = id;
+    ++_index_used;
+  }
+}
+//-----------------------------------------------------------------------------
+//! Copies live strings in to a new arena. Ids are unchanged, only their offsets move
+void String_Pool::compact()
+{
+  std::vector<char> arena;
+  arena.reserve(_arena.size() - _dead_bytes);
+  for (auto& slice : _slices) {
+    if (slice.references == 0) {
+      continue;
+    }
+    auto offset = static_cast<uint32_t>(arena.size());
+    arena.insert(arena.end(), _arena.begin() + slice.offset, _arena.begin() + slice.offset + slice.length);
+    slice.offset = offset;
+  }
+  _arena.swap(arena);
+  _dead_bytes = 0;
+  rehash();
+}
+} //namespace pfc
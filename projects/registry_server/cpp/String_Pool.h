@@ -0,0 +1,76 @@
+#ifndef SUSTAIN_REGISTRY_STRING_POOL_H
+#define SUSTAIN_REGISTRY_STRING_POOL_H
+
+/**************************************************************************************
+copyright 2019 applied research associates, inc.
+licensed under the apache license, version 2.0 (the "license"); you may not use
+this file except in compliance with the license. you may obtain a copy of the license
+at:
+http://www.apache.org/licenses/license-2.0
+unless required by applicable law or agreed to in writing, software distributed under
+the license is distributed on an "as is" basis, without warranties or
+conditions of any kind, either express or implied. see the license for the
+specific language governing permissions and limitations under the license.
+**************************************************************************************/
+
+//!
+//! \brief Reference counted string interning for the registry table
+//!
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pfc {
+
+//!
+//!  Stores each distinct string once in a contiguous arena and hands out 32bit ids.
+//!  Ids are stable for as long as they are referenced. When the bytes of released strings
+//!  make up more than half of the arena the live strings are packed in to a new arena;
+//!  only offsets change so outstanding ids remain valid.
+//!
+//!  Not thread safe. The registry only touches its pool while holding the table lock.
+//!
+class String_Pool {
+public:
+  using Id = uint32_t;
+  static constexpr Id npos = 0xFFFFFFFF; //!< Returned by find when the string is not interned
+
+  String_Pool();
+
+  Id intern(const std::string&);
+  Id find(const std::string&) const;
+  void retain(Id);
+  void release(Id);
+
+  std::string str(Id) const;
+  bool equals(Id, const std::string&) const;
+
+  size_t count() const;
+  size_t memory_usage() const;
+
+private:
+  static constexpr Id empty = npos;
+  static constexpr Id tombstone = npos - 1;
+
+  struct Slice {
+    uint32_t offset;
+    uint32_t length;
+    uint32_t hash;
+    uint32_t references;
+  };
+
+  size_t probe(const char*, size_t, uint32_t) const;
+  void rehash();
+  void compact();
+
+  std::vector<char> _arena;   //!< Bytes of every interned string back to back
+  std::vector<Slice> _slices; //!< Indexed by Id
+  std::vector<Id> _free;      //!< Ids whose references dropped to zero
+  std::vector<Id> _index;     //!< Open addressing table of Ids keyed by string hash
+  size_t _index_used;         //!< Slots of _index which are not empty, including tombstones
+  size_t _dead_bytes;         //!< Bytes of _arena held by released strings
+};
+} //namespace pfc
+
+#endif //SUSTAIN_REGISTRY_STRING_POOL_H
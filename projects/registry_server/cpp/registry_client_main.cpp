@@ -10,13 +10,18 @@ conditions of any kind, either express or implied. see the license for the
 specific language governing permissions and limitations under the license.
 **************************************************************************************/
 
+#include <chrono>
+#include <functional>
 #include <iostream>
 #include <thread>
 
 #include "Registry.h"
 
+#include <sustain/framework/util/Thread_Affinity.h>
+
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/signal_set.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/log/trivial.hpp>
 #include <boost/program_options.hpp>
 
@@ -26,7 +31,13 @@ int main(int argc, const char* argv[])
   bpo::options_description options("Allowed options");
   options.add_options()("help,h", "Produce help message") //
     ("bind,b", bpo::value<std::string>()->default_value("0::0"), "Server port bind address") //
-    ("multicast,m", bpo::value<std::string>()->default_value("ff31::8000:1234"), "Server multicast broadcast address");
+    ("multicast,m", bpo::value<std::string>()->default_value("ff31::8000:1234"), "Server multicast broadcast address") //
+    ("receive-cpu", bpo::value<int>()->default_value(pfc::g_pfc_any_cpu), "Pin the receive stage to a cpu") //
+    ("table-cpu", bpo::value<int>()->default_value(pfc::g_pfc_any_cpu), "Pin the table stage to a cpu") //
+    ("broadcast-cpu", bpo::value<int>()->default_value(pfc::g_pfc_any_cpu), "Pin the broadcast stage to a cpu") //
+    ("watch,w", bpo::value<std::string>()->default_value("tcp://*:" + std::to_string(pfc::g_pfc_registry_watch_port)), "PubSub endpoint for the change feed. Empty disables") //
+    ("snapshot", bpo::value<std::string>()->default_value("tcp://*:" + std::to_string(pfc::g_pfc_registry_snapshot_port)), "ReqRep endpoint for change feed snapshots. Empty disables") //
+    ("stats,s", bpo::value<int>()->default_value(0), "Log pipeline queue metrics every N seconds. 0 disables");
 
   bpo::variables_map vm;
   bpo::store(bpo::parse_command_line(argc, argv, options), vm);
@@ -51,17 +62,42 @@ int main(int argc, const char* argv[])
   signals.add(SIGINT);
   signals.add(SIGTERM);
 #if defined(SIGQUIT)
-  signals_.add(SIGQUIT);
+  signals.add(SIGQUIT);
 #endif
+  boost::asio::steady_timer stats_timer(context);
+  auto stats_interval = std::chrono::seconds(vm["stats"].as<int>());
+  std::function<void(const boost::system::error_code&)> log_stats = [&](const boost::system::error_code& ec) {
+    if (ec) {
+      return;
+    }
+    for (auto& queue : reg->metrics()) {
+      BOOST_LOG_TRIVIAL(info) << queue.name << " depth=" << queue.depth << "/" << queue.capacity
+                              << " high_water=" << queue.high_water << " processed=" << queue.processed
+                              << " dropped=" << queue.dropped;
+    }
+    auto table = reg->table_metrics();
+    BOOST_LOG_TRIVIAL(info) << "table entries=" << table.entries << " tombstones=" << table.tombstones << " strings=" << table.strings
+                            << " bytes=" << table.bytes << " sequence=" << table.sequence;
+    stats_timer.expires_after(stats_interval);
+    stats_timer.async_wait(log_stats);
+  };
+
   signals.async_wait([&](const boost::system::error_code& /*ec*/, int /*no*/) {
     BOOST_LOG_TRIVIAL(info) << "Stopping PFC Registry\n";
+    stats_timer.cancel();
     reg->shutdown();
   });
 
   // Start an asynchronous wait for one of the signals to occur.
   if (reg) {
     BOOST_LOG_TRIVIAL(info) << "Starting PFC Registry on " << vm["bind"].as<std::string>() << " broadcasting on " << vm["multicast"].as<std::string>() << "\n";
+    reg->thread_affinity(vm["receive-cpu"].as<int>(), vm["table-cpu"].as<int>(), vm["broadcast-cpu"].as<int>());
+    reg->watch(vm["watch"].as<std::string>(), vm["snapshot"].as<std::string>());
     reg->start();
+    if (stats_interval.count() > 0) {
+      stats_timer.expires_after(stats_interval);
+      stats_timer.async_wait(log_stats);
+    }
   } else {
     BOOST_LOG_TRIVIAL(error) << "PFC Registry failed to start\n";
   }
@@ -0,0 +1,101 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include "Flat_Map.h"
+
+#include <map>
+#include <random>
+
+#include <gtest/gtest.h>
+
+#ifdef DISABLE_SUSTAIN_Flat_Map_TEST
+#define TEST_FIXTURE_NAME DISABLED_Flat_Map_Fixture
+#else
+#define TEST_FIXTURE_NAME Flat_Map_Fixture
+#endif
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+namespace {
+//! Sends every key to one of a few slots so probe chains are long and overlap
+struct Clustered_Hash {
+  size_t operator()(int key) const { return (key % 3 == 0) ? 63 : static_cast<size_t>(key % 5); }
+};
+}
+
+TEST_F(TEST_FIXTURE_NAME, backward_shift_erase)
+{
+  using namespace pfc;
+
+  //16 elements index 64 slots, so the chain homed on 63 wraps past 0 in to the chains homed on 0..4
+  Flat_Map<int, int, Clustered_Hash> map(16);
+  for (int key = 0; key < 12; ++key) {
+    *map.emplace(key).first = key * 10;
+  }
+  ASSERT_EQ(12u, map.size());
+
+  for (int key : { 3, 0, 7, 11 }) {
+    EXPECT_TRUE(map.erase(key));
+    EXPECT_FALSE(map.erase(key));
+    EXPECT_EQ(nullptr, map.find(key));
+  }
+  EXPECT_EQ(8u, map.size());
+  for (int key : { 1, 2, 4, 5, 6, 8, 9, 10 }) {
+    auto value = map.find(key);
+    ASSERT_NE(nullptr, value) << key;
+    EXPECT_EQ(key * 10, *value);
+  }
+
+  auto inserted = map.emplace(3);
+  EXPECT_TRUE(inserted.second);
+  EXPECT_EQ(0, *inserted.first);
+  EXPECT_FALSE(map.emplace(4).second);
+}
+
+TEST_F(TEST_FIXTURE_NAME, matches_std_map)
+{
+  using namespace pfc;
+
+  Flat_Map<int, int, Clustered_Hash> map;
+  std::map<int, int> expected;
+  std::mt19937 random(7);
+  for (int step = 0; step < 20000; ++step) {
+    int key = static_cast<int>(random() % 200);
+    if (random() % 3) {
+      *map.emplace(key).first = step;
+      expected[key] = step;
+    } else {
+      EXPECT_EQ(expected.erase(key) == 1, map.erase(key));
+    }
+  }
+  ASSERT_EQ(expected.size(), map.size());
+  for (int key = 0; key < 200; ++key) {
+    auto value = map.find(key);
+    auto it = expected.find(key);
+    if (it == expected.end()) {
+      EXPECT_EQ(nullptr, value) << key;
+    } else {
+      ASSERT_NE(nullptr, value) << key;
+      EXPECT_EQ(it->second, *value);
+    }
+  }
+  size_t visited = 0;
+  map.for_each([&](const int& key, const int& value) {
+    EXPECT_EQ(expected[key], value);
+    ++visited;
+  });
+  EXPECT_EQ(expected.size(), visited);
+}
@@ -0,0 +1,101 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include "String_Pool.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#ifdef DISABLE_SUSTAIN_String_Pool_TEST
+#define TEST_FIXTURE_NAME DISABLED_String_Pool_Fixture
+#else
+#define TEST_FIXTURE_NAME String_Pool_Fixture
+#endif
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+TEST_F(TEST_FIXTURE_NAME, reference_counting)
+{
+  using namespace pfc;
+
+  String_Pool pool;
+  auto vitals = pool.intern("vitals");
+  EXPECT_EQ(vitals, pool.intern("vitals"));
+  pool.retain(vitals);
+  auto lungs = pool.intern("lungs");
+  EXPECT_NE(vitals, lungs);
+  EXPECT_EQ(2u, pool.count());
+  EXPECT_EQ("vitals", pool.str(vitals));
+  EXPECT_TRUE(pool.equals(lungs, "lungs"));
+  EXPECT_FALSE(pool.equals(lungs, "lung"));
+
+  pool.release(vitals);
+  pool.release(vitals);
+  EXPECT_EQ(vitals, pool.find("vitals"));
+  pool.release(vitals);
+  EXPECT_EQ(String_Pool::npos, pool.find("vitals"));
+  EXPECT_EQ(1u, pool.count());
+
+  //Released ids are handed out again
+  EXPECT_EQ(vitals, pool.intern("heart"));
+  EXPECT_EQ(lungs, pool.find("lungs"));
+}
+
+TEST_F(TEST_FIXTURE_NAME, empty_string)
+{
+  using namespace pfc;
+
+  String_Pool pool;
+  auto before = pool.intern("brief");
+  auto empty = pool.intern("");
+  EXPECT_EQ(empty, pool.intern(""));
+  EXPECT_EQ(empty, pool.find(""));
+  EXPECT_NE(before, empty);
+  EXPECT_TRUE(pool.equals(empty, ""));
+  EXPECT_EQ("", pool.str(empty));
+  pool.release(empty);
+  pool.release(empty);
+  EXPECT_EQ(String_Pool::npos, pool.find(""));
+}
+
+TEST_F(TEST_FIXTURE_NAME, compaction)
+{
+  using namespace pfc;
+
+  String_Pool pool;
+  std::vector<String_Pool::Id> ids;
+  for (int i = 0; i < 400; ++i) {
+    ids.push_back(pool.intern(std::to_string(i) + std::string(1000, 'x')));
+  }
+  auto grown = pool.memory_usage();
+
+  //Releasing all but every tenth string leaves most of the arena dead and triggers a compaction
+  for (int i = 0; i < 400; ++i) {
+    if (i % 10) {
+      pool.release(ids[i]);
+    }
+  }
+  EXPECT_EQ(40u, pool.count());
+  EXPECT_LT(pool.memory_usage(), grown / 2);
+  for (int i = 0; i < 400; i += 10) {
+    auto value = std::to_string(i) + std::string(1000, 'x');
+    EXPECT_EQ(value, pool.str(ids[i]));
+    EXPECT_EQ(ids[i], pool.find(value));
+  }
+  EXPECT_EQ(String_Pool::npos, pool.find(std::to_string(1) + std::string(1000, 'x')));
+}
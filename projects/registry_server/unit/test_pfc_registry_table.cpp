@@ -0,0 +1,220 @@
+/**************************************************************************************
+Copyright 2019 Applied Research Associates, Inc.
+Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+this file except in compliance with the License. You may obtain a copy of the License
+at:
+http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software distributed under
+the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+CONDITIONS OF ANY KIND, either express or implied. See the License for the
+specific language governing permissions and limitations under the License.
+**************************************************************************************/
+
+#include "Registry_Table.h"
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#ifdef DISABLE_SUSTAIN_Registry_Table_TEST
+#define TEST_FIXTURE_NAME DISABLED_Registry_Table_Fixture
+#else
+#define TEST_FIXTURE_NAME Registry_Table_Fixture
+#endif
+
+class TEST_FIXTURE_NAME : public ::testing::Test {
+protected:
+  TEST_FIXTURE_NAME() = default;
+  virtual ~TEST_FIXTURE_NAME() = default;
+};
+
+namespace {
+pfc::pfc_service_announcement service(std::string address, pfc::pfc_ushort port, std::string brief = "")
+{
+  pfc::pfc_service_announcement announcement;
+  announcement._name = "vitals";
+  announcement._address = std::move(address);
+  announcement._port = port;
+  announcement._brief = std::move(brief);
+  return announcement;
+}
+//! One anti-entropy round as the registries run it: to compares the digest of from with its own
+//! and from sends every row of the differing buckets with its version
+//! \return size_t -- Rows sent
+size_t sync(const pfc::Registry_Table& from, pfc::Registry_Table& to)
+{
+  using namespace pfc;
+  auto& theirs = from.buckets();
+  auto& ours = to.buckets();
+  if (from.root() == to.root()) {
+    return 0;
+  }
+  std::vector<std::pair<pfc_service_announcement, Registry_Entry>> rows;
+  from.for_each([&](const Service_Key& key, const Registry_Entry& entry) {
+    auto bucket = key.hash % theirs.size();
+    if (theirs[bucket] != ours[bucket]) {
+      rows.emplace_back(from.announcement(key, entry), entry);
+    }
+  });
+  for (auto& row : rows) {
+    pfc_uint version = row.second.version;
+    pfc_uint key_hash = 0;
+    to.apply(row.first, version, row.second.removed, key_hash);
+  }
+  return rows.size();
+}
+}
+
+TEST_F(TEST_FIXTURE_NAME, versions)
+{
+  using namespace pfc;
+
+  Registry_Table table(16);
+  pfc_uint version = 0;
+  pfc_uint key_hash = 0;
+  EXPECT_EQ(Table_Change::added, table.apply(service("10.0.0.1", 8080), version, false, key_hash));
+  EXPECT_EQ(1u, version);
+
+  //A repeated local announcement does not bump the version
+  version = 0;
+  EXPECT_EQ(Table_Change::unchanged, table.apply(service("10.0.0.1", 8080), version, false, key_hash));
+  version = 0;
+  EXPECT_EQ(Table_Change::updated, table.apply(service("10.0.0.1", 8080, "heart rate"), version, false, key_hash));
+  EXPECT_EQ(2u, version);
+
+  //Replicated rows only win with a newer version
+  version = 1;
+  EXPECT_EQ(Table_Change::unchanged, table.apply(service("10.0.0.1", 8080, "stale"), version, false, key_hash));
+  version = 5;
+  EXPECT_EQ(Table_Change::updated, table.apply(service("10.0.0.1", 8080, "replicated"), version, false, key_hash));
+
+  ASSERT_EQ(1u, table.size());
+  table.for_each([&](const Service_Key& key, const Registry_Entry& entry) {
+    EXPECT_EQ(5u, entry.version);
+    auto row = table.announcement(key, entry);
+    EXPECT_EQ("10.0.0.1", row._address);
+    EXPECT_EQ(8080, row._port);
+    EXPECT_EQ("replicated", row._brief);
+  });
+
+  //The digest only depends on content, not on the order rows arrived in
+  Registry_Table other(16);
+  version = 1;
+  other.apply(service("host.local", 9000), version, false, key_hash);
+  version = 5;
+  other.apply(service("10.0.0.1", 8080, "replicated"), version, false, key_hash);
+  version = 1;
+  table.apply(service("host.local", 9000), version, false, key_hash);
+  EXPECT_EQ(other.root(), table.root());
+}
+
+TEST_F(TEST_FIXTURE_NAME, tombstones)
+{
+  using namespace pfc;
+
+  Registry_Table table(16);
+  auto empty_root = table.root();
+  pfc_uint version = 0;
+  pfc_uint key_hash = 0;
+  table.apply(service("host.local", 9000), version, false, key_hash);
+  version = 0;
+  table.apply(service("10.0.0.2", 9001), version, false, key_hash);
+
+  version = 0;
+  EXPECT_EQ(Table_Change::removed, table.apply(service("host.local", 9000), version, true, key_hash));
+  EXPECT_EQ(2u, version);
+  version = 0;
+  EXPECT_EQ(Table_Change::unchanged, table.apply(service("host.local", 9000), version, true, key_hash));
+  EXPECT_EQ(2u, table.size());
+  EXPECT_EQ(1u, table.tombstones());
+
+  //A replica still holding the live row can not undo the signoff
+  version = 1;
+  EXPECT_EQ(Table_Change::unchanged, table.apply(service("host.local", 9000), version, false, key_hash));
+
+  //Signing off an unknown service leaves no tombstone
+  version = 0;
+  EXPECT_EQ(Table_Change::unchanged, table.apply(service("10.0.0.3", 9002), version, true, key_hash));
+
+  auto later = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  EXPECT_EQ(0u, table.expire(std::chrono::steady_clock::now() - std::chrono::seconds(1)));
+  EXPECT_EQ(1u, table.expire(later));
+  EXPECT_EQ(1u, table.size());
+  EXPECT_EQ(0u, table.tombstones());
+
+  //A tombstone revived before it expires is kept
+  version = 0;
+  table.apply(service("10.0.0.2", 9001), version, true, key_hash);
+  version = 0;
+  EXPECT_EQ(Table_Change::added, table.apply(service("10.0.0.2", 9001), version, false, key_hash));
+  EXPECT_EQ(0u, table.expire(later));
+  EXPECT_EQ(1u, table.size());
+
+  version = 0;
+  table.apply(service("10.0.0.2", 9001), version, true, key_hash);
+  EXPECT_EQ(1u, table.expire(later));
+  EXPECT_EQ(0u, table.size());
+  EXPECT_EQ(0u, table.string_count());
+  EXPECT_EQ(empty_root, table.root());
+}
+
+TEST_F(TEST_FIXTURE_NAME, anti_entropy)
+{
+  using namespace pfc;
+
+  Registry_Table first(16);
+  Registry_Table second(16);
+  pfc_uint version = 0;
+  pfc_uint key_hash = 0;
+  for (pfc_ushort port = 9000; port < 9040; ++port) {
+    version = 0;
+    first.apply(service("10.0.0.1", port), version, false, key_hash);
+    version = 1;
+    second.apply(service("10.0.0.1", port), version, false, key_hash);
+  }
+  ASSERT_EQ(first.root(), second.root());
+  EXPECT_EQ(0u, sync(first, second));
+
+  //Each side hears announcements the other missed, one row changes on both and one signs off
+  version = 0;
+  first.apply(service("10.0.0.2", 9100, "only first"), version, false, key_hash);
+  version = 0;
+  second.apply(service("host.local", 9200, "only second"), version, false, key_hash);
+  version = 0;
+  first.apply(service("10.0.0.1", 9001, "older"), version, false, key_hash);
+  version = 0;
+  second.apply(service("10.0.0.1", 9001, "newer"), version, false, key_hash);
+  version = 0;
+  second.apply(service("10.0.0.1", 9001, "newest"), version, false, key_hash);
+  version = 0;
+  first.apply(service("10.0.0.1", 9002), version, true, key_hash);
+  EXPECT_NE(first.root(), second.root());
+
+  //Only the differing buckets are exchanged, and one round each way converges
+  auto sent = sync(first, second) + sync(second, first);
+  EXPECT_GT(sent, 0u);
+  EXPECT_LT(sent, first.size() + second.size());
+  EXPECT_EQ(first.root(), second.root());
+  EXPECT_EQ(first.buckets(), second.buckets());
+  EXPECT_EQ(first.size(), second.size());
+  EXPECT_EQ(1u, second.tombstones());
+  EXPECT_EQ(0u, sync(first, second));
+
+  for (auto table : { &first, &second }) {
+    size_t live = 0;
+    table->for_each([&](const Service_Key& key, const Registry_Entry& entry) {
+      auto row = table->announcement(key, entry);
+      live += !entry.removed;
+      if (row._port == 9001) {
+        EXPECT_EQ("newest", row._brief);
+      }
+      if (row._port == 9002) {
+        EXPECT_TRUE(entry.removed);
+      }
+    });
+    EXPECT_EQ(41u, live);
+  }
+}